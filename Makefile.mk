@@ -1,6 +1,7 @@
 # コンパイラとフラグ
 CXX = g++
-CXXFLAGS = -std=c++11 -Wall -Wextra -pedantic # その他必要なコンパイラフラグを追加
+# -O2: 最適化なしでは制御ループのテーブル参照や ADC フィルタのベクトル演算 (adc_filter.cpp) が毎回メモリを経由する
+CXXFLAGS = -std=c++11 -Wall -Wextra -pedantic -O2 # その他必要なコンパイラフラグを追加
 
 # --- ディレクトリ定義 ---
 SRC_DIR = src
@@ -28,7 +29,7 @@ LDFLAGS = -L$(NAVIGATOR_LIB_PATH) \
 
 # --- リンクするライブラリ ---
 # コマンドで指定された特定のライブラリ名を使用
-LIBS = -lbluerobotics_navigator -lpthread -lm
+LIBS = -lbluerobotics_navigator -lpthread -lm -lrt # -lrt: shm_open (glibc 2.34 未満)
 LIBS += $(GSTREAMER_LIBS) # GStreamer のリンクライブラリを追加
 
 # --- ターゲット実行ファイル ---
@@ -54,6 +55,88 @@ $(TARGET): $(OBJS) | $(BIN_DIR) # リンク前に BIN_DIR が存在すること
 $(OBJ_DIR)/%.o: $(SRC_DIR)/%.cpp | $(OBJ_DIR) # コンパイル前に OBJ_DIR が存在することを確認
 	$(CXX) $(CXXFLAGS) $(INCLUDES) -c $< -o $@
 
+# --- ホスト上でのテストとベンチマーク ---
+# 実機の navigator-lib の代わりに tests/stub の bindings.h スタブをリンクし、
+# ハードウェアなしでモジュール単体のテストとホットパスのベンチマークを実行する。
+# GStreamer に依存する gstPipeline.cpp と main.cpp は対象外。
+TEST_DIR = tests
+BENCH_DIR = bench
+STUB_DIR = $(TEST_DIR)/stub
+TEST_OBJ_DIR = $(OBJ_DIR)/host
+HOST_CXXFLAGS = -std=c++11 -Wall -Wextra -pedantic -O2 -g -MMD -MP # -MMD -MP: ヘッダー変更時に再ビルドするための依存関係ファイル (.d)
+HOST_INCLUDES = -I$(INC_DIR) -I$(STUB_DIR) -I$(TEST_DIR)
+HOST_LIBS = -lpthread -lm -lrt
+
+CORE_SRCS = $(filter-out $(SRC_DIR)/main.cpp $(SRC_DIR)/gstPipeline.cpp,$(SRCS))
+CORE_OBJS = $(patsubst $(SRC_DIR)/%.cpp,$(TEST_OBJ_DIR)/src/%.o,$(CORE_SRCS)) \
+            $(TEST_OBJ_DIR)/stub/bindings_stub.o
+TEST_OBJS = $(patsubst $(TEST_DIR)/%.cpp,$(TEST_OBJ_DIR)/tests/%.o,$(wildcard $(TEST_DIR)/*.cpp))
+BENCH_OBJS = $(patsubst $(BENCH_DIR)/%.cpp,$(TEST_OBJ_DIR)/bench/%.o,$(wildcard $(BENCH_DIR)/*.cpp))
+
+TEST_TARGET = $(BIN_DIR)/run_tests
+BENCH_TARGET = $(BIN_DIR)/run_bench
+
+# 閉ループシミュレーター: 制御コードを -DMONOTONIC_CLOCK_SIMULATED で別にビルドし (時刻をシミュレーターが進める)、
+# sim/ の 6 自由度運動モデル・シナリオと組み合わせる
+SIM_DIR = sim
+SIM_OBJ_DIR = $(OBJ_DIR)/host_sim
+SIM_CORE_OBJS = $(patsubst $(SRC_DIR)/%.cpp,$(SIM_OBJ_DIR)/src/%.o,$(CORE_SRCS)) \
+                $(SIM_OBJ_DIR)/stub/bindings_stub.o
+SIM_OBJS = $(patsubst $(SIM_DIR)/%.cpp,$(SIM_OBJ_DIR)/sim/%.o,$(wildcard $(SIM_DIR)/*.cpp))
+SIM_TARGET = $(BIN_DIR)/run_sim
+
+# テストをビルドして実行する
+test: $(TEST_TARGET)
+	./$(TEST_TARGET)
+
+# ベンチマークをビルドして実行する (引数で名前を絞り込む場合は ./bin/run_bench <名前> を直接実行)
+bench: $(BENCH_TARGET)
+	./$(BENCH_TARGET)
+
+# シミュレーターをビルドして全シナリオを実行する (絞り込む場合は ./bin/run_sim <名前> を直接実行)
+sim: $(SIM_TARGET)
+	./$(SIM_TARGET)
+
+$(TEST_TARGET): $(CORE_OBJS) $(TEST_OBJS) | $(BIN_DIR)
+	$(CXX) $^ -o $@ $(HOST_LIBS)
+
+$(BENCH_TARGET): $(CORE_OBJS) $(BENCH_OBJS) | $(BIN_DIR)
+	$(CXX) $^ -o $@ $(HOST_LIBS)
+
+$(TEST_OBJ_DIR)/src/%.o: $(SRC_DIR)/%.cpp
+	@mkdir -p $(@D)
+	$(CXX) $(HOST_CXXFLAGS) $(HOST_INCLUDES) -c $< -o $@
+
+$(TEST_OBJ_DIR)/stub/%.o: $(STUB_DIR)/%.cpp
+	@mkdir -p $(@D)
+	$(CXX) $(HOST_CXXFLAGS) $(HOST_INCLUDES) -c $< -o $@
+
+$(TEST_OBJ_DIR)/tests/%.o: $(TEST_DIR)/%.cpp
+	@mkdir -p $(@D)
+	$(CXX) $(HOST_CXXFLAGS) $(HOST_INCLUDES) -c $< -o $@
+
+$(TEST_OBJ_DIR)/bench/%.o: $(BENCH_DIR)/%.cpp
+	@mkdir -p $(@D)
+	$(CXX) $(HOST_CXXFLAGS) $(HOST_INCLUDES) -I$(BENCH_DIR) -c $< -o $@
+
+$(SIM_TARGET): $(SIM_CORE_OBJS) $(SIM_OBJS) | $(BIN_DIR)
+	$(CXX) $^ -o $@ $(HOST_LIBS)
+
+$(SIM_OBJ_DIR)/src/%.o: $(SRC_DIR)/%.cpp
+	@mkdir -p $(@D)
+	$(CXX) $(HOST_CXXFLAGS) -DMONOTONIC_CLOCK_SIMULATED $(HOST_INCLUDES) -c $< -o $@
+
+$(SIM_OBJ_DIR)/stub/%.o: $(STUB_DIR)/%.cpp
+	@mkdir -p $(@D)
+	$(CXX) $(HOST_CXXFLAGS) -DMONOTONIC_CLOCK_SIMULATED $(HOST_INCLUDES) -c $< -o $@
+
+$(SIM_OBJ_DIR)/sim/%.o: $(SIM_DIR)/%.cpp
+	@mkdir -p $(@D)
+	$(CXX) $(HOST_CXXFLAGS) -DMONOTONIC_CLOCK_SIMULATED $(HOST_INCLUDES) -I$(SIM_DIR) -c $< -o $@
+
+# ヘッダーの依存関係 (存在する場合のみ)
+-include $(wildcard $(TEST_OBJ_DIR)/*/*.d $(SIM_OBJ_DIR)/*/*.d)
+
 # --- ディレクトリ作成 ---
 # これらのターゲットは、ディレクトリが存在しない場合に作成します
 # これらは、順序のみの依存関係 (|) を使用するコンパイルおよびリンクルールの前提条件です
@@ -70,7 +153,7 @@ clean:
 	@echo "Cleaned."
 
 # --- Phony ターゲット (ファイルを表さないターゲット) ---
-.PHONY: all clean $(OBJ_DIR) $(BIN_DIR)
+.PHONY: all clean test bench sim $(OBJ_DIR) $(BIN_DIR)
 
 # --- 中間ファイルが削除されるのを防ぐ ---
 .SECONDARY: $(OBJS)
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "bench_harness.h"
+#include <atomic>              // std::atomic を使用するため
+#include <new>                 // operator new の置き換えのため
+#include <stdlib.h>            // malloc, free を使用するため
+#include <string.h>            // memset を使用するため
+#include <unistd.h>            // syscall, close, read を使用するため
+#include <sys/ioctl.h>         // ioctl を使用するため
+#include <sys/syscall.h>       // SYS_perf_event_open を使用するため
+#include <linux/perf_event.h>  // perf_event_attr を使用するため
+
+// --- メモリ確保回数の計測 ---
+// グローバルな operator new/delete を置き換えて呼び出し回数を数える (ベンチマークバイナリのみ)
+static std::atomic<uint64_t> allocation_count(0);
+
+void *operator new(size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+uint64_t bench_allocation_count()
+{
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+// --- ハードウェア性能カウンタ (perf_event_open) ---
+static int perf_fds[3] = {-1, -1, -1};
+
+static int open_counter(uint64_t config, int group_fd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = group_fd == -1 ? 1 : 0; // グループリーダーだけ無効状態で作成し、まとめて有効化する
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+static void close_counters()
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        if (perf_fds[i] >= 0)
+            close(perf_fds[i]);
+        perf_fds[i] = -1;
+    }
+}
+
+bool bench_perf_start()
+{
+    close_counters();
+    perf_fds[0] = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (perf_fds[0] < 0)
+        return false; // コンテナや perf_event_paranoid の設定で使えない環境
+    perf_fds[1] = open_counter(PERF_COUNT_HW_INSTRUCTIONS, perf_fds[0]);
+    perf_fds[2] = open_counter(PERF_COUNT_HW_CACHE_MISSES, perf_fds[0]);
+    if (perf_fds[1] < 0 || perf_fds[2] < 0)
+    {
+        close_counters();
+        return false;
+    }
+    ioctl(perf_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(perf_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+bool bench_perf_stop(uint64_t counters[3])
+{
+    if (perf_fds[0] < 0)
+        return false;
+    ioctl(perf_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    bool ok = true;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (read(perf_fds[i], &counters[i], sizeof(counters[i])) != sizeof(counters[i]))
+            ok = false;
+    }
+    close_counters();
+    return ok;
+}
+
+void bench_print_result(const char *name, const BenchResult &result)
+{
+    if (result.perf_available)
+    {
+        printf("%-44s %10.1f ns/op %6.2f allocs/op %10.0f cycles/op %10.0f instr/op %8.2f cache-miss/op\n",
+               name, result.ns_per_op, result.allocs_per_op,
+               result.cycles_per_op, result.instructions_per_op, result.cache_misses_per_op);
+    }
+    else
+    {
+        printf("%-44s %10.1f ns/op %6.2f allocs/op %10s cycles/op %10s instr/op %8s cache-miss/op\n",
+               name, result.ns_per_op, result.allocs_per_op, "n/a", "n/a", "n/a");
+    }
+}
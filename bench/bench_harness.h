@@ -0,0 +1,67 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+// マイクロベンチマーク用のハーネス
+// 1回あたりの実行時間 (ns/op)、メモリ確保回数 (allocs/op)、ハードウェア性能カウンタ
+// (cycles, instructions, cache-misses / op; perf_event_open が使える環境のみ) を計測して表示する。
+
+#include <stdint.h>  // uint64_t を使用するため
+#include <stdio.h>   // printf を使用するため
+#include "monotonic_clock.h"
+
+// 計測結果
+struct BenchResult
+{
+    double ns_per_op;
+    double allocs_per_op;
+    bool perf_available;      // 性能カウンタが取得できたか
+    double cycles_per_op;
+    double instructions_per_op;
+    double cache_misses_per_op;
+};
+
+// --- 計測用の低レベル関数 (bench_harness.cpp) ---
+// operator new の累積呼び出し回数
+uint64_t bench_allocation_count();
+// 性能カウンタを開始する (使えない環境では false)
+bool bench_perf_start();
+// 性能カウンタを停止して値を取得する (cycles, instructions, cache-misses)
+bool bench_perf_stop(uint64_t counters[3]);
+// 結果を1行で表示する
+void bench_print_result(const char *name, const BenchResult &result);
+// 最適化で計算が消されないように値を使用済みにする
+template <typename T>
+inline void bench_do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// func を iterations 回実行して計測し、結果を表示する
+template <typename Func>
+BenchResult run_bench(const char *name, uint64_t iterations, Func func)
+{
+    // ウォームアップ (キャッシュ・分岐予測・遅延初期化の影響を除く)
+    for (uint64_t i = 0; i < iterations / 10 + 1; ++i)
+        func();
+
+    BenchResult result = BenchResult();
+    uint64_t counters[3] = {0, 0, 0};
+    uint64_t allocs_before = bench_allocation_count();
+    bool perf = bench_perf_start();
+    uint64_t start_ns = monotonic_now_ns();
+    for (uint64_t i = 0; i < iterations; ++i)
+        func();
+    uint64_t elapsed_ns = monotonic_now_ns() - start_ns;
+    result.perf_available = perf && bench_perf_stop(counters);
+    uint64_t allocs = bench_allocation_count() - allocs_before;
+
+    result.ns_per_op = static_cast<double>(elapsed_ns) / iterations;
+    result.allocs_per_op = static_cast<double>(allocs) / iterations;
+    result.cycles_per_op = static_cast<double>(counters[0]) / iterations;
+    result.instructions_per_op = static_cast<double>(counters[1]) / iterations;
+    result.cache_misses_per_op = static_cast<double>(counters[2]) / iterations;
+    bench_print_result(name, result);
+    return result;
+}
+
+#endif // BENCH_HARNESS_H
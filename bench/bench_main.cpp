@@ -0,0 +1,421 @@
+// 制御ループのホットパスのマイクロベンチマーク
+// 実機なしで bindings.h のスタブとループバックソケットを使って計測する。
+// 使い方: make -f Makefile.mk bench  (bin/run_bench [名前フィルタ])
+
+#include "bench_harness.h"
+#include "bindings_stub.h"
+#include "gamepad.h"
+#include "thruster_control.h"
+#include "thrust_curve.h"
+#include "sensor_data.h"
+#include "telemetry.h"
+#include "command_arbiter.h"
+#include "network.h"
+#include "state_bus.h"
+#include "attitude_estimator.h"
+#include "jitter_buffer.h"
+#include "fec.h"
+#include "runtime_state.h"
+#include "bus_manager.h"
+#include "adc_filter.h"
+#include "monotonic_clock.h"
+#include "legacy_thruster_mapping.h" // 旧実装 (ベースラインの float の線形写像) の参照
+
+#include <algorithm>   // std::max, std::min を使用するため
+#include <string>      // std::string を使用するため
+#include <string.h>    // strstr, memset を使用するため
+#include <stdio.h>     // snprintf を使用するため
+#include <arpa/inet.h> // htonl, htons を使用するため
+#include <unistd.h>    // close を使用するため
+
+static const uint64_t FAST_ITERATIONS = 1000000; // 計算のみのベンチマークの反復回数
+static const uint64_t IO_ITERATIONS = 20000;     // システムコールを伴うベンチマークの反復回数
+
+static const char *bench_filter = NULL; // 指定された場合、名前に含む文字列のベンチマークのみ実行
+
+static bool selected(const char *name)
+{
+    return bench_filter == NULL || strstr(name, bench_filter) != NULL;
+}
+
+// ベンチマーク用の受信側ソケット (ループバック)
+static int open_sink(int port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    return fd;
+}
+
+static void drain(int fd)
+{
+    char buf[NET_BUFFER_SIZE];
+    while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+    {
+    }
+}
+
+static void bench_parsing()
+{
+    const std::string legacy_packet = "12000,-8000,32767,-32768,128,0,4097";
+    const std::string arbiter_packet = "C,2,1234,20,12000,-8000,32767,-32768,128,0,4097";
+
+    if (selected("parseGamepadData"))
+        run_bench("parseGamepadData", FAST_ITERATIONS, [&]() {
+            bench_do_not_optimize(parseGamepadData(legacy_packet));
+        });
+    if (selected("parseCommandPacket/legacy"))
+        run_bench("parseCommandPacket/legacy", FAST_ITERATIONS, [&]() {
+            bench_do_not_optimize(parseCommandPacket(legacy_packet));
+        });
+    if (selected("parseCommandPacket/sourced"))
+        run_bench("parseCommandPacket/sourced", FAST_ITERATIONS, [&]() {
+            bench_do_not_optimize(parseCommandPacket(arbiter_packet));
+        });
+}
+
+static void bench_thruster_mapping()
+{
+    // スティック値を全域で変化させ、分岐予測が1点に固定されないようにする
+    int stick = -32768;
+    auto next_stick = [&stick]() {
+        stick += 7919;
+        if (stick > 32767)
+            stick -= 65535;
+        return stick;
+    };
+
+    if (selected("stick_to_pwm"))
+        run_bench("stick_to_pwm", FAST_ITERATIONS, [&]() {
+            bench_do_not_optimize(stick_to_pwm(next_stick(), PWM_MIN, PWM_BOOST_MAX - PWM_MIN));
+        });
+    if (selected("thrust_to_pwm"))
+        run_bench("thrust_to_pwm", FAST_ITERATIONS, [&]() {
+            bench_do_not_optimize(thrust_to_pwm(next_stick() / 32768.0f));
+        });
+    if (selected("legacy_map_value/forward_reverse"))
+        run_bench("legacy_map_value/forward_reverse", FAST_ITERATIONS, [&]() {
+            bench_do_not_optimize(legacy::calculate_forward_reverse_pwm(next_stick()));
+        });
+
+    GamepadData data;
+    AxisData gyro = {0.01f, -0.02f, 0.05f};
+    int pwm_out[NUM_THRUSTERS];
+    ThrustAllocation allocation;
+    if (selected("thruster_mix/saturating"))
+        run_bench("thruster_mix/saturating", FAST_ITERATIONS, [&]() {
+            BodyThrust demand;
+            demand.yaw = next_stick() / 32768.0f;
+            demand.sway = next_stick() / 32768.0f;
+            demand.surge = next_stick() / 32768.0f;
+            thruster_mix(demand, pwm_out, &allocation);
+            bench_do_not_optimize(pwm_out[0] + allocation.saturated_axes);
+        });
+
+    // 1周期分のマッピング (スティック -> 推力要求 -> 優先度つき配分 -> 6ch) と、旧実装 (軸ごとの浮動小数点の線形変換) の比較
+    if (selected("tick_mapping/lut"))
+        run_bench("tick_mapping/lut", FAST_ITERATIONS, [&]() {
+            data.leftThumbX = static_cast<int16_t>(next_stick());
+            data.rightThumbX = static_cast<int16_t>(next_stick());
+            data.rightThumbY = static_cast<int16_t>(next_stick());
+            thruster_mix(thruster_manual_demand(data, gyro), pwm_out, &allocation);
+            bench_do_not_optimize(pwm_out[0] + pwm_out[4]);
+        });
+    if (selected("tick_mapping/legacy_float"))
+        run_bench("tick_mapping/legacy_float", FAST_ITERATIONS, [&]() {
+            data.leftThumbX = static_cast<int16_t>(next_stick());
+            data.rightThumbX = static_cast<int16_t>(next_stick());
+            data.rightThumbY = static_cast<int16_t>(next_stick());
+            int horizontal_pwm[4];
+            legacy::update_horizontal_thrusters(data, gyro, horizontal_pwm);
+            int forward_pwm = legacy::calculate_forward_reverse_pwm(data.rightThumbY);
+            for (int i = 0; i < 4; ++i)
+                pwm_out[i] = legacy::clamp_pwm(horizontal_pwm[i]);
+            pwm_out[4] = pwm_out[5] = legacy::clamp_pwm(forward_pwm);
+            bench_do_not_optimize(pwm_out[0] + pwm_out[4]);
+        });
+}
+
+static void bench_sensor_and_telemetry()
+{
+    char buffer[SENSOR_BUFFER_SIZE];
+    if (selected("read_and_format_sensor_data"))
+        run_bench("read_and_format_sensor_data", FAST_ITERATIONS / 10, [&]() {
+            bench_do_not_optimize(read_and_format_sensor_data(buffer, sizeof(buffer)));
+        });
+    // バス管理の実行中の IMU の読み取り (バススレッドが読んだ最新値のコピー。バスのトランザクションを待たない)
+    if (selected("sensor_read_fast/bus_cache"))
+    {
+        bus_manager_start(BusManagerConfig());
+        SensorData cached;
+        run_bench("sensor_read_fast/bus_cache", FAST_ITERATIONS, [&]() {
+            sensor_read_fast(&cached);
+            bench_do_not_optimize(cached.gyro.z);
+        });
+        bus_manager_stop();
+    }
+
+    // ADC のフィルタバンク: 間引きの1周期分 (100Hz の10サンプル x 4チャンネル) をまとめて処理し、10Hz の値を1つ出す
+    if (selected("adc_filter/block"))
+    {
+        AdcFilterConfig config;
+        AdcFilterBank bank;
+        adc_filter_init(&bank, config);
+        float samples[ADC_FILTER_MAX_BLOCK][ADC_FILTER_CHANNELS];
+        for (uint32_t n = 0; n < config.decimation; ++n)
+        {
+            for (int ch = 0; ch < ADC_FILTER_CHANNELS; ++ch)
+                samples[n][ch] = 1.0f + 0.01f * static_cast<float>((n * 7 + ch * 3) % 11);
+        }
+        float out[1][ADC_FILTER_CHANNELS];
+        run_bench("adc_filter/block", FAST_ITERATIONS, [&]() {
+            samples[0][0] += 1e-6f; // 入力を毎回変える
+            bench_do_not_optimize(adc_filter_process(&bank, samples, static_cast<int>(config.decimation), out, 1));
+            bench_do_not_optimize(out[0][0]);
+        });
+    }
+
+    SensorData sensor;
+    sensor_read_fast(&sensor);
+    sensor_read_slow(&sensor);
+    TelemetryScheduler sched;
+    telemetry_init(&sched, 4000, 1000);
+    uint64_t now_ms = 0;
+    if (selected("telemetry_build_frame"))
+        run_bench("telemetry_build_frame", FAST_ITERATIONS / 10, [&]() {
+            now_ms += 10;
+            sensor.gyro.z += 0.01f; // 毎周期ジャイロが変化する想定
+            bool keyframe = false;
+            bench_do_not_optimize(telemetry_build_frame(&sched, sensor, 0, now_ms, buffer, sizeof(buffer), &keyframe));
+        });
+}
+
+static void bench_arbiter()
+{
+    CommandArbiter arb;
+    arbiter_init(&arb, 200);
+    CommandPacket packets[3];
+    for (int i = 0; i < 3; ++i)
+        packets[i] = parseCommandPacket("C," + std::to_string(i) + ",1," + std::to_string(10 * (i + 1)) + ",0,0,0,0,0,0,0");
+    uint64_t now_ms = 0;
+    uint32_t seq = 1;
+    if (selected("arbiter_submit+select"))
+        run_bench("arbiter_submit+select", FAST_ITERATIONS, [&]() {
+            now_ms += 1;
+            ++seq;
+            for (int i = 0; i < 3; ++i)
+            {
+                packets[i].seq = seq;
+                arbiter_submit(&arb, packets[i], now_ms);
+            }
+            bench_do_not_optimize(arbiter_select(&arb, now_ms));
+        });
+
+    // 2周期に1回受信し、3周期ごとに途切れが挟まる入力でジッタバッファの各方式を比較する
+    const JitterPolicy policies[] = {JITTER_POLICY_HOLD, JITTER_POLICY_EXTRAPOLATE, JITTER_POLICY_DELAYED};
+    for (JitterPolicy policy : policies)
+    {
+        std::string name = std::string("jitter_sample/") + jitter_policy_name(policy);
+        if (!selected(name.c_str()))
+            continue;
+        JitterConfig config;
+        config.policy = policy;
+        JitterBuffer jb;
+        jitter_init(&jb, config);
+        GamepadData command;
+        uint64_t tick_ms = 0;
+        run_bench(name.c_str(), FAST_ITERATIONS, [&]() {
+            tick_ms += 10;
+            if ((tick_ms / 10) % 2 == 0 && (tick_ms / 100) % 3 != 0)
+            {
+                command.leftThumbX = static_cast<int>(tick_ms % 60000) - 30000;
+                jitter_push(&jb, 1, command, tick_ms);
+            }
+            bench_do_not_optimize(jitter_sample(&jb, tick_ms));
+        });
+    }
+}
+
+static void bench_fec()
+{
+    FecConfig config;
+    FecEncoder enc;
+    fec_encoder_init(&enc, config);
+    FecDecoder dec;
+    fec_decoder_init(&dec);
+    static uint8_t frames[2][FEC_MAX_FRAME];
+    size_t frame_len[2];
+    const char command[] = "C,2,1234,20,12000,-8000,32767,-32768,128,0,4097";
+    char out[FEC_MAX_PAYLOAD + 1];
+    size_t out_len = 0;
+    if (selected("fec_encode+decode/command"))
+        run_bench("fec_encode+decode/command", FAST_ITERATIONS, [&]() {
+            int count = fec_encode(&enc, reinterpret_cast<const uint8_t *>(command), sizeof(command) - 1, frames, frame_len);
+            for (int i = 0; i < count; ++i)
+                fec_decode(&dec, frames[i], frame_len[i]);
+            while (fec_next_payload(&dec, out, sizeof(out), &out_len))
+                bench_do_not_optimize(out_len);
+        });
+}
+
+static void bench_state_bus()
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/ws3_state_bus_bench_%d", static_cast<int>(getpid()));
+    StateBus server, client;
+    if (!state_bus_create(&server, name) || !state_bus_open(&client, name))
+    {
+        printf("state bus benches skipped (共有メモリを作成できません)\n");
+        state_bus_close(&server);
+        return;
+    }
+    StateSnapshot snapshot = StateSnapshot();
+    if (selected("state_bus_publish"))
+        run_bench("state_bus_publish", FAST_ITERATIONS, [&]() {
+            snapshot.tick++;
+            state_bus_publish(&server, snapshot);
+        });
+    if (selected("state_bus_read"))
+        run_bench("state_bus_read", FAST_ITERATIONS, [&]() {
+            StateSnapshot out;
+            bench_do_not_optimize(state_bus_read(&client, &out));
+            bench_do_not_optimize(out.tick);
+        });
+    StateBusCommand command = StateBusCommand();
+    command.type = CommandGamepad;
+    if (selected("state_bus_push+pop_command"))
+        run_bench("state_bus_push+pop_command", FAST_ITERATIONS, [&]() {
+            StateBusCommand out;
+            state_bus_push_command(&client, command);
+            bench_do_not_optimize(state_bus_pop_command(&server, &out));
+        });
+
+    AttitudeEstimator est;
+    attitude_init(&est, ATTITUDE_DEFAULT_ACCEL_WEIGHT, ATTITUDE_DEFAULT_MAG_WEIGHT);
+    AxisData accel = {0.1f, 0.2f, 9.8f};
+    AxisData gyro = {0.5f, -0.3f, 1.2f};
+    AxisData mag = {25.0f, 5.0f, -40.0f};
+    if (selected("attitude_update"))
+        run_bench("attitude_update", FAST_ITERATIONS, [&]() {
+            attitude_update(&est, accel, gyro, mag, 0.01f);
+            bench_do_not_optimize(est.attitude.yaw_deg);
+        });
+
+    state_bus_close(&client);
+    state_bus_close(&server);
+}
+
+static void bench_runtime_state()
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/ws3_runtime_state_bench_%d", static_cast<int>(getpid()));
+    RuntimeState state;
+    if (!runtime_state_open(&state, name))
+    {
+        printf("runtime state benches skipped (共有メモリを作成できません)\n");
+        return;
+    }
+    RuntimeSnapshot snapshot = RuntimeSnapshot();
+    if (selected("runtime_state_save"))
+        run_bench("runtime_state_save", FAST_ITERATIONS, [&]() {
+            snapshot.tick++;
+            runtime_state_save(&state, snapshot);
+        });
+    snapshot.saved_ns = monotonic_now_ns();
+    runtime_state_save(&state, snapshot);
+    if (selected("runtime_state_load"))
+        run_bench("runtime_state_load", FAST_ITERATIONS, [&]() {
+            RuntimeSnapshot out;
+            bench_do_not_optimize(runtime_state_load(&state, snapshot.saved_ns, RUNTIME_STATE_MAX_AGE_MS, &out));
+            bench_do_not_optimize(out.tick);
+        });
+    runtime_state_close(&state);
+    runtime_state_unlink(name);
+}
+
+static void bench_network()
+{
+    const int server_port = 39200;
+    const int sink_base_port = 39210;
+    NetworkContext ctx;
+    if (!network_init(&ctx, server_port, sink_base_port))
+    {
+        printf("network benches skipped (ループバックソケットを開けません)\n");
+        return;
+    }
+
+    int sinks[8];
+    for (int i = 0; i < 8; ++i)
+        sinks[i] = open_sink(sink_base_port + i);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    const char frame[] = "SEQ:1,KF:0,GYRZ:0.0123,ACCX:0.981";
+    for (int count = 1; count <= 8; count *= 8)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            addr.sin_port = htons(sink_base_port + i);
+            network_subscribe(&ctx, &addr, 0);
+        }
+        std::string name = "network_send_to_all/" + std::to_string(count) + "_subscribers";
+        if (selected(name.c_str()))
+        {
+            int n = 0;
+            run_bench(name.c_str(), IO_ITERATIONS, [&]() {
+                network_send_to_all(&ctx, frame, sizeof(frame) - 1);
+                if (++n % 64 == 0)
+                    for (int i = 0; i < count; ++i)
+                        drain(sinks[i]); // ソケットバッファがあふれないよう定期的に読み捨てる
+            });
+        }
+    }
+
+    // 受信: 1パケット送信 → network_receive で1パケット読み出し
+    if (selected("network_receive"))
+    {
+        int client = open_sink(sink_base_port + 8);
+        struct sockaddr_in server;
+        memset(&server, 0, sizeof(server));
+        server.sin_family = AF_INET;
+        server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        server.sin_port = htons(server_port);
+        const char packet[] = "C,1,1,10,12000,-8000,32767,-32768,128,0,4097";
+        char buffer[NET_BUFFER_SIZE];
+        run_bench("network_receive (incl. loopback sendto)", IO_ITERATIONS, [&]() {
+            sendto(client, packet, sizeof(packet) - 1, 0, (struct sockaddr *)&server, sizeof(server));
+            bench_do_not_optimize(network_receive(&ctx, buffer, sizeof(buffer)));
+        });
+        close(client);
+    }
+
+    for (int i = 0; i < 8; ++i)
+        close(sinks[i]);
+    network_close(&ctx);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        bench_filter = argv[1];
+    stub_hardware_reset();
+
+    // thruster_update は実機用のデバッグ出力 (printf) を含むため計測対象外とし、
+    // その内部の計算関数を個別に計測する
+    bench_parsing();
+    bench_thruster_mapping();
+    bench_sensor_and_telemetry();
+    bench_arbiter();
+    bench_fec();
+    bench_state_bus();
+    bench_runtime_state();
+    bench_network();
+    return 0;
+}
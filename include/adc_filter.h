@@ -0,0 +1,51 @@
+#ifndef ADC_FILTER_H
+#define ADC_FILTER_H
+
+#include <stdint.h> // uint32_t を使用するため
+
+// ADC のフィルタバンク
+// 高いレートで読んだ ADC の4チャンネル (バッテリー電圧・電流、補助のアナログセンサー) を、
+// メディアン (スパイク除去) -> 移動平均 -> 一次 IIR ローパス の順に通し、decimation 個ごとに1つの値に間引く。
+// 4チャンネルを1つの4要素ベクトル (GCC のベクトル拡張) として同時に処理し、
+// 間引きの1周期分のサンプルをまとめて (ブロック単位で) 処理する。
+// ベクトル演算は x86-64 では SSE、aarch64 (64bit の Raspberry Pi OS) では NEON になる。32bit ARM (armhf) では
+// GCC が浮動小数点のベクトル演算に NEON を使わないため (-funsafe-math-optimizations が必要)、要素ごとの VFP 命令に展開される。
+// 各段はタップ数 1 (IIR は係数 1.0) で無効になる。
+
+#define ADC_FILTER_CHANNELS 4     // チャンネル数 (SENSOR_ADC_CHANNELS と同じ。ベクトルの幅)
+#define ADC_FILTER_MAX_MEDIAN 7   // メディアンの最大タップ数
+#define ADC_FILTER_MAX_AVERAGE 32 // 移動平均の最大タップ数
+#define ADC_FILTER_MAX_BLOCK 64   // 間引き率の上限 (1ブロックの最大サンプル数)
+
+// フィルタバンクの設定 (全チャンネル共通)
+struct AdcFilterConfig
+{
+    uint32_t median_taps = 3;   // メディアンのタップ数 (奇数。1 で無効)。単発のスパイクは 3 で除去できる
+    uint32_t average_taps = 10; // 移動平均のタップ数 (1 で無効)。間引き率と同じ長さにすると、出力レートの倍数の周波数の雑音を除去できる
+    float iir_alpha = 0.5f;     // IIR の係数 (0 < alpha <= 1。y += alpha * (x - y)。1.0 で無効)
+    uint32_t decimation = 10;   // 入力この個数ごとに1つ出力する (100Hz の読み取りで 10Hz)
+};
+
+// フィルタバンクの状態 (各行が4チャンネル分のベクトル)
+struct AdcFilterBank
+{
+    AdcFilterConfig config;
+    alignas(16) float median_history[ADC_FILTER_MAX_MEDIAN][ADC_FILTER_CHANNELS];   // メディアンの窓 (リングバッファ)
+    alignas(16) float average_history[ADC_FILTER_MAX_AVERAGE][ADC_FILTER_CHANNELS]; // 移動平均の窓 (リングバッファ)
+    alignas(16) float average_sum[ADC_FILTER_CHANNELS];                             // 移動平均の窓の合計
+    alignas(16) float iir_state[ADC_FILTER_CHANNELS];                               // IIR の出力
+    uint32_t median_pos;  // 次に書き込むメディアンの窓の位置
+    uint32_t average_pos; // 次に書き込む移動平均の窓の位置
+    uint32_t decimation_count; // 前回の出力からの入力数
+    bool primed;          // 最初のサンプルで各段の状態を埋めたか (起動直後に 0 からの立ち上がりを出さないため)
+};
+
+// 関数のプロトタイプ宣言
+// フィルタバンクを初期化する (設定が範囲外なら false)
+bool adc_filter_init(AdcFilterBank *bank, const AdcFilterConfig &config);
+// count 個のサンプル (各4チャンネル) をまとめて処理し、間引いた出力を out に書き込む。書き込んだ数を返す
+// 出力が max_out 個を超える場合は何も処理せずに -1 を返す (状態は変わらない。出力を捨てずに呼び出し側で分割できるように)
+int adc_filter_process(AdcFilterBank *bank, const float (*samples)[ADC_FILTER_CHANNELS], int count,
+                       float (*out)[ADC_FILTER_CHANNELS], int max_out);
+
+#endif // ADC_FILTER_H
@@ -0,0 +1,39 @@
+#ifndef ATTITUDE_ESTIMATOR_H
+#define ATTITUDE_ESTIMATOR_H
+
+#include "bindings.h" // AxisData を使用するため
+
+// 姿勢推定 (相補フィルタ)
+// ロール/ピッチはジャイロの積分を加速度 (重力方向) で、ヨーはジャイロの積分を傾き補正した磁気方位で補正する。
+// 角速度の単位は thruster_control.cpp と同じく deg/s を仮定し、出力も度で表す。
+
+#define ATTITUDE_DEFAULT_ACCEL_WEIGHT 0.02f // 1周期あたりに加速度から求めた角度へ寄せる割合 (100Hz で時定数 約0.5秒)
+#define ATTITUDE_DEFAULT_MAG_WEIGHT 0.01f   // 1周期あたりに磁気方位へ寄せる割合
+#define ATTITUDE_MAX_DT_S 0.1f              // これより長い周期間隔 (停止からの復帰など) は積分しない
+
+// 推定した姿勢 (度)
+struct Attitude
+{
+    float roll_deg = 0.0f;  // ロール (右舷側が下がると正)
+    float pitch_deg = 0.0f; // ピッチ (機首上げが正)
+    float yaw_deg = 0.0f;   // ヨー (磁北基準の方位, -180 〜 180)
+};
+
+// 姿勢推定の状態
+struct AttitudeEstimator
+{
+    Attitude attitude;                                // 現在の推定値
+    bool initialized = false;                         // 最初の更新で加速度・磁気から直接初期化したか
+    float accel_weight = ATTITUDE_DEFAULT_ACCEL_WEIGHT;
+    float mag_weight = ATTITUDE_DEFAULT_MAG_WEIGHT;   // 0 の場合はジャイロ積分のみ (磁気の乱れが大きい環境向け)
+};
+
+// 関数のプロトタイプ宣言
+// 推定器を初期化する
+void attitude_init(AttitudeEstimator *est, float accel_weight, float mag_weight);
+// センサー値で推定を1周期進める (dt_s: 前回の更新からの経過秒)
+void attitude_update(AttitudeEstimator *est, const AxisData &accel, const AxisData &gyro, const AxisData &mag, float dt_s);
+// 角度を -180 〜 180 度に正規化する
+float attitude_wrap_deg(float angle_deg);
+
+#endif // ATTITUDE_ESTIMATOR_H
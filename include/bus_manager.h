@@ -0,0 +1,105 @@
+#ifndef BUS_MANAGER_H
+#define BUS_MANAGER_H
+
+#include "bindings.h" // AxisData を使用するため
+#include "adc_filter.h" // ADC のフィルタバンクの設定 (AdcFilterConfig)
+#include <stddef.h>   // size_t を使用するため
+#include <stdint.h>   // uint32_t, uint64_t を使用するため
+
+// バス管理スレッド
+// Navigator の I2C/SPI バスを共有するセンサーの読み取り (read_*) と PWM の書き込み (set_pwm_*) を、
+// 専用のスレッド1つだけが実行する。他のスレッド (メインループ・ウォッチドッグ・浸水監視) からは
+//   - PWM: チャンネルごとに最新の値を登録してバススレッドを起こす (書き込みの完了は待たない。
+//          同じチャンネルへの連続した書き込みは最後の値だけを書く)
+//   - センサー: バススレッドが周期ごとに読んだ最新の値をコピーする (待たない)
+//   - 即時の読み取り (浸水監視のリーク): 要求を登録し、バススレッドが読むまで待つ
+// バススレッドは周期 (timerfd) ごとに優先度順 (BusDevice の順: PWM -> ジャイロ -> 加速度 -> 磁気 -> リーク -> 圧力 -> ADC -> 温度) に処理し、
+// 低速のセンサーは1周期の時間予算に収まる分だけ読む (収まらなければ次の周期に回す)。
+// デバイスごとの処理時間 (1回のトランザクションの所要時間) を記録する。
+// ADC は制御周期ごとに読み (オーバーサンプリング)、間引きの1周期分をフィルタバンク (adc_filter.h) でまとめて処理した値を最新値にする。
+// バス管理を開始していない間 (テスト・シミュレーター・起動直後) は、呼び出したスレッドで直接ハードウェアにアクセスする。
+
+// バス上のデバイス (値が小さいほど優先度が高い)
+enum BusDevice
+{
+    BUS_DEVICE_PWM = 0,  // PWM 出力 (書き込み)
+    BUS_DEVICE_GYRO,     // ジャイロ
+    BUS_DEVICE_ACCEL,    // 加速度
+    BUS_DEVICE_MAG,      // 磁気
+    BUS_DEVICE_LEAK,     // リークセンサー
+    BUS_DEVICE_PRESSURE, // 圧力
+    BUS_DEVICE_ADC,      // ADC (全チャンネル)
+    BUS_DEVICE_TEMP,     // 温度
+    BUS_DEVICE_COUNT
+};
+
+#define BUS_ADC_CHANNELS 4 // 読み取る ADC チャンネル数 (SENSOR_ADC_CHANNELS と同じ)
+
+// バス管理の設定
+struct BusManagerConfig
+{
+    uint32_t period_ms = 10;        // 周期 (timerfd の周期)。メインループと同じ 100Hz
+    uint32_t tick_budget_us = 2000; // 1周期でバスを使ってよい時間。低速のセンサーはこの予算に収まる分だけ読む
+    // デバイスごとの読み取り周期 [ms] (PWM は書き込み要求のたびに処理するため使わない)
+    // ADC は 100Hz で読み、adc_filter.decimation (既定 10) 個ごとに 10Hz の値にする
+    uint32_t device_period_ms[BUS_DEVICE_COUNT] = {0, 10, 10, 10, 100, 100, 10, 1000};
+    uint32_t max_defer_ticks = 5;   // 予算不足で後回しにできる最大周期数 (超えたら予算を超えても読み、読み取りが止まらないようにする)
+    uint32_t idle_period_ms = 100;         // アイドル中の周期 (IMU はこの周期で読む)
+    AdcFilterConfig adc_filter;            // ADC のフィルタバンク (メディアン -> 移動平均 -> IIR -> 間引き)
+    uint32_t idle_slow_period_ms = 1000;   // アイドル中の低速のセンサーの読み取り周期 (device_period_ms がこれより短ければこちらを使う)
+};
+
+// デバイスごとのトランザクションの統計
+struct BusDeviceStats
+{
+    uint32_t transactions = 0; // 実行した回数 (PWM はチャンネルごとの書き込み回数)
+    uint32_t deferred = 0;     // 予算不足で次の周期に回した回数
+    uint64_t total_ns = 0;     // 所要時間の合計 (平均の計算用)
+    uint32_t last_ns = 0;      // 直前の所要時間
+    uint32_t max_ns = 0;       // 最大の所要時間
+};
+
+// バス管理の統計
+struct BusStats
+{
+    BusDeviceStats devices[BUS_DEVICE_COUNT];
+    uint32_t ticks = 0;           // 処理した周期数
+    uint32_t budget_overruns = 0; // PWM と IMU だけで予算を超えた周期数
+    uint32_t max_tick_us = 0;     // 1周期の処理時間の最大値
+    uint32_t pwm_flushes = 0;     // PWM の書き込み要求でバススレッドが起きた回数
+    uint32_t on_demand_reads = 0; // 即時の読み取り要求の数
+    uint32_t idle_ticks = 0;      // アイドル中に処理した周期数
+};
+
+// 関数のプロトタイプ宣言
+// バス管理スレッドを開始する (開始前に全センサーを一度読み、最新値を用意しておく)
+bool bus_manager_start(const BusManagerConfig &config);
+// バス管理スレッドを停止する (未処理の PWM の書き込みを済ませてから戻る)。以降は直接アクセスに戻る
+void bus_manager_stop();
+// バス管理スレッドが動いているか
+bool bus_manager_running();
+// 統計を返す
+BusStats bus_manager_stats();
+// デバイス名を返す (ログ表示用)
+const char *bus_device_name(BusDevice device);
+// アイドル (低消費電力) にする/戻す。アイドル中は周期を idle_period_ms に延ばし、低速のセンサーは idle_slow_period_ms ごとに読む。
+// 戻すときは IMU をすぐに読み直すため、次の sensor_read_fast から最新値になる。PWM の書き込みと即時の読み取りはアイドル中もすぐに処理する
+void bus_manager_set_idle(bool idle);
+// 統計をログ用の文字列にする ("[BUS] ticks=... gyro=avg/max us ..."。書き込めなかった場合は false)
+bool format_bus_stats(const BusStats &stats, char *buffer, size_t buffer_size);
+
+// --- ハードウェアアクセス (バス管理の開始前・停止後は直接アクセス) ---
+// PWM 出力の有効/無効
+void bus_set_pwm_enable(bool enable);
+// PWM 周波数
+void bus_set_pwm_freq_hz(float freq_hz);
+// PWM デューティ比 (チャンネル 0-15)
+void bus_set_pwm_duty(int channel, float duty_cycle);
+// IMU の最新値
+void bus_read_imu(AxisData *accel, AxisData *gyro, AxisData *mag);
+// 低速のセンサーの最新値 (adc は adc_count 個まで。バス管理の実行中はフィルタバンクを通した値、開始前・停止後は1回読んだ生の値)
+void bus_read_slow(float *temperature, float *pressure, bool *leak, float *adc, int adc_count);
+// リークセンサーを今読む (バススレッドが読むまで待つ。浸水監視用)
+bool bus_read_leak_now();
+
+#endif // BUS_MANAGER_H
@@ -0,0 +1,71 @@
+#ifndef COMMAND_ARBITER_H
+#define COMMAND_ARBITER_H
+
+#include "gamepad.h" // GamepadData, CommandPacket を使用するため
+#include <netinet/in.h> // sockaddr_in を使用するため
+#include <stdint.h>  // uint32_t, uint64_t を使用するため
+
+#define ARBITER_MAX_SOURCES 8 // 同時に追跡する操縦コマンド送信元の最大数
+#define ARBITER_NO_SOURCE -1  // 有効な送信元がないことを示す値
+
+// 操縦コマンド送信元1件分の状態
+struct CommandSource
+{
+    bool in_use = false;           // このスロットが使用中かどうか
+    int source_id = 0;             // 送信元ID
+    int priority = 0;              // 優先度 (大きいほど優先)
+    uint32_t last_seq = 0;         // 最後に受理したシーケンス番号
+    bool seq_valid = false;        // last_seq が有効かどうか
+    uint64_t last_update_ms = 0;   // 最後にコマンドを受理した時刻 (CLOCK_MONOTONIC, ミリ秒)
+    uint32_t timeout_ms = 0;       // この送信元の鮮度の判定時間 (目標値コマンドで指定されたタイムアウト。0 なら調停器の既定値)
+    GamepadData command;           // 最新のコマンド
+    bool is_setpoint = false;      // 最新のコマンドが目標値コマンドかどうか
+    SetpointCommand setpoint;      // 最新の目標値 (is_setpoint の場合のみ有効)
+    uint32_t rejected_count = 0;   // 順序逆転・重複で破棄したパケット数
+    bool sender_bound = false;     // 送信元アドレスを結び付けたか (最初に受理したパケットの送信元)
+    bool sender_is_network = false; // 結び付けた送信元がネットワーク経由か (false は同一機体上のプロセス)
+    struct sockaddr_in sender = sockaddr_in(); // 結び付けた送信元アドレス
+    uint32_t address_rejected_count = 0; // 結び付けたものと異なるアドレスから届いたため破棄したパケット数
+    uint32_t unsupported_count = 0; // 機体が実行できない目標値 (上下方向のスラスターがない構成での深度保持) のため破棄したパケット数
+};
+
+// 複数の操縦コマンド送信元から、毎周期アクティブな送信元を1つ選ぶ調停器
+// 選択規則:
+//   1. TAKEOVER を要求した送信元が鮮度内であれば、優先度に関係なくその送信元
+//   2. それ以外は鮮度内の送信元のうち最も優先度が高いもの (同じ優先度なら現在のアクティブを維持)
+// 送信元テーブルは固定長 (ARBITER_MAX_SOURCES) のため、選択は送信元の数によらず一定時間で完了する。
+// 送信元IDは最初に受理したパケットの送信元アドレスに結び付け、別のアドレスからの同じIDのパケット
+// (TAKEOVER / RELEASE を含む) は破棄する。rebind_after_ms の間何も届かなかった送信元だけは、
+// 地上局の再起動 (送信ポートの変更) に備えて新しいアドレスに結び付け直す。
+struct CommandArbiter
+{
+    CommandSource sources[ARBITER_MAX_SOURCES];
+    int active_slot = ARBITER_NO_SOURCE;   // 現在アクティブな送信元のスロット番号
+    int takeover_slot = ARBITER_NO_SOURCE; // TAKEOVER 中の送信元のスロット番号
+    uint32_t freshness_timeout_ms = 200;   // この時間コマンドが届かない送信元は選択対象外
+    uint32_t rebind_after_ms = 5000;       // この時間何も届かなかった送信元は別のアドレスに結び付け直せる
+    bool depth_hold_supported = true;      // 深度保持の目標値を受け付けるか (上下方向のスラスターがない構成では false にする)
+    uint32_t switch_count = 0;             // アクティブな送信元が切り替わった回数
+};
+
+// 関数のプロトタイプ宣言
+// 調停器を初期化する
+void arbiter_init(CommandArbiter *arb, uint32_t freshness_timeout_ms);
+// 受信したパケット (操縦データ / 目標値 / TAKEOVER / RELEASE) を調停器に反映する。受理した場合は true
+bool arbiter_submit(CommandArbiter *arb, const CommandPacket &packet, uint64_t now_ms);
+// アクティブな送信元を選び直し、その送信元IDを返す (なければ ARBITER_NO_SOURCE)
+int arbiter_select(CommandArbiter *arb, uint64_t now_ms);
+// 現在アクティブな送信元IDを返す (なければ ARBITER_NO_SOURCE)
+int arbiter_active_source(const CommandArbiter *arb);
+// 現在アクティブな送信元の最新コマンドを返す (なければニュートラルのコマンド)
+GamepadData arbiter_active_command(const CommandArbiter *arb);
+// 現在アクティブな送信元の最新コマンドを受理した時刻を返す (なければ 0)
+uint64_t arbiter_active_update_ms(const CommandArbiter *arb);
+// ウォッチドッグに渡す、現在アクティブな送信元の最新コマンドの時刻を返す (なければ 0)
+// 通常は受理した時刻。目標値コマンドで既定より長いタイムアウトが指定されている場合はその差の分だけ後ろにずらし、
+// 送信元が鮮度切れになるのと同時にウォッチドッグが途絶と判定するようにする
+uint64_t arbiter_active_feed_ms(const CommandArbiter *arb);
+// 現在アクティブな送信元の最新コマンドが目標値コマンドなら setpoint に格納して true を返す
+bool arbiter_active_setpoint(const CommandArbiter *arb, SetpointCommand *setpoint);
+
+#endif // COMMAND_ARBITER_H
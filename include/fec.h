@@ -0,0 +1,110 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include <stddef.h> // size_t を使用するため
+#include <stdint.h> // uint8_t, uint16_t, uint32_t を使用するため
+
+// UDP データグラムの前方誤り訂正 (FEC)
+// 再送なしで欠落を補うため、送信側は次の2つを付加する:
+//   - 冗長コピー: 各データフレームに直前 redundancy 件のペイロードを同梱する (連続しない単発の欠落をその場で補う)
+//   - XOR パリティ: group_size 件ごとにパリティフレームを1つ送る (グループ内の1件の欠落を復元する)
+// フレームは先頭2バイトのマジック (0xFE 0xC0) で識別するため、テキストの操縦パケット・テレメトリと同じポートで混在できる。
+//
+// データフレーム:    FE C0 00 <件数> { <seq:4> <len:2> <ペイロード> } × 件数  (先頭が最新、以降は古い順に冗長コピー)
+// パリティフレーム:  FE C0 01 <group_size> <先頭seq:4> <長さのXOR:2> <最大長:2> <ペイロードのXOR:最大長>
+// 整数はネットワークバイトオーダー。seq は送信側のペイロードの通し番号で、パリティのグループは seq / group_size で決まる。
+
+#define FEC_MAGIC0 0xFE
+#define FEC_MAGIC1 0xC0
+#define FEC_MAX_PAYLOAD 512  // 保護できるペイロードの最大長 (SENSOR_BUFFER_SIZE と同じ)
+#define FEC_MAX_FRAME 1023   // フレームの最大長 (NET_BUFFER_SIZE の受信バッファに NUL 終端付きで収まる長さ)
+#define FEC_MAX_GROUP 8      // パリティグループの最大サイズ
+#define FEC_MAX_REDUNDANCY 3 // 冗長コピーの最大数
+#define FEC_HISTORY 16       // 復号側が保持するペイロード数 (2グループ分以上)
+#define FEC_MAX_PENDING 8    // 1フレームから取り出せるペイロードの最大数 (冗長コピー + 復元分)
+
+// 符号化の設定
+struct FecConfig
+{
+    uint8_t group_size = 4; // パリティを付けるペイロード数 (0 または 1 でパリティなし)。オーバーヘッドは 1/group_size
+    uint8_t redundancy = 1; // 各データフレームに同梱する直前のペイロード数 (0 で冗長コピーなし)
+};
+
+// 符号化側の状態
+struct FecEncoder
+{
+    FecConfig config;
+    uint32_t next_seq = 0;
+    // 冗長コピー用の直前のペイロード (新しい順)
+    uint8_t history[FEC_MAX_REDUNDANCY][FEC_MAX_PAYLOAD];
+    uint16_t history_len[FEC_MAX_REDUNDANCY];
+    uint32_t history_seq[FEC_MAX_REDUNDANCY];
+    int history_count = 0;
+    // 現在のグループのパリティ (XOR の累積)
+    uint8_t parity[FEC_MAX_PAYLOAD];
+    uint16_t parity_len_xor = 0;
+    uint16_t parity_max_len = 0;
+    uint8_t group_count = 0;
+};
+
+// 復号側の統計
+struct FecStats
+{
+    uint32_t data_frames = 0;         // 受信したデータフレーム数
+    uint32_t parity_frames = 0;       // 受信したパリティフレーム数
+    uint32_t malformed = 0;           // 形式が不正なフレーム数
+    uint32_t delivered = 0;           // 取り出したペイロード数 (重複を除く)
+    uint32_t recovered_redundant = 0; // 冗長コピーから補ったペイロード数
+    uint32_t recovered_parity = 0;    // パリティから復元したペイロード数
+    uint32_t duplicates = 0;          // 受信済みのため捨てたペイロード数
+    uint32_t expected = 0;            // 送信されたはずのペイロード数 (最初と最新の seq から計算)
+    uint32_t resyncs = 0;             // 送信側の再起動 (seq の大きな後戻り・無通信) で同期し直した回数
+};
+
+// 復号側が保持するペイロード1件
+struct FecSlot
+{
+    bool valid = false;
+    uint32_t seq = 0;
+    uint16_t len = 0;
+    uint8_t data[FEC_MAX_PAYLOAD];
+};
+
+// 復号側の状態 (送信元ごとに1つ)
+// seq が保持している窓 (FEC_HISTORY) より大きく戻った場合は、送信側が再起動したとみなして窓を始め直す
+struct FecDecoder
+{
+    bool started = false;
+    uint32_t first_seq = 0;     // 最初に受信した seq (同期し直した場合はその時点の seq)
+    uint32_t highest_seq = 0;   // 受信した最大の seq (32bit の一周を考慮して比較する)
+    uint32_t expected_base = 0; // 同期し直す前までの expected の累計
+    uint64_t delivered_mask = 0; // bit i: highest_seq - i を取り出し済み
+    FecSlot slots[FEC_HISTORY]; // seq % FEC_HISTORY の位置に保持
+    uint32_t pending[FEC_MAX_PENDING]; // 取り出し待ちのペイロードの seq (受理した順)
+    int pending_head = 0;
+    int pending_count = 0;
+    FecStats stats;
+};
+
+// 関数のプロトタイプ宣言
+// 符号化側を初期化する (group_size, redundancy は上限に丸める)
+void fec_encoder_init(FecEncoder *enc, const FecConfig &config);
+// ペイロードを符号化する。frames[0] にデータフレーム、グループが揃った場合は frames[1] にパリティフレームを書き込み、
+// フレーム数 (1 または 2) を返す。ペイロードが FEC_MAX_PAYLOAD を超える場合は 0 (呼び出し側で素のまま送る)
+int fec_encode(FecEncoder *enc, const uint8_t *payload, size_t len, uint8_t frames[2][FEC_MAX_FRAME], size_t frame_len[2]);
+// FEC のフレームかどうか (先頭のマジックで判定)
+bool fec_is_frame(const uint8_t *data, size_t len);
+// 復号側を初期化する
+void fec_decoder_init(FecDecoder *dec);
+// 次に受信するフレームから同期し直す (無通信が続いた後など。統計は累計を保つ)
+void fec_decoder_resync(FecDecoder *dec);
+// フレームを復号し、新しく取り出せるようになったペイロード数を返す (形式が不正なら -1)
+int fec_decode(FecDecoder *dec, const uint8_t *frame, size_t len);
+// 取り出し待ちのペイロードを受理した順に1つ取り出す (out は NUL 終端する)。なければ false
+bool fec_next_payload(FecDecoder *dec, char *out, size_t out_size, size_t *out_len);
+// 受信前の欠落率 (データフレームが届かなかった割合)
+float fec_raw_loss_rate(const FecStats &stats);
+// FEC で補った後の欠落率 (取り出せなかったペイロードの割合)
+float fec_effective_loss_rate(const FecStats &stats);
+
+#endif // FEC_H
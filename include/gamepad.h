@@ -1,6 +1,7 @@
 #ifndef GAMEPAD_H
 #define GAMEPAD_H
 
+#include <netinet/in.h> // sockaddr_in を使用するため
 #include <stdint.h> // 固定幅整数型 (uint16_t など) を使用するため
 #include <string>   // std::string を使用するため
 #include <vector>   // 将来的な使用や代替のパース方法のために含める (現在は未使用)
@@ -35,8 +36,66 @@ enum GamepadButton : uint32_t // 基底型を明示的に指定
     Y = 0x8000              // Y ボタン (標準的な値 0x8000)
 };
 
+// 受信パケットの種類
+enum CommandPacketType
+{
+    CommandInvalid = 0, // パース失敗
+    CommandGamepad,     // 操縦データ (従来形式または送信元ヘッダ付き形式)
+    CommandTakeover,    // 操縦権の明示的な取得要求 "TAKEOVER,<source_id>[,<priority>]"
+    CommandRelease,     // 操縦権の明示的な解放 "RELEASE,<source_id>"
+    CommandSetpoint     // 機体座標系の推力・方位・深度の目標値 "S,..." (閉ループは機体側で実行)
+};
+
+// 従来形式 (送信元ヘッダなし) のパケットに割り当てる送信元IDと優先度
+#define LEGACY_SOURCE_ID 0
+#define LEGACY_SOURCE_PRIORITY 10
+
+// 目標値コマンドのタイムアウトの既定値と上限 (ミリ秒)
+// タイムアウト内に次の目標値が届かなければ送信元は鮮度切れとなり、他の送信元またはフェイルセーフに移る
+#define SETPOINT_DEFAULT_TIMEOUT_MS 500
+#define SETPOINT_MAX_TIMEOUT_MS 5000
+
+// 目標値コマンド (自律制御プロセスなど、スティック操作を模擬しない送信元向け)
+// 形式: "S,<source_id>,<seq>,<priority>,<surge>,<sway>,<heave>,<yaw_rate>,<heading>,<depth>,<timeout_ms>"
+//   surge/sway/heave: 機体座標系の推力 (-1.0 〜 1.0、前・右・上が正)
+//   yaw_rate: ヨー角速度の目標値 (deg/s、右旋回が正)。heading を指定した場合は無視
+//   heading: 方位の目標値 (度)。"-" または空なら方位保持なし
+//   depth: 深度の目標値 (m、下向き正)。"-" または空なら深度保持なし (heave をそのまま使う)
+//   timeout_ms: この目標値の有効時間 (0 なら既定値)
+struct SetpointCommand
+{
+    float surge = 0.0f;
+    float sway = 0.0f;
+    float heave = 0.0f;
+    float yaw_rate_dps = 0.0f;
+    bool hold_heading = false;
+    float heading_deg = 0.0f;
+    bool hold_depth = false;
+    float depth_m = 0.0f;
+    uint32_t timeout_ms = SETPOINT_DEFAULT_TIMEOUT_MS;
+};
+
+// 送信元情報付きの操縦コマンド
+// 形式: "C,<source_id>,<seq>,<priority>,LX,LY,RX,RY,LT,RT,BUTTONS"
+// 従来の "LX,LY,RX,RY,LT,RT,BUTTONS" は source_id=LEGACY_SOURCE_ID、シーケンス番号なしとして扱う
+struct CommandPacket
+{
+    CommandPacketType type = CommandInvalid;
+    int source_id = LEGACY_SOURCE_ID;       // 送信元ID (主操縦者、予備操縦席、自律プロセスなどを区別)
+    uint32_t seq = 0;                       // 送信元ごとのシーケンス番号
+    bool has_seq = false;                   // シーケンス番号が付与されているか (従来形式は false)
+    int priority = LEGACY_SOURCE_PRIORITY;  // 優先度 (大きいほど優先)
+    bool has_priority = true;               // 優先度が指定されているか (TAKEOVER は省略でき、その場合は現在の優先度を保つ)
+    GamepadData gamepad;                    // 操縦データ本体
+    SetpointCommand setpoint;               // 目標値 (type が CommandSetpoint の場合のみ有効)
+    bool has_sender = false;                // ネットワーク経由で受信したか (false は同一機体上のプロセスから)
+    struct sockaddr_in sender = sockaddr_in(); // 受信したパケットの送信元アドレス (has_sender の場合のみ有効)
+};
+
 // 関数のプロトタイプ宣言
 // 受信した文字列データを GamepadData 構造体にパースする関数
 GamepadData parseGamepadData(const std::string &data);
+// 受信した文字列データを送信元情報付きの CommandPacket にパースする関数 (従来形式も受け付ける)
+CommandPacket parseCommandPacket(const std::string &data);
 
 #endif // GAMEPAD_H
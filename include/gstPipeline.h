@@ -6,5 +6,8 @@
 
 bool start_gstreamer_pipelines();
 void stop_gstreamer_pipelines();
+bool set_gstreamer_recording(bool enable); // オンボード録画を開始/停止する (実行時に切り替え可能)
+bool is_gstreamer_recording();             // 現在録画中かどうか
+void set_gstreamer_idle(bool idle);        // アイドル中は全パイプラインを READY に落とす (キャプチャ・エンコードを止める。録画中は落とさない)
 
 #endif // GST_PIPELINE_H
@@ -0,0 +1,81 @@
+#ifndef IDLE_MODE_H
+#define IDLE_MODE_H
+
+#include "bindings.h" // AxisData を使用するため
+#include <stddef.h>   // size_t を使用するため
+#include <stdint.h>   // uint32_t, uint64_t を使用するため
+
+// 低消費電力のアイドルモード
+// 操縦者がいない (どの送信元からも鮮度内のコマンドがない) 状態で、スラスターが停止 (PWM_STOP) し、
+// 機体が静止している (角速度が小さい) 状態が enter_after_ms 続いたらアイドルに移行する。
+// アイドル中はメインループの周期を下げ (受信ソケットを poll で待つため、操縦パケットが届けばすぐに起きる)、
+// 映像パイプラインを READY に落とし (キャプチャ・エンコードを止める)、バス管理のセンサー読み取りを最小限の周期にする。
+// 操縦者が現れたらその周期のうちに通常の周期に戻る。
+// 状態ごとの CPU 時間・起床回数 (コンテキストスイッチ)・ループ回数を集計し、消費電力の目安としてログに出す。
+// 浸水監視とウォッチドッグのスレッドはアイドル中も通常の周期で動く。
+
+// 電力状態
+enum PowerState
+{
+    POWER_STATE_ACTIVE = 0, // 通常 (100Hz)
+    POWER_STATE_IDLE,       // アイドル
+    POWER_STATE_COUNT
+};
+
+// アイドルモードの設定
+struct IdleConfig
+{
+    uint32_t enter_after_ms = 5000;     // 操縦者なし・停止・静止がこれだけ続いたらアイドルに移行する
+    uint32_t active_period_ms = 10;     // 通常のループ周期 (100Hz)
+    uint32_t idle_period_ms = 100;      // アイドル中のループ周期 (10Hz)
+    float stationary_rate_dps = 2.0f;   // 静止とみなす角速度の大きさの上限 [deg/s] (波で揺れている間はアイドルにしない)
+};
+
+// プロセスの資源使用量の標本 (getrusage)
+struct PowerUsage
+{
+    uint64_t cpu_ns = 0;           // ユーザー + システムの CPU 時間 (全スレッドの合計)
+    uint64_t context_switches = 0; // 自発的 + 非自発的なコンテキストスイッチの回数 (起床回数の目安)
+};
+
+// 電力状態ごとの累計
+struct PowerStateStats
+{
+    uint64_t time_ms = 0;          // この状態にいた時間
+    uint64_t cpu_ns = 0;           // この状態の間に使った CPU 時間
+    uint64_t context_switches = 0; // この状態の間のコンテキストスイッチの回数
+    uint64_t ticks = 0;            // この状態の間のメインループの回数
+    uint32_t entries = 0;          // この状態に入った回数
+};
+
+// アイドルモードの状態
+struct IdleController
+{
+    IdleConfig config;
+    PowerState state = POWER_STATE_ACTIVE;
+    bool quiet = false;            // 操縦者なし・停止・静止の条件を満たしているか
+    uint64_t quiet_since_ms = 0;   // 条件を満たし始めた時刻
+    uint64_t state_since_ms = 0;   // 現在の状態に入った時刻 (または最後に集計した時刻)
+    PowerUsage state_usage;        // その時点の資源使用量
+    PowerStateStats stats[POWER_STATE_COUNT];
+};
+
+// 関数のプロトタイプ宣言
+// 初期化する (通常の状態から始める)
+void idle_init(IdleController *idle, const IdleConfig &config, uint64_t now_ms, const PowerUsage &usage);
+// 1周期分の状態を渡して電力状態を更新する。状態が変わった周期だけ true を返す
+// operator_present: 鮮度内の操縦コマンドがある, outputs_stopped: 全スラスターが PWM_STOP, gyro: 角速度 [deg/s]
+bool idle_update(IdleController *idle, bool operator_present, bool outputs_stopped, const AxisData &gyro,
+                 uint64_t now_ms, const PowerUsage &usage);
+// 現在の状態のループ周期 [ms]
+uint32_t idle_loop_period_ms(const IdleController *idle);
+// 状態ごとの累計を返す (現在の状態は now_ms / usage までの分を含める)
+void idle_stats(const IdleController *idle, uint64_t now_ms, const PowerUsage &usage, PowerStateStats out[POWER_STATE_COUNT]);
+// 状態名を返す (ログ表示用)
+const char *power_state_name(PowerState state);
+// プロセスの資源使用量を読む (失敗した場合は false)
+bool power_usage_sample(PowerUsage *usage);
+// 状態ごとの累計をログ用の文字列にする ("[POWER] state=... active: cpu=..% wakeups=../s loop=../s ...")
+bool format_power_stats(const IdleController *idle, uint64_t now_ms, const PowerUsage &usage, char *buffer, size_t buffer_size);
+
+#endif // IDLE_MODE_H
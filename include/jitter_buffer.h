@@ -0,0 +1,79 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include "gamepad.h" // GamepadData を使用するため
+#include <stdint.h>  // uint32_t, uint64_t を使用するため
+
+// 操縦コマンドのジッタバッファ
+// 受信時刻付きのコマンド履歴を保持し、Wi-Fi やテザーの短い途切れ (数十〜百数十ms) の間に
+// 制御ループへ渡すコマンドを方式 (JitterPolicy) に従って補う。フェイルセーフの判定 (調停器の鮮度・ウォッチドッグ) には関与しないが、
+// 途切れの判定はウォッチドッグと同じ「最後に受理したパケットの時刻」から数え、deadline_ms (途絶の判定時間) までにニュートラルへ戻す。
+
+#define JITTER_HISTORY_SIZE 16 // 保持するコマンド履歴の件数
+
+// 途切れの間のコマンドの補い方
+enum JitterPolicy
+{
+    JITTER_POLICY_HOLD = 0,        // 最後に受信したコマンドをそのまま保持する (従来の動作)
+    JITTER_POLICY_EXTRAPOLATE = 1, // スティックを直近の変化率で線形外挿し、その後ニュートラルへ減衰させる
+    JITTER_POLICY_DELAYED = 2      // 一定時間遅らせて履歴を補間再生する (遅延と引き換えに滑らか)
+};
+
+// ジッタバッファの設定
+struct JitterConfig
+{
+    JitterPolicy policy = JITTER_POLICY_HOLD;
+    uint32_t gap_threshold_ms = 40;  // 最後の受信からこの時間を超えたら途切れとみなす
+    uint32_t extrapolate_ms = 50;    // 途切れ後に線形外挿する最大時間
+    uint32_t decay_ms = 100;         // 外挿の後、ニュートラルまで減衰させる時間
+    uint32_t deadline_ms = 200;      // 最後の受信からこの時間までにニュートラルへ戻す (ウォッチドッグの link_timeout_ms と同じ値にする)。
+                                     // 途切れ判定+外挿+減衰がこれを超える場合は減衰を短くする
+    uint32_t playout_delay_ms = 40;  // JITTER_POLICY_DELAYED の再生遅延
+};
+
+// 各方式が働いた周期数の統計
+struct JitterStats
+{
+    uint32_t samples = 0;      // jitter_sample の呼び出し回数
+    uint32_t fresh = 0;        // 途切れなし (受信したコマンドをそのまま使用)
+    uint32_t held = 0;         // 途切れ中に最後のコマンドを保持
+    uint32_t extrapolated = 0; // 途切れ中に線形外挿
+    uint32_t decayed = 0;      // 途切れ中にニュートラルへ減衰
+    uint32_t interpolated = 0; // 遅延再生で履歴を補間
+    uint32_t underruns = 0;    // 遅延再生で再生位置が最新の受信に追いついた
+    uint32_t gaps = 0;         // 途切れの発生回数
+    uint32_t max_gap_ms = 0;   // 観測した最長の途切れ
+};
+
+// 受信時刻付きのコマンド1件
+struct JitterSample
+{
+    uint64_t time_ms = 0; // 受信時刻 (CLOCK_MONOTONIC, ミリ秒)
+    GamepadData command;
+};
+
+// ジッタバッファの状態 (リングバッファ)
+struct JitterBuffer
+{
+    JitterConfig config;
+    JitterSample history[JITTER_HISTORY_SIZE];
+    int head = 0;        // 最新のサンプルの位置
+    int count = 0;       // 保持しているサンプル数
+    int source_id = -1;  // 履歴の送信元ID (送信元が切り替わったら履歴を破棄する)
+    bool in_gap = false; // 途切れ中かどうか (統計用)
+    JitterStats stats;
+};
+
+// 関数のプロトタイプ宣言
+// ジッタバッファを初期化する
+void jitter_init(JitterBuffer *jb, const JitterConfig &config);
+// 受信したコマンドを履歴に追加する (同じ時刻のコマンドは最新のものに置き換える)
+void jitter_push(JitterBuffer *jb, int source_id, const GamepadData &command, uint64_t time_ms);
+// 現在時刻に制御ループへ渡すコマンドを求める (履歴が空ならニュートラル)
+GamepadData jitter_sample(JitterBuffer *jb, uint64_t now_ms);
+// 履歴を破棄する (統計は保持)
+void jitter_reset(JitterBuffer *jb);
+// 方式名を返す (ログ用)
+const char *jitter_policy_name(JitterPolicy policy);
+
+#endif // JITTER_BUFFER_H
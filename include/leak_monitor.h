@@ -0,0 +1,75 @@
+#ifndef LEAK_MONITOR_H
+#define LEAK_MONITOR_H
+
+#include "thruster_control.h" // NUM_THRUSTERS, ThrusterOutputOwner を使用するため
+#include <netinet/in.h>       // sockaddr_in を使用するため
+#include <stdint.h>           // uint32_t, uint64_t を使用するため
+
+// 浸水監視
+// メインループ・通信の状態とは独立したスレッド (timerfd) でリークセンサーを高レートで読み、
+// 浸水を確定したら設定した保護動作を直ちに出力し、テレメトリの送信周期を待たずに警報パケットを送る。
+// 検知はラッチされ、leak_monitor_clear() を呼ぶまで保護動作を続ける。
+// 運用中の解除は、操縦者がコントローラーの Back+Start を LEAK_CLEAR_HOLD_MS 押し続けて行う (メインループが leak_clear_gesture_update() で判定する)。
+
+#define LEAK_MAX_ALERT_TARGETS 8 // 警報の送信先の最大数
+#define LEAK_CLEAR_BUTTONS (GamepadButton::Back | GamepadButton::Start) // ラッチを解除するボタンの組み合わせ
+#define LEAK_CLEAR_HOLD_MS 2000  // 解除に必要な押し続ける時間 (誤操作での解除を防ぐ)
+
+// 浸水を確定したときの保護動作
+enum LeakAction
+{
+    LEAK_ACTION_ALERT_ONLY = 0, // 警報のみ (出力は操縦者に任せる)
+    LEAK_ACTION_STOP,           // 全スラスターを直ちに停止する
+    LEAK_ACTION_SURFACE         // 指定チャンネルに浮上用のPWMを出力し、他は停止する (上下方向のスラスターがなければ STOP になる)
+};
+
+// 浸水監視の設定
+struct LeakMonitorConfig
+{
+    uint32_t period_ms = 5;             // サンプリング周期 (timerfd の周期。0 は 1 として扱う)
+    uint32_t confirm_samples = 2;       // 連続してこの回数検知したら浸水と確定する (ノイズ対策)。反応は period_ms * confirm_samples 以内
+    LeakAction action = LEAK_ACTION_STOP;
+    int surface_pwm = 1600;             // LEAK_ACTION_SURFACE で出力するPWM値
+    uint32_t surface_channel_mask = 0;  // 浮上に使用するチャンネル (bit n = Ch n)。0 なら推力配分表で上向きの全チャンネル
+    bool flash_led = true;              // 保護動作中に LED_PWM_CHANNEL を点滅させる (LEAK_ACTION_ALERT_ONLY では出力を占有しないため無効)
+    uint32_t led_flash_period_ms = 250; // 点滅の切り替え間隔
+    uint32_t alert_repeat_ms = 1000;    // 検知中に警報パケットを再送する間隔 (UDP の欠落対策)
+};
+
+// 浸水監視の統計
+struct LeakMonitorStats
+{
+    uint32_t samples = 0;         // センサーを読んだ回数
+    uint32_t detections = 0;      // 浸水を確定した回数
+    uint32_t alerts_sent = 0;     // 送信した警報パケット数 (送信先ごと)
+    uint32_t last_reaction_us = 0; // 最初にセンサーが反応してから保護動作を出力するまでの時間
+    uint32_t max_sample_gap_us = 0; // サンプリング間隔の最大値 (周期の遅れの確認用)
+};
+
+// ラッチ解除のボタン操作の判定状態 (メインループが保持する)
+struct LeakClearGesture
+{
+    bool holding = false;  // 組み合わせを押し続けているか
+    uint64_t since_ms = 0; // 押し始めた時刻
+    bool fired = false;    // この押下で既に解除を要求したか (離すまで再度要求しない)
+};
+
+// 関数のプロトタイプ宣言
+// 浸水監視スレッドを開始する
+bool leak_monitor_start(const LeakMonitorConfig &config);
+// 浸水監視スレッドを停止する (保護動作中であれば出力の占有も解除する)
+void leak_monitor_stop();
+// 浸水を確定しているかどうか (ラッチ)
+bool leak_monitor_leak_detected();
+// ラッチを解除して出力を返す (浸水が続いていれば再び検知される)
+void leak_monitor_clear();
+// ボタンの状態を渡し、LEAK_CLEAR_BUTTONS を LEAK_CLEAR_HOLD_MS 押し続けた時点で1度だけ true を返す
+bool leak_clear_gesture_update(LeakClearGesture *gesture, uint16_t buttons, uint64_t now_ms);
+// 警報の送信先を設定する (メインループがテレメトリの送信先をコピーして渡す)
+void leak_monitor_set_alert_targets(const struct sockaddr_in *targets, int count);
+// 統計を返す
+LeakMonitorStats leak_monitor_stats();
+// 保護動作名を返す (ログ・警報パケット用)
+const char *leak_action_name(LeakAction action);
+
+#endif // LEAK_MONITOR_H
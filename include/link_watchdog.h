@@ -0,0 +1,61 @@
+#ifndef LINK_WATCHDOG_H
+#define LINK_WATCHDOG_H
+
+#include "thruster_control.h" // PWM_STOP, NUM_THRUSTERS を使用するため
+#include <stdint.h>           // uint32_t, uint64_t を使用するため
+
+// 通信監視 (ウォッチドッグ) の状態
+// WAITING -> NORMAL -> HOLD -> RAMP_DOWN -> SAFE (-> SURFACE) と段階的に遷移し、
+// どの段階でも操縦コマンドが再開すれば NORMAL に戻る
+enum WatchdogState
+{
+    WATCHDOG_WAITING = 0, // 最初の操縦コマンド待ち (スラスターは安全値)
+    WATCHDOG_NORMAL,      // 正常 (メインループが出力を制御)
+    WATCHDOG_HOLD,        // 途絶直後: 最後のコマンドを短時間保持する
+    WATCHDOG_RAMP_DOWN,   // 設定したスルーレートで安全値に向けて出力を下げる
+    WATCHDOG_SAFE,        // 安全値で停止
+    WATCHDOG_SURFACE      // 浮上 (オプション): 指定チャンネルに浮上用のPWMを出力する
+};
+
+// ウォッチドッグの設定
+struct WatchdogConfig
+{
+    uint32_t period_ms = 10;          // 監視周期 (timerfd の周期)。途絶検知の遅れはこの値以内に収まる
+    uint32_t link_timeout_ms = 200;   // 最後の feed からこの時間が経過したら HOLD に移行
+    uint32_t hold_ms = 300;           // HOLD で最後のコマンドを保持する時間
+    int ramp_slew_us_per_s = 2000;    // RAMP_DOWN での出力変化率 (PWMパルス幅 マイクロ秒/秒)
+    int safe_pwm = PWM_STOP;          // SAFE で出力するPWM値
+    bool surface_enabled = false;     // SAFE の後に浮上するかどうか
+    uint32_t surface_delay_ms = 2000; // SAFE に入ってから浮上を開始するまでの時間
+    int surface_pwm = 1600;           // 浮上時に出力するPWM値
+    uint32_t surface_channel_mask = 0; // 浮上に使用するチャンネル (bit n = Ch n)。0 なら推力配分表で上向きの全チャンネル。
+                                       // 上下方向のスラスターがない構成では浮上は警告を出して無効になる
+};
+
+// 関数のプロトタイプ宣言
+// ウォッチドッグスレッドを開始する
+bool watchdog_start(const WatchdogConfig &config);
+// スレッドを使わない手動駆動モードで開始する (シミュレーターなど、実時間と異なる時刻で動かす場合)
+// 以降は watchdog_step を period_ms ごとに呼び出して状態を進める。停止は watchdog_stop
+void watchdog_start_manual(const WatchdogConfig &config);
+// 手動駆動モードで1周期分の監視処理を行う (手動駆動モードでなければ何もしない)
+void watchdog_step(uint64_t now_ns);
+// ウォッチドッグスレッドを停止する (手動駆動モードも終了する)
+void watchdog_stop();
+// 有効な操縦コマンドを受け取ったことを通知する (現在時刻で feed する)
+void watchdog_feed();
+// 有効な操縦コマンドを command_ns (CLOCK_MONOTONIC) に受け取ったことを通知する (メインループから毎周期呼び出す)
+// 途絶の判定は最後のパケットの受理時刻から数えるため、調停器の鮮度判定の分だけフェイルセーフが遅れることはない。
+// 既に feed された時刻より古い時刻は無視する
+void watchdog_feed_at(uint64_t command_ns);
+// 再起動前のプロセスが最後に feed した時刻を引き継ぐ (ウォーム再起動時、watchdog_start の直後に呼び出す)
+// 操縦コマンドが途絶えたままなら、復元した出力から通常どおり HOLD -> RAMP_DOWN -> SAFE に進む
+void watchdog_restore_feed(uint64_t last_feed_ns);
+// 現在の状態を返す
+WatchdogState watchdog_state();
+// メインループが通常制御を行ってよいかどうか (NORMAL のときのみ true)
+bool watchdog_control_allowed();
+// 状態名を返す (ログ表示用)
+const char *watchdog_state_name(WatchdogState state);
+
+#endif // LINK_WATCHDOG_H
@@ -0,0 +1,34 @@
+#ifndef MONOTONIC_CLOCK_H
+#define MONOTONIC_CLOCK_H
+
+#include <stdint.h> // uint64_t を使用するため
+#include <time.h>   // clock_gettime, CLOCK_MONOTONIC を使用するため
+
+#ifdef MONOTONIC_CLOCK_SIMULATED
+// シミュレーター用のビルド (make sim): 時刻はシミュレーターが進める。
+// 制御コード (スルーレート制限・ウォッチドッグなど) を実時間より速く、決定的に実行するため
+uint64_t simulated_clock_now_ns();            // sim/ で定義する
+void simulated_clock_set_ns(uint64_t now_ns); // sim/ で定義する
+
+static inline uint64_t monotonic_now_ns()
+{
+    return simulated_clock_now_ns();
+}
+#else
+// CLOCK_MONOTONIC による現在時刻をナノ秒で返す
+// gettimeofday と異なり NTP などによる時刻補正で巻き戻ったり飛んだりしないため、経過時間の計測に使用する
+static inline uint64_t monotonic_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+// CLOCK_MONOTONIC による現在時刻をミリ秒で返す
+static inline uint64_t monotonic_now_ms()
+{
+    return monotonic_now_ns() / 1000000ULL;
+}
+
+#endif // MONOTONIC_CLOCK_H
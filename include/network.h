@@ -5,11 +5,34 @@
 #include <sys/time.h>   // struct timeval を使用するため
 #include <stdbool.h>    // bool 型を使用するため
 #include <stddef.h>     // size_t 型を使用するため
+#include <stdint.h>     // uint32_t, uint64_t 型を使用するため
+#include "fec.h"        // 前方誤り訂正 (FecEncoder, FecDecoder) を使用するため
 
 #define DEFAULT_RECV_PORT 12345 // デフォルトの受信UDPポート番号
 #define DEFAULT_SEND_PORT 12346 // デフォルトの送信UDPポート番号
 #define NET_BUFFER_SIZE 1024    // ネットワーク送受信バッファのサイズ (バイト単位)
 
+// --- テレメトリ購読者テーブル関連の定数 ---
+#define MAX_TELEMETRY_SUBSCRIBERS 8       // 同時に登録できるテレメトリ購読者の最大数
+#define SUBSCRIBER_EXPIRY_MS 10000        // 購読の有効期限 (ミリ秒)。この時間内に SUB の再送 (または操縦パケット) がなければ削除
+#define NETWORK_FEC_PEERS 4               // FEC フレームを復号する送信元の最大数 (送信元ごとに復号状態を持つ)
+#define NETWORK_FEC_IDLE_RESYNC_MS 1000   // この時間 FEC フレームが届かなかった送信元は、次のフレームで seq を同期し直す (送信側の再起動対策)
+#define DEFAULT_TELEMETRY_RATE_HZ 100     // 購読時にレートが指定されなかった場合のテレメトリ送信レート (Hz)。
+                                          // フィールドごとのレートと帯域はテレメトリスケジューラが管理するため、既定では間引かない
+
+// テレメトリ購読者1件分の情報
+// 購読は "SUB,<rate_hz>[,<port>]" を受信ポートに送ることで登録/更新、"UNSUB" で解除する。
+// rate_hz は network_send で送るフレーム (テレメトリの差分フレーム) に適用される。キーフレームは network_send_to_all で全員に送られる。
+// 操縦パケットを送ってきたクライアントはデフォルトレートで自動的に登録される。
+typedef struct
+{
+    bool active;              // このスロットが使用中かどうか
+    struct sockaddr_in addr;  // テレメトリの送信先アドレス
+    uint32_t interval_ms;     // 送信間隔 (ミリ秒)。要求レートから計算
+    uint64_t next_send_ms;    // 次に送信してよい時刻 (CLOCK_MONOTONIC, ミリ秒)
+    uint64_t expires_at_ms;   // 購読の有効期限 (CLOCK_MONOTONIC, ミリ秒)
+} TelemetrySubscriber;
+
 // ネットワーク通信の状態を保持する構造体
 typedef struct
 {
@@ -21,13 +44,32 @@ typedef struct
     socklen_t client_addr_len;           // client_addr_recv のサイズを格納する変数
     bool client_addr_known;              // 送信先クライアントアドレスが設定されているかを示すフラグ
     struct timeval last_successful_recv_time; // 最後にデータパケットを正常に受信した時刻
+    TelemetrySubscriber subscribers[MAX_TELEMETRY_SUBSCRIBERS]; // テレメトリ購読者テーブル
+    bool multicast_enabled;                   // true の場合、テレメトリはマルチキャストグループへ1回だけ送信する
+    struct sockaddr_in multicast_addr;        // マルチキャスト送信先 (グループアドレスとポート)
+    bool fec_tx_enabled;                      // true の場合、テレメトリを FEC フレームで送信する
+    FecEncoder fec_tx;                        // テレメトリ送信用の符号化状態
+    FecDecoder fec_rx[NETWORK_FEC_PEERS];     // 受信した FEC フレームの送信元ごとの復号状態
+    struct sockaddr_in fec_rx_addr[NETWORK_FEC_PEERS]; // fec_rx の送信元アドレス
+    bool fec_rx_used[NETWORK_FEC_PEERS];      // fec_rx のスロットが使用中かどうか
+    uint64_t fec_rx_last_ms[NETWORK_FEC_PEERS]; // fec_rx の送信元から最後に FEC フレームを受信した時刻 (CLOCK_MONOTONIC)
+    int fec_rx_next_victim;                   // 空きがないときに再利用するスロット
 } NetworkContext;
 
 // 関数のプロトタイプ宣言
 bool network_init(NetworkContext *ctx, int recv_port, int send_port);           // ネットワークコンテキストを初期化し、ソケットを作成・バインドする
 void network_close(NetworkContext *ctx);                                        // ネットワーク関連のリソース（ソケット）を解放する
 ssize_t network_receive(NetworkContext *ctx, char *buffer, size_t buffer_size); // UDPデータを受信する (ノンブロッキング)
-bool network_send(NetworkContext *ctx, const char *data, size_t data_len);      // UDPデータを送信する
-bool network_update_send_address(NetworkContext *ctx);                          // 最後に受信したクライアントのアドレスを送信先として設定するヘルパー関数
+bool network_send(NetworkContext *ctx, const char *data, size_t data_len);      // UDPデータを送信期限に達した全購読者へまとめて送信する (sendmmsg 1回)
+bool network_send_to_all(NetworkContext *ctx, const char *data, size_t data_len); // 購読者ごとのレートに関係なく全購読者へ送信する
+bool network_update_send_address(NetworkContext *ctx);                          // 最後に受信したクライアントのアドレスを購読者として登録/更新するヘルパー関数
+bool network_subscribe(NetworkContext *ctx, const struct sockaddr_in *addr, int rate_hz); // 購読者を登録/更新する (rate_hz <= 0 はデフォルトレート)
+void network_unsubscribe(NetworkContext *ctx, const struct sockaddr_in *addr);  // 購読者を削除する
+int network_subscriber_count(const NetworkContext *ctx);                        // 現在有効な購読者数を返す
+int network_get_telemetry_targets(const NetworkContext *ctx, struct sockaddr_in *out, int max_targets); // テレメトリの送信先 (購読者またはマルチキャストグループ) を out にコピーし、その数を返す
+bool network_enable_multicast(NetworkContext *ctx, const char *group_ip, int port, int ttl); // テレメトリ送信をマルチキャストに切り替える
+
+bool network_enable_fec(NetworkContext *ctx, const FecConfig &config);          // テレメトリの送信を FEC フレームに切り替える (受信側の FEC フレームは常に自動で復号する)
+void network_fec_stats(const NetworkContext *ctx, FecStats *out);               // 全送信元の FEC 受信統計を合計する
 
 #endif // NETWORK_H
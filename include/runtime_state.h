@@ -0,0 +1,93 @@
+#ifndef RUNTIME_STATE_H
+#define RUNTIME_STATE_H
+
+// 再起動をまたいで引き継ぐ実行時状態 (共有メモリ)
+// 制御プロセスが異常終了・再起動しても、プロセスの外 (/dev/shm) に残した状態から素早く制御を再開するため、
+// 制御ループは毎周期ここに最新の状態を保存する。保存から RUNTIME_STATE_MAX_AGE_MS 以内に起動した制御プロセスは
+// 「ウォーム再起動」として状態を復元し、スラスターを PWM_STOP に戻さずに最後の出力から制御を再開する。
+//   - 保存はダブルバッファ: 使っていない側のスロットに書いてから active_slot を切り替えるため、
+//     書き込み中に異常終了しても、もう一方のスロットには一貫した状態が残る。
+//   - 監視プロセス (supervisor) は子プロセスの終了を検知した時刻をここに書き、再起動後の制御プロセスが
+//     終了検知から最初の制御周期までの時間 (restart-to-control) を計算する。
+//   - 映像を別プロセスで動かす場合の録画の切り替え要求もここでやり取りする。
+// 状態バス (state_bus) と同じく、共有メモリ上の std::atomic はロックフリーであることを前提とする。
+
+#include "thruster_control.h"   // NUM_THRUSTERS を使用するため
+#include "command_arbiter.h"    // CommandArbiter を使用するため
+#include "network.h"            // TelemetrySubscriber, MAX_TELEMETRY_SUBSCRIBERS を使用するため
+#include "attitude_estimator.h" // AttitudeEstimator を使用するため
+#include <atomic>               // std::atomic を使用するため
+#include <stdint.h>             // uint32_t, uint64_t を使用するため
+
+#define RUNTIME_STATE_DEFAULT_NAME "/ws3_runtime_state" // shm_open に渡す共有メモリ名
+#define RUNTIME_STATE_MAGIC 0x57533352u                 // "WS3R"
+#define RUNTIME_STATE_VERSION 3                         // レイアウトを変更したら上げる (不一致なら作り直す)
+#define RUNTIME_STATE_MAX_AGE_MS 1000                   // これより古い状態は復元しない (コールドスタートになる)
+
+// 制御ループが毎周期保存する状態
+struct RuntimeSnapshot
+{
+    uint64_t saved_ns;                      // 保存した時刻 (CLOCK_MONOTONIC。プロセスをまたいで比較できる)
+    uint32_t tick;                          // 制御周期の通し番号
+    int32_t thruster_pwm[NUM_THRUSTERS];    // 最後に出力したスラスターのPWM値
+    int32_t led_pwm;                        // LED の状態 (LED_PWM_ON / LED_PWM_OFF)
+    uint64_t last_command_ns;               // 最後に受理した操縦コマンドの時刻 (0 = 未接続)。ウォッチドッグに引き継ぐ
+    CommandArbiter arbiter;                 // 送信元ごとのシーケンス番号・優先度・TAKEOVER の状態
+    TelemetrySubscriber subscribers[MAX_TELEMETRY_SUBSCRIBERS]; // テレメトリ購読者 (クライアントのアドレス)
+    struct sockaddr_in client_addr_send;    // 最後に操縦パケットを送ってきたクライアント
+    bool client_addr_known;
+    uint32_t telemetry_seq;                 // テレメトリのフレーム番号 (地上局から見て連続させる)
+    bool surface_valid;                     // 深度0の基準 (水面の圧力) を記録済みか
+    float surface_pressure;                 // 水面の圧力 [kPa]。水中で再起動しても深度の基準を保つ
+    AttitudeEstimator attitude;             // 姿勢推定の状態 (ヨーを磁気なしで積分している場合に重要)
+};
+
+// 共有メモリのレイアウト
+struct RuntimeStateLayout
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t layout_size; // sizeof(RuntimeStateLayout)
+
+    // 制御プロセスが書く (書き手は常に1プロセス)
+    std::atomic<uint32_t> active_slot;     // 最後に書き終えたスロット (0 / 1)
+    std::atomic<uint32_t> save_count;      // 保存した回数 (0 = 復元できる状態なし)
+    RuntimeSnapshot slots[2];
+    std::atomic<uint64_t> last_restart_to_control_ns; // 直近の再起動で終了検知から制御再開までにかかった時間
+    std::atomic<uint64_t> max_restart_to_control_ns;  // その最大値
+    std::atomic<uint32_t> recording_requested;        // 録画の要求 (映像プロセスが反映する。制御プロセスの再起動後も残る)
+    std::atomic<uint32_t> video_idle_requested;       // 映像のアイドルの要求 (映像プロセスがパイプラインを READY に落とす)
+
+    // 監視プロセスが書く
+    std::atomic<uint64_t> control_exit_ns; // 制御プロセスの終了を検知した時刻 (0 = 再起動ではない)
+    std::atomic<uint32_t> restart_count;   // 制御プロセスを再起動した回数
+
+    // 映像プロセスが書く
+    std::atomic<uint32_t> recording_active; // 実際に録画中か
+};
+
+// 実行時状態のハンドル
+struct RuntimeState
+{
+    RuntimeStateLayout *layout = nullptr;
+    int fd = -1;
+    char name[64] = {0};
+};
+
+// 関数のプロトタイプ宣言
+// 共有メモリを開く。なければ作成し、バージョンやサイズが一致しなければ作り直す (既存の一致する状態は残す)
+bool runtime_state_open(RuntimeState *state, const char *name);
+// マッピングを解除する (共有メモリは残る)
+void runtime_state_close(RuntimeState *state);
+// 共有メモリ名を削除する (監視プロセスの正常終了時)
+void runtime_state_unlink(const char *name);
+// 状態を保存する (制御ループから毎周期呼び出す)
+void runtime_state_save(RuntimeState *state, const RuntimeSnapshot &snapshot);
+// 最後に保存した一貫した状態を読み取る。保存されていない、または now_ns から見て max_age_ms より古ければ false
+bool runtime_state_load(const RuntimeState *state, uint64_t now_ns, uint32_t max_age_ms, RuntimeSnapshot *out);
+// 保存した状態を無効にする (正常終了時や、再起動を繰り返す場合にコールドスタートさせるため)
+void runtime_state_invalidate(RuntimeState *state);
+// ウォーム再起動後の最初の制御周期で、終了検知 (監視プロセスがいなければ最後の保存) からの時間を記録して返す
+uint64_t runtime_state_mark_control_resumed(RuntimeState *state, uint64_t saved_ns, uint64_t now_ns);
+
+#endif // RUNTIME_STATE_H
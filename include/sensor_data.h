@@ -1,13 +1,46 @@
 #ifndef SENSOR_DATA_H // インクルードガード: ヘッダーファイルが複数回インクルードされるのを防ぐ
 #define SENSOR_DATA_H // インクルードガード
 
-#include <string>   // std::string を使用するため (現在は直接使用していないが、将来的に使う可能性あり)
-#include <vector>   // ADCデータなどの配列データを扱うために含める (現在は直接使用していない)
-#include <stddef.h> // size_t 型を使用するため
+#include <string>     // std::string を使用するため (現在は直接使用していないが、将来的に使う可能性あり)
+#include <vector>     // ADCデータなどの配列データを扱うために含める (現在は直接使用していない)
+#include <stddef.h>   // size_t 型を使用するため
+#include "bindings.h" // AxisData 構造体を使用するため
 
 #define SENSOR_BUFFER_SIZE 512 // センサーデータを格納する文字列バッファの推奨サイズ
+#define SENSOR_ADC_CHANNELS 4  // ADCチャンネル数
+
+// 電源モジュール (Blue Robotics Power Sense Module) を接続した ADC チャンネルと換算係数
+#define SENSOR_ADC_VOLTAGE_CHANNEL 0  // バッテリー電圧のチャンネル
+#define SENSOR_ADC_CURRENT_CHANNEL 1  // バッテリー電流のチャンネル
+#define SENSOR_VOLTS_PER_ADC_V 11.0f  // ADC 1V あたりのバッテリー電圧 [V]
+#define SENSOR_AMPS_PER_ADC_V 37.8788f // ADC 1V あたりの電流 [A]
+#define SENSOR_CURRENT_OFFSET_V 0.330f // 電流 0A のときの ADC の電圧 [V]
+
+// 最新のセンサー値を保持するキャッシュ
+// 変化の速いIMU (加速度・ジャイロ・磁気) と、変化の遅いセンサー (温度・圧力・リーク・ADC) を別々の周期で更新する
+struct SensorData
+{
+    float temperature = 0.0f;              // 温度
+    float pressure = 0.0f;                 // 圧力
+    bool leak = false;                     // リーク検知 (true: 漏れあり)
+    float adc[SENSOR_ADC_CHANNELS] = {0};  // ADC 各チャンネルの値 (バス管理の実行中はフィルタバンクを通した値)
+    float battery_voltage = 0.0f;          // バッテリー電圧 [V] (adc から換算)
+    float battery_current = 0.0f;          // バッテリー電流 [A] (adc から換算)
+    float power_w = 0.0f;                  // 消費電力 [W] (電圧 x 電流)
+    AxisData accel = {0.0f, 0.0f, 0.0f};   // 加速度 (X, Y, Z軸)
+    AxisData gyro = {0.0f, 0.0f, 0.0f};    // 角速度 (X, Y, Z軸)
+    AxisData mag = {0.0f, 0.0f, 0.0f};     // 磁気 (X, Y, Z軸)
+};
 
 // 関数のプロトタイプ宣言
+// IMU (加速度・ジャイロ・磁気) を読み取りキャッシュを更新する (制御周期ごとに呼び出す)
+void sensor_read_fast(SensorData *data);
+// 温度・圧力・リーク・ADC を読み取りキャッシュを更新する (低い周期で呼び出す)
+void sensor_read_slow(SensorData *data);
+// ADC の値から電源モジュールの電圧・電流・消費電力を計算する (sensor_read_slow から呼ばれる)
+void sensor_update_power(SensorData *data);
+// キャッシュの全センサー値を指定されたバッファに文字列としてフォーマットする
+bool format_sensor_data(const SensorData &data, char *buffer, size_t buffer_size);
 // 関連するすべてのセンサーを読み取り、指定されたバッファに文字列としてフォーマットする
 // 成功した場合は true、失敗した場合は false を返す。出力文字列は buffer に格納される。
 bool read_and_format_sensor_data(char *buffer, size_t buffer_size); // バッファとそのサイズを引数にとる
@@ -0,0 +1,49 @@
+#ifndef SETPOINT_CONTROLLER_H
+#define SETPOINT_CONTROLLER_H
+
+#include "gamepad.h"            // SetpointCommand を使用するため
+#include "thruster_control.h"   // BodyThrust を使用するため
+#include "attitude_estimator.h" // Attitude を使用するため
+#include "bindings.h"           // AxisData を使用するため
+
+// 目標値コマンドの閉ループ制御 (制御周期で機体側で実行する)
+// 方位保持: 方位誤差の P 制御 + 角速度によるダンピング。方位を指定しない場合はヨー角速度の P 制御
+// 深度保持: 圧力から求めた深度の PID 制御 (積分は出力が飽和していない間だけ行う)
+// surge/sway と、深度を指定しない場合の heave は要求をそのまま推力配分に渡す
+
+// 制御ゲイン (出力は推力 -1.0 〜 1.0)
+struct SetpointGains
+{
+    float heading_kp = 0.02f;         // 方位誤差 [deg] あたりのヨー推力 (50度の誤差で最大)
+    float heading_kd = 0.005f;        // ヨー角速度 [deg/s] あたりのダンピング
+    float yaw_rate_kp = 0.0064f;      // ヨー角速度誤差 [deg/s] あたりのヨー推力 (ヨー推力 1.0 は後退側も含めた最大トルク)
+    float depth_kp = 0.5f;            // 深度誤差 [m] あたりの上下推力
+    float depth_ki = 0.05f;           // 深度誤差の積分 [m·s] あたりの上下推力
+    float depth_kd = 0.3f;            // 深度変化率 [m/s] あたりのダンピング
+    float depth_integral_limit = 0.3f; // 積分項の上限 (推力)
+    float kpa_per_m = 10.05f;         // 水深1mあたりの圧力 [kPa] (海水。read_pressure は kPa を仮定)
+};
+
+// 制御器の状態
+struct SetpointController
+{
+    SetpointGains gains;
+    bool surface_valid = false;    // 水面の圧力 (深度0の基準) を記録したか
+    float surface_pressure = 0.0f; // 起動時 (水面) の圧力 [kPa]
+    float depth_m = 0.0f;          // 現在の深度 [m] (下向き正)
+    float depth_rate = 0.0f;       // 深度の変化率 [m/s] (一次遅れで平滑化)
+    float depth_integral = 0.0f;   // 深度誤差の積分項 (推力)
+};
+
+// 関数のプロトタイプ宣言
+// 制御器を初期化する
+void setpoint_init(SetpointController *ctrl, const SetpointGains &gains);
+// 圧力から深度を更新する (毎周期呼び出す)。最初の有効な圧力を水面の基準として記録する。現在の深度を返す
+float setpoint_update_depth(SetpointController *ctrl, float pressure, float dt_s);
+// 目標値と現在の状態から機体座標系の推力要求を計算する
+BodyThrust setpoint_update(SetpointController *ctrl, const SetpointCommand &setpoint, const Attitude &attitude,
+                           const AxisData &gyro, float dt_s);
+// 積分項をリセットする (手動操縦に切り替わったときなど)
+void setpoint_reset(SetpointController *ctrl);
+
+#endif // SETPOINT_CONTROLLER_H
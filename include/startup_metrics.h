@@ -0,0 +1,24 @@
+#ifndef STARTUP_METRICS_H
+#define STARTUP_METRICS_H
+
+#include <stdint.h> // uint64_t を使用するため
+
+// 起動時間の計測
+// プログラム開始 (main の先頭) から、最初の制御周期と各カメラの最初の映像フレームまでの時間を記録してログに出す。
+// 映像パイプラインはバックグラウンドで起動するため、制御周期の開始はカメラの状態に左右されない。
+
+#define STARTUP_MAX_CAMERAS 2 // 計測するカメラの数
+
+// 関数のプロトタイプ宣言
+// 計測の基準時刻を記録する (main の先頭で1回呼び出す)
+void startup_metrics_begin();
+// 最初の制御周期が完了したことを記録する (2回目以降の呼び出しは無視)
+void startup_metrics_mark_first_control_tick();
+// 指定カメラの最初の映像フレームが送出されたことを記録する (任意のスレッドから呼び出し可、2回目以降は無視)
+void startup_metrics_mark_first_video_frame(int camera_index);
+// 最初の制御周期までの時間 (ナノ秒)。未記録なら 0
+uint64_t startup_metrics_first_control_tick_ns();
+// 指定カメラの最初の映像フレームまでの時間 (ナノ秒)。未記録なら 0
+uint64_t startup_metrics_first_video_frame_ns(int camera_index);
+
+#endif // STARTUP_METRICS_H
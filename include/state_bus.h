@@ -0,0 +1,115 @@
+#ifndef STATE_BUS_H
+#define STATE_BUS_H
+
+// 共有メモリによる状態バス
+// 同じ機体上で動く自律制御・データロガー・ROSブリッジなどのプロセスと、UDP やテキストのパースを介さずに
+// 状態とコマンドをやり取りする。
+//   - 状態 (センサーキャッシュ・姿勢・スラスター出力・フェイルセーフ状態): 制御ループが毎周期 seqlock で公開する。
+//     読み手はシステムコールもロックも使わずに最新の一貫したスナップショットを読める (書き手を待たせない)。
+//   - コマンド: 1つの外部プロセス (生産者) から制御ループ (消費者) へのロックフリー SPSC キュー。
+//     取り出したコマンドは UDP の操縦パケットと同じく調停器 (command_arbiter) に渡される。
+// 共有メモリ上で std::atomic<uint32_t> を使うため、ロックフリー (プロセス間でアドレス非依存) であることを前提とする。
+
+#include "sensor_data.h"        // SensorData を使用するため
+#include "attitude_estimator.h" // Attitude を使用するため
+#include "thruster_control.h"   // NUM_THRUSTERS を使用するため
+#include "gamepad.h"            // CommandPacket を使用するため
+#include <atomic>               // std::atomic を使用するため
+#include <stdint.h>             // uint32_t, uint64_t を使用するため
+#include <stddef.h>             // size_t を使用するため
+
+#define STATE_BUS_DEFAULT_NAME "/ws3_state_bus" // shm_open に渡す共有メモリ名 (/dev/shm/ws3_state_bus)
+#define STATE_BUS_MAGIC 0x57533342u             // "WS3B"
+#define STATE_BUS_VERSION 3                     // レイアウトを変更したら上げる (読み手は一致を確認する)
+#define STATE_BUS_COMMAND_CAPACITY 64           // コマンドキューの容量 (2のべき乗)
+#define STATE_BUS_CACHE_LINE 64                 // 生産者と消費者のインデックスを別のキャッシュラインに置くため
+
+// 制御ループが毎周期公開する状態のスナップショット
+struct StateSnapshot
+{
+    uint64_t timestamp_ns;             // 公開した時刻 (CLOCK_MONOTONIC)
+    uint32_t tick;                     // 制御周期の通し番号
+    int32_t active_source;             // 操縦権を持つ送信元ID (ARBITER_NO_SOURCE = -1 なら無し)
+    int32_t watchdog_state;            // WatchdogState の値
+    int32_t control_allowed;           // 1: 通常制御中, 0: フェイルセーフ中
+    SensorData sensors;                // 最新のセンサーキャッシュ
+    Attitude attitude;                 // 推定姿勢
+    float depth_m;                     // 圧力から求めた深度 [m] (起動時を0とする)
+    int32_t thruster_pwm[NUM_THRUSTERS]; // 最後に出力したスラスターのPWM値
+};
+
+// StateBusCommand.flags のビット (CommandSetpoint の場合)
+#define STATE_BUS_HOLD_HEADING 0x1u // heading_deg を保持する
+#define STATE_BUS_HOLD_DEPTH 0x2u   // depth_m を保持する
+
+// 外部プロセスから制御ループへのコマンド
+struct StateBusCommand
+{
+    uint32_t type;       // CommandPacketType の値 (CommandGamepad / CommandSetpoint / CommandTakeover / CommandRelease)
+    int32_t source_id;   // 送信元ID (UDP の送信元と重ならない値を使うこと)
+    uint32_t seq;        // 送信元ごとのシーケンス番号
+    int32_t priority;    // 優先度 (大きいほど優先)
+    int32_t axes[6];     // CommandGamepad: LX, LY, RX, RY, LT, RT (操縦パケットと同じ範囲)
+    uint32_t buttons;    // CommandGamepad: ボタンのビットマスク
+    float thrust[3];     // CommandSetpoint: surge, sway, heave (-1.0 〜 1.0)
+    float yaw_rate_dps;  // CommandSetpoint: ヨー角速度の目標値
+    float heading_deg;   // CommandSetpoint: 方位の目標値 (flags に STATE_BUS_HOLD_HEADING がある場合)
+    float depth_m;       // CommandSetpoint: 深度の目標値 (flags に STATE_BUS_HOLD_DEPTH がある場合)
+    uint32_t flags;      // CommandSetpoint: STATE_BUS_HOLD_* の組み合わせ
+    uint32_t timeout_ms; // CommandSetpoint: 有効時間 (0 なら既定値)
+};
+
+// 共有メモリのレイアウト
+struct StateBusLayout
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t layout_size;  // sizeof(StateBusLayout)。読み手側のビルドとの不一致を検出する
+    int32_t writer_pid;    // 制御プロセスの PID
+
+    // 状態 (seqlock): 書き込み中は seq が奇数になる
+    alignas(STATE_BUS_CACHE_LINE) std::atomic<uint32_t> state_seq;
+    StateSnapshot state;
+
+    // コマンドキュー (SPSC): tail は生産者だけ、head は消費者だけが進める
+    alignas(STATE_BUS_CACHE_LINE) std::atomic<uint32_t> command_tail;
+    alignas(STATE_BUS_CACHE_LINE) std::atomic<uint32_t> command_head;
+    StateBusCommand commands[STATE_BUS_COMMAND_CAPACITY];
+    std::atomic<uint32_t> commands_dropped; // キューが満杯で捨てたコマンド数 (生産者側で加算)
+};
+
+// 状態バスのハンドル
+struct StateBus
+{
+    StateBusLayout *layout = nullptr;
+    int fd = -1;
+    bool owner = false;  // true: 制御プロセス (作成・公開・消費側), false: 外部プロセス (読み取り・生産側)
+    char name[64] = {0};
+};
+
+// 関数のプロトタイプ宣言
+// --- 制御プロセス側 ---
+// 共有メモリを作成して初期化する (既存のものは作り直す)
+bool state_bus_create(StateBus *bus, const char *name);
+// 再起動した制御プロセスが既存の共有メモリを書き手として引き継ぐ (一致するものがなければ state_bus_create と同じ)
+bool state_bus_resume(StateBus *bus, const char *name);
+// 状態を公開する (制御ループから毎周期呼び出す。書き手は1つだけ)
+void state_bus_publish(StateBus *bus, const StateSnapshot &snapshot);
+// コマンドを1件取り出す。空なら false
+bool state_bus_pop_command(StateBus *bus, StateBusCommand *command);
+// 取り出したコマンドを調停器に渡せる形式に変換する
+CommandPacket state_bus_command_to_packet(const StateBusCommand &command);
+
+// --- 外部プロセス側 ---
+// 既存の共有メモリに接続する (制御プロセスが起動していなければ false)
+bool state_bus_open(StateBus *bus, const char *name);
+// 一貫した最新の状態を読み取る。公開前なら false
+bool state_bus_read(const StateBus *bus, StateSnapshot *snapshot);
+// コマンドを1件追加する。キューが満杯なら false (生産者は1プロセス・1スレッドに限る)
+bool state_bus_push_command(StateBus *bus, const StateBusCommand &command);
+
+// --- 共通 ---
+// マッピングを解除する (制御プロセス側は共有メモリ名も削除する)
+void state_bus_close(StateBus *bus);
+
+#endif // STATE_BUS_H
@@ -0,0 +1,46 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+// 監視プロセス (supervisor)
+// 制御と映像をそれぞれ子プロセスとして起動し、異常終了したプロセスだけを直ちに起動し直す。
+// 監視プロセス自身はハードウェアにもネットワークにも触らず、スレッドも持たない (fork を安全に行うため)。
+// 子プロセスの終了は waitpid で待つため、検知の遅れはカーネルのスケジューリング分だけで済む。
+// 制御プロセスの終了を検知した時刻は実行時状態 (runtime_state) に書き、再起動後の制御プロセスが
+// 終了検知から制御再開までの時間を計算する。
+// 起動直後の異常終了が続く場合は、保存した状態を無効にして (コールドスタートでスラスターを PWM_STOP に戻す)
+// backoff_ms おきに起動し直す。
+
+#include "runtime_state.h" // RuntimeState を使用するため
+#include <sys/types.h>     // pid_t を使用するため
+#include <stdint.h>        // uint32_t, uint64_t を使用するため
+
+#define SUPERVISOR_MAX_PROCESSES 4 // 監視できる子プロセスの最大数
+
+// 監視設定
+struct SupervisorConfig
+{
+    uint32_t stable_ms = 2000;          // 起動からこの時間動き続けたら、起動直後の異常終了の回数をリセットする
+    uint32_t rapid_failure_limit = 5;   // 起動直後の異常終了がこの回数続いたらコールドスタート + バックオフに切り替える
+    uint32_t backoff_ms = 1000;         // バックオフ中の再起動間隔
+};
+
+// 監視する子プロセス1件分
+struct SupervisedProcess
+{
+    const char *name = "";          // ログ表示用の名前
+    int (*entry)() = nullptr;       // 子プロセスで実行する関数 (戻り値が終了コード)
+    bool is_control = false;        // 制御プロセスか (終了時刻を記録し、正常終了したら監視全体を終了する)
+    // 以下は監視プロセスが管理する
+    pid_t pid = -1;
+    uint64_t started_ns = 0;        // 最後に起動した時刻
+    uint64_t restart_at_ns = 0;     // 次に起動する時刻 (0 = 起動待ちではない)
+    uint32_t rapid_failures = 0;    // 起動直後の異常終了が続いた回数
+    uint32_t restarts = 0;          // 起動し直した回数
+};
+
+// 関数のプロトタイプ宣言
+// 子プロセスを起動して監視する。制御プロセスが正常終了するか、SIGINT / SIGTERM を受けるまで戻らない
+// (受けた場合は子プロセスに SIGTERM を送り、終了を待ってから戻る)。正常に終了したら 0 を返す
+int supervisor_run(const SupervisorConfig &config, SupervisedProcess *processes, int count, RuntimeState *state);
+
+#endif // SUPERVISOR_H
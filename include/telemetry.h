@@ -0,0 +1,85 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "sensor_data.h" // SensorData を使用するため
+#include <stddef.h>      // size_t を使用するため
+#include <stdint.h>      // uint32_t, uint64_t を使用するため
+
+#define TELEMETRY_DATAGRAM_OVERHEAD_BYTES 28 // 1フレーム (UDP データグラム1個) ごとに加わる IPv4 (20) + UDP (8) ヘッダのバイト数
+
+// テレメトリのフィールド (送信順 = 帯域不足時の優先順)
+enum TelemetryField
+{
+    TF_LEAK = 0,
+    TF_SRC,
+    TF_AUTH,  // 推力配分で出せた要求の割合の最小値 (1.0 = 全量。飽和で縮小した軸があると小さくなる)
+    TF_SATAX, // 飽和で縮小した軸のビットマスク (bit0 前進, bit1 平行移動, bit2 上下, bit3 旋回)
+    TF_GYROX,
+    TF_GYROY,
+    TF_GYROZ,
+    TF_ACCX,
+    TF_ACCY,
+    TF_ACCZ,
+    TF_PRESSURE,
+    TF_MAGX,
+    TF_MAGY,
+    TF_MAGZ,
+    TF_TEMP,
+    TF_ADC0,
+    TF_ADC1,
+    TF_ADC2,
+    TF_ADC3,
+    TF_POWER, // 消費電力 [W] (電源モジュールの電圧 x 電流)
+    TELEMETRY_FIELD_COUNT
+};
+
+// フィールドごとの送信設定
+struct TelemetryFieldConfig
+{
+    const char *name;  // フレーム内のラベル (例: "GYROX")
+    float rate_hz;     // 最大送信レート (Hz)
+    float threshold;   // 前回送信値からこの値を超えて変化したときだけ送信する
+};
+
+// テレメトリの送信スケジューラ
+// 各フィールドを「レート上限」と「変化量のしきい値」で間引き、変化したフィールドだけを差分フレームで送る。
+// 一定間隔で全フィールドを含むキーフレームを送り、途中から受信した地上局や欠落したフレームを再同期する。
+// フレームの合計サイズ (UDP/IP ヘッダを含む) はトークンバケットで budget_bytes_per_s 以内に抑える (あふれたフィールドは次の周期に持ち越す)。
+// 差分フレームも変化したフィールドの値そのものを含むため、購読者ごとのレートで間引いてよい (間引かれた値は次の変化かキーフレームで揃う)。
+//
+// フレーム形式: "SEQ:<n>,KF:<0|1>,<NAME>:<value>,..." (キーフレームは全フィールドを含む)
+struct TelemetryScheduler
+{
+    TelemetryFieldConfig fields[TELEMETRY_FIELD_COUNT];
+    float last_sent_value[TELEMETRY_FIELD_COUNT];  // 最後に送信した値
+    uint64_t last_sent_ms[TELEMETRY_FIELD_COUNT];  // 最後に送信した時刻
+    uint32_t keyframe_interval_ms;                 // キーフレームの送信間隔
+    uint64_t last_keyframe_ms;                     // 最後にキーフレームを送信した時刻
+    bool keyframe_sent;                            // キーフレームを1度でも送信したか
+    uint32_t budget_bytes_per_s;                   // 送信帯域の上限 (バイト/秒)
+    double tokens;                                 // トークンバケットの残量 (バイト)
+    uint64_t last_refill_ms;                       // トークンを最後に補充した時刻
+    uint32_t seq;                                  // フレーム番号
+    float authority;                               // 直近の制御周期の推力配分の結果 (TF_AUTH)
+    uint32_t saturated_axes;                       // 直近の制御周期に縮小した軸 (TF_SATAX)
+
+    // 統計情報
+    uint32_t frames_sent;      // 送信フレーム数
+    uint32_t keyframes_sent;   // うちキーフレーム数
+    uint64_t bytes_sent;       // 送信バイト数 (UDP/IP ヘッダを含む)
+    uint32_t fields_deferred;  // 帯域不足で持ち越したフィールド数
+};
+
+// 関数のプロトタイプ宣言
+// スケジューラを既定のフィールド設定で初期化する
+void telemetry_init(TelemetryScheduler *sched, uint32_t budget_bytes_per_s, uint32_t keyframe_interval_ms);
+// フィールドのレートとしきい値を変更する
+void telemetry_set_field(TelemetryScheduler *sched, TelemetryField field, float rate_hz, float threshold);
+// 推力配分の結果 (操縦権限の低下) を次のフレームのフィールドに設定する (制御周期ごとに呼び出す)
+void telemetry_set_authority(TelemetryScheduler *sched, float authority, uint32_t saturated_axes);
+// 今回送信すべきフレームを組み立てる。送信不要なら 0 を返す
+// is_keyframe には組み立てたフレームがキーフレームかどうかが格納される
+size_t telemetry_build_frame(TelemetryScheduler *sched, const SensorData &data, int active_source, uint64_t now_ms,
+                             char *buffer, size_t buffer_size, bool *is_keyframe);
+
+#endif // TELEMETRY_H
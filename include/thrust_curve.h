@@ -0,0 +1,171 @@
+#ifndef THRUST_CURVE_H
+#define THRUST_CURVE_H
+
+#include <stdint.h> // int32_t, uint32_t を使用するため
+
+// --- スラスター推力特性とスティック入力カーブのルックアップテーブル ---
+// スラスターの推力はPWMパルス幅に対して線形ではなく、おおよそ (パルス幅 - 不感帯)^2 に比例する
+// (T200 の公開特性に近い2次モデル)。スティック入力をそのままPWMに線形変換すると、デッドゾーン付近では
+// ほとんど推力が出ず、最大付近で急激に推力が立ち上がる。
+// そこで「スティック → 要求推力 (expo カーブ) → 推力を出すためのPWM (推力特性の逆関数)」をテーブル化し、
+// 毎周期の変換を浮動小数点の除算なしの整数演算 (テーブル参照 + 線形補間) だけで行う。
+// テーブルはすべてコンパイル時 (constexpr) に生成される。
+//
+// 固定小数点表現: Q15 (32768 = 1.0)
+// テーブルサイズ: 257 要素 (入力 0 ~ 32768 を 128 刻みで分割し、端点を含む)
+
+#define THRUST_LUT_SHIFT 7                                 // 入力 (Q15) からテーブル位置を得るシフト量 (128刻み)
+#define THRUST_LUT_SIZE ((32768 >> THRUST_LUT_SHIFT) + 1)  // テーブル要素数 (257)
+#define THRUST_Q15_ONE 32768                               // Q15 の 1.0
+
+#define STICK_LUT_DEADZONE 6500        // スティックのデッドゾーン (JOYSTICK_DEADZONE と同じ値)
+#define STICK_EXPO 0.35                // スティック expo 係数 (0.0 = 線形, 1.0 = 3次カーブ)。中央付近の微調整がしやすくなる
+#define THRUSTER_DEADBAND_FRAC 0.06    // スラスターの不感帯 (PWM可動範囲に対する割合)。この範囲では推力がほぼ出ない
+
+namespace thrust_curve_detail
+{
+// constexpr で使える平方根 (ニュートン法)。C++11 の constexpr 関数は単一の return 文しか書けないため再帰で実装
+constexpr double sqrt_newton(double x, double guess, int iterations)
+{
+    return iterations == 0 ? guess : sqrt_newton(x, 0.5 * (guess + x / guess), iterations - 1);
+}
+constexpr double csqrt(double x)
+{
+    return x <= 0.0 ? 0.0 : sqrt_newton(x, x > 1.0 ? x : 1.0, 40);
+}
+constexpr double clamp01(double x)
+{
+    return x < 0.0 ? 0.0 : (x > 1.0 ? 1.0 : x);
+}
+constexpr int32_t to_q15(double x)
+{
+    return static_cast<int32_t>(clamp01(x) * THRUST_Q15_ONE + 0.5);
+}
+// テーブル位置 i に対応する入力値 (0.0 ~ 1.0)
+constexpr double lut_input(int i)
+{
+    return static_cast<double>(i) / (THRUST_LUT_SIZE - 1);
+}
+
+// PWM可動範囲に対する位置 u (0.0 ~ 1.0) -> 推力 (最大推力に対する割合)
+constexpr double thrust_from_pwm(double u)
+{
+    return u <= THRUSTER_DEADBAND_FRAC ? 0.0
+                                       : ((u - THRUSTER_DEADBAND_FRAC) / (1.0 - THRUSTER_DEADBAND_FRAC)) *
+                                             ((u - THRUSTER_DEADBAND_FRAC) / (1.0 - THRUSTER_DEADBAND_FRAC));
+}
+// 推力 t (0.0 ~ 1.0) -> PWM可動範囲に対する位置 (thrust_from_pwm の逆関数)。推力 0 は不感帯を飛ばさず 0 を返す
+constexpr double pwm_from_thrust(double t)
+{
+    return t <= 0.0 ? 0.0 : THRUSTER_DEADBAND_FRAC + (1.0 - THRUSTER_DEADBAND_FRAC) * csqrt(t);
+}
+// スティックの絶対値 s (0 ~ 32768) -> 要求推力 (デッドゾーン除去 + expo カーブ)
+constexpr double stick_expo_from_normalized(double x)
+{
+    return (1.0 - STICK_EXPO) * x + STICK_EXPO * x * x * x;
+}
+constexpr double stick_demand(double s)
+{
+    return s <= STICK_LUT_DEADZONE ? 0.0
+                                   : stick_expo_from_normalized(clamp01((s - STICK_LUT_DEADZONE) / (32767.0 - STICK_LUT_DEADZONE)));
+}
+
+// テーブル生成器 (value(i) がテーブル位置 i の値を返す)
+struct ThrustFromPwmGen
+{
+    static constexpr int32_t value(int i) { return to_q15(thrust_from_pwm(lut_input(i))); }
+};
+struct PwmFromThrustGen
+{
+    static constexpr int32_t value(int i) { return to_q15(pwm_from_thrust(lut_input(i))); }
+};
+struct StickDemandGen
+{
+    static constexpr int32_t value(int i) { return to_q15(stick_demand(lut_input(i) * THRUST_Q15_ONE)); }
+};
+
+// コンパイル時に 0, 1, ..., N-1 の整数列を作る (C++14 の std::make_integer_sequence 相当)
+template <int... Is>
+struct IndexSequence
+{
+};
+template <int N, int... Is>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, Is...>
+{
+};
+template <int... Is>
+struct MakeIndexSequence<0, Is...>
+{
+    typedef IndexSequence<Is...> type;
+};
+
+// 生成器 Gen を整数列で展開して constexpr 配列を作る
+template <typename Gen, typename Seq>
+struct LookupTable;
+template <typename Gen, int... Is>
+struct LookupTable<Gen, IndexSequence<Is...> >
+{
+    static constexpr int32_t values[sizeof...(Is)] = {Gen::value(Is)...};
+};
+template <typename Gen, int... Is>
+constexpr int32_t LookupTable<Gen, IndexSequence<Is...> >::values[sizeof...(Is)];
+
+typedef MakeIndexSequence<THRUST_LUT_SIZE>::type LutIndices;
+} // namespace thrust_curve_detail
+
+// --- 生成されたテーブル ---
+// PWM位置 (Q15) -> 推力 (Q15)
+typedef thrust_curve_detail::LookupTable<thrust_curve_detail::ThrustFromPwmGen, thrust_curve_detail::LutIndices> ThrustFromPwmTable;
+// 推力 (Q15) -> PWM位置 (Q15)
+typedef thrust_curve_detail::LookupTable<thrust_curve_detail::PwmFromThrustGen, thrust_curve_detail::LutIndices> PwmFromThrustTable;
+// スティック絶対値 (0 ~ 32768) -> 要求推力 (Q15)
+typedef thrust_curve_detail::LookupTable<thrust_curve_detail::StickDemandGen, thrust_curve_detail::LutIndices> StickDemandTable;
+
+// テーブルを線形補間で参照する (x は 0 ~ 32768 の Q15 値。範囲外はクランプ)
+static inline int32_t thrust_lut_lookup(const int32_t *table, int32_t x)
+{
+    if (x <= 0)
+        return table[0];
+    if (x >= THRUST_Q15_ONE)
+        return table[THRUST_LUT_SIZE - 1];
+    int32_t idx = x >> THRUST_LUT_SHIFT;
+    int32_t frac = x & ((1 << THRUST_LUT_SHIFT) - 1);
+    return table[idx] + (((table[idx + 1] - table[idx]) * frac) >> THRUST_LUT_SHIFT);
+}
+
+// PWM位置 (Q15) から推力 (Q15) を求める
+static inline int32_t thrust_q15_from_pwm_q15(int32_t pwm_q15)
+{
+    return thrust_lut_lookup(ThrustFromPwmTable::values, pwm_q15);
+}
+
+// 推力 (Q15) を出すためのPWM位置 (Q15) を求める
+static inline int32_t pwm_q15_from_thrust_q15(int32_t thrust_q15)
+{
+    return thrust_lut_lookup(PwmFromThrustTable::values, thrust_q15);
+}
+
+// スティック入力 (-32768 ~ 32767、符号は無視) を推力が線形になるPWM値に変換する
+// pwm_base: 推力ゼロに対応するPWM値, pwm_span: 最大推力までのPWM幅
+static inline int stick_to_pwm(int stick_value, int pwm_base, int pwm_span)
+{
+    int32_t magnitude = stick_value < 0 ? -stick_value : stick_value;
+    if (magnitude <= STICK_LUT_DEADZONE)
+        return pwm_base; // デッドゾーン内 (テーブルの補間でわずかに値が出るのを防ぐ)
+    int32_t demand_q15 = thrust_lut_lookup(StickDemandTable::values, magnitude);
+    int32_t pwm_q15 = pwm_q15_from_thrust_q15(demand_q15);
+    return pwm_base + ((pwm_q15 * pwm_span) >> 15);
+}
+
+// スティック入力 (-32768 ~ 32767) を要求推力 (Q15、スティックと同じ符号) に変換する
+// stick_to_pwm と同じデッドゾーン・expo カーブで、PWM への変換は推力配分の後に行う
+static inline int32_t stick_demand_q15(int stick_value)
+{
+    int32_t magnitude = stick_value < 0 ? -stick_value : stick_value;
+    if (magnitude <= STICK_LUT_DEADZONE)
+        return 0;
+    int32_t demand_q15 = thrust_lut_lookup(StickDemandTable::values, magnitude);
+    return stick_value < 0 ? -demand_q15 : demand_q15;
+}
+
+#endif // THRUST_CURVE_H
@@ -3,16 +3,30 @@
 
 #include "gamepad.h"  // GamepadData 構造体の定義が必要なためインクルード
 #include "bindings.h" // AxisData 構造体を使用するため (read_gyro() の戻り値型)
+#include <stddef.h>   // NULL を使用するため
 
 // --- 定数定義 ---
-#define PWM_MIN 1100                               // PWMパルス幅の最小値 (マイクロ秒) - 後退最大または停止に対応
-#define PWM_NEUTRAL 1500                           // PWMパルス幅のニュートラル値 (マイクロ秒) - 停止に対応 (ESCで一般的)
-#define PWM_NORMAL_MAX 1500                        // 通常操作時の最大PWMパルス幅 (マイクロ秒) - 要確認: 現在ニュートラルと同じ
-#define PWM_BOOST_MAX 1900                         // ブースト操作時の最大PWMパルス幅 (マイクロ秒) - 前進最大に対応
+#define PWM_MIN 1100                               // PWMパルス幅の最小値 (マイクロ秒) - 後退最大 (両方向 ESC) または停止 (一方向 ESC) に対応
+#define PWM_NEUTRAL 1500                           // PWMパルス幅のニュートラル値 (マイクロ秒) - 両方向 ESC の停止に対応
+#define PWM_BOOST_MAX 1900                         // PWMパルス幅の最大値 (マイクロ秒) - 前進最大に対応
 #define PWM_FREQUENCY 50.0f                        // PWM信号の周波数 (Hz)
 #define PWM_PERIOD_US (1000000.0f / PWM_FREQUENCY) // PWM信号の周期 (マイクロ秒) - 50Hzの場合20000us
 
+// ESC の設定: 1 = 両方向 (PWM_NEUTRAL で停止、PWM_MIN で後退最大。T200 / Basic ESC の標準設定)、
+//             0 = 一方向 (PWM_MIN で停止、後退なし。前進専用に設定した ESC の場合はビルド時に -DTHRUSTER_BIDIRECTIONAL=0)
+#ifndef THRUSTER_BIDIRECTIONAL
+#define THRUSTER_BIDIRECTIONAL 1
+#endif
+#if THRUSTER_BIDIRECTIONAL
+#define PWM_STOP PWM_NEUTRAL // 推力ゼロのPWMパルス幅 (初期化・フェイルセーフ・浸水時の停止に使う)
+#else
+#define PWM_STOP PWM_MIN
+#endif
+#define THRUSTER_REVERSE_RATIO 0.78f // 後退の最大推力 / 前進の最大推力 (T200 @16V: 約 4.1 kgf / 5.25 kgf)
+
 #define JOYSTICK_DEADZONE 6500 // ジョイスティック入力のデッドゾーン閾値 (この値以下は無視)
+#define THRUSTER_SLEW_US_PER_S 4000ULL           // 出力段のスルーレート上限 (PWMパルス幅 マイクロ秒/秒)。全範囲800usを0.2秒で変化
+#define THRUSTER_SLEW_MAX_DT_NS 50000000ULL       // スルーレート計算に使う経過時間の上限 (50ms)
 #define NUM_THRUSTERS 6        // 制御対象のスラスター総数 (Ch0-3 水平, Ch4-5 前進/後退)
 
 // --- LED制御用定数 ---
@@ -20,16 +34,83 @@
 #define LED_PWM_ON 1900        // LED点灯時のPWM値
 #define LED_PWM_OFF 1100       // LED消灯時のPWM値 (1500以下で消灯との指示に基づき1500に設定)
 
+// --- 出力の所有者 ---
+// PWM出力に書き込む主体。値が大きいほど優先度が高く、占有 (claim) 中は優先度の低い主体の書き込みが無視される
+enum ThrusterOutputOwner
+{
+    OUTPUT_OWNER_CONTROL = 0,  // 通常の操縦制御 (thruster_update)
+    OUTPUT_OWNER_WATCHDOG = 1, // 通信途絶時のフェイルセーフ (link_watchdog)
+    OUTPUT_OWNER_LEAK = 2      // 浸水検知時の保護動作 (leak_monitor)。通信の状態に関係なく最優先
+};
+
+// --- 推力配分 ---
+// 機体座標系の推力要求 (-1.0 〜 1.0)。前進・右・上昇・右旋回が正
+// 1.0 はその軸だけを要求したときに出せる最大の推力 (後退は前進より弱いため、負の側の 1.0 は前進の 1.0 より小さい力になる)
+struct BodyThrust
+{
+    float surge = 0.0f;
+    float sway = 0.0f;
+    float heave = 0.0f;
+    float yaw = 0.0f;
+};
+
+// 推力配分の軸 (BodyThrust のメンバーの順)
+enum ThrustAxis
+{
+    THRUST_AXIS_SURGE = 0,
+    THRUST_AXIS_SWAY,
+    THRUST_AXIS_HEAVE,
+    THRUST_AXIS_YAW,
+    THRUST_AXIS_COUNT
+};
+
+// 推力配分の結果: 要求がスラスターの上限を超えたときに、優先度の低い軸をどれだけ縮小したか
+struct ThrustAllocation
+{
+    BodyThrust achieved;                                        // 実際に出力する推力要求 (縮小後)
+    float authority[THRUST_AXIS_COUNT] = {1.0f, 1.0f, 1.0f, 1.0f}; // 軸ごとの要求に対して出せた割合 (1.0 = 全量)
+    float min_authority = 1.0f;                                 // authority の最小値 (テレメトリで報告する)
+    unsigned int saturated_axes = 0;                            // 縮小した軸のビットマスク (bit n = ThrustAxis n)
+};
+
 // --- 関数のプロトタイプ宣言 ---
 // スラスター制御モジュールを初期化する (PWM設定など)
 bool thruster_init();
+// 再起動時に、保存しておいた出力を PWM_STOP を経由せずに復元する (thruster_init の代わりに呼び出す)
+bool thruster_restore_outputs(const int pwm[NUM_THRUSTERS], int led_pwm);
 // スラスター制御を無効化する (PWM停止など)
 void thruster_disable();
 // ゲームパッドデータとジャイロデータに基づいてすべてのスラスターのPWM出力を更新する
-void thruster_update(const GamepadData &gamepad_data, const AxisData &gyro_data);
+// (report を渡すと、飽和によって縮小した軸が格納される)
+void thruster_update(const GamepadData &gamepad_data, const AxisData &gyro_data, ThrustAllocation *report = NULL);
 // 全てのスラスターを指定されたPWM値に設定し、LEDをオフにする (フェイルセーフ用)
 void thruster_set_all_pwm(int pwm_value);
-// ヘルパー関数（他の場所で必要ない場合は .cpp 内部に保持できます）
-// float map_value(float x, float in_min, float in_max, float out_min, float out_max);
+// 出力を占有する/占有を解除する
+void thruster_claim_output(ThrusterOutputOwner owner);
+void thruster_release_output(ThrusterOutputOwner owner);
+// 指定した所有者として1チャンネルのPWM値を設定する (書き込む権利がなければ false)
+bool thruster_owner_set_pwm(ThrusterOutputOwner owner, int channel, int pwm_value);
+// 指定した所有者として全スラスターを同じPWM値にし、LEDをオフにする (書き込む権利がなければ false)
+bool thruster_owner_set_all_pwm(ThrusterOutputOwner owner, int pwm_value);
+// 各スラスターチャンネルに最後に書き込んだPWM値を取得する
+void thruster_get_outputs(int pwm_out[NUM_THRUSTERS]);
+// LED の現在のPWM値 (LED_PWM_ON / LED_PWM_OFF) を取得する
+int thruster_get_led_pwm();
+// 機体座標系の推力要求を推力配分表で各スラスターのPWM値に変換する (ハードウェアには書き込まない)
+// スラスターの上限を超える場合は優先度の低い軸 (前進 -> 平行移動 -> 上下 -> 旋回 の順) から縮小し、report に報告する
+void thruster_mix(const BodyThrust &demand, int pwm_out[NUM_THRUSTERS], ThrustAllocation *report = NULL);
+// 通常制御としてスラスターのPWM値を出力する (スルーレート制限・出力の所有者を考慮。LEDは変更しない)
+void thruster_apply_pwm(const int pwm[NUM_THRUSTERS]);
+// 推力配分表で上向きの推力 (heave の配分が正) を持つチャンネルのビットマスク (bit n = Ch n)。0 なら上下方向のスラスターがない
+unsigned int thruster_heave_channel_mask();
+// 浮上 (ウォッチドッグ・浸水監視の SURFACE) に使うチャンネルを決める。requested_mask が 0 なら上向きの全チャンネル。
+// 上下方向のスラスターがない場合や、上向きの配分がないチャンネルを含む場合は 0 を返す (前進用のスラスターで浮上させない)
+unsigned int thruster_surface_channel_mask(unsigned int requested_mask);
+
+// --- 内部の計算関数 (ハードウェアに書き込まない。テスト・ベンチマークから個別に呼び出すために公開) ---
+// ゲームパッドの入力とジャイロの値から機体座標系の推力要求を求める (旋回・平行移動・前進/後退とジャイロによる安定化)
+BodyThrust thruster_manual_demand(const GamepadData &data, const AxisData &gyro_data);
+// スラスター1基の推力 (前進の最大推力を 1.0 とした割合。負は後退) をPWM値に変換する
+int thrust_to_pwm(float thrust);
 
 #endif // THRUSTER_CONTROL_H
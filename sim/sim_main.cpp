@@ -0,0 +1,132 @@
+// 閉ループシミュレーションの実行
+// 実際の制御コードと 6 自由度の運動モデルを組み合わせ、全シナリオを実時間より速く実行して採点する。
+// 使い方: make -f Makefile.mk sim  (bin/run_sim [名前フィルタ] [-v])
+//   名前フィルタ: シナリオ名にこの文字列を含むものだけを実行する (例: heading_step, "link_loss gamepad")
+//   -v: 制御コードのデバッグ出力 (thruster_update の PWM 表示など) をそのまま表示する
+// 不合格のシナリオがあれば終了コード 1 を返す。
+
+#include "sim_scenarios.h"
+#include <stdio.h>   // printf, fprintf, fdopen, freopen を使用するため
+#include <math.h>    // fabsf を使用するため
+#include <string.h>  // strcmp, strstr を使用するため
+#include <unistd.h>  // dup, STDOUT_FILENO を使用するため
+#include <time.h>    // 実行時間の計測 (clock_gettime) のため
+#include <algorithm> // std::max を使用するため
+#include <string>    // std::string を使用するため
+#include <vector>    // シナリオ・集計の一覧を保持するため
+
+static const int MAX_FAILURES_SHOWN = 20; // 表示する不合格シナリオの最大数
+
+// シナリオの系統ごとの集計
+struct FamilySummary
+{
+    std::string family;
+    int run = 0;
+    int passed = 0;
+    float worst_rise_s = 0.0f;
+    float worst_overshoot = 0.0f;
+    float worst_settling_s = 0.0f;
+    float worst_steady_error = 0.0f;
+    float worst_deviation = 0.0f;
+    float worst_failsafe_s = 0.0f;
+    float worst_drift_m = 0.0f;
+    float worst_speed_error = 0.0f; // 終端速度の誤差 (予測値に対する割合)。予測値のない系統は 0
+    double rms_sum = 0.0;
+};
+
+static FamilySummary &summary_for(std::vector<FamilySummary> *summaries, const char *family)
+{
+    for (FamilySummary &s : *summaries)
+    {
+        if (s.family == family)
+            return s;
+    }
+    summaries->push_back(FamilySummary());
+    summaries->back().family = family;
+    return summaries->back();
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = NULL;
+    bool verbose = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-v") == 0)
+            verbose = true;
+        else
+            filter = argv[i];
+    }
+
+    // 結果は元の標準出力に書き、制御コードの printf (100Hz の PWM 表示) は捨てる
+    FILE *report = stdout;
+    if (!verbose)
+    {
+        int report_fd = dup(STDOUT_FILENO);
+        report = report_fd >= 0 ? fdopen(report_fd, "w") : NULL;
+        if (!report || !freopen("/dev/null", "w", stdout))
+        {
+            perror("標準出力の切り替え失敗");
+            return 1;
+        }
+    }
+
+    std::vector<Scenario> scenarios;
+    sim_build_scenarios(&scenarios);
+
+    struct timespec wall_start, wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    std::vector<FamilySummary> summaries;
+    int run = 0, failed = 0;
+    double simulated_s = 0.0;
+    for (const Scenario &scenario : scenarios)
+    {
+        if (filter && !strstr(scenario.name, filter))
+            continue;
+        ScenarioResult result;
+        bool passed = sim_run_scenario(scenario, &result);
+        run++;
+        simulated_s += scenario.duration_s;
+
+        FamilySummary &s = summary_for(&summaries, scenario.family);
+        s.run++;
+        s.passed += passed ? 1 : 0;
+        s.worst_rise_s = std::max(s.worst_rise_s, result.rise_s);
+        s.worst_overshoot = std::max(s.worst_overshoot, result.overshoot);
+        s.worst_settling_s = std::max(s.worst_settling_s, result.settling_s);
+        s.worst_steady_error = std::max(s.worst_steady_error, result.steady_error);
+        s.worst_deviation = std::max(s.worst_deviation, result.max_deviation);
+        s.worst_failsafe_s = std::max(s.worst_failsafe_s, result.failsafe_s);
+        s.worst_drift_m = std::max(s.worst_drift_m, result.drift_m);
+        if (result.expected_speed > 0.0f)
+            s.worst_speed_error = std::max(s.worst_speed_error,
+                                           fabsf(result.speed - result.expected_speed) / result.expected_speed);
+        s.rms_sum += result.rms_error;
+        if (!passed)
+        {
+            if (failed < MAX_FAILURES_SHOWN)
+                fprintf(report, "[FAIL] %s: %s\n", scenario.name, result.reason);
+            failed++;
+        }
+        else if (verbose)
+        {
+            fprintf(report, "[PASS] %s\n", scenario.name);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    double wall_s = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+
+    fprintf(report, "%-14s %6s %6s %8s %10s %9s %9s %9s %9s %9s %8s %9s\n", "family", "run", "pass", "rise[s]",
+            "overshoot", "settle[s]", "steady", "max_dev", "rms(avg)", "safe[s]", "drift[m]", "speed_err");
+    for (const FamilySummary &s : summaries)
+    {
+        fprintf(report, "%-14s %6d %6d %8.2f %10.2f %9.2f %9.2f %9.2f %9.2f %9.2f %8.2f %9.3f\n", s.family.c_str(), s.run,
+                s.passed, s.worst_rise_s, s.worst_overshoot, s.worst_settling_s, s.worst_steady_error, s.worst_deviation,
+                s.run > 0 ? s.rms_sum / s.run : 0.0, s.worst_failsafe_s, s.worst_drift_m, s.worst_speed_error);
+    }
+    fprintf(report, "(各列は系統内の最悪値。単位は方位 deg / 角速度 deg/s。speed_err は終端速度の予測値に対する誤差の割合)\n");
+    fprintf(report, "%d シナリオ中 %d 合格、%d 不合格 (シミュレーション時間 %.0f 秒を %.1f 秒で実行、%.0f 倍速)\n", run,
+            run - failed, failed, simulated_s, wall_s, wall_s > 0.0 ? simulated_s / wall_s : 0.0);
+    fflush(report);
+    return failed == 0 ? 0 : 1;
+}
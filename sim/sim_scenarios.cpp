@@ -0,0 +1,599 @@
+#include "sim_scenarios.h"
+#include "command_arbiter.h"     // 調停器 (main.cpp と同じ経路でコマンドを渡す)
+#include "jitter_buffer.h"       // 短い途切れの補完
+#include "link_watchdog.h"       // 通信途絶のフェイルセーフ (手動駆動モード)
+#include "sensor_data.h"         // センサーキャッシュ
+#include "attitude_estimator.h"  // 姿勢推定
+#include "setpoint_controller.h" // 目標値制御
+#include "thruster_control.h"    // スラスター出力
+#include "monotonic_clock.h"     // simulated_clock_now_ns / simulated_clock_set_ns の宣言
+#include "bindings_stub.h"       // スタブへのセンサー値の設定と PWM 出力の読み出し
+#include <stdio.h>               // snprintf を使用するため
+#include <math.h>                // sqrt, fabs を使用するため
+#include <algorithm>             // std::max を使用するため
+#include <random>                // パケットロスの乱数
+
+// main.cpp と同じ設定
+static const uint32_t SIM_LINK_TIMEOUT_MS = 200;        // CONNECTION_TIMEOUT_SECONDS (調停器の鮮度とウォッチドッグ)
+static const unsigned int SIM_SLOW_SENSOR_INTERVAL = 10; // 低速センサーを読み取るループ間隔
+static const JitterPolicy SIM_JITTER_POLICY = JITTER_POLICY_EXTRAPOLATE;
+static const int SIM_SOURCE_ID = 1;
+static const int SIM_SOURCE_PRIORITY = 10;
+static const uint64_t SIM_SCENARIO_GAP_NS = 1000000000ULL; // シナリオ間で時刻を進める量 (スルーレート制限などの前回の時刻を引きずらない)
+
+// --- シミュレーションの時刻 (MONOTONIC_CLOCK_SIMULATED のビルドで monotonic_now_ns が返す値) ---
+static uint64_t sim_clock_ns = 1000000000ULL;
+
+uint64_t simulated_clock_now_ns()
+{
+    return sim_clock_ns;
+}
+
+void simulated_clock_set_ns(uint64_t now_ns)
+{
+    sim_clock_ns = now_ns;
+}
+
+// --- コマンドの生成 ---
+// 送信元ヘッダ付きの操縦コマンド / 目標値コマンドの文字列を作る (クライアントが送るものと同じ形式)
+static std::string format_command(const Scenario &scenario, bool after_step, uint32_t seq)
+{
+    char buffer[160];
+    if (scenario.mode == SIM_COMMAND_GAMEPAD)
+    {
+        GamepadData g = after_step ? scenario.gamepad : GamepadData();
+        snprintf(buffer, sizeof(buffer), "C,%d,%u,%d,%d,%d,%d,%d,%d,%d,%u", SIM_SOURCE_ID, seq, SIM_SOURCE_PRIORITY,
+                 g.leftThumbX, g.leftThumbY, g.rightThumbX, g.rightThumbY, g.LT, g.RT, static_cast<unsigned>(g.buttons));
+        return std::string(buffer);
+    }
+    SetpointCommand sp;
+    if (after_step)
+    {
+        sp = scenario.setpoint;
+    }
+    else
+    {
+        sp.hold_heading = true; // ステップ前は初期の方位を保持して静止
+        sp.heading_deg = scenario.initial_yaw_deg;
+    }
+    char heading[16] = "-";
+    if (sp.hold_heading)
+        snprintf(heading, sizeof(heading), "%.2f", sp.heading_deg);
+    snprintf(buffer, sizeof(buffer), "S,%d,%u,%d,%.3f,%.3f,%.3f,%.3f,%s,-,%u", SIM_SOURCE_ID, seq, SIM_SOURCE_PRIORITY,
+             sp.surge, sp.sway, sp.heave, sp.yaw_rate_dps, heading, sp.timeout_ms);
+    return std::string(buffer);
+}
+
+// この周期にコマンドを送るか (途絶・バースト状の途切れ・ランダムなパケットロス)
+static bool command_delivered(const Scenario &scenario, double t, std::mt19937 *rng)
+{
+    if (scenario.link_loss_s > 0.0f && t >= scenario.link_loss_s)
+        return false;
+    if (scenario.burst_ms > 0 && t >= scenario.step_s)
+    {
+        uint32_t phase_ms = static_cast<uint32_t>((t - scenario.step_s) * 1000.0 + 0.5) % scenario.burst_interval_ms;
+        if (phase_ms < scenario.burst_ms)
+            return false;
+    }
+    if (scenario.packet_loss > 0.0f)
+    {
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        if (uniform(*rng) < scenario.packet_loss)
+            return false;
+    }
+    return true;
+}
+
+// --- 採点 ---
+// 採点する量の誤差 (目標 - 現在値)
+static float metric_error(const Scenario &scenario, const VehicleState &state, float yaw_deg)
+{
+    switch (scenario.metric)
+    {
+    case SIM_METRIC_YAW_RATE:
+        return scenario.target - static_cast<float>(state.velocity[5] * 57.29577951308232);
+    case SIM_METRIC_SURGE_SPEED:
+        return 0.0f; // 速度は終了時の値だけを見る
+    default:
+        return attitude_wrap_deg(scenario.target - yaw_deg); // 方位・途絶中の方位の変化
+    }
+}
+
+// 推力特性が線形化テーブルどおりなら到達するはずの終端速度 (前進スラスター2基の推力 = 抗力)
+static float expected_surge_speed(const Scenario &scenario, const VehicleParams &params)
+{
+    float force = 0.0f;
+    for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+    {
+        if (params.thrusters[ch].direction[0] > 0.5f)
+            force += scenario.setpoint.surge * params.thrusters[ch].curve.max_forward_n;
+    }
+    float lin = params.linear_drag[0];
+    float quad = params.quadratic_drag[0];
+    return (-lin + sqrtf(lin * lin + 4.0f * quad * force)) / (2.0f * quad);
+}
+
+static void fail(ScenarioResult *result, const char *format, float value, float limit)
+{
+    if (!result->passed)
+        return; // 最初の理由だけを残す
+    result->passed = false;
+    snprintf(result->reason, sizeof(result->reason), format, value, limit);
+}
+
+// 記録した誤差の時系列から指標を求めて基準と比べる
+static void score(const Scenario &scenario, const std::vector<float> &times, const std::vector<float> &errors,
+                  ScenarioResult *result)
+{
+    const SimLimits &lim = scenario.limits;
+    result->passed = true;
+    if (times.empty())
+    {
+        fail(result, "記録なし (%.0f/%.0f)", 0.0f, 0.0f);
+        return;
+    }
+
+    float initial = errors.front();
+    float step_size = fabsf(initial);
+    float sign = initial >= 0.0f ? 1.0f : -1.0f;
+    float end_s = times.back();
+    float rise = -1.0f, overshoot = 0.0f, settling = 0.0f, max_dev = 0.0f;
+    double sum_sq = 0.0, steady_sum = 0.0;
+    int steady_count = 0;
+    for (size_t i = 0; i < times.size(); ++i)
+    {
+        float e = errors[i];
+        float t = times[i] - scenario.step_s;
+        if (rise < 0.0f && sign * e <= 0.1f * step_size)
+            rise = t;
+        overshoot = std::max(overshoot, -sign * e);
+        if (lim.settle_band > 0.0f && fabsf(e) > lim.settle_band)
+            settling = t + static_cast<float>(SIM_TICK_S);
+        if (times[i] >= scenario.disturbance_s)
+            max_dev = std::max(max_dev, fabsf(e));
+        if (times[i] > end_s - 1.0f)
+        {
+            steady_sum += fabsf(e);
+            steady_count++;
+        }
+        sum_sq += static_cast<double>(e) * e;
+    }
+    result->rise_s = rise;
+    result->overshoot = step_size > 0.0f ? overshoot : 0.0f;
+    result->settling_s = settling;
+    result->max_deviation = max_dev;
+    result->steady_error = steady_count > 0 ? static_cast<float>(steady_sum / steady_count) : 0.0f;
+    result->rms_error = static_cast<float>(sqrt(sum_sq / times.size()));
+
+    if (result->failsafe_ticks > 0)
+        fail(result, "フェイルセーフに移行した (%.0f 周期, 許容 %.0f)", static_cast<float>(result->failsafe_ticks), 0.0f);
+    if (lim.rise_s > 0.0f && (rise < 0.0f || rise > lim.rise_s))
+        fail(result, "立ち上がり時間 %.2fs > %.2fs", rise, lim.rise_s);
+    if (lim.overshoot > 0.0f && result->overshoot > lim.overshoot)
+        fail(result, "オーバーシュート %.2f > %.2f", result->overshoot, lim.overshoot);
+    if (lim.settling_s > 0.0f && settling > lim.settling_s)
+        fail(result, "整定時間 %.2fs > %.2fs", settling, lim.settling_s);
+    if (lim.steady_error > 0.0f && result->steady_error > lim.steady_error)
+        fail(result, "定常誤差 %.2f > %.2f", result->steady_error, lim.steady_error);
+    if (lim.max_deviation > 0.0f && max_dev > lim.max_deviation)
+        fail(result, "最大偏差 %.2f > %.2f", max_dev, lim.max_deviation);
+    if (lim.speed_error_frac > 0.0f && result->expected_speed > 0.0f)
+    {
+        float frac = fabsf(result->speed - result->expected_speed) / result->expected_speed;
+        if (frac > lim.speed_error_frac)
+            fail(result, "終端速度の誤差 %.3f > %.3f", frac, lim.speed_error_frac);
+    }
+    if (lim.failsafe_start_s > 0.0f &&
+        (result->failsafe_start_s < lim.failsafe_start_s ||
+         result->failsafe_start_s > lim.failsafe_start_s + static_cast<float>(SIM_TICK_S) + 1e-4f))
+        fail(result, "途絶の判定までの時間 %.3fs (期待値 %.3fs)", result->failsafe_start_s, lim.failsafe_start_s);
+    if (lim.failsafe_s > 0.0f && (result->failsafe_s < 0.0f || result->failsafe_s > lim.failsafe_s))
+        fail(result, "安全値までの時間 %.2fs > %.2fs", result->failsafe_s, lim.failsafe_s);
+    if (lim.drift_m > 0.0f && result->drift_m > lim.drift_m)
+        fail(result, "途絶後の移動距離 %.2fm > %.2fm", result->drift_m, lim.drift_m);
+}
+
+bool sim_run_scenario(const Scenario &scenario, ScenarioResult *result)
+{
+    *result = ScenarioResult();
+    sim_clock_ns += SIM_SCENARIO_GAP_NS;
+    const uint64_t start_ns = sim_clock_ns;
+
+    // 制御側のモジュールを main.cpp と同じ設定で初期化する
+    stub_hardware_reset();
+    thruster_release_output(OUTPUT_OWNER_LEAK);
+    thruster_release_output(OUTPUT_OWNER_WATCHDOG);
+    thruster_init();
+    WatchdogConfig watchdog_config;
+    watchdog_config.link_timeout_ms = SIM_LINK_TIMEOUT_MS;
+    watchdog_start_manual(watchdog_config);
+    CommandArbiter arbiter;
+    arbiter_init(&arbiter, SIM_LINK_TIMEOUT_MS);
+    arbiter.depth_hold_supported = thruster_heave_channel_mask() != 0;
+    JitterConfig jitter_config;
+    jitter_config.policy = SIM_JITTER_POLICY;
+    jitter_config.deadline_ms = watchdog_config.link_timeout_ms;
+    JitterBuffer jitter;
+    jitter_init(&jitter, jitter_config);
+    SensorData sensor_cache;
+    AttitudeEstimator attitude;
+    attitude_init(&attitude, ATTITUDE_DEFAULT_ACCEL_WEIGHT, ATTITUDE_DEFAULT_MAG_WEIGHT);
+    SetpointController setpoint_ctrl;
+    setpoint_init(&setpoint_ctrl, SetpointGains());
+
+    // 機体
+    VehicleParams params;
+    vehicle_default_params(&params);
+    for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+    {
+        params.thrusters[ch].curve.max_forward_n *= scenario.thrust_scale;
+        params.thrusters[ch].curve.max_reverse_n *= scenario.thrust_scale;
+    }
+    SensorNoise noise;
+    noise.seed = scenario.seed;
+    VehicleModel model;
+    vehicle_init(&model, params, noise, 1.0f, scenario.initial_yaw_deg);
+    std::mt19937 link_rng(scenario.seed * 7919u + 1u);
+
+    GamepadData latest_gamepad_data;
+    bool currently_in_failsafe = true;
+    bool commanded = false;
+    unsigned int loop_counter = 0;
+    uint32_t seq = 0;
+    double last_delivered_s = 0.0;
+    result->failsafe_s = -1.0f;
+    std::vector<float> times, errors;
+    int ticks = static_cast<int>(scenario.duration_s / SIM_TICK_S + 0.5);
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        double t = tick * SIM_TICK_S;
+        uint64_t now_ns = start_ns + static_cast<uint64_t>(tick) * static_cast<uint64_t>(SIM_TICK_S * 1e9 + 0.5);
+        simulated_clock_set_ns(now_ns);
+        uint64_t now_ms = now_ns / 1000000ULL;
+        bool after_step = t >= scenario.step_s;
+        model.disturbance = t >= scenario.disturbance_s ? scenario.disturbance : Disturbance();
+
+        // 1-2. コマンド受信と送信元の選択 (送信側は落ちたパケットの分もシーケンス番号を進める)
+        ++seq;
+        if (command_delivered(scenario, t, &link_rng))
+        {
+            arbiter_submit(&arbiter, parseCommandPacket(format_command(scenario, after_step, seq)), now_ms);
+            last_delivered_s = t;
+        }
+        int active_source = arbiter_select(&arbiter, now_ms);
+        if (active_source != ARBITER_NO_SOURCE)
+        {
+            watchdog_feed_at(arbiter_active_feed_ms(&arbiter) * 1000000ULL);
+            commanded = true;
+            jitter_push(&jitter, active_source, arbiter_active_command(&arbiter), arbiter_active_update_ms(&arbiter));
+            latest_gamepad_data = jitter_sample(&jitter, now_ms);
+        }
+        else
+        {
+            jitter_reset(&jitter);
+        }
+        watchdog_step(now_ns); // 実機では監視スレッドが period_ms ごとに実行する
+        bool control_allowed = watchdog_control_allowed();
+        if (control_allowed && currently_in_failsafe)
+        {
+            currently_in_failsafe = false;
+        }
+        else if (!control_allowed && !currently_in_failsafe)
+        {
+            latest_gamepad_data = GamepadData{};
+            currently_in_failsafe = true;
+        }
+        bool link_up = scenario.link_loss_s <= 0.0f || t < scenario.link_loss_s;
+        if (commanded && !control_allowed && link_up)
+            result->failsafe_ticks++;
+        if (!control_allowed && !link_up && result->failsafe_start_s < 0.0f)
+            result->failsafe_start_s = static_cast<float>(t - last_delivered_s);
+
+        // 3. センサー読み取りと姿勢推定 (運動モデルの値をスタブ経由で読む)
+        StubHardwareState &hw = stub_hardware();
+        vehicle_sensors(&model, &hw.gyro, &hw.accel, &hw.mag, &hw.pressure);
+        sensor_read_fast(&sensor_cache);
+        if (loop_counter >= SIM_SLOW_SENSOR_INTERVAL)
+        {
+            loop_counter = 0;
+            sensor_read_slow(&sensor_cache);
+        }
+        else
+        {
+            loop_counter++;
+        }
+        float dt_s = tick > 0 ? static_cast<float>(SIM_TICK_S) : 0.0f;
+        attitude_update(&attitude, sensor_cache.accel, sensor_cache.gyro, sensor_cache.mag, dt_s);
+        setpoint_update_depth(&setpoint_ctrl, sensor_cache.pressure, dt_s);
+
+        // 4. 制御
+        if (!currently_in_failsafe)
+        {
+            SetpointCommand setpoint;
+            if (arbiter_active_setpoint(&arbiter, &setpoint))
+            {
+                BodyThrust demand = setpoint_update(&setpoint_ctrl, setpoint, attitude.attitude, sensor_cache.gyro, dt_s);
+                int pwm[NUM_THRUSTERS];
+                thruster_mix(demand, pwm);
+                thruster_apply_pwm(pwm);
+            }
+            else
+            {
+                setpoint_reset(&setpoint_ctrl);
+                thruster_update(latest_gamepad_data, sensor_cache.gyro);
+            }
+        }
+
+        // 出力された PWM で機体を1周期分動かす
+        int pwm_us[NUM_THRUSTERS];
+        bool all_safe = true;
+        for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+        {
+            pwm_us[ch] = stub_pwm_us(ch);
+            all_safe = all_safe && pwm_us[ch] == watchdog_config.safe_pwm;
+        }
+        vehicle_step(&model, pwm_us, SIM_TICK_S, SIM_SUBSTEP_S);
+
+        // 記録
+        double t_next = t + SIM_TICK_S;
+        if (!link_up)
+        {
+            if (all_safe && result->failsafe_s < 0.0f)
+                result->failsafe_s = static_cast<float>(t - scenario.link_loss_s);
+            double v_ned[3];
+            vehicle_velocity_ned(model.state, v_ned);
+            result->drift_m += static_cast<float>(sqrt(v_ned[0] * v_ned[0] + v_ned[1] * v_ned[1]) * SIM_TICK_S);
+        }
+        if (t_next >= scenario.step_s)
+        {
+            float roll, pitch, yaw;
+            vehicle_euler_deg(model.state, &roll, &pitch, &yaw);
+            times.push_back(static_cast<float>(t_next));
+            errors.push_back(metric_error(scenario, model.state, yaw));
+        }
+    }
+    watchdog_stop();
+
+    result->speed = static_cast<float>(model.state.velocity[0]);
+    if (scenario.metric == SIM_METRIC_SURGE_SPEED)
+        result->expected_speed = expected_surge_speed(scenario, params);
+    score(scenario, times, errors, result);
+    return result->passed;
+}
+
+// --- シナリオの生成 ---
+static const float INITIAL_YAWS[] = {0.0f, 90.0f, -135.0f, 179.0f}; // 方位の折り返し (±180) をまたぐ場合を含む
+static const float THRUST_SCALES[] = {0.8f, 1.0f, 1.2f};           // 電圧低下 〜 満充電
+
+static void add_heading_steps(std::vector<Scenario> *out)
+{
+    static const float steps[] = {5.0f, 10.0f, 20.0f, 30.0f, 45.0f, 60.0f, 90.0f, 120.0f, 170.0f};
+    for (float yaw0 : INITIAL_YAWS)
+        for (float step : steps)
+            for (float sign : {1.0f, -1.0f})
+                for (float scale : THRUST_SCALES)
+                    for (uint32_t seed = 1; seed <= 3; ++seed)
+                    {
+                        Scenario s;
+                        s.family = "heading_step";
+                        s.metric = SIM_METRIC_HEADING;
+                        s.duration_s = 12.0f;
+                        s.initial_yaw_deg = yaw0;
+                        s.setpoint.hold_heading = true;
+                        s.setpoint.heading_deg = attitude_wrap_deg(yaw0 + sign * step);
+                        s.target = s.setpoint.heading_deg;
+                        s.thrust_scale = scale;
+                        s.seed = seed;
+                        s.limits.rise_s = 1.0f + step / 60.0f;
+                        s.limits.overshoot = 5.0f;
+                        s.limits.settle_band = 2.0f;
+                        s.limits.settling_s = 3.0f + step / 60.0f;
+                        s.limits.steady_error = 1.5f;
+                        snprintf(s.name, sizeof(s.name), "heading_step yaw0=%.0f step=%+.0f thrust=%.1f seed=%u", yaw0,
+                                 sign * step, scale, seed);
+                        out->push_back(s);
+                    }
+}
+
+static void add_yaw_rate_steps(std::vector<Scenario> *out)
+{
+    static const float rates[] = {5.0f, 10.0f, 20.0f, 30.0f, 45.0f, 60.0f};
+    for (float yaw0 : INITIAL_YAWS)
+        for (float rate : rates)
+            for (float sign : {1.0f, -1.0f})
+                for (float scale : THRUST_SCALES)
+                    for (uint32_t seed = 1; seed <= 2; ++seed)
+                    {
+                        Scenario s;
+                        s.family = "yaw_rate_step";
+                        s.metric = SIM_METRIC_YAW_RATE;
+                        s.duration_s = 6.0f;
+                        s.initial_yaw_deg = yaw0;
+                        s.setpoint.yaw_rate_dps = sign * rate;
+                        s.target = sign * rate;
+                        s.thrust_scale = scale;
+                        s.seed = seed;
+                        // ヨー角速度は P 制御のみのため、スルーレート制限と推力の応答遅れで立ち上がりに行き過ぎが出て、
+                        // 定常偏差も残る。その大きさと応答の安定を見る
+                        s.limits.overshoot = 0.35f * rate + 2.0f;
+                        s.limits.settle_band = 0.35f * rate + 2.0f;
+                        s.limits.settling_s = 2.0f;
+                        s.limits.steady_error = 0.3f * rate + 1.5f;
+                        snprintf(s.name, sizeof(s.name), "yaw_rate_step yaw0=%.0f rate=%+.0f thrust=%.1f seed=%u", yaw0,
+                                 sign * rate, scale, seed);
+                        out->push_back(s);
+                    }
+}
+
+static void add_surge_steps(std::vector<Scenario> *out)
+{
+    for (float yaw0 : INITIAL_YAWS)
+        for (int i = 2; i <= 10; ++i)
+            for (float scale : THRUST_SCALES)
+            {
+                Scenario s;
+                s.family = "surge_step";
+                s.metric = SIM_METRIC_SURGE_SPEED;
+                s.duration_s = 10.0f;
+                s.initial_yaw_deg = yaw0;
+                s.setpoint.surge = i * 0.1f;
+                s.setpoint.hold_heading = true;
+                s.setpoint.heading_deg = yaw0;
+                s.thrust_scale = scale;
+                s.limits.speed_error_frac = 0.1f; // 推力の線形化テーブルが T200 の推力特性と合っているか
+                snprintf(s.name, sizeof(s.name), "surge_step yaw0=%.0f surge=%.1f thrust=%.1f", yaw0, s.setpoint.surge, scale);
+                out->push_back(s);
+            }
+}
+
+static void add_disturbances(std::vector<Scenario> *out)
+{
+    static const float current_speeds[] = {0.1f, 0.2f, 0.3f, 0.5f};
+    static const float torques[] = {0.5f, 1.0f, 2.0f};
+    for (float yaw0 : INITIAL_YAWS)
+    {
+        Scenario base;
+        base.family = "disturbance";
+        base.metric = SIM_METRIC_HEADING;
+        base.duration_s = 10.0f;
+        base.initial_yaw_deg = yaw0;
+        base.setpoint.hold_heading = true;
+        base.setpoint.heading_deg = yaw0;
+        base.target = yaw0;
+        base.disturbance_s = 2.0f;
+        base.limits.max_deviation = 10.0f;
+        // 潮流 (向きを30度おき): 横滑りによる流体力のモーメント (Munk モーメント) に対する方位保持
+        for (float speed : current_speeds)
+            for (int dir = 0; dir < 360; dir += 30)
+            {
+                Scenario s = base;
+                float rad = dir * 0.017453292f;
+                s.disturbance.current_ned[0] = speed * cosf(rad);
+                s.disturbance.current_ned[1] = speed * sinf(rad);
+                s.limits.steady_error = 2.0f;
+                snprintf(s.name, sizeof(s.name), "disturbance yaw0=%.0f current=%.1fm/s@%d", yaw0, speed, dir);
+                out->push_back(s);
+            }
+        // 一定のヨーモーメント (テザーの張力など): 方位は P + D 制御のため、モーメントに比例した定常偏差が残る
+        for (float torque : torques)
+            for (float sign : {1.0f, -1.0f})
+            {
+                Scenario s = base;
+                s.disturbance.torque_body[2] = sign * torque;
+                s.limits.steady_error = 8.0f;
+                s.limits.max_deviation = 12.0f;
+                snprintf(s.name, sizeof(s.name), "disturbance yaw0=%.0f torque=%+.1fNm", yaw0, sign * torque);
+                out->push_back(s);
+            }
+    }
+}
+
+static void add_link_losses(std::vector<Scenario> *out)
+{
+    WatchdogConfig wd;
+    // ランプダウンは安全値から最も遠い出力 (前進最大、両方向 ESC では後退最大も) から始まる場合が最長
+    int ramp_us = std::max(PWM_BOOST_MAX - wd.safe_pwm, wd.safe_pwm - PWM_MIN);
+    float ramp_s = static_cast<float>(ramp_us) / wd.ramp_slew_us_per_s;
+    // 途絶の判定 (最後のパケットから数えるため、調停器の鮮度切れと同時) -> HOLD -> RAMP_DOWN の合計 (+ 周期の余裕)
+    float gamepad_failsafe_s = (wd.link_timeout_ms + wd.hold_ms) / 1000.0f + ramp_s + 0.05f;
+    float setpoint_failsafe_s = (SETPOINT_DEFAULT_TIMEOUT_MS + wd.hold_ms) / 1000.0f + ramp_s + 0.05f;
+    static const int forwards[] = {8000, 16000, 24000, 32767};
+    static const int turns[] = {0, 16000, -16000};
+    static const float loss_times[] = {2.0f, 3.5f, 5.0f};
+    for (int forward : forwards)
+        for (int turn : turns)
+            for (float loss_s : loss_times)
+                for (float scale : THRUST_SCALES)
+                {
+                    Scenario s;
+                    s.family = "link_loss";
+                    s.metric = SIM_METRIC_LINK_LOSS;
+                    s.mode = SIM_COMMAND_GAMEPAD;
+                    s.duration_s = loss_s + 8.0f;
+                    s.gamepad.rightThumbY = forward;
+                    s.gamepad.leftThumbX = turn;
+                    s.link_loss_s = loss_s;
+                    s.thrust_scale = scale;
+                    s.limits.failsafe_start_s = wd.link_timeout_ms / 1000.0f;
+                    s.limits.failsafe_s = gamepad_failsafe_s;
+                    s.limits.drift_m = 6.0f;
+                    snprintf(s.name, sizeof(s.name), "link_loss gamepad fwd=%d turn=%+d loss=%.1fs thrust=%.1f", forward,
+                             turn, loss_s, scale);
+                    out->push_back(s);
+                }
+    for (float surge : {0.5f, 1.0f})
+        for (float loss_s : loss_times)
+            for (float scale : THRUST_SCALES)
+            {
+                Scenario s;
+                s.family = "link_loss";
+                s.metric = SIM_METRIC_LINK_LOSS;
+                s.duration_s = loss_s + 8.0f;
+                s.setpoint.surge = surge;
+                s.setpoint.hold_heading = true;
+                s.link_loss_s = loss_s;
+                s.thrust_scale = scale;
+                s.limits.failsafe_start_s = SETPOINT_DEFAULT_TIMEOUT_MS / 1000.0f;
+                s.limits.failsafe_s = setpoint_failsafe_s;
+                s.limits.drift_m = 6.0f;
+                snprintf(s.name, sizeof(s.name), "link_loss setpoint surge=%.1f loss=%.1fs thrust=%.1f", surge, loss_s, scale);
+                out->push_back(s);
+            }
+}
+
+static void add_packet_losses(std::vector<Scenario> *out)
+{
+    Scenario base;
+    base.family = "packet_loss";
+    base.metric = SIM_METRIC_HEADING;
+    base.duration_s = 10.0f;
+    base.setpoint.surge = 0.5f;
+    base.setpoint.hold_heading = true;
+    base.limits.max_deviation = 5.0f;
+    // ランダムなパケットロス: フェイルセーフに入らず、方位を保持し続けること
+    for (float loss : {0.1f, 0.2f, 0.3f, 0.5f})
+        for (uint32_t seed = 1; seed <= 10; ++seed)
+        {
+            Scenario s = base;
+            s.packet_loss = loss;
+            s.seed = seed;
+            snprintf(s.name, sizeof(s.name), "packet_loss setpoint loss=%.0f%% seed=%u", loss * 100.0f, seed);
+            out->push_back(s);
+        }
+    // 調停器の鮮度より短いバースト状の途切れ
+    for (uint32_t burst : {50u, 100u, 150u})
+        for (uint32_t interval : {500u, 1000u})
+            for (uint32_t seed = 1; seed <= 5; ++seed)
+            {
+                Scenario s = base;
+                s.burst_ms = burst;
+                s.burst_interval_ms = interval;
+                s.seed = seed;
+                snprintf(s.name, sizeof(s.name), "packet_loss setpoint burst=%ums/%ums seed=%u", burst, interval, seed);
+                out->push_back(s);
+            }
+    // 手動操縦 (直進): ジッタバッファの外挿で補いながら、途切れでフェイルセーフに入らないこと
+    for (float loss : {0.1f, 0.3f, 0.5f})
+        for (uint32_t seed = 1; seed <= 10; ++seed)
+        {
+            Scenario s = base;
+            s.mode = SIM_COMMAND_GAMEPAD;
+            s.gamepad.rightThumbY = 24000;
+            s.limits.max_deviation = 10.0f;
+            s.packet_loss = loss;
+            s.seed = seed;
+            snprintf(s.name, sizeof(s.name), "packet_loss gamepad loss=%.0f%% seed=%u", loss * 100.0f, seed);
+            out->push_back(s);
+        }
+}
+
+void sim_build_scenarios(std::vector<Scenario> *out)
+{
+    out->clear();
+    add_heading_steps(out);
+    add_yaw_rate_steps(out);
+    add_surge_steps(out);
+    add_disturbances(out);
+    add_link_losses(out);
+    add_packet_losses(out);
+}
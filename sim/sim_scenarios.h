@@ -0,0 +1,100 @@
+#ifndef SIM_SCENARIOS_H
+#define SIM_SCENARIOS_H
+
+// 閉ループシミュレーションのシナリオと採点
+// 実機の main.cpp と同じ順序で制御コード (コマンドのパース・調停器・ジッタバッファ・ウォッチドッグ・
+// センサーキャッシュ・姿勢推定・目標値制御・スラスター出力) を 100Hz で動かし、
+// スタブに書き込まれた PWM を vehicle_model に与え、その運動から作ったセンサー値をスタブ経由で読ませる。
+// 時刻はシミュレーションの時刻 (MONOTONIC_CLOCK_SIMULATED) で進むため、実時間より速く、乱数の種が同じなら同じ結果になる。
+//
+// 深度 (heave) のシナリオはない: 現在のスラスター配置 (Ch0-3 水平、Ch4-5 前進) には上下方向の推力がないため。
+
+#include "vehicle_model.h" // VehicleParams, Disturbance を使用するため
+#include "gamepad.h"       // GamepadData, SetpointCommand を使用するため
+#include <stdint.h>        // uint32_t を使用するため
+#include <vector>          // シナリオの一覧を保持するため
+
+#define SIM_TICK_S 0.01      // 制御周期 (main.cpp と同じ 100Hz)
+#define SIM_SUBSTEP_S 0.002  // 運動モデルの積分刻み
+
+// 送るコマンドの種類
+enum SimCommandMode
+{
+    SIM_COMMAND_GAMEPAD = 0, // 手動操縦 ("C,..."、thruster_update)
+    SIM_COMMAND_SETPOINT     // 目標値 ("S,..."、setpoint_update + thruster_mix)
+};
+
+// 採点する量
+enum SimMetric
+{
+    SIM_METRIC_HEADING = 0, // 方位 [deg] のステップ応答
+    SIM_METRIC_YAW_RATE,    // ヨー角速度 [deg/s] のステップ応答
+    SIM_METRIC_SURGE_SPEED, // 前進速度 [m/s] (推力特性から求めた終端速度と比べる)
+    SIM_METRIC_LINK_LOSS    // 通信途絶後にフェイルセーフで停止するまでの時間と流された距離
+};
+
+// 合格の基準 (0 の項目は判定しない)
+struct SimLimits
+{
+    float rise_s = 0.0f;           // 立ち上がり時間 (目標の 90% に達するまで)
+    float overshoot = 0.0f;        // オーバーシュート (量の単位)
+    float settling_s = 0.0f;       // 整定時間 (誤差が許容幅に収まり続けるまで)
+    float settle_band = 0.0f;      // 整定の許容幅 (量の単位)
+    float steady_error = 0.0f;     // 最後の1秒の平均誤差 (量の単位)
+    float max_deviation = 0.0f;    // 外乱開始後・パケットロス中の最大誤差 (量の単位)
+    float speed_error_frac = 0.0f; // 終端速度の誤差 (予測値に対する割合)
+    float failsafe_s = 0.0f;       // 途絶から全スラスターが安全値になるまでの時間
+    float failsafe_start_s = 0.0f; // 最後に届いたパケットからウォッチドッグが途絶と判定するまでの時間 (1周期以内の遅れまで許容)
+    float drift_m = 0.0f;          // 途絶から終了までに進んだ距離
+};
+
+// シナリオ1件分
+struct Scenario
+{
+    char name[80] = "";
+    const char *family = "";
+    SimMetric metric = SIM_METRIC_HEADING;
+    SimCommandMode mode = SIM_COMMAND_SETPOINT;
+    float duration_s = 10.0f;
+    float initial_yaw_deg = 0.0f;
+    float step_s = 1.0f;           // この時刻までは初期方位の保持 (手動操縦ではニュートラル) を送り、以降 command / setpoint を送る
+    GamepadData gamepad;           // step_s 以降の手動操縦の入力
+    SetpointCommand setpoint;      // step_s 以降の目標値
+    float target = 0.0f;           // 採点する量の目標値 (方位・角速度。速度は推力特性から求める)
+    Disturbance disturbance;       // disturbance_s 以降に加わる外乱
+    float disturbance_s = 0.0f;
+    float link_loss_s = 0.0f;      // この時刻以降コマンドを送らない (0 なら途絶なし)
+    float packet_loss = 0.0f;      // パケットを落とす確率
+    uint32_t burst_ms = 0;         // burst_interval_ms ごとにこの時間まとめて落とす (短い途切れ)
+    uint32_t burst_interval_ms = 1000;
+    float thrust_scale = 1.0f;     // 全スラスターの最大推力の倍率 (電圧低下・個体差)
+    uint32_t seed = 1;             // センサー雑音・パケットロスの乱数の種
+    SimLimits limits;
+};
+
+// シナリオの結果
+struct ScenarioResult
+{
+    bool passed = false;
+    char reason[96] = "";          // 不合格の理由
+    float rise_s = 0.0f;
+    float overshoot = 0.0f;
+    float settling_s = 0.0f;
+    float steady_error = 0.0f;
+    float max_deviation = 0.0f;
+    float rms_error = 0.0f;
+    float speed = 0.0f;            // 終了時の前進速度 [m/s]
+    float expected_speed = 0.0f;   // 推力特性と抗力から求めた終端速度 [m/s]
+    float failsafe_s = 0.0f;
+    float failsafe_start_s = -1.0f; // 最後に届いたパケットから、ウォッチドッグが通常制御を止めるまでの時間
+    float drift_m = 0.0f;
+    uint32_t failsafe_ticks = 0;   // 最初のコマンドの後、ウォッチドッグが通常制御を許可しなかった周期数
+};
+
+// 関数のプロトタイプ宣言
+// 全シナリオ (ステップ応答・外乱・通信途絶・パケットロスのパラメータの組み合わせ) を生成する
+void sim_build_scenarios(std::vector<Scenario> *out);
+// シナリオを1件実行して採点する。合格なら true
+bool sim_run_scenario(const Scenario &scenario, ScenarioResult *result);
+
+#endif // SIM_SCENARIOS_H
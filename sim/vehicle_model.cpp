@@ -0,0 +1,321 @@
+#include "vehicle_model.h"
+#include <math.h>    // sin, cos, atan2, asin, exp, fabs, sqrt を使用するため
+#include <algorithm> // std::max, std::min を使用するため
+
+static const double RAD_PER_DEG = 0.017453292519943295;
+static const double DEG_PER_RAD = 57.29577951308232;
+static const int STATE_SIZE = 13; // 位置3 + クォータニオン4 + 速度6
+
+// --- ベクトル・回転の補助関数 ---
+static void cross(const double a[3], const double b[3], double out[3])
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// クォータニオン (機体 -> 世界) から回転行列を作る
+static void rotation_from_quat(const double q[4], double r[3][3])
+{
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+    r[0][0] = 1 - 2 * (y * y + z * z);
+    r[0][1] = 2 * (x * y - w * z);
+    r[0][2] = 2 * (x * z + w * y);
+    r[1][0] = 2 * (x * y + w * z);
+    r[1][1] = 1 - 2 * (x * x + z * z);
+    r[1][2] = 2 * (y * z - w * x);
+    r[2][0] = 2 * (x * z - w * y);
+    r[2][1] = 2 * (y * z + w * x);
+    r[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+static void body_to_world(const double r[3][3], const double b[3], double out[3])
+{
+    for (int i = 0; i < 3; ++i)
+        out[i] = r[i][0] * b[0] + r[i][1] * b[1] + r[i][2] * b[2];
+}
+
+static void world_to_body(const double r[3][3], const double w[3], double out[3])
+{
+    for (int i = 0; i < 3; ++i)
+        out[i] = r[0][i] * w[0] + r[1][i] * w[1] + r[2][i] * w[2];
+}
+
+// --- 推力特性 ---
+float thrust_curve_force(const ThrustCurve &curve, int pwm_us)
+{
+    // 可動範囲に対する位置 u (0.0 ~ 1.0) -> 最大推力に対する割合 (不感帯を除いて exponent 乗)
+    auto shape = [&curve](double u) {
+        u = std::max(0.0, std::min(1.0, u));
+        if (u <= curve.deadband_frac)
+            return 0.0;
+        return pow((u - curve.deadband_frac) / (1.0 - curve.deadband_frac), curve.exponent);
+    };
+    if (!curve.bidirectional)
+    {
+        double u = static_cast<double>(pwm_us - curve.pwm_stop) / (curve.pwm_full - curve.pwm_stop);
+        return static_cast<float>(shape(u) * curve.max_forward_n);
+    }
+    if (pwm_us >= curve.pwm_neutral)
+    {
+        double u = static_cast<double>(pwm_us - curve.pwm_neutral) / (curve.pwm_full - curve.pwm_neutral);
+        return static_cast<float>(shape(u) * curve.max_forward_n);
+    }
+    double u = static_cast<double>(curve.pwm_neutral - pwm_us) / (curve.pwm_neutral - curve.pwm_stop);
+    return static_cast<float>(-shape(u) * curve.max_reverse_n);
+}
+
+void vehicle_default_params(VehicleParams *params)
+{
+    *params = VehicleParams();
+    // THRUSTER_ALLOCATION (thruster_control.cpp) と同じ配置:
+    //   Ch0 (前左)・Ch2 (後左) は右向き、Ch1 (前右)・Ch3 (後右) は左向きに押す (前の2基と後の2基で旋回方向が逆)
+    //   Ch4-5 は後部で前向きに押す
+    // 水平スラスターは重心より少し下にあるため、平行移動でロールが生じる (ジャイロによるロール補正の対象)
+    const float mounts[NUM_THRUSTERS][6] = {
+        // x, y, z, dir_x, dir_y, dir_z
+        {0.156f, -0.111f, 0.05f, 0.0f, 1.0f, 0.0f},  // Ch0
+        {0.156f, 0.111f, 0.05f, 0.0f, -1.0f, 0.0f},  // Ch1
+        {-0.156f, -0.111f, 0.05f, 0.0f, 1.0f, 0.0f}, // Ch2
+        {-0.156f, 0.111f, 0.05f, 0.0f, -1.0f, 0.0f}, // Ch3
+        {-0.2f, -0.1f, 0.0f, 1.0f, 0.0f, 0.0f},      // Ch4
+        {-0.2f, 0.1f, 0.0f, 1.0f, 0.0f, 0.0f},       // Ch5
+    };
+    for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            params->thrusters[ch].position[i] = mounts[ch][i];
+            params->thrusters[ch].direction[i] = mounts[ch][3 + i];
+        }
+        params->thrusters[ch].curve = ThrustCurve();
+    }
+}
+
+void vehicle_init(VehicleModel *model, const VehicleParams &params, const SensorNoise &noise, float depth_m, float yaw_deg)
+{
+    model->params = params;
+    model->noise = noise;
+    model->disturbance = Disturbance();
+    VehicleState &s = model->state;
+    s = VehicleState();
+    s.position[2] = depth_m;
+    double half_yaw = 0.5 * yaw_deg * RAD_PER_DEG;
+    s.quat[0] = cos(half_yaw);
+    s.quat[3] = sin(half_yaw);
+    model->rng.seed(noise.seed);
+}
+
+// 状態 y の時間微分を求める (推力は積分の間一定)
+static void derivative(const VehicleModel &model, const double thrust[NUM_THRUSTERS], const double y[STATE_SIZE],
+                       double dy[STATE_SIZE], double accel_out[3])
+{
+    const VehicleParams &p = model.params;
+    const Disturbance &d = model.disturbance;
+    const double *q = y + 3;
+    const double *v = y + 7;  // u, v, w
+    const double *w = y + 10; // p, q, r
+    double r[3][3];
+    rotation_from_quat(q, r);
+
+    // 水に対する相対速度 (潮流を機体座標に変換して差し引く)
+    double current_ned[3] = {d.current_ned[0], d.current_ned[1], d.current_ned[2]};
+    double current_body[3];
+    world_to_body(r, current_ned, current_body);
+    double vr[3] = {v[0] - current_body[0], v[1] - current_body[1], v[2] - current_body[2]};
+
+    double force[3] = {d.force_body[0], d.force_body[1], d.force_body[2]};
+    double torque[3] = {d.torque_body[0], d.torque_body[1], d.torque_body[2]};
+
+    // スラスター
+    for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+    {
+        const ThrusterMount &m = p.thrusters[ch];
+        double f[3] = {m.direction[0] * thrust[ch], m.direction[1] * thrust[ch], m.direction[2] * thrust[ch]};
+        double pos[3] = {m.position[0], m.position[1], m.position[2]};
+        double moment[3];
+        cross(pos, f, moment);
+        for (int i = 0; i < 3; ++i)
+        {
+            force[i] += f[i];
+            torque[i] += moment[i];
+        }
+    }
+
+    // 抗力 (線形 + 2次)
+    for (int i = 0; i < 3; ++i)
+    {
+        force[i] -= (p.linear_drag[i] + p.quadratic_drag[i] * fabs(vr[i])) * vr[i];
+        torque[i] -= (p.linear_drag[3 + i] + p.quadratic_drag[3 + i] * fabs(w[i])) * w[i];
+    }
+
+    // 重力と浮力。水面に出た部分の浮力は失われる (上端から下端まで線形に減る)
+    double down_ned[3] = {0.0, 0.0, 1.0};
+    double down_body[3];
+    world_to_body(r, down_ned, down_body);
+    double submerged = std::max(0.0, std::min(1.0, (y[2] + 0.5 * p.height_m) / p.height_m));
+    double weight = p.mass_kg * SIM_GRAVITY;
+    double buoyancy = p.buoyancy_n * submerged;
+    double buoyancy_force[3];
+    double cob[3] = {p.cob[0], p.cob[1], p.cob[2]};
+    for (int i = 0; i < 3; ++i)
+    {
+        force[i] += (weight - buoyancy) * down_body[i];
+        buoyancy_force[i] = -buoyancy * down_body[i];
+    }
+    double restoring[3];
+    cross(cob, buoyancy_force, restoring); // 重心を原点とするため、モーメントは浮心の浮力だけ
+    for (int i = 0; i < 3; ++i)
+        torque[i] += restoring[i];
+
+    // 付加質量を含む運動方程式
+    double mt[3], it[3], momentum[3], ang_momentum[3], added_momentum[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        mt[i] = p.mass_kg + p.added_mass[i];
+        it[i] = p.inertia[i] + p.added_mass[3 + i];
+        momentum[i] = mt[i] * vr[i];
+        ang_momentum[i] = it[i] * w[i];
+        added_momentum[i] = p.munk_factor * p.added_mass[i] * vr[i];
+    }
+    double w_x_momentum[3], w_x_ang[3], munk[3];
+    cross(w, momentum, w_x_momentum);
+    cross(w, ang_momentum, w_x_ang);
+    cross(vr, added_momentum, munk); // 剛体の質量分 (v × m v) は 0
+    for (int i = 0; i < 3; ++i)
+    {
+        dy[7 + i] = (force[i] - w_x_momentum[i]) / mt[i];
+        dy[10 + i] = (torque[i] - w_x_ang[i] - munk[i]) / it[i];
+    }
+
+    // 位置と姿勢の運動学
+    body_to_world(r, v, dy);
+    dy[3] = 0.5 * (-q[1] * w[0] - q[2] * w[1] - q[3] * w[2]);
+    dy[4] = 0.5 * (q[0] * w[0] + q[2] * w[2] - q[3] * w[1]);
+    dy[5] = 0.5 * (q[0] * w[1] - q[1] * w[2] + q[3] * w[0]);
+    dy[6] = 0.5 * (q[0] * w[2] + q[1] * w[1] - q[2] * w[0]);
+
+    if (accel_out)
+    {
+        // 慣性加速度 (機体座標) = dv/dt + ω × v
+        double w_x_v[3];
+        cross(w, v, w_x_v);
+        for (int i = 0; i < 3; ++i)
+            accel_out[i] = dy[7 + i] + w_x_v[i];
+    }
+}
+
+static void pack(const VehicleState &s, double y[STATE_SIZE])
+{
+    for (int i = 0; i < 3; ++i)
+        y[i] = s.position[i];
+    for (int i = 0; i < 4; ++i)
+        y[3 + i] = s.quat[i];
+    for (int i = 0; i < 6; ++i)
+        y[7 + i] = s.velocity[i];
+}
+
+static void unpack(const double y[STATE_SIZE], VehicleState *s)
+{
+    for (int i = 0; i < 3; ++i)
+        s->position[i] = y[i];
+    double norm = sqrt(y[3] * y[3] + y[4] * y[4] + y[5] * y[5] + y[6] * y[6]);
+    for (int i = 0; i < 4; ++i)
+        s->quat[i] = y[3 + i] / norm;
+    for (int i = 0; i < 6; ++i)
+        s->velocity[i] = y[7 + i];
+}
+
+void vehicle_step(VehicleModel *model, const int pwm_us[NUM_THRUSTERS], double dt_s, double step_s)
+{
+    VehicleState &s = model->state;
+    double target[NUM_THRUSTERS];
+    for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+        target[ch] = thrust_curve_force(model->params.thrusters[ch].curve, pwm_us[ch]);
+
+    double remaining = dt_s;
+    while (remaining > 1e-9)
+    {
+        double h = std::min(step_s, remaining);
+        remaining -= h;
+        // 推力の応答遅れ (一次遅れを厳密に離散化)
+        for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+        {
+            double tau = model->params.thrusters[ch].curve.time_constant_s;
+            double alpha = tau > 0.0 ? 1.0 - exp(-h / tau) : 1.0;
+            s.thrust[ch] += (target[ch] - s.thrust[ch]) * alpha;
+        }
+
+        // 4次のルンゲ・クッタ法
+        double y[STATE_SIZE], k1[STATE_SIZE], k2[STATE_SIZE], k3[STATE_SIZE], k4[STATE_SIZE], tmp[STATE_SIZE];
+        pack(s, y);
+        derivative(*model, s.thrust, y, k1, nullptr);
+        for (int i = 0; i < STATE_SIZE; ++i)
+            tmp[i] = y[i] + 0.5 * h * k1[i];
+        derivative(*model, s.thrust, tmp, k2, nullptr);
+        for (int i = 0; i < STATE_SIZE; ++i)
+            tmp[i] = y[i] + 0.5 * h * k2[i];
+        derivative(*model, s.thrust, tmp, k3, nullptr);
+        for (int i = 0; i < STATE_SIZE; ++i)
+            tmp[i] = y[i] + h * k3[i];
+        derivative(*model, s.thrust, tmp, k4, nullptr);
+        for (int i = 0; i < STATE_SIZE; ++i)
+            y[i] += h / 6.0 * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+        unpack(y, &s);
+        s.time_s += h;
+    }
+
+    // 加速度センサー用に、積分後の状態での加速度を求めておく
+    double y[STATE_SIZE], dy[STATE_SIZE];
+    pack(s, y);
+    derivative(*model, s.thrust, y, dy, s.accel);
+}
+
+void vehicle_sensors(VehicleModel *model, AxisData *gyro, AxisData *accel, AxisData *mag, float *pressure_kpa)
+{
+    const VehicleState &s = model->state;
+    const SensorNoise &n = model->noise;
+    std::normal_distribution<float> unit(0.0f, 1.0f);
+    double r[3][3];
+    rotation_from_quat(s.quat, r);
+
+    gyro->x = static_cast<float>(s.velocity[3] * DEG_PER_RAD) + n.gyro_bias_dps[0] + n.gyro_dps * unit(model->rng);
+    gyro->y = static_cast<float>(s.velocity[4] * DEG_PER_RAD) + n.gyro_bias_dps[1] + n.gyro_dps * unit(model->rng);
+    gyro->z = static_cast<float>(s.velocity[5] * DEG_PER_RAD) + n.gyro_bias_dps[2] + n.gyro_dps * unit(model->rng);
+
+    // 加速度センサーは「重力 - 慣性加速度」を測る (静止・水平で z = +g)
+    double down_ned[3] = {0.0, 0.0, 1.0};
+    double down_body[3];
+    world_to_body(r, down_ned, down_body);
+    accel->x = static_cast<float>(SIM_GRAVITY * down_body[0] - s.accel[0]) + n.accel_ms2 * unit(model->rng);
+    accel->y = static_cast<float>(SIM_GRAVITY * down_body[1] - s.accel[1]) + n.accel_ms2 * unit(model->rng);
+    accel->z = static_cast<float>(SIM_GRAVITY * down_body[2] - s.accel[2]) + n.accel_ms2 * unit(model->rng);
+
+    double field_ned[3] = {model->params.mag_field_ned[0], model->params.mag_field_ned[1], model->params.mag_field_ned[2]};
+    double field_body[3];
+    world_to_body(r, field_ned, field_body);
+    mag->x = static_cast<float>(field_body[0]) + n.mag * unit(model->rng);
+    mag->y = static_cast<float>(field_body[1]) + n.mag * unit(model->rng);
+    mag->z = static_cast<float>(field_body[2]) + n.mag * unit(model->rng);
+
+    // 圧力センサーは重心の位置にあるとする。水面より上では大気圧
+    double depth = std::max(0.0, s.position[2]);
+    *pressure_kpa = static_cast<float>(SIM_SURFACE_PRESSURE_KPA + model->params.water_density * SIM_GRAVITY * depth / 1000.0) +
+                    n.pressure_kpa * unit(model->rng);
+}
+
+void vehicle_euler_deg(const VehicleState &state, float *roll_deg, float *pitch_deg, float *yaw_deg)
+{
+    const double *q = state.quat;
+    double sinp = std::max(-1.0, std::min(1.0, 2.0 * (q[0] * q[2] - q[3] * q[1])));
+    *roll_deg = static_cast<float>(atan2(2.0 * (q[0] * q[1] + q[2] * q[3]), 1.0 - 2.0 * (q[1] * q[1] + q[2] * q[2])) * DEG_PER_RAD);
+    *pitch_deg = static_cast<float>(asin(sinp) * DEG_PER_RAD);
+    *yaw_deg = static_cast<float>(atan2(2.0 * (q[0] * q[3] + q[1] * q[2]), 1.0 - 2.0 * (q[2] * q[2] + q[3] * q[3])) * DEG_PER_RAD);
+}
+
+void vehicle_velocity_ned(const VehicleState &state, double out[3])
+{
+    double r[3][3];
+    rotation_from_quat(state.quat, r);
+    body_to_world(r, state.velocity, out);
+}
@@ -0,0 +1,121 @@
+#ifndef VEHICLE_MODEL_H
+#define VEHICLE_MODEL_H
+
+// 機体の6自由度運動モデル (閉ループシミュレーション用)
+// 剛体の運動方程式に付加質量・線形 + 2次の抗力・重力と浮力 (重心と浮心のずれによる復元モーメント) を加え、
+// スラスターの推力特性 (T200 型の2次カーブ + 回転数の応答遅れ) と取り付け位置・向きから力とモーメントを求める。
+//
+// 座標系: 世界座標は NED (北・東・下)、機体座標は前・右・下。角度は右舷下がり・機首上げ・右旋回が正。
+// 運動方程式 (付加質量を含む対角の慣性、重心を原点とする Kirchhoff の式):
+//   M_t dv/dt = F - ω × (M_t v)
+//   I_t dω/dt = τ - ω × (I_t ω) - munk_factor · v × (M_A v)
+// v, ω は水に対する相対速度で抗力を計算する (潮流は世界座標の一定速度として与える)。
+// センサー出力は実機の bindings.h と同じ単位・向き (ジャイロ deg/s、加速度は静止・水平で z = +g、圧力 kPa) で返す。
+
+#include "thruster_control.h" // NUM_THRUSTERS, PWM_MIN, PWM_BOOST_MAX, THRUSTER_BIDIRECTIONAL を使用するため
+#include "thrust_curve.h"     // THRUSTER_DEADBAND_FRAC を使用するため
+#include "bindings.h"         // AxisData を使用するため
+#include <stdint.h>           // uint32_t を使用するため
+#include <random>             // std::mt19937 を使用するため
+
+#define SIM_GRAVITY 9.81f           // 重力加速度 [m/s^2]
+#define SIM_SURFACE_PRESSURE_KPA 101.325f // 水面の大気圧 [kPa]
+
+// スラスターの推力特性 (PWM パルス幅 -> 推力 [N])
+// 既定は thrust_curve.h と同じ不感帯・2次カーブで、制御側と同じ ESC の設定 (THRUSTER_BIDIRECTIONAL) の T200 (16V) を模擬する
+struct ThrustCurve
+{
+    int pwm_stop = PWM_MIN;                        // 推力ゼロのパルス幅 (一方向の場合)
+    int pwm_full = PWM_BOOST_MAX;                  // 最大推力のパルス幅
+    float deadband_frac = THRUSTER_DEADBAND_FRAC;  // 不感帯 (可動範囲に対する割合)
+    float exponent = 2.0f;                         // 推力 ∝ (位置 - 不感帯)^exponent
+    float max_forward_n = 51.5f;                   // 最大推力 [N] (T200 @16V: 約 5.25 kgf)
+    bool bidirectional = THRUSTER_BIDIRECTIONAL != 0; // true: pwm_neutral を中心に正逆両方向 (T200 の標準 ESC 設定)
+    int pwm_neutral = PWM_NEUTRAL;                 // 両方向の場合の停止位置
+    float max_reverse_n = 40.2f;                   // 両方向の場合の最大逆推力 [N] (T200 @16V: 約 4.1 kgf)
+    float time_constant_s = 0.05f;                 // 推力の応答遅れ (一次遅れの時定数)
+};
+
+// スラスター1基の取り付け
+struct ThrusterMount
+{
+    float position[3];  // 重心からの位置 [m] (機体座標)
+    float direction[3]; // 正の推力の向き (単位ベクトル、機体座標)
+    ThrustCurve curve;
+};
+
+// 機体のパラメータ (既定値は BlueROV2 程度の大きさ・公開されている流体力係数)
+struct VehicleParams
+{
+    float mass_kg = 11.5f;
+    float buoyancy_n = 11.7f * SIM_GRAVITY;        // 全没時の浮力 [N] (わずかに正浮力)
+    float height_m = 0.25f;                         // 水面で浮力が減り始める高さ (上端から下端まで)
+    float cob[3] = {0.0f, 0.0f, -0.04f};            // 浮心 (重心より上にあると復元モーメントが働く)
+    float inertia[3] = {0.16f, 0.16f, 0.16f};       // 慣性モーメント Ixx, Iyy, Izz [kg m^2]
+    float added_mass[6] = {5.5f, 12.7f, 14.57f, 0.12f, 0.12f, 0.12f};   // 付加質量 X_u', Y_v', Z_w', K_p', M_q', N_r'
+    float linear_drag[6] = {4.03f, 6.22f, 5.18f, 0.07f, 0.07f, 0.07f};  // 線形抗力 [N/(m/s)], [Nm/(rad/s)]
+    float quadratic_drag[6] = {18.18f, 21.66f, 36.99f, 1.55f, 1.55f, 1.55f}; // 2次抗力
+    float munk_factor = 0.1f;                       // 付加質量による Munk モーメント (v × M_A v) に掛ける割合。
+                                                    // 箱型の機体では流れの剥離のためポテンシャル流の値より大幅に小さい
+    ThrusterMount thrusters[NUM_THRUSTERS];         // vehicle_default_params で THRUSTER_ALLOCATION と同じ配置にする
+    float mag_field_ned[3] = {0.3f, 0.0f, 0.4f};    // 地磁気 (NED、スタブと同じ単位)
+    float water_density = 1025.0f;                  // 海水の密度 [kg/m^3] (圧力の換算用)
+};
+
+// センサーの雑音
+struct SensorNoise
+{
+    float gyro_dps = 0.1f;       // ジャイロの白色雑音 (標準偏差)
+    float gyro_bias_dps[3] = {0.0f, 0.0f, 0.0f}; // ジャイロのバイアス
+    float accel_ms2 = 0.05f;     // 加速度
+    float mag = 0.005f;          // 磁気
+    float pressure_kpa = 0.02f;  // 圧力 (約2mm)
+    uint32_t seed = 1;           // 乱数の種 (同じ種なら同じ結果)
+};
+
+// 外乱
+struct Disturbance
+{
+    float current_ned[3] = {0.0f, 0.0f, 0.0f}; // 潮流 [m/s] (世界座標)
+    float force_body[3] = {0.0f, 0.0f, 0.0f};  // 機体に加わる外力 [N] (テザーの張力など)
+    float torque_body[3] = {0.0f, 0.0f, 0.0f}; // 外力によるモーメント [Nm]
+};
+
+// 運動の状態
+struct VehicleState
+{
+    double position[3];   // 位置 [m] (NED。position[2] が深度)
+    double quat[4];       // 姿勢 (機体 -> 世界の回転、w, x, y, z)
+    double velocity[6];   // 機体座標の速度 u, v, w [m/s] と角速度 p, q, r [rad/s]
+    double accel[3];      // 直前の積分で求めた機体座標の加速度 dv/dt + ω × v (加速度センサー用)
+    double thrust[NUM_THRUSTERS]; // 各スラスターの現在の推力 [N] (応答遅れを含む)
+    double time_s;
+};
+
+// シミュレーターの状態
+struct VehicleModel
+{
+    VehicleParams params;
+    SensorNoise noise;
+    Disturbance disturbance;
+    VehicleState state;
+    std::mt19937 rng;
+};
+
+// 関数のプロトタイプ宣言
+// 既定のパラメータ (スラスター配置を含む) を設定する
+void vehicle_default_params(VehicleParams *params);
+// PWM パルス幅から定常推力 [N] を求める
+float thrust_curve_force(const ThrustCurve &curve, int pwm_us);
+// モデルを初期化する (静止・水平、指定した深度と方位)
+void vehicle_init(VehicleModel *model, const VehicleParams &params, const SensorNoise &noise, float depth_m, float yaw_deg);
+// PWM 出力 (Ch0-5) を dt_s の間与えて運動を進める (内部で step_s ごとに RK4 で積分する)
+void vehicle_step(VehicleModel *model, const int pwm_us[NUM_THRUSTERS], double dt_s, double step_s);
+// センサーの読み値を作る (雑音を含む)
+void vehicle_sensors(VehicleModel *model, AxisData *gyro, AxisData *accel, AxisData *mag, float *pressure_kpa);
+// 現在の姿勢をオイラー角 (度) で返す
+void vehicle_euler_deg(const VehicleState &state, float *roll_deg, float *pitch_deg, float *yaw_deg);
+// 世界座標の速度 [m/s] を返す (北・東・下)
+void vehicle_velocity_ned(const VehicleState &state, double out[3]);
+
+#endif // VEHICLE_MODEL_H
@@ -0,0 +1,138 @@
+#include "adc_filter.h"
+#include <string.h> // memcpy, memset を使用するため
+
+// 4チャンネル分のベクトル (GCC のベクトル拡張。SIMD 命令が使える環境では各要素に対して同時に演算する)
+typedef float AdcVec __attribute__((vector_size(ADC_FILTER_CHANNELS * sizeof(float))));
+
+static inline AdcVec load_vec(const float *p)
+{
+    AdcVec v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void store_vec(float *p, AdcVec v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline AdcVec splat(float x)
+{
+    AdcVec v = {x, x, x, x};
+    return v;
+}
+
+static inline AdcVec vec_min(AdcVec a, AdcVec b)
+{
+    return a < b ? a : b;
+}
+
+static inline AdcVec vec_max(AdcVec a, AdcVec b)
+{
+    return a < b ? b : a;
+}
+
+// 窓の中央値 (チャンネルごと)。min/max の比較交換で窓を並べ替え、中央を取る (n <= ADC_FILTER_MAX_MEDIAN)
+static AdcVec median_of(const float (*window)[ADC_FILTER_CHANNELS], uint32_t n)
+{
+    AdcVec v[ADC_FILTER_MAX_MEDIAN];
+    for (uint32_t i = 0; i < n; ++i)
+        v[i] = load_vec(window[i]);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        for (uint32_t j = i + 1; j < n; ++j)
+        {
+            AdcVec lo = vec_min(v[i], v[j]);
+            v[j] = vec_max(v[i], v[j]);
+            v[i] = lo;
+        }
+    }
+    return v[n / 2];
+}
+
+// 最初のサンプルで各段の状態を埋める
+static void prime(AdcFilterBank *bank, AdcVec x)
+{
+    for (uint32_t i = 0; i < bank->config.median_taps; ++i)
+        store_vec(bank->median_history[i], x);
+    for (uint32_t i = 0; i < bank->config.average_taps; ++i)
+        store_vec(bank->average_history[i], x);
+    store_vec(bank->average_sum, x * splat(static_cast<float>(bank->config.average_taps)));
+    store_vec(bank->iir_state, x);
+    bank->primed = true;
+}
+
+bool adc_filter_init(AdcFilterBank *bank, const AdcFilterConfig &config)
+{
+    if (config.median_taps == 0 || config.median_taps > ADC_FILTER_MAX_MEDIAN || config.median_taps % 2 == 0 ||
+        config.average_taps == 0 || config.average_taps > ADC_FILTER_MAX_AVERAGE || !(config.iir_alpha > 0.0f) ||
+        config.iir_alpha > 1.0f || config.decimation == 0 || config.decimation > ADC_FILTER_MAX_BLOCK)
+    {
+        return false;
+    }
+    memset(static_cast<void *>(bank), 0, sizeof(*bank));
+    bank->config = config;
+    return true;
+}
+
+int adc_filter_process(AdcFilterBank *bank, const float (*samples)[ADC_FILTER_CHANNELS], int count,
+                       float (*out)[ADC_FILTER_CHANNELS], int max_out)
+{
+    const AdcFilterConfig &c = bank->config;
+    if (count <= 0)
+        return 0;
+    // このブロックで出る出力の数 (間引きの位置は前のブロックから引き継ぐ)
+    uint32_t outputs = (bank->decimation_count + static_cast<uint32_t>(count)) / c.decimation;
+    if (max_out < 0 || outputs > static_cast<uint32_t>(max_out))
+        return -1;
+    if (!bank->primed)
+        prime(bank, load_vec(samples[0]));
+
+    // ブロック内は状態をレジスタ (ローカル変数) に置いたまま処理し、最後に書き戻す
+    const AdcVec alpha = splat(c.iir_alpha);
+    const AdcVec inv_average = splat(1.0f / static_cast<float>(c.average_taps));
+    AdcVec sum = load_vec(bank->average_sum);
+    AdcVec y = load_vec(bank->iir_state);
+    int written = 0;
+    for (int n = 0; n < count; ++n)
+    {
+        AdcVec x = load_vec(samples[n]);
+
+        // 1. メディアン: 単発のスパイク (ノイズ・読み取りの失敗) を除去する
+        if (c.median_taps > 1)
+        {
+            store_vec(bank->median_history[bank->median_pos], x);
+            bank->median_pos = (bank->median_pos + 1) % c.median_taps;
+            x = median_of(bank->median_history, c.median_taps);
+        }
+
+        // 2. 移動平均: 窓の合計を差分で更新する (窓が一周するたびに合計を計算し直し、丸め誤差を溜めない)
+        if (c.average_taps > 1)
+        {
+            sum += x - load_vec(bank->average_history[bank->average_pos]);
+            store_vec(bank->average_history[bank->average_pos], x);
+            bank->average_pos++;
+            if (bank->average_pos == c.average_taps)
+            {
+                bank->average_pos = 0;
+                sum = splat(0.0f);
+                for (uint32_t i = 0; i < c.average_taps; ++i)
+                    sum += load_vec(bank->average_history[i]);
+            }
+            x = sum * inv_average;
+        }
+
+        // 3. 一次 IIR ローパス
+        y += alpha * (x - y);
+
+        // 4. 間引き: decimation 個ごとに出力する (それ以外の出力は捨てる。エイリアシングは前段のフィルタで抑える)
+        if (++bank->decimation_count >= c.decimation)
+        {
+            bank->decimation_count = 0;
+            store_vec(out[written++], y);
+        }
+    }
+    store_vec(bank->average_sum, sum);
+    store_vec(bank->iir_state, y);
+    return written;
+}
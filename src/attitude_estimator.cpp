@@ -0,0 +1,84 @@
+#include "attitude_estimator.h"
+#include <math.h> // atan2f, sqrtf, sinf, cosf を使用するため
+
+static const float DEG_PER_RAD = 57.29577951f;
+static const float RAD_PER_DEG = 0.01745329252f;
+
+float attitude_wrap_deg(float angle_deg)
+{
+    while (angle_deg >= 180.0f)
+        angle_deg -= 360.0f;
+    while (angle_deg < -180.0f)
+        angle_deg += 360.0f;
+    return angle_deg;
+}
+
+// 加速度 (重力方向) からロール・ピッチを求める
+static void tilt_from_accel(const AxisData &accel, float *roll_deg, float *pitch_deg)
+{
+    *roll_deg = atan2f(accel.y, accel.z) * DEG_PER_RAD;
+    *pitch_deg = atan2f(-accel.x, sqrtf(accel.y * accel.y + accel.z * accel.z)) * DEG_PER_RAD;
+}
+
+// 傾き補正した磁気方位を求める。磁気の値が無効 (ゼロ) なら false
+static bool heading_from_mag(const AxisData &mag, float roll_deg, float pitch_deg, float *yaw_deg)
+{
+    if (mag.x == 0.0f && mag.y == 0.0f && mag.z == 0.0f)
+        return false;
+    float r = roll_deg * RAD_PER_DEG;
+    float p = pitch_deg * RAD_PER_DEG;
+    float mx = mag.x * cosf(p) + mag.z * sinf(p);
+    float my = mag.x * sinf(r) * sinf(p) + mag.y * cosf(r) - mag.z * sinf(r) * cosf(p);
+    *yaw_deg = atan2f(-my, mx) * DEG_PER_RAD;
+    return true;
+}
+
+void attitude_init(AttitudeEstimator *est, float accel_weight, float mag_weight)
+{
+    *est = AttitudeEstimator();
+    est->accel_weight = accel_weight;
+    est->mag_weight = mag_weight;
+}
+
+void attitude_update(AttitudeEstimator *est, const AxisData &accel, const AxisData &gyro, const AxisData &mag, float dt_s)
+{
+    float accel_roll, accel_pitch;
+    tilt_from_accel(accel, &accel_roll, &accel_pitch);
+    bool accel_valid = !(accel.x == 0.0f && accel.y == 0.0f && accel.z == 0.0f);
+    Attitude &att = est->attitude;
+
+    if (!est->initialized)
+    {
+        // 最初の更新は加速度・磁気から直接初期化する (ゼロから収束するまで待たない)
+        if (!accel_valid)
+            return;
+        att.roll_deg = accel_roll;
+        att.pitch_deg = accel_pitch;
+        float mag_yaw;
+        if (heading_from_mag(mag, att.roll_deg, att.pitch_deg, &mag_yaw))
+            att.yaw_deg = mag_yaw;
+        est->initialized = true;
+        return;
+    }
+
+    // ジャイロの積分 (小角近似。周期間隔が異常に長い場合は積分しない)
+    if (dt_s > 0.0f && dt_s <= ATTITUDE_MAX_DT_S)
+    {
+        att.roll_deg += gyro.x * dt_s;
+        att.pitch_deg += gyro.y * dt_s;
+        att.yaw_deg = attitude_wrap_deg(att.yaw_deg + gyro.z * dt_s);
+    }
+
+    // 加速度による補正 (ロール・ピッチ)
+    if (accel_valid)
+    {
+        att.roll_deg += est->accel_weight * attitude_wrap_deg(accel_roll - att.roll_deg);
+        att.pitch_deg += est->accel_weight * (accel_pitch - att.pitch_deg);
+        att.roll_deg = attitude_wrap_deg(att.roll_deg);
+    }
+
+    // 磁気方位による補正 (ヨー)。差は -180〜180 に正規化して 0/360 の境界をまたいでも最短方向へ寄せる
+    float mag_yaw;
+    if (est->mag_weight > 0.0f && heading_from_mag(mag, att.roll_deg, att.pitch_deg, &mag_yaw))
+        att.yaw_deg = attitude_wrap_deg(att.yaw_deg + est->mag_weight * attitude_wrap_deg(mag_yaw - att.yaw_deg));
+}
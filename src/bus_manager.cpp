@@ -0,0 +1,631 @@
+#include "bus_manager.h"
+#include "monotonic_clock.h" // CLOCK_MONOTONIC による時刻取得
+#include <stdio.h>           // printf, snprintf, perror を使用するため
+#include <unistd.h>          // read, write, close を使用するため
+#include <poll.h>            // poll を使用するため
+#include <pthread.h>         // スレッド優先度の設定のため
+#include <sys/eventfd.h>     // eventfd を使用するため (要求があったときにバススレッドを起こす)
+#include <sys/timerfd.h>     // timerfd_create, timerfd_settime を使用するため
+#include <thread>            // std::thread を使用するため
+#include <atomic>            // std::atomic を使用するため
+#include <mutex>             // std::mutex を使用するため
+#include <condition_variable> // 即時の読み取りの完了待ち
+#include <string.h>          // memcpy を使用するため
+
+#define BUS_PWM_CHANNELS 16                              // Navigator の PWM チャンネル数
+static const uint64_t ON_DEMAND_TIMEOUT_NS = 100000000ULL; // 即時の読み取りを待つ上限 (バススレッドが止まっていた場合は最新値を返す)
+
+// --- バス管理の状態 ---
+static BusManagerConfig bm_config;          // 現在の設定
+static std::thread bm_thread;               // バススレッド
+static std::atomic<bool> bm_running(false); // バススレッドの実行フラグ (true の間はバススレッドだけがハードウェアに触る)
+static std::atomic<bool> bm_stop_request(false); // バススレッドへの停止要求 (PWM を書き終えてから bm_running を下ろす)
+static int bm_timer_fd = -1;                // 周期の timerfd
+static int bm_event_fd = -1;                // 要求の通知用 eventfd
+static std::atomic<bool> bm_wake_pending(false); // 通知済みでバススレッドがまだ起きていない (同じ周期の書き込みの通知を1回にまとめる)
+static std::atomic<bool> bm_idle(false);         // アイドル中 (周期を延ばし、低速のセンサーの読み取りを減らす)
+
+// 書き込み待ちの PWM (bm_pwm_mutex で保護)
+static std::mutex bm_pwm_mutex;
+static float pending_duty[BUS_PWM_CHANNELS];
+static uint32_t pending_duty_mask = 0; // bit n = チャンネル n に書き込み待ちの値がある
+static int pending_enable = -1;        // -1: 要求なし, 0: 無効化, 1: 有効化
+static float pending_freq_hz = 0.0f;   // 0 以下: 要求なし
+static bool pwm_direct = true;         // PWM を呼び出したスレッドで直接書き込むか (バススレッドが書き込み待ちを処理し終えると true)
+
+// 最新のセンサー値 (bm_cache_mutex で保護)
+struct BusSensorCache
+{
+    AxisData accel = {0.0f, 0.0f, 0.0f};
+    AxisData gyro = {0.0f, 0.0f, 0.0f};
+    AxisData mag = {0.0f, 0.0f, 0.0f};
+    bool leak = false;
+    float pressure = 0.0f;
+    float adc[BUS_ADC_CHANNELS] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float temperature = 0.0f;
+};
+static std::mutex bm_cache_mutex;
+static BusSensorCache bm_cache;
+
+// 即時の読み取り要求 (bit n = BusDevice n)。完了は世代番号を進めて通知する
+static std::atomic<uint32_t> bm_on_demand_mask(0);
+static std::mutex bm_on_demand_mutex;
+static std::condition_variable bm_on_demand_cv;
+static uint32_t bm_on_demand_generation[BUS_DEVICE_COUNT];
+
+// 統計 (bm_stats_mutex で保護。更新はバススレッドのみ)
+static std::mutex bm_stats_mutex;
+static BusStats bm_stats;
+
+// 以下はバススレッド (開始前・停止後は呼び出し側のスレッド) のみが触る
+static uint64_t next_due_ns[BUS_DEVICE_COUNT]; // 次に読む時刻
+static uint32_t defer_ticks[BUS_DEVICE_COUNT]; // 予算不足で続けて後回しにした周期数
+static AdcFilterBank bm_adc_filter;                                    // ADC のフィルタバンク
+static float bm_adc_block[ADC_FILTER_MAX_BLOCK][ADC_FILTER_CHANNELS]; // フィルタバンクに渡す前の ADC のサンプル (間引きの1周期分)
+static uint32_t bm_adc_block_count = 0;                                // bm_adc_block に溜まったサンプル数
+static bool bm_adc_filtered = false;                                   // フィルタバンクの出力があるか
+
+static_assert(BUS_ADC_CHANNELS == ADC_FILTER_CHANNELS, "ADC のチャンネル数をフィルタバンクの幅と一致させてください");
+
+const char *bus_device_name(BusDevice device)
+{
+    switch (device)
+    {
+    case BUS_DEVICE_PWM:
+        return "pwm";
+    case BUS_DEVICE_GYRO:
+        return "gyro";
+    case BUS_DEVICE_ACCEL:
+        return "accel";
+    case BUS_DEVICE_MAG:
+        return "mag";
+    case BUS_DEVICE_LEAK:
+        return "leak";
+    case BUS_DEVICE_PRESSURE:
+        return "pressure";
+    case BUS_DEVICE_ADC:
+        return "adc";
+    case BUS_DEVICE_TEMP:
+        return "temp";
+    case BUS_DEVICE_COUNT:
+        break;
+    }
+    return "unknown";
+}
+
+// トランザクション1回分の所要時間を記録する
+static void record_transaction(BusDevice device, uint64_t elapsed_ns)
+{
+    uint32_t ns = elapsed_ns > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(elapsed_ns);
+    std::lock_guard<std::mutex> lock(bm_stats_mutex);
+    BusDeviceStats &s = bm_stats.devices[device];
+    s.transactions++;
+    s.total_ns += ns;
+    s.last_ns = ns;
+    if (ns > s.max_ns)
+        s.max_ns = ns;
+}
+
+// ADC のサンプルを間引きの1周期分溜め、溜まったらフィルタバンクでまとめて処理して adc を出力で置き換える。
+// 最新値を更新すべきとき true を返す (最初の出力が出るまでは生の値で更新する)
+static bool filter_adc_sample(float adc[BUS_ADC_CHANNELS])
+{
+    memcpy(bm_adc_block[bm_adc_block_count++], adc, sizeof(bm_adc_block[0]));
+    if (bm_adc_block_count < bm_adc_filter.config.decimation)
+        return !bm_adc_filtered;
+    float filtered[1][ADC_FILTER_CHANNELS];
+    int outputs = adc_filter_process(&bm_adc_filter, bm_adc_block, static_cast<int>(bm_adc_block_count), filtered, 1);
+    bm_adc_block_count = 0;
+    if (outputs < 0)
+    {
+        // 1周期分ずつ渡しているため起こらないはず (起きた場合はこのブロックを捨てる)
+        fprintf(stderr, "バス管理: ADC のフィルタの出力が溢れました (ブロックを破棄)\n");
+        return !bm_adc_filtered;
+    }
+    if (outputs == 0)
+        return !bm_adc_filtered;
+    memcpy(adc, filtered[0], sizeof(filtered[0]));
+    bm_adc_filtered = true;
+    return true;
+}
+
+// センサー1つを読み、最新値を更新する (PWM 以外)
+static void read_device(BusDevice device)
+{
+    uint64_t start_ns = monotonic_now_ns();
+    BusSensorCache value;
+    switch (device)
+    {
+    case BUS_DEVICE_GYRO:
+        value.gyro = read_gyro();
+        break;
+    case BUS_DEVICE_ACCEL:
+        value.accel = read_accel();
+        break;
+    case BUS_DEVICE_MAG:
+        value.mag = read_mag();
+        break;
+    case BUS_DEVICE_LEAK:
+        value.leak = read_leak();
+        break;
+    case BUS_DEVICE_PRESSURE:
+        value.pressure = read_pressure();
+        break;
+    case BUS_DEVICE_ADC:
+        read_adc_all(value.adc, BUS_ADC_CHANNELS);
+        break;
+    case BUS_DEVICE_TEMP:
+        value.temperature = read_temp();
+        break;
+    default:
+        return;
+    }
+    record_transaction(device, monotonic_now_ns() - start_ns);
+    if (device == BUS_DEVICE_ADC && !filter_adc_sample(value.adc))
+        return;
+
+    std::lock_guard<std::mutex> lock(bm_cache_mutex);
+    switch (device)
+    {
+    case BUS_DEVICE_GYRO:
+        bm_cache.gyro = value.gyro;
+        break;
+    case BUS_DEVICE_ACCEL:
+        bm_cache.accel = value.accel;
+        break;
+    case BUS_DEVICE_MAG:
+        bm_cache.mag = value.mag;
+        break;
+    case BUS_DEVICE_LEAK:
+        bm_cache.leak = value.leak;
+        break;
+    case BUS_DEVICE_PRESSURE:
+        bm_cache.pressure = value.pressure;
+        break;
+    case BUS_DEVICE_ADC:
+        for (int i = 0; i < BUS_ADC_CHANNELS; ++i)
+            bm_cache.adc[i] = value.adc[i];
+        break;
+    case BUS_DEVICE_TEMP:
+        bm_cache.temperature = value.temperature;
+        break;
+    default:
+        break;
+    }
+}
+
+// 書き込み待ちの PWM を取り出す (bm_pwm_mutex を保持して呼び出す)
+static void take_pending_pwm(float duty[BUS_PWM_CHANNELS], uint32_t *mask, int *enable, float *freq_hz)
+{
+    *mask = pending_duty_mask;
+    *enable = pending_enable;
+    *freq_hz = pending_freq_hz;
+    for (int ch = 0; ch < BUS_PWM_CHANNELS; ++ch)
+        duty[ch] = pending_duty[ch];
+    pending_duty_mask = 0;
+    pending_enable = -1;
+    pending_freq_hz = 0.0f;
+}
+
+// 取り出した PWM の要求をハードウェアに書き込む
+// 有効化・周波数はデューティ比より先に、無効化は最後に行う (thruster_init / thruster_disable の順序を保つ)
+static void write_pwm(const float duty[BUS_PWM_CHANNELS], uint32_t mask, int enable, float freq_hz)
+{
+    if (enable == 1)
+        set_pwm_enable(true);
+    if (freq_hz > 0.0f)
+        set_pwm_freq_hz(freq_hz);
+    for (int ch = 0; ch < BUS_PWM_CHANNELS; ++ch)
+    {
+        if (!(mask & (1u << ch)))
+            continue;
+        uint64_t start_ns = monotonic_now_ns();
+        set_pwm_channel_duty_cycle(static_cast<uintptr_t>(ch), duty[ch]);
+        record_transaction(BUS_DEVICE_PWM, monotonic_now_ns() - start_ns);
+    }
+    if (enable == 0)
+        set_pwm_enable(false);
+}
+
+// 書き込み待ちの PWM をハードウェアに書き込む (要求はロック内で取り出し、書き込みはロックの外で行う)
+static void flush_pwm()
+{
+    float duty[BUS_PWM_CHANNELS];
+    uint32_t mask;
+    int enable;
+    float freq_hz;
+    {
+        std::lock_guard<std::mutex> lock(bm_pwm_mutex);
+        take_pending_pwm(duty, &mask, &enable, &freq_hz);
+    }
+    write_pwm(duty, mask, enable, freq_hz);
+}
+
+// 停止時に書き込み待ちの PWM を書き込み、以降の書き込みを呼び出したスレッドでの直接書き込みに切り替える。
+// ロックを保持したまま書き込むため、切り替え後の直接書き込み (ウォッチドッグ・浸水監視) が古い値で上書きされることはない
+static void drain_pwm_and_go_direct()
+{
+    float duty[BUS_PWM_CHANNELS];
+    uint32_t mask;
+    int enable;
+    float freq_hz;
+    std::lock_guard<std::mutex> lock(bm_pwm_mutex);
+    take_pending_pwm(duty, &mask, &enable, &freq_hz);
+    write_pwm(duty, mask, enable, freq_hz);
+    pwm_direct = true;
+}
+
+// 即時の読み取り要求を優先度順に処理し、待っているスレッドに通知する
+static void serve_on_demand()
+{
+    uint32_t mask = bm_on_demand_mask.exchange(0);
+    if (mask == 0)
+        return;
+    for (int d = BUS_DEVICE_GYRO; d < BUS_DEVICE_COUNT; ++d)
+    {
+        if (mask & (1u << d))
+            read_device(static_cast<BusDevice>(d));
+    }
+    {
+        std::lock_guard<std::mutex> lock(bm_on_demand_mutex);
+        for (int d = 0; d < BUS_DEVICE_COUNT; ++d)
+        {
+            if (mask & (1u << d))
+                bm_on_demand_generation[d]++;
+        }
+    }
+    bm_on_demand_cv.notify_all();
+}
+
+// 1周期分の処理: PWM -> IMU (毎周期) -> 低速のセンサー (周期が来ていて予算に収まるもの)
+static void bus_tick(uint64_t now_ns)
+{
+    const uint64_t budget_ns = static_cast<uint64_t>(bm_config.tick_budget_us) * 1000ULL;
+    const bool idle = bm_idle.load();
+    flush_pwm();
+    serve_on_demand();
+
+    bool overrun = false;
+    for (int d = BUS_DEVICE_GYRO; d < BUS_DEVICE_COUNT; ++d)
+    {
+        BusDevice device = static_cast<BusDevice>(d);
+        if (now_ns < next_due_ns[d])
+            continue;
+        uint64_t elapsed_ns = monotonic_now_ns() - now_ns;
+        bool high_priority = device <= BUS_DEVICE_MAG; // ジャイロ・加速度・磁気は予算に関係なく毎周期読む
+        if (high_priority)
+        {
+            overrun = overrun || elapsed_ns > budget_ns;
+        }
+        else
+        {
+            // 予算の残りが前回までの平均の所要時間に満たなければ次の周期に回す (続けて後回しにしすぎたら読む)
+            uint64_t estimate_ns;
+            {
+                std::lock_guard<std::mutex> lock(bm_stats_mutex);
+                const BusDeviceStats &s = bm_stats.devices[d];
+                estimate_ns = s.transactions > 0 ? s.total_ns / s.transactions : 0;
+            }
+            if (elapsed_ns + estimate_ns > budget_ns && defer_ticks[d] < bm_config.max_defer_ticks)
+            {
+                defer_ticks[d]++;
+                std::lock_guard<std::mutex> lock(bm_stats_mutex);
+                bm_stats.devices[d].deferred++;
+                continue;
+            }
+        }
+        read_device(device);
+        defer_ticks[d] = 0;
+        uint32_t period_ms = bm_config.device_period_ms[d];
+        if (idle && !high_priority && period_ms < bm_config.idle_slow_period_ms)
+            period_ms = bm_config.idle_slow_period_ms;
+        uint64_t period_ns = static_cast<uint64_t>(period_ms) * 1000000ULL;
+        // 読み取りの時刻が周期の途中にずれていかないよう、予定時刻から次の予定を決める
+        next_due_ns[d] += period_ns;
+        if (next_due_ns[d] <= now_ns)
+            next_due_ns[d] = now_ns + period_ns;
+        // PWM の書き込み要求・即時の読み取り要求は、次のセンサーより先に処理する
+        flush_pwm();
+        serve_on_demand();
+    }
+
+    uint64_t tick_ns = monotonic_now_ns() - now_ns;
+    std::lock_guard<std::mutex> lock(bm_stats_mutex);
+    bm_stats.ticks++;
+    if (idle)
+        bm_stats.idle_ticks++;
+    if (overrun)
+        bm_stats.budget_overruns++;
+    uint32_t tick_us = static_cast<uint32_t>(tick_ns / 1000ULL);
+    if (tick_us > bm_stats.max_tick_us)
+        bm_stats.max_tick_us = tick_us;
+}
+
+// 周期の timerfd を設定する
+static bool set_timer_period(uint32_t period_ms)
+{
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = period_ms / 1000;
+    spec.it_interval.tv_nsec = (period_ms % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    return timerfd_settime(bm_timer_fd, 0, &spec, NULL) == 0;
+}
+
+// バススレッドを起こす (既に通知済みなら何もしない)
+static void wake_bus_thread()
+{
+    if (bm_wake_pending.exchange(true))
+        return;
+    uint64_t one = 1;
+    if (write(bm_event_fd, &one, sizeof(one)) != sizeof(one))
+    {
+        // カウンタが飽和している (既に通知済み) 場合のみ失敗するため無視する
+    }
+}
+
+// バススレッド本体: 周期 (timerfd) と要求の通知 (eventfd) を待つ
+static void bus_thread_main()
+{
+    // 浸水監視 (優先度 20) がリークの読み取りを待つため、それより高い優先度で実行する (権限がなければ通常優先度のまま)
+    struct sched_param param;
+    param.sched_priority = 25;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    struct pollfd fds[2];
+    fds[0].fd = bm_timer_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = bm_event_fd;
+    fds[1].events = POLLIN;
+    while (!bm_stop_request.load())
+    {
+        if (poll(fds, 2, -1) <= 0)
+            continue; // EINTR など
+        uint64_t count = 0;
+        if (fds[1].revents & POLLIN)
+        {
+            // 要求を取り出す前にフラグを下ろす (取り出した後に登録された要求は次の通知で処理する)
+            bm_wake_pending.store(false);
+            if (read(bm_event_fd, &count, sizeof(count)) == sizeof(count))
+            {
+                std::lock_guard<std::mutex> lock(bm_stats_mutex);
+                bm_stats.pwm_flushes++;
+            }
+            flush_pwm();
+            serve_on_demand();
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            if (read(bm_timer_fd, &count, sizeof(count)) == sizeof(count))
+                bus_tick(monotonic_now_ns());
+        }
+    }
+    serve_on_demand();
+    drain_pwm_and_go_direct(); // 停止前に要求された PWM (thruster_disable など) を書き込む
+}
+
+bool bus_manager_start(const BusManagerConfig &config)
+{
+    if (bm_running.load())
+        return true;
+
+    bm_config = config;
+    if (bm_config.period_ms == 0)
+        bm_config.period_ms = 1;
+    if (!adc_filter_init(&bm_adc_filter, bm_config.adc_filter))
+    {
+        fprintf(stderr, "バス管理: ADC のフィルタバンクの設定が範囲外です\n");
+        return false;
+    }
+    bm_adc_block_count = 0;
+    bm_adc_filtered = false;
+    {
+        std::lock_guard<std::mutex> lock(bm_stats_mutex);
+        bm_stats = BusStats();
+    }
+    // 開始前に全センサーを一度読んでおく (まだバススレッドはないため、このスレッドから直接読む)
+    uint64_t now_ns = monotonic_now_ns();
+    for (int d = BUS_DEVICE_GYRO; d < BUS_DEVICE_COUNT; ++d)
+    {
+        read_device(static_cast<BusDevice>(d));
+        next_due_ns[d] = now_ns + static_cast<uint64_t>(bm_config.device_period_ms[d]) * 1000000ULL;
+        defer_ticks[d] = 0;
+    }
+
+    bm_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (bm_event_fd < 0)
+    {
+        perror("バス管理 eventfd 作成失敗");
+        return false;
+    }
+    bm_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (bm_timer_fd < 0)
+    {
+        perror("バス管理 timerfd 作成失敗");
+        close(bm_event_fd);
+        bm_event_fd = -1;
+        return false;
+    }
+    if (bm_config.idle_period_ms == 0)
+        bm_config.idle_period_ms = bm_config.period_ms;
+    if (!set_timer_period(bm_idle.load() ? bm_config.idle_period_ms : bm_config.period_ms))
+    {
+        perror("バス管理 timerfd 設定失敗");
+        close(bm_timer_fd);
+        close(bm_event_fd);
+        bm_timer_fd = -1;
+        bm_event_fd = -1;
+        return false;
+    }
+
+    bm_wake_pending.store(false);
+    bm_stop_request.store(false);
+    {
+        std::lock_guard<std::mutex> lock(bm_pwm_mutex);
+        pwm_direct = false;
+    }
+    bm_running.store(true);
+    bm_thread = std::thread(bus_thread_main);
+    printf("バス管理開始 (周期 %u ms, 予算 %u us)\n", bm_config.period_ms, bm_config.tick_budget_us);
+    return true;
+}
+
+void bus_manager_stop()
+{
+    if (!bm_running.load())
+        return;
+    // 書き込み待ちの PWM はバススレッドが最後に書き込み、同時に直接書き込みへ切り替える (bm_running はその後で下ろす)
+    bm_stop_request.store(true);
+    bm_wake_pending.store(false);
+    wake_bus_thread();
+    if (bm_thread.joinable())
+        bm_thread.join();
+    bm_running.store(false);
+    close(bm_timer_fd);
+    close(bm_event_fd);
+    bm_timer_fd = -1;
+    bm_event_fd = -1;
+    bm_on_demand_cv.notify_all();
+}
+
+void bus_manager_set_idle(bool idle)
+{
+    if (bm_idle.exchange(idle) == idle || !bm_running.load())
+        return;
+    if (!set_timer_period(idle ? bm_config.idle_period_ms : bm_config.period_ms))
+        perror("バス管理 timerfd 設定失敗");
+    if (!idle)
+    {
+        // アイドル中に古くなった IMU の値を、次の周期を待たずに読み直す
+        bm_on_demand_mask.fetch_or((1u << BUS_DEVICE_GYRO) | (1u << BUS_DEVICE_ACCEL) | (1u << BUS_DEVICE_MAG));
+        wake_bus_thread();
+    }
+}
+
+bool bus_manager_running()
+{
+    return bm_running.load();
+}
+
+BusStats bus_manager_stats()
+{
+    std::lock_guard<std::mutex> lock(bm_stats_mutex);
+    return bm_stats;
+}
+
+bool format_bus_stats(const BusStats &stats, char *buffer, size_t buffer_size)
+{
+    if (!buffer || buffer_size == 0)
+        return false;
+    int written = snprintf(buffer, buffer_size, "[BUS] ticks=%u idle_ticks=%u overruns=%u max_tick=%uus flushes=%u on_demand=%u",
+                           stats.ticks, stats.idle_ticks, stats.budget_overruns, stats.max_tick_us, stats.pwm_flushes,
+                           stats.on_demand_reads);
+    for (int d = 0; d < BUS_DEVICE_COUNT && written >= 0 && static_cast<size_t>(written) < buffer_size; ++d)
+    {
+        const BusDeviceStats &s = stats.devices[d];
+        uint64_t avg_ns = s.transactions > 0 ? s.total_ns / s.transactions : 0;
+        written += snprintf(buffer + written, buffer_size - written, " %s=%.0f/%.0fus(n=%u,deferred=%u)",
+                            bus_device_name(static_cast<BusDevice>(d)), avg_ns / 1e3, s.max_ns / 1e3,
+                            s.transactions, s.deferred);
+    }
+    return written >= 0 && static_cast<size_t>(written) < buffer_size;
+}
+
+// --- ハードウェアアクセス ---
+
+// PWM の書き込みは、バス管理の動作中 (pwm_direct が false の間) は書き込み待ちに登録してバススレッドを起こし、
+// それ以外はロックを保持したまま直接書き込む (停止時の書き込み待ちの処理と順序が入れ替わらないようにする)
+void bus_set_pwm_enable(bool enable)
+{
+    std::lock_guard<std::mutex> lock(bm_pwm_mutex);
+    if (pwm_direct)
+    {
+        set_pwm_enable(enable);
+        return;
+    }
+    pending_enable = enable ? 1 : 0;
+    wake_bus_thread();
+}
+
+void bus_set_pwm_freq_hz(float freq_hz)
+{
+    std::lock_guard<std::mutex> lock(bm_pwm_mutex);
+    if (pwm_direct)
+    {
+        set_pwm_freq_hz(freq_hz);
+        return;
+    }
+    pending_freq_hz = freq_hz;
+    wake_bus_thread();
+}
+
+void bus_set_pwm_duty(int channel, float duty_cycle)
+{
+    if (channel < 0 || channel >= BUS_PWM_CHANNELS)
+        return;
+    std::lock_guard<std::mutex> lock(bm_pwm_mutex);
+    if (pwm_direct)
+    {
+        set_pwm_channel_duty_cycle(static_cast<uintptr_t>(channel), duty_cycle);
+        return;
+    }
+    pending_duty[channel] = duty_cycle;
+    pending_duty_mask |= 1u << channel;
+    wake_bus_thread();
+}
+
+void bus_read_imu(AxisData *accel, AxisData *gyro, AxisData *mag)
+{
+    if (!bm_running.load())
+    {
+        *accel = read_accel();
+        *gyro = read_gyro();
+        *mag = read_mag();
+        return;
+    }
+    std::lock_guard<std::mutex> lock(bm_cache_mutex);
+    *accel = bm_cache.accel;
+    *gyro = bm_cache.gyro;
+    *mag = bm_cache.mag;
+}
+
+void bus_read_slow(float *temperature, float *pressure, bool *leak, float *adc, int adc_count)
+{
+    if (adc_count > BUS_ADC_CHANNELS)
+        adc_count = BUS_ADC_CHANNELS;
+    if (!bm_running.load())
+    {
+        *temperature = read_temp();
+        *pressure = read_pressure();
+        *leak = read_leak();
+        read_adc_all(adc, static_cast<uintptr_t>(adc_count));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(bm_cache_mutex);
+    *temperature = bm_cache.temperature;
+    *pressure = bm_cache.pressure;
+    *leak = bm_cache.leak;
+    for (int i = 0; i < adc_count; ++i)
+        adc[i] = bm_cache.adc[i];
+}
+
+bool bus_read_leak_now()
+{
+    if (!bm_running.load())
+        return read_leak();
+    {
+        std::unique_lock<std::mutex> lock(bm_on_demand_mutex);
+        uint32_t generation = bm_on_demand_generation[BUS_DEVICE_LEAK];
+        bm_on_demand_mask.fetch_or(1u << BUS_DEVICE_LEAK);
+        wake_bus_thread();
+        // 同じ周期に複数のスレッドが要求しても、読み取りは1回にまとめられる
+        bm_on_demand_cv.wait_for(lock, std::chrono::nanoseconds(ON_DEMAND_TIMEOUT_NS), [generation]() {
+            return bm_on_demand_generation[BUS_DEVICE_LEAK] != generation || !bm_running.load();
+        });
+    }
+    {
+        std::lock_guard<std::mutex> lock(bm_stats_mutex);
+        bm_stats.on_demand_reads++;
+    }
+    std::lock_guard<std::mutex> lock(bm_cache_mutex);
+    return bm_cache.leak;
+}
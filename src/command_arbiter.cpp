@@ -0,0 +1,232 @@
+#include "command_arbiter.h"
+#include <stdio.h> // printf を使用するため
+
+// 送信元IDに対応するスロットを探す。見つからなければ ARBITER_NO_SOURCE
+static int find_slot(const CommandArbiter *arb, int source_id)
+{
+    for (int i = 0; i < ARBITER_MAX_SOURCES; ++i)
+    {
+        if (arb->sources[i].in_use && arb->sources[i].source_id == source_id)
+            return i;
+    }
+    return ARBITER_NO_SOURCE;
+}
+
+// 送信元IDに対応するスロットを探し、なければ新しく割り当てる
+// 空きがなければ最も長く更新のないスロットを再利用する
+static int find_or_allocate_slot(CommandArbiter *arb, int source_id)
+{
+    int slot = find_slot(arb, source_id);
+    if (slot != ARBITER_NO_SOURCE)
+        return slot;
+
+    int oldest = 0;
+    for (int i = 0; i < ARBITER_MAX_SOURCES; ++i)
+    {
+        if (!arb->sources[i].in_use)
+        {
+            oldest = i;
+            break;
+        }
+        if (arb->sources[i].last_update_ms < arb->sources[oldest].last_update_ms)
+            oldest = i;
+    }
+    if (oldest == arb->active_slot)
+        arb->active_slot = ARBITER_NO_SOURCE;
+    if (oldest == arb->takeover_slot)
+        arb->takeover_slot = ARBITER_NO_SOURCE;
+
+    arb->sources[oldest] = CommandSource();
+    arb->sources[oldest].in_use = true;
+    arb->sources[oldest].source_id = source_id;
+    return oldest;
+}
+
+// 送信元がまだ鮮度内かどうか
+static bool is_fresh(const CommandArbiter *arb, int slot, uint64_t now_ms)
+{
+    const CommandSource &src = arb->sources[slot];
+    uint32_t timeout_ms = src.timeout_ms != 0 ? src.timeout_ms : arb->freshness_timeout_ms;
+    return src.in_use && now_ms - src.last_update_ms <= timeout_ms;
+}
+
+// パケットの送信元が、スロットに結び付けた送信元と同じかどうか
+static bool same_sender(const CommandSource &src, const CommandPacket &packet)
+{
+    if (src.sender_is_network != packet.has_sender)
+        return false;
+    return !packet.has_sender || (src.sender.sin_addr.s_addr == packet.sender.sin_addr.s_addr &&
+                                  src.sender.sin_port == packet.sender.sin_port);
+}
+
+// 送信元IDとアドレスの結び付けを確認する (未設定か、長く何も届いていなければ結び付け直す)。受理できなければ false
+static bool accept_sender(CommandArbiter *arb, int slot, const CommandPacket &packet, uint64_t now_ms)
+{
+    CommandSource &src = arb->sources[slot];
+    if (src.sender_bound && same_sender(src, packet))
+        return true;
+    if (src.sender_bound && now_ms - src.last_update_ms <= arb->rebind_after_ms)
+    {
+        if (src.address_rejected_count++ == 0)
+            printf("[ARBITER] 警告: 送信元 %d のパケットが別のアドレスから届いたため破棄します。\n", packet.source_id);
+        return false;
+    }
+    if (src.sender_bound)
+        printf("[ARBITER] 送信元 %d を新しいアドレスに結び付け直しました。\n", packet.source_id);
+    src.sender_bound = true;
+    src.sender_is_network = packet.has_sender;
+    src.sender = packet.has_sender ? packet.sender : sockaddr_in();
+    return true;
+}
+
+void arbiter_init(CommandArbiter *arb, uint32_t freshness_timeout_ms)
+{
+    *arb = CommandArbiter();
+    arb->freshness_timeout_ms = freshness_timeout_ms;
+}
+
+bool arbiter_submit(CommandArbiter *arb, const CommandPacket &packet, uint64_t now_ms)
+{
+    if (packet.type == CommandInvalid)
+        return false;
+
+    if (packet.type == CommandRelease)
+    {
+        int slot = find_slot(arb, packet.source_id);
+        if (slot != ARBITER_NO_SOURCE && !accept_sender(arb, slot, packet, now_ms))
+            return false;
+        if (slot != ARBITER_NO_SOURCE && slot == arb->takeover_slot)
+        {
+            printf("[ARBITER] 送信元 %d が操縦権を解放しました。\n", packet.source_id);
+            arb->takeover_slot = ARBITER_NO_SOURCE;
+        }
+        return true;
+    }
+
+    bool known = find_slot(arb, packet.source_id) != ARBITER_NO_SOURCE;
+    int slot = find_or_allocate_slot(arb, packet.source_id);
+    if (!accept_sender(arb, slot, packet, now_ms))
+        return false;
+    CommandSource &src = arb->sources[slot];
+    // 深度を保持できない機体への深度の目標値は受理しない (上下の推力なしで目標を受け付けたように見せない)。
+    // 送信元は鮮度切れになり、他の送信元またはフェイルセーフに移る
+    if (packet.type == CommandSetpoint && packet.setpoint.hold_depth && !arb->depth_hold_supported)
+    {
+        if (src.unsupported_count++ == 0)
+            printf("[ARBITER] 警告: 上下方向のスラスターがないため、送信元 %d の深度の目標値を破棄します。\n", packet.source_id);
+        return false;
+    }
+    // 優先度を省略した TAKEOVER は、既知の送信元なら現在の優先度を保つ
+    if (packet.has_priority || !known)
+        src.priority = packet.priority;
+
+    if (packet.type == CommandTakeover)
+    {
+        printf("[ARBITER] 送信元 %d が操縦権の取得を要求しました。\n", packet.source_id);
+        arb->takeover_slot = slot;
+        // TAKEOVER 自体も送信元が生きている証拠として扱う (直後のコマンドを待たずに切り替えられる)
+        src.last_update_ms = now_ms;
+        return true;
+    }
+
+    // シーケンス番号による順序逆転・重複パケットの破棄
+    // 送信元が鮮度切れになっていた場合は、送信側の再起動とみなして番号をリセットする
+    if (packet.has_seq && src.seq_valid && is_fresh(arb, slot, now_ms))
+    {
+        int32_t diff = static_cast<int32_t>(packet.seq - src.last_seq); // 32bit の折り返しを考慮した差分
+        if (diff <= 0)
+        {
+            src.rejected_count++;
+            return false;
+        }
+    }
+    src.last_seq = packet.seq;
+    src.seq_valid = packet.has_seq;
+    src.last_update_ms = now_ms;
+    if (packet.type == CommandSetpoint)
+    {
+        // 目標値コマンドは送信元が指定したタイムアウトまで有効 (ネットワーク越しの閉ループより低いレートで送れる)
+        src.is_setpoint = true;
+        src.setpoint = packet.setpoint;
+        src.timeout_ms = packet.setpoint.timeout_ms;
+        src.command = GamepadData{};
+    }
+    else
+    {
+        src.is_setpoint = false;
+        src.timeout_ms = 0;
+        src.command = packet.gamepad;
+    }
+    return true;
+}
+
+int arbiter_select(CommandArbiter *arb, uint64_t now_ms)
+{
+    int selected = ARBITER_NO_SOURCE;
+
+    if (arb->takeover_slot != ARBITER_NO_SOURCE && is_fresh(arb, arb->takeover_slot, now_ms))
+    {
+        selected = arb->takeover_slot;
+    }
+    else
+    {
+        // 現在のアクティブを初期候補にして、同じ優先度では切り替えないようにする (チャタリング防止)
+        if (arb->active_slot != ARBITER_NO_SOURCE && is_fresh(arb, arb->active_slot, now_ms))
+            selected = arb->active_slot;
+        for (int i = 0; i < ARBITER_MAX_SOURCES; ++i)
+        {
+            if (!is_fresh(arb, i, now_ms))
+                continue;
+            if (selected == ARBITER_NO_SOURCE || arb->sources[i].priority > arb->sources[selected].priority)
+                selected = i;
+        }
+    }
+
+    if (selected != arb->active_slot)
+    {
+        int from = arbiter_active_source(arb);
+        int to = selected == ARBITER_NO_SOURCE ? ARBITER_NO_SOURCE : arb->sources[selected].source_id;
+        printf("[ARBITER] アクティブな送信元を切り替え: %d -> %d\n", from, to);
+        arb->active_slot = selected;
+        arb->switch_count++;
+    }
+    return arbiter_active_source(arb);
+}
+
+int arbiter_active_source(const CommandArbiter *arb)
+{
+    if (arb->active_slot == ARBITER_NO_SOURCE)
+        return ARBITER_NO_SOURCE;
+    return arb->sources[arb->active_slot].source_id;
+}
+
+GamepadData arbiter_active_command(const CommandArbiter *arb)
+{
+    if (arb->active_slot == ARBITER_NO_SOURCE)
+        return GamepadData{};
+    return arb->sources[arb->active_slot].command;
+}
+
+uint64_t arbiter_active_update_ms(const CommandArbiter *arb)
+{
+    if (arb->active_slot == ARBITER_NO_SOURCE)
+        return 0;
+    return arb->sources[arb->active_slot].last_update_ms;
+}
+
+uint64_t arbiter_active_feed_ms(const CommandArbiter *arb)
+{
+    if (arb->active_slot == ARBITER_NO_SOURCE)
+        return 0;
+    const CommandSource &src = arb->sources[arb->active_slot];
+    uint32_t extra_ms = src.timeout_ms > arb->freshness_timeout_ms ? src.timeout_ms - arb->freshness_timeout_ms : 0;
+    return src.last_update_ms + extra_ms;
+}
+
+bool arbiter_active_setpoint(const CommandArbiter *arb, SetpointCommand *setpoint)
+{
+    if (arb->active_slot == ARBITER_NO_SOURCE || !arb->sources[arb->active_slot].is_setpoint)
+        return false;
+    *setpoint = arb->sources[arb->active_slot].setpoint;
+    return true;
+}
@@ -0,0 +1,346 @@
+#include "fec.h"
+#include <string.h> // memcpy, memset を使用するため
+
+#define FEC_KIND_DATA 0
+#define FEC_KIND_PARITY 1
+#define FEC_DATA_HEADER 4    // マジック2 + 種別1 + 件数1
+#define FEC_ENTRY_HEADER 6   // seq 4 + 長さ 2
+#define FEC_PARITY_HEADER 12 // マジック2 + 種別1 + group_size 1 + 先頭seq 4 + 長さのXOR 2 + 最大長 2
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// --- 符号化 ---
+
+void fec_encoder_init(FecEncoder *enc, const FecConfig &config)
+{
+    *enc = FecEncoder(); // 値初期化 (配列も 0 になる)
+    enc->config = config;
+    if (enc->config.group_size > FEC_MAX_GROUP)
+        enc->config.group_size = FEC_MAX_GROUP;
+    if (enc->config.redundancy > FEC_MAX_REDUNDANCY)
+        enc->config.redundancy = FEC_MAX_REDUNDANCY;
+}
+
+int fec_encode(FecEncoder *enc, const uint8_t *payload, size_t len, uint8_t frames[2][FEC_MAX_FRAME], size_t frame_len[2])
+{
+    if (len > FEC_MAX_PAYLOAD)
+        return 0;
+    uint32_t seq = enc->next_seq++;
+
+    // データフレーム: 最新のペイロード + フレームに収まる範囲で直前のペイロードの冗長コピー
+    uint8_t *out = frames[0];
+    out[0] = FEC_MAGIC0;
+    out[1] = FEC_MAGIC1;
+    out[2] = FEC_KIND_DATA;
+    size_t pos = FEC_DATA_HEADER;
+    put_u32(out + pos, seq);
+    put_u16(out + pos + 4, static_cast<uint16_t>(len));
+    memcpy(out + pos + FEC_ENTRY_HEADER, payload, len);
+    pos += FEC_ENTRY_HEADER + len;
+    int entries = 1;
+    for (int i = 0; i < enc->history_count && i < enc->config.redundancy; ++i)
+    {
+        if (pos + FEC_ENTRY_HEADER + enc->history_len[i] > FEC_MAX_FRAME)
+            break;
+        put_u32(out + pos, enc->history_seq[i]);
+        put_u16(out + pos + 4, enc->history_len[i]);
+        memcpy(out + pos + FEC_ENTRY_HEADER, enc->history[i], enc->history_len[i]);
+        pos += FEC_ENTRY_HEADER + enc->history_len[i];
+        entries++;
+    }
+    out[3] = static_cast<uint8_t>(entries);
+    frame_len[0] = pos;
+
+    // 冗長コピー用の履歴を更新 (新しい順)
+    if (enc->config.redundancy > 0)
+    {
+        int keep = enc->history_count < enc->config.redundancy ? enc->history_count : enc->config.redundancy - 1;
+        for (int i = keep; i > 0; --i)
+        {
+            memcpy(enc->history[i], enc->history[i - 1], enc->history_len[i - 1]);
+            enc->history_len[i] = enc->history_len[i - 1];
+            enc->history_seq[i] = enc->history_seq[i - 1];
+        }
+        memcpy(enc->history[0], payload, len);
+        enc->history_len[0] = static_cast<uint16_t>(len);
+        enc->history_seq[0] = seq;
+        enc->history_count = keep + 1;
+    }
+
+    if (enc->config.group_size < 2)
+        return 1;
+
+    // パリティの累積 (短いペイロードは 0 で埋めたものとして XOR する)
+    for (size_t i = 0; i < len; ++i)
+        enc->parity[i] ^= payload[i];
+    enc->parity_len_xor ^= static_cast<uint16_t>(len);
+    if (len > enc->parity_max_len)
+        enc->parity_max_len = static_cast<uint16_t>(len);
+    enc->group_count++;
+    if (seq % enc->config.group_size != static_cast<uint32_t>(enc->config.group_size - 1))
+        return 1;
+
+    // グループの最後のペイロード: パリティフレームを出力して累積をリセット
+    uint8_t *par = frames[1];
+    par[0] = FEC_MAGIC0;
+    par[1] = FEC_MAGIC1;
+    par[2] = FEC_KIND_PARITY;
+    par[3] = enc->config.group_size;
+    put_u32(par + 4, seq + 1 - enc->config.group_size);
+    put_u16(par + 8, enc->parity_len_xor);
+    put_u16(par + 10, enc->parity_max_len);
+    memcpy(par + FEC_PARITY_HEADER, enc->parity, enc->parity_max_len);
+    frame_len[1] = FEC_PARITY_HEADER + enc->parity_max_len;
+    bool complete = enc->group_count == enc->config.group_size; // 途中から始まったグループのパリティは送らない
+    memset(enc->parity, 0, sizeof(enc->parity));
+    enc->parity_len_xor = 0;
+    enc->parity_max_len = 0;
+    enc->group_count = 0;
+    return complete ? 2 : 1;
+}
+
+// --- 復号 ---
+
+bool fec_is_frame(const uint8_t *data, size_t len)
+{
+    return len >= FEC_DATA_HEADER && data[0] == FEC_MAGIC0 && data[1] == FEC_MAGIC1;
+}
+
+void fec_decoder_init(FecDecoder *dec)
+{
+    *dec = FecDecoder(); // 値初期化 (配列も 0 になる)
+}
+
+void fec_decoder_resync(FecDecoder *dec)
+{
+    if (!dec->started)
+        return;
+    // 取り出し待ちのペイロードは残し、受信の窓と保持しているペイロード (パリティの復元用) を捨てる
+    dec->expected_base += dec->highest_seq - dec->first_seq + 1;
+    dec->stats.resyncs++;
+    dec->started = false;
+    dec->delivered_mask = 0;
+    for (int i = 0; i < FEC_HISTORY; ++i)
+        dec->slots[i].valid = false;
+}
+
+// seq の差 (a - b)。32bit の通し番号が一周しても正しく前後を比べられるよう、符号付きで扱う
+static int32_t seq_diff(uint32_t a, uint32_t b)
+{
+    return static_cast<int32_t>(a - b);
+}
+
+// seq を取り出し済みかどうか (窓より古いものは取り出し済みとして扱う)
+static bool is_delivered(const FecDecoder *dec, uint32_t seq)
+{
+    if (!dec->started || seq_diff(seq, dec->highest_seq) > 0)
+        return false;
+    uint32_t age = dec->highest_seq - seq;
+    if (age >= 64)
+        return true;
+    return (dec->delivered_mask >> age) & 1u;
+}
+
+// 受信の窓をこの seq から始める
+static void start_window(FecDecoder *dec, uint32_t seq)
+{
+    dec->started = true;
+    dec->first_seq = seq;
+    dec->highest_seq = seq;
+    dec->delivered_mask = 0;
+}
+
+// ペイロードを保持し、取り出し待ちに積む。新しく受理した場合は true
+static bool accept_payload(FecDecoder *dec, uint32_t seq, const uint8_t *data, uint16_t len)
+{
+    // 保持している窓より大きく戻った seq は、送信側が再起動して番号を振り直したものとみなして同期し直す
+    // (そうしないと新しい番号が古い最大値を超えるまで、すべて受信済みとして捨ててしまう)
+    if (dec->started && seq_diff(seq, dec->highest_seq) < -FEC_HISTORY)
+        fec_decoder_resync(dec);
+    if (!dec->started)
+        start_window(dec, seq);
+    if (seq_diff(seq, dec->first_seq) < 0 || is_delivered(dec, seq))
+    {
+        dec->stats.duplicates++;
+        return false;
+    }
+    if (dec->pending_count >= FEC_MAX_PENDING)
+        return false; // 取り出しが追いついていない。冗長コピー・パリティで後から補える可能性がある
+
+    if (seq_diff(seq, dec->highest_seq) > 0)
+    {
+        uint32_t shift = seq - dec->highest_seq;
+        dec->delivered_mask = shift >= 64 ? 0 : dec->delivered_mask << shift;
+        dec->highest_seq = seq;
+    }
+    dec->delivered_mask |= 1ull << (dec->highest_seq - seq);
+
+    FecSlot &slot = dec->slots[seq % FEC_HISTORY];
+    slot.valid = true;
+    slot.seq = seq;
+    slot.len = len;
+    memcpy(slot.data, data, len);
+
+    dec->pending[(dec->pending_head + dec->pending_count) % FEC_MAX_PENDING] = seq;
+    dec->pending_count++;
+    dec->stats.delivered++;
+    dec->stats.expected = dec->expected_base + (dec->highest_seq - dec->first_seq + 1);
+    return true;
+}
+
+// データフレームを復号する。古い冗長コピーから順に受理する (操縦コマンドの順序を保つため)
+static int decode_data(FecDecoder *dec, const uint8_t *frame, size_t len)
+{
+    int entries = frame[3];
+    const uint8_t *entry_ptr[FEC_MAX_REDUNDANCY + 1];
+    size_t pos = FEC_DATA_HEADER;
+    if (entries < 1 || entries > FEC_MAX_REDUNDANCY + 1)
+        return -1;
+    for (int i = 0; i < entries; ++i)
+    {
+        if (pos + FEC_ENTRY_HEADER > len)
+            return -1;
+        uint16_t entry_len = get_u16(frame + pos + 4);
+        if (entry_len > FEC_MAX_PAYLOAD || pos + FEC_ENTRY_HEADER + entry_len > len)
+            return -1;
+        entry_ptr[i] = frame + pos;
+        pos += FEC_ENTRY_HEADER + entry_len;
+    }
+
+    dec->stats.data_frames++;
+    int accepted = 0;
+    for (int i = entries - 1; i >= 0; --i)
+    {
+        uint32_t seq = get_u32(entry_ptr[i]);
+        if (accept_payload(dec, seq, entry_ptr[i] + FEC_ENTRY_HEADER, get_u16(entry_ptr[i] + 4)))
+        {
+            accepted++;
+            if (i > 0)
+                dec->stats.recovered_redundant++;
+        }
+    }
+    return accepted;
+}
+
+// パリティフレームを復号する。グループ内の欠落がちょうど1件で、他のペイロードを保持していれば復元する
+static int decode_parity(FecDecoder *dec, const uint8_t *frame, size_t len)
+{
+    if (len < FEC_PARITY_HEADER)
+        return -1;
+    uint8_t group_size = frame[3];
+    uint32_t first = get_u32(frame + 4);
+    uint16_t len_xor = get_u16(frame + 8);
+    uint16_t max_len = get_u16(frame + 10);
+    if (group_size < 2 || group_size > FEC_MAX_GROUP || max_len > FEC_MAX_PAYLOAD || static_cast<size_t>(FEC_PARITY_HEADER + max_len) > len)
+        return -1;
+    dec->stats.parity_frames++;
+    if (!dec->started)
+        return 0;
+
+    int missing = -1;
+    for (uint32_t i = 0; i < group_size; ++i)
+    {
+        uint32_t seq = first + i;
+        if (is_delivered(dec, seq))
+        {
+            const FecSlot &slot = dec->slots[seq % FEC_HISTORY];
+            if (!slot.valid || slot.seq != seq)
+                return 0; // 保持していない (窓より古い) ため復元に使えない
+            continue;
+        }
+        if (missing >= 0)
+            return 0; // 2件以上欠落している
+        missing = static_cast<int>(seq - first);
+    }
+    if (missing < 0)
+        return 0; // 欠落なし
+
+    uint8_t data[FEC_MAX_PAYLOAD];
+    memcpy(data, frame + FEC_PARITY_HEADER, max_len);
+    uint16_t recovered_len = len_xor;
+    for (uint32_t i = 0; i < group_size; ++i)
+    {
+        if (static_cast<int>(i) == missing)
+            continue;
+        const FecSlot &slot = dec->slots[(first + i) % FEC_HISTORY];
+        for (uint16_t b = 0; b < slot.len && b < max_len; ++b)
+            data[b] ^= slot.data[b];
+        recovered_len ^= slot.len;
+    }
+    if (recovered_len > max_len)
+        return -1;
+    if (!accept_payload(dec, first + missing, data, recovered_len))
+        return 0;
+    dec->stats.recovered_parity++;
+    return 1;
+}
+
+int fec_decode(FecDecoder *dec, const uint8_t *frame, size_t len)
+{
+    int result = -1;
+    if (fec_is_frame(frame, len))
+    {
+        if (frame[2] == FEC_KIND_DATA)
+            result = decode_data(dec, frame, len);
+        else if (frame[2] == FEC_KIND_PARITY)
+            result = decode_parity(dec, frame, len);
+    }
+    if (result < 0)
+        dec->stats.malformed++;
+    return result;
+}
+
+bool fec_next_payload(FecDecoder *dec, char *out, size_t out_size, size_t *out_len)
+{
+    while (dec->pending_count > 0)
+    {
+        uint32_t seq = dec->pending[dec->pending_head];
+        dec->pending_head = (dec->pending_head + 1) % FEC_MAX_PENDING;
+        dec->pending_count--;
+        const FecSlot &slot = dec->slots[seq % FEC_HISTORY];
+        if (!slot.valid || slot.seq != seq || slot.len >= out_size)
+            continue; // 取り出す前に上書きされた、またはバッファに収まらない
+        memcpy(out, slot.data, slot.len);
+        out[slot.len] = '\0';
+        *out_len = slot.len;
+        return true;
+    }
+    return false;
+}
+
+float fec_raw_loss_rate(const FecStats &stats)
+{
+    if (stats.expected == 0 || stats.data_frames >= stats.expected)
+        return 0.0f;
+    return 1.0f - static_cast<float>(stats.data_frames) / stats.expected;
+}
+
+float fec_effective_loss_rate(const FecStats &stats)
+{
+    if (stats.expected == 0 || stats.delivered >= stats.expected)
+        return 0.0f;
+    return 1.0f - static_cast<float>(stats.delivered) / stats.expected;
+}
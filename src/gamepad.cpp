@@ -2,6 +2,10 @@
 #include <sstream>   // 文字列ストリーム (std::stringstream) を使用するため
 #include <iostream>  // 標準入出力 (std::cerr) を使用するため
 #include <stdexcept> // 例外クラス (std::invalid_argument, std::out_of_range) を使用するため
+#include <stdio.h>   // sscanf を使用するため
+#include <string.h>  // strncmp を使用するため
+#include <stdlib.h>  // strtof を使用するため
+#include <math.h>    // isfinite を使用するため
 
 // ヘルパー関数: 文字列の前後の空白文字 (スペース、タブ、改行など) を削除する
 std::string trim(const std::string &str)
@@ -76,3 +80,142 @@ GamepadData parseGamepadData(const std::string &data)
 
     return gamepad; // パースされたデータを返す
 }
+
+// 目標値のうち省略可能なフィールド ("-" または空なら保持なし) を解釈する
+// 数値として解釈できない場合は false を返す
+static bool parse_optional_target(const char *token, bool *enabled, float *value)
+{
+    if (token[0] == '\0' || strcmp(token, "-") == 0)
+    {
+        *enabled = false;
+        return true;
+    }
+    char *end = nullptr;
+    float parsed = strtof(token, &end);
+    if (end == token || *end != '\0' || !isfinite(parsed))
+        return false;
+    *enabled = true;
+    *value = parsed;
+    return true;
+}
+
+// [begin, end) の文字列を buffer にコピーする (収まらない場合は false)
+static bool copy_field(const char *begin, const char *end, char *buffer, size_t buffer_size)
+{
+    size_t length = static_cast<size_t>(end - begin);
+    if (length >= buffer_size)
+        return false;
+    memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    return true;
+}
+
+// -1.0 〜 1.0 に制限する (NaN は 0 とみなす)
+static float clamp_unit(float value)
+{
+    if (!(value == value))
+        return 0.0f;
+    return value > 1.0f ? 1.0f : (value < -1.0f ? -1.0f : value);
+}
+
+// 受信した文字列データを送信元情報付きの CommandPacket にパースする関数
+CommandPacket parseCommandPacket(const std::string &data)
+{
+    CommandPacket packet;
+    const char *str = data.c_str();
+
+    // 操縦権の取得/解放要求
+    if (strncmp(str, "TAKEOVER,", 9) == 0 || strncmp(str, "RELEASE,", 8) == 0)
+    {
+        bool takeover = (str[0] == 'T');
+        int source_id = 0;
+        int priority = packet.priority;
+        int fields = sscanf(strchr(str, ',') + 1, "%d,%d", &source_id, &priority);
+        if (fields < 1)
+        {
+            std::cerr << "警告: 操縦権要求の形式が不正です (" << data << ")" << std::endl;
+            return packet; // CommandInvalid
+        }
+        packet.type = takeover ? CommandTakeover : CommandRelease;
+        packet.source_id = source_id;
+        packet.priority = priority;
+        packet.has_priority = fields >= 2;
+        return packet;
+    }
+
+    // 目標値コマンド
+    if (strncmp(str, "S,", 2) == 0)
+    {
+        int source_id = 0;
+        unsigned int seq = 0;
+        int priority = 0;
+        float surge = 0.0f, sway = 0.0f, heave = 0.0f, yaw_rate = 0.0f;
+        char heading[32] = {0};
+        char depth[32] = {0};
+        unsigned int timeout_ms = 0;
+        int consumed = 0;
+        int fields = sscanf(str + 2, "%d,%u,%d,%f,%f,%f,%f,%n", &source_id, &seq, &priority, &surge, &sway, &heave,
+                            &yaw_rate, &consumed);
+        // heading/depth は "-" や空 (保持なし) を許すため、区切りを手で探して文字列として取り出す
+        // (sscanf の %[^,] は空のフィールドに一致しない)
+        const char *heading_begin = str + 2 + consumed;
+        const char *depth_begin = NULL;
+        const char *timeout_begin = NULL;
+        if (fields == 7 && consumed > 0)
+        {
+            const char *comma = strchr(heading_begin, ',');
+            depth_begin = comma ? comma + 1 : NULL;
+            comma = depth_begin ? strchr(depth_begin, ',') : NULL;
+            timeout_begin = comma ? comma + 1 : NULL;
+        }
+        SetpointCommand setpoint;
+        if (!timeout_begin || !copy_field(heading_begin, depth_begin - 1, heading, sizeof(heading)) ||
+            !copy_field(depth_begin, timeout_begin - 1, depth, sizeof(depth)) ||
+            sscanf(timeout_begin, "%u", &timeout_ms) != 1 || !isfinite(yaw_rate) ||
+            !parse_optional_target(heading, &setpoint.hold_heading, &setpoint.heading_deg) ||
+            !parse_optional_target(depth, &setpoint.hold_depth, &setpoint.depth_m))
+        {
+            std::cerr << "警告: 目標値コマンドの形式が不正です (" << data << ")" << std::endl;
+            return packet; // CommandInvalid
+        }
+        setpoint.surge = clamp_unit(surge);
+        setpoint.sway = clamp_unit(sway);
+        setpoint.heave = clamp_unit(heave);
+        setpoint.yaw_rate_dps = yaw_rate;
+        setpoint.timeout_ms = timeout_ms == 0 ? SETPOINT_DEFAULT_TIMEOUT_MS
+                                              : (timeout_ms > SETPOINT_MAX_TIMEOUT_MS ? SETPOINT_MAX_TIMEOUT_MS : timeout_ms);
+        packet.type = CommandSetpoint;
+        packet.source_id = source_id;
+        packet.seq = seq;
+        packet.has_seq = true;
+        packet.priority = priority;
+        packet.setpoint = setpoint;
+        return packet;
+    }
+
+    // 送信元ヘッダ付きの操縦データ
+    if (strncmp(str, "C,", 2) == 0)
+    {
+        int source_id = 0;
+        unsigned int seq = 0;
+        int priority = 0;
+        int consumed = 0;
+        if (sscanf(str + 2, "%d,%u,%d,%n", &source_id, &seq, &priority, &consumed) < 3 || consumed == 0)
+        {
+            std::cerr << "警告: 操縦データのヘッダが不正です (" << data << ")" << std::endl;
+            return packet; // CommandInvalid
+        }
+        packet.type = CommandGamepad;
+        packet.source_id = source_id;
+        packet.seq = seq;
+        packet.has_seq = true;
+        packet.priority = priority;
+        packet.gamepad = parseGamepadData(data.substr(2 + consumed));
+        return packet;
+    }
+
+    // 従来形式の操縦データ
+    packet.type = CommandGamepad;
+    packet.gamepad = parseGamepadData(data);
+    return packet;
+}
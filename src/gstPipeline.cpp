@@ -2,20 +2,52 @@
 #include <iostream>
 #include <string>   // For std::string and std::to_string
 #include <thread>   // For std::thread
+#include <mutex>    // For std::mutex (録画状態の保護)
+#include <condition_variable> // For std::condition_variable (起動スレッドの停止要求)
+#include <chrono>   // For std::chrono::milliseconds
+#include <algorithm> // For std::min
+#include <atomic>    // For std::atomic (アイドルの要求)
+#include <unistd.h> // カメラデバイスの存在確認 (access)
+#include <sys/statvfs.h> // 録画先の空き容量確認 (statvfs)
+#include <sys/stat.h>    // 録画ディレクトリ作成 (mkdir)
+#include "startup_metrics.h" // 最初の映像フレームまでの時間の記録
+#include "monotonic_clock.h" // 起動待ちのタイムアウト計測
 
-// --- グローバル変数 ---
-// GStreamerパイプラインのインスタンス (カメラ1用)
-static GstElement *pipeline1 = nullptr; 
-// GStreamerパイプラインのインスタンス (カメラ2用)
-static GstElement *pipeline2 = nullptr; 
-// GStreamerのメインループ (カメラ1用)。イベント処理やメッセージ処理を行う。
-static GMainLoop *main_loop1 = nullptr; 
-// GStreamerのメインループ (カメラ2用)
-static GMainLoop *main_loop2 = nullptr; 
-// main_loop1を実行するためのスレッド
-static std::thread loop_thread1; 
-// main_loop2を実行するためのスレッド
-static std::thread loop_thread2; 
+// --- 非同期起動関連の定数 ---
+// カメラの列挙やネゴシエーションには数秒かかることがあり、カメラが無い場合もあるため、
+// パイプラインはカメラごとのバックグラウンドスレッドで起動し、失敗したら間隔を広げながら再試行する。
+// PLAYING への遷移を待つ最大時間 (ミリ秒)
+static const unsigned int CAMERA_START_TIMEOUT_MS = 5000;
+// 再試行間隔の初期値と上限 (ミリ秒)。失敗するたびに2倍にする
+static const unsigned int CAMERA_RETRY_INITIAL_MS = 1000;
+static const unsigned int CAMERA_RETRY_MAX_MS = 10000;
+// 起動待ち・バス監視で停止要求を確認する間隔 (ミリ秒)
+static const unsigned int CAMERA_POLL_INTERVAL_MS = 200;
+// カメラの数
+static const int NUM_CAMERAS = 2;
+
+// --- 録画関連の定数 ---
+// 録画先ファイルシステムの空き容量がこの値を下回ったら録画を開始しない/停止する (MB)
+static const unsigned long long RECORD_MIN_FREE_MB = 500;
+// 空き容量をチェックする間隔 (秒)
+static const unsigned int RECORD_FREE_SPACE_CHECK_INTERVAL_SEC = 5;
+
+// 各パイプラインの録画分岐 (tee -> queue -> valve -> splitmuxsink) の要素を保持する構造体
+struct RecordingBranch {
+    GstElement *valve = nullptr; // 録画のON/OFFを切り替える valve 要素 (drop=true で録画停止)
+    GstElement *sink = nullptr;  // セグメント分割して書き込む splitmuxsink 要素
+    std::string dir;             // 録画ファイルの保存先ディレクトリ
+};
+// 録画中かどうか (全カメラ共通)
+static bool recording_active = false;
+// 録画状態 (recording_active と valve の状態) を保護するミューテックス
+// ゲームパッド操作 (メインスレッド)、空き容量チェック (GMainLoopスレッド)、カメラ起動スレッドから操作されるため
+static std::mutex recording_mutex;
+// 空き容量チェック用タイマーのソースID (0 なら未登録)
+static guint free_space_timer_id = 0;
+// アイドルの要求 (true の間、録画中でなければパイプラインを READY に落とす)
+// 反映は各カメラの起動スレッドがバスの監視の合間に行う (最大 CAMERA_POLL_INTERVAL_MS 遅れる)
+static std::atomic<bool> video_idle_requested(false);
 
 // パイプライン設定を保持するための構造体
 struct PipelineConfig {
@@ -34,15 +66,47 @@ struct PipelineConfig {
     int x264_bitrate = 5000;                     // エンコードビットレート (kbps, デフォルト値)
     std::string x264_tune = "zerolatency";       // x264encのチューニングオプション (デフォルト値)
     std::string x264_speed_preset = "superfast"; // x264encの速度プリセット (デフォルト値)
+
+    // オンボード録画 (エンコード済みH.264をteeで分岐してローカルに保存。再エンコードはしない)
+    bool enable_recording = true;                   // 録画分岐をパイプラインに組み込むかどうか
+    std::string record_dir = "/home/pi/recordings"; // 録画ファイルの保存先ディレクトリ
+    std::string record_prefix = "cam";              // 録画ファイル名の接頭辞 (例: cam1_00000.mkv)
+    std::string record_muxer = "matroskamux";       // コンテナ ("matroskamux" は途中で電源断しても再生可能、"mp4mux" も可)
+    std::string record_extension = "mkv";           // 録画ファイルの拡張子
+    int record_max_size_time_sec = 60;              // 1セグメントの最大長 (秒)。超えると次のファイルに切り替え
+    unsigned long long record_max_size_bytes = 256ULL * 1024 * 1024; // 1セグメントの最大サイズ (バイト)
+    int record_max_files = 60;                      // 保持する最大ファイル数 (超えると古いファイルから上書き)
+    int record_queue_max_buffers = 300;             // 録画分岐の leaky queue の長さ (SD書き込みの遅延を吸収)
 };
 
+// カメラ1台分のパイプラインと、それを起動・監視するスレッド
+// pipeline/loop/loop_thread は起動スレッドだけが書き換え、停止時は起動スレッドを join してから解放する。
+// rec は録画操作と共有するため recording_mutex で保護する。
+struct CameraSlot {
+    PipelineConfig config;          // パイプライン設定
+    GstElement *pipeline = nullptr; // GStreamerパイプラインのインスタンス
+    GMainLoop *loop = nullptr;      // GStreamerのメインループ。イベント処理やメッセージ処理を行う。
+    std::thread loop_thread;        // loop を実行するためのスレッド
+    std::thread startup_thread;     // パイプラインの起動・再試行・実行中のエラー監視を行うスレッド
+    RecordingBranch rec;            // 録画分岐
+    bool paused = false;            // アイドルのため READY に落としているか (起動スレッドだけが触る)
+};
+static CameraSlot cameras[NUM_CAMERAS];
+
+// 起動スレッドへの停止要求
+static std::mutex startup_mutex;
+static std::condition_variable startup_cv;
+static bool startup_stop_requested = false;
+// gst_init と空き容量チェックタイマーの登録を1回だけ行うためのフラグ
+static std::once_flag gst_init_flag;
+
 // GMainLoopを指定されたスレッドで実行するための関数
 static void run_main_loop(GMainLoop* loop) {
     g_main_loop_run(loop);
 }
 
-// 指定された設定に基づいてGStreamerパイプラインを作成し、メインループを開始する関数
-static bool create_pipeline(const PipelineConfig& config, GstElement** pipeline_ptr, GMainLoop** loop_ptr) {
+// 指定された設定に基づいてGStreamerパイプラインとメインループを作成する関数
+static bool create_pipeline(const PipelineConfig& config, GstElement** pipeline_ptr, GMainLoop** loop_ptr, RecordingBranch* rec) {
     std::string pipeline_str = "v4l2src device=" + config.device + " ! ";
 
     if (config.is_h264_native_source) {
@@ -64,11 +128,32 @@ static bool create_pipeline(const PipelineConfig& config, GstElement** pipeline_
                         " speed-preset=" + config.x264_speed_preset;
     }
 
+    if (config.enable_recording) {
+        // エンコード済みストリームを tee で分岐し、ライブ配信側と録画側をそれぞれ queue でスレッド分離する
+        pipeline_str += " ! tee name=t t. ! queue";
+    }
+
     // 共通のパイプライン末尾部分 (RTPパッキングとUDP送信) を追加
     // ... ! rtph264pay ! udpsink
     pipeline_str += " ! rtph264pay config-interval=" + std::to_string(config.rtp_config_interval) +
                     " pt=" + std::to_string(config.rtp_payload_type) + " ! "
-                    "udpsink host=" + config.host + " port=" + std::to_string(config.port);
+                    "udpsink name=live_sink host=" + config.host + " port=" + std::to_string(config.port);
+
+    if (config.enable_recording) {
+        // 録画分岐: t. -> leaky queue -> valve -> h264parse -> splitmuxsink
+        // queue を leaky=downstream にすることで、SDカードへの書き込みが遅れても古いバッファを捨てるだけで
+        // tee (= ライブ配信側) にバックプレッシャーがかからない。valve は起動時 drop=true (録画停止状態)。
+        const unsigned long long max_size_time_ns = static_cast<unsigned long long>(config.record_max_size_time_sec) * 1000000000ULL;
+        pipeline_str += " t. ! queue leaky=downstream max-size-buffers=" + std::to_string(config.record_queue_max_buffers) +
+                        " max-size-bytes=0 max-size-time=0 ! "
+                        "valve name=rec_valve drop=true ! "
+                        "h264parse config-interval=-1 ! "
+                        "splitmuxsink name=rec_sink muxer-factory=" + config.record_muxer +
+                        " location=" + config.record_dir + "/" + config.record_prefix + "_%05d." + config.record_extension +
+                        " max-size-time=" + std::to_string(max_size_time_ns) +
+                        " max-size-bytes=" + std::to_string(config.record_max_size_bytes) +
+                        " max-files=" + std::to_string(config.record_max_files);
+    }
 
     GError* error = nullptr;
     // 構築したパイプライン文字列からGStreamerパイプラインをパース(作成)
@@ -82,83 +167,378 @@ static bool create_pipeline(const PipelineConfig& config, GstElement** pipeline_
     // 作成されたパイプライン文字列をデバッグ出力
     std::cout << "GStreamer pipeline for " << config.device << " (" << config.port << "): " << pipeline_str << std::endl;
 
-    // パイプライン用のGMainLoopを作成
+    if (config.enable_recording && rec) {
+        // 実行時に録画のON/OFFを切り替えるため、録画分岐の要素を名前で取得しておく
+        rec->valve = gst_bin_get_by_name(GST_BIN(*pipeline_ptr), "rec_valve");
+        rec->sink = gst_bin_get_by_name(GST_BIN(*pipeline_ptr), "rec_sink");
+        rec->dir = config.record_dir;
+        if (!rec->valve || !rec->sink) {
+            std::cerr << "録画分岐の要素が見つかりません (" << config.device << ")。録画は無効になります。" << std::endl;
+        }
+    }
+
+    // パイプライン用のGMainLoopを作成 (PLAYING への遷移は呼び出し側で行う)
     *loop_ptr = g_main_loop_new(nullptr, FALSE);
-    // パイプラインをPLAYING状態に遷移させる
-    gst_element_set_state(*pipeline_ptr, GST_STATE_PLAYING);
 
     return true;
 }
 
+// 録画先ディレクトリの空き容量 (MB) を返す。取得できない場合は 0 を返す
+static unsigned long long get_free_space_mb(const std::string& dir) {
+    struct statvfs st;
+    if (statvfs(dir.c_str(), &st) != 0) {
+        return 0;
+    }
+    return (static_cast<unsigned long long>(st.f_bavail) * st.f_frsize) / (1024ULL * 1024ULL);
+}
+
+// 録画分岐が使用可能かどうか
+static bool recording_branch_available(const RecordingBranch& rec) {
+    return rec.valve != nullptr && rec.sink != nullptr;
+}
+
+// 1つの録画分岐の valve を開閉する (recording_mutex を保持した状態で呼び出すこと)
+static void apply_recording_state(RecordingBranch& rec, bool enable) {
+    if (!recording_branch_available(rec)) return;
+
+    if (enable) {
+        // 録画開始時は上流にキーフレームを要求し、新しいセグメントがIDRフレームから始まるようにする
+        // (GstForceKeyUnit は gst-plugins-base の video ライブラリを使わずにカスタムイベントとして送れる)
+        GstStructure* s = gst_structure_new("GstForceKeyUnit", "all-headers", G_TYPE_BOOLEAN, TRUE, nullptr);
+        gst_element_send_event(rec.valve, gst_event_new_custom(GST_EVENT_CUSTOM_UPSTREAM, s));
+        g_object_set(rec.valve, "drop", FALSE, nullptr);
+    } else {
+        g_object_set(rec.valve, "drop", TRUE, nullptr);
+        // 現在のセグメントを閉じる (次に録画を再開したときは新しいファイルから始まる)
+        g_signal_emit_by_name(rec.sink, "split-now");
+    }
+}
+
+// 空き容量を定期的に確認し、下限を下回ったら録画を停止するタイマーコールバック (GMainLoopスレッドで実行)
+static gboolean check_free_space_cb(gpointer) {
+    std::lock_guard<std::mutex> lock(recording_mutex);
+    if (recording_active) {
+        for (const CameraSlot& cam : cameras) {
+            if (!recording_branch_available(cam.rec)) continue;
+            unsigned long long free_mb = get_free_space_mb(cam.rec.dir);
+            if (free_mb < RECORD_MIN_FREE_MB) {
+                std::cerr << "録画先の空き容量が不足しています (" << cam.rec.dir << ": " << free_mb << " MB < "
+                          << RECORD_MIN_FREE_MB << " MB)。録画を停止します。" << std::endl;
+                for (CameraSlot& c : cameras) apply_recording_state(c.rec, false);
+                recording_active = false;
+                break;
+            }
+        }
+    }
+    return G_SOURCE_CONTINUE; // タイマーを継続
+}
+
+// 録画を開始/停止する関数 (ゲームパッドのボタン操作などから実行時に呼び出す)
+bool set_gstreamer_recording(bool enable) {
+    std::lock_guard<std::mutex> lock(recording_mutex);
+    if (enable == recording_active) return true;
+
+    bool any_available = false;
+    for (const CameraSlot& cam : cameras) {
+        if (recording_branch_available(cam.rec)) any_available = true;
+    }
+    if (!any_available) {
+        // カメラがまだ起動していない場合もここに来る (起動後に改めて録画を開始する)
+        std::cerr << "録画分岐が有効なパイプラインがありません。" << std::endl;
+        return false;
+    }
+
+    if (enable) {
+        // 開始前に保存先ディレクトリを用意し、空き容量を確認する
+        for (const CameraSlot& cam : cameras) {
+            if (!recording_branch_available(cam.rec)) continue;
+            mkdir(cam.rec.dir.c_str(), 0755); // 既に存在する場合の EEXIST は無視
+            unsigned long long free_mb = get_free_space_mb(cam.rec.dir);
+            if (free_mb < RECORD_MIN_FREE_MB) {
+                std::cerr << "録画先の空き容量が不足しているため録画を開始できません (" << cam.rec.dir << ": "
+                          << free_mb << " MB)。" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    for (CameraSlot& cam : cameras) apply_recording_state(cam.rec, enable);
+    recording_active = enable;
+    std::cout << (enable ? "録画を開始しました。" : "録画を停止しました。") << std::endl;
+    return true;
+}
+
+// 現在録画中かどうかを返す関数
+bool is_gstreamer_recording() {
+    std::lock_guard<std::mutex> lock(recording_mutex);
+    return recording_active;
+}
+
+// 録画分岐の要素への参照を解放する
+static void release_recording_branch(RecordingBranch& rec) {
+    if (rec.valve) {
+        gst_object_unref(rec.valve);
+        rec.valve = nullptr;
+    }
+    if (rec.sink) {
+        gst_object_unref(rec.sink);
+        rec.sink = nullptr;
+    }
+}
+
+// 録画中のセグメントを正しく閉じてから録画分岐の参照を解放する (パイプライン停止前に呼び出す)
+static void finalize_recording(GstElement* pipeline, RecordingBranch& rec) {
+    if (pipeline && recording_active && recording_branch_available(rec)) {
+        // EOS を流して splitmuxsink に現在のファイルを確定させる (mp4mux の場合は moov の書き込みに必要)
+        gst_element_send_event(pipeline, gst_event_new_eos());
+        GstBus* bus = gst_element_get_bus(pipeline);
+        GstMessage* msg = gst_bus_timed_pop_filtered(bus, 2 * GST_SECOND,
+                                                     static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        if (msg) gst_message_unref(msg);
+        gst_object_unref(bus);
+    }
+    release_recording_branch(rec);
+}
+
+// 停止要求が出ているかどうか
+static bool camera_stop_requested() {
+    std::lock_guard<std::mutex> lock(startup_mutex);
+    return startup_stop_requested;
+}
+
+// 停止要求が出るか指定時間が経過するまで待つ。停止要求が出た場合は true を返す
+static bool wait_for_stop(unsigned int timeout_ms) {
+    std::unique_lock<std::mutex> lock(startup_mutex);
+    return startup_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [] { return startup_stop_requested; });
+}
+
+// GStreamerライブラリの初期化 (最初に起動したカメラスレッドで1回だけ実行)
+// 初回はプラグインレジストリの走査に時間がかかるため、メインスレッドでは実行しない
+static void init_gstreamer_once() {
+    gst_init(nullptr, nullptr);
+    // 録画先の空き容量を定期的にチェックするタイマーを登録 (デフォルトコンテキスト = GMainLoopスレッドで実行)
+    free_space_timer_id = g_timeout_add_seconds(RECORD_FREE_SPACE_CHECK_INTERVAL_SEC, check_free_space_cb, nullptr);
+}
+
+// 最初の映像バッファが udpsink に届いた時刻を記録するプローブ (ストリーミングスレッドで実行)
+static GstPadProbeReturn first_frame_probe_cb(GstPad*, GstPadProbeInfo*, gpointer user_data) {
+    startup_metrics_mark_first_video_frame(GPOINTER_TO_INT(user_data));
+    return GST_PAD_PROBE_REMOVE; // 1回記録したら外す
+}
+
+static void attach_first_frame_probe(GstElement* pipeline, int camera_index) {
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "live_sink");
+    if (!sink) return;
+    GstPad* pad = gst_element_get_static_pad(sink, "sink");
+    if (pad) {
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, first_frame_probe_cb, GINT_TO_POINTER(camera_index), nullptr);
+        gst_object_unref(pad);
+    }
+    gst_object_unref(sink);
+}
+
+// バスのエラーメッセージをログに出す
+static void log_pipeline_error(const CameraSlot& cam, GstMessage* msg) {
+    if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+        GError* err = nullptr;
+        gst_message_parse_error(msg, &err, nullptr);
+        std::cerr << "GStreamerエラー (" << cam.config.device << "): " << (err ? err->message : "unknown") << std::endl;
+        if (err) g_error_free(err);
+    } else {
+        std::cerr << "GStreamerパイプラインが終了しました (" << cam.config.device << ")。" << std::endl;
+    }
+}
+
+// カメラのパイプラインを停止して解放する (起動スレッドまたは起動スレッド終了後に呼び出す)
+static void teardown_camera(CameraSlot& cam) {
+    {
+        std::lock_guard<std::mutex> lock(recording_mutex);
+        release_recording_branch(cam.rec);
+    }
+    cam.paused = false;
+    if (cam.pipeline) {
+        // パイプラインをNULL状態に遷移させて停止し、参照カウントを減らす (不要になれば解放される)
+        gst_element_set_state(cam.pipeline, GST_STATE_NULL);
+        gst_object_unref(cam.pipeline);
+        cam.pipeline = nullptr;
+    }
+    if (cam.loop) {
+        // メインループに終了を要求し、実行しているスレッドが終了するのを待ってから解放する
+        g_main_loop_quit(cam.loop);
+        if (cam.loop_thread.joinable()) cam.loop_thread.join();
+        g_main_loop_unref(cam.loop);
+        cam.loop = nullptr;
+    }
+}
+
+// カメラのパイプラインを1回起動してみる。PLAYING に遷移できなければ解放して false を返す
+static bool try_start_camera(CameraSlot& cam, int camera_index) {
+    // デバイスが存在しなければパイプラインを作らない
+    if (access(cam.config.device.c_str(), R_OK) != 0) {
+        std::cerr << "カメラデバイスが見つかりません: " << cam.config.device << std::endl;
+        return false;
+    }
+
+    RecordingBranch branch;
+    if (!create_pipeline(cam.config, &cam.pipeline, &cam.loop, &branch)) return false;
+    attach_first_frame_probe(cam.pipeline, camera_index);
+
+    // パイプラインをPLAYING状態に遷移させる。ライブソースは通常すぐに NO_PREROLL を返すが、
+    // ASYNC の場合は停止要求を確認しながらタイムアウトまで待つ
+    GstStateChangeReturn ret = gst_element_set_state(cam.pipeline, GST_STATE_PLAYING);
+    const uint64_t deadline_ms = monotonic_now_ms() + CAMERA_START_TIMEOUT_MS;
+    while (ret == GST_STATE_CHANGE_ASYNC && monotonic_now_ms() < deadline_ms && !camera_stop_requested()) {
+        ret = gst_element_get_state(cam.pipeline, nullptr, nullptr, CAMERA_POLL_INTERVAL_MS * GST_MSECOND);
+    }
+    if (ret == GST_STATE_CHANGE_FAILURE || ret == GST_STATE_CHANGE_ASYNC) {
+        GstBus* bus = gst_element_get_bus(cam.pipeline);
+        GstMessage* msg = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR);
+        if (msg) {
+            log_pipeline_error(cam, msg);
+            gst_message_unref(msg);
+        }
+        gst_object_unref(bus);
+        release_recording_branch(branch);
+        teardown_camera(cam);
+        return false;
+    }
+
+    // 録画分岐を公開する。録画中に起動したカメラはそのまま録画に加わる
+    {
+        std::lock_guard<std::mutex> lock(recording_mutex);
+        cam.rec = branch;
+        if (recording_active) apply_recording_state(cam.rec, true);
+    }
+    cam.loop_thread = std::thread(run_main_loop, cam.loop);
+    return true;
+}
+
+// アイドルの要求をパイプラインに反映する (起動スレッドから呼び出す)
+// READY ではカメラデバイスを閉じ、キャプチャ・エンコード・送信がすべて止まる。PLAYING に戻すとネゴシエーションからやり直す
+static void apply_idle_state(CameraSlot& cam, int camera_index) {
+    bool pause = video_idle_requested.load() && !is_gstreamer_recording();
+    if (pause == cam.paused) return;
+    GstStateChangeReturn ret = gst_element_set_state(cam.pipeline, pause ? GST_STATE_READY : GST_STATE_PLAYING);
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+        std::cerr << "カメラ" << camera_index + 1 << " (" << cam.config.device << ") を "
+                  << (pause ? "READY" : "PLAYING") << " にできませんでした。" << std::endl;
+        return;
+    }
+    cam.paused = pause;
+    std::cout << "カメラ" << camera_index + 1 << " の映像配信を" << (pause ? "一時停止しました (アイドル)。" : "再開しました。")
+              << std::endl;
+}
+
+// 実行中のパイプラインのバスを監視する。エラー (カメラの抜去など) が発生したら true、停止要求なら false を返す
+static bool monitor_camera(CameraSlot& cam, int camera_index) {
+    GstBus* bus = gst_element_get_bus(cam.pipeline);
+    bool failed = false;
+    while (!camera_stop_requested()) {
+        apply_idle_state(cam, camera_index);
+        GstMessage* msg = gst_bus_timed_pop_filtered(bus, CAMERA_POLL_INTERVAL_MS * GST_MSECOND,
+                                                     static_cast<GstMessageType>(GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+        if (!msg) continue;
+        log_pipeline_error(cam, msg);
+        gst_message_unref(msg);
+        failed = true;
+        break;
+    }
+    gst_object_unref(bus);
+    return failed;
+}
+
+// カメラ1台分の起動スレッド: 起動に成功するまで再試行し、起動後はエラーを監視して作り直す
+static void camera_startup_worker(int camera_index) {
+    CameraSlot& cam = cameras[camera_index];
+    std::call_once(gst_init_flag, init_gstreamer_once);
+
+    unsigned int retry_ms = CAMERA_RETRY_INITIAL_MS;
+    unsigned int attempt = 0;
+    while (!camera_stop_requested()) {
+        ++attempt;
+        if (try_start_camera(cam, camera_index)) {
+            std::cout << "カメラ" << camera_index + 1 << " (" << cam.config.device << ", port " << cam.config.port
+                      << ") の映像配信を開始しました (試行 " << attempt << " 回目)。" << std::endl;
+            if (!monitor_camera(cam, camera_index)) return; // 停止要求。解放は stop_gstreamer_pipelines で行う
+            teardown_camera(cam);
+            retry_ms = CAMERA_RETRY_INITIAL_MS;
+            attempt = 0;
+        }
+        std::cerr << "カメラ" << camera_index + 1 << " (" << cam.config.device << ") を " << retry_ms
+                  << " ms 後に再試行します。" << std::endl;
+        if (wait_for_stop(retry_ms)) return;
+        retry_ms = std::min(retry_ms * 2, CAMERA_RETRY_MAX_MS);
+    }
+}
+
+// アイドルの要求を設定する (反映は各カメラの起動スレッドが行うため、この関数はすぐに戻る)
+void set_gstreamer_idle(bool idle) {
+    video_idle_requested.store(idle);
+}
+
 // GStreamerパイプラインを開始するメイン関数
+// パイプラインの作成・ネゴシエーション・再試行はカメラごとのスレッドで行い、この関数はすぐに戻る
 bool start_gstreamer_pipelines() {
-    // GStreamerライブラリの初期化 (アプリケーション開始時に一度だけ呼び出す)
-    gst_init(nullptr, nullptr);
+    for (const CameraSlot& cam : cameras) {
+        if (cam.startup_thread.joinable()) {
+            std::cerr << "GStreamerパイプラインは既に起動しています。" << std::endl;
+            return false;
+        }
+    }
 
     // カメラ1 (/dev/video2) の設定: H.264ネイティブソースとして設定
-    PipelineConfig config1;
+    PipelineConfig& config1 = cameras[0].config;
     config1.device = "/dev/video2";
     config1.port = 5000;
     config1.is_h264_native_source = true; // H.264ネイティブソースであることを指定
+    config1.record_prefix = "cam1";
     // その他のパラメータ (解像度、フレームレートなど) はPipelineConfig構造体のデフォルト値を使用
 
-    // カメラ1のパイプラインを作成・起動
-    if (!create_pipeline(config1, &pipeline1, &main_loop1)) return false;
-
     // カメラ2 (/dev/video4) の設定: JPEGソースとして設定 (H.264へのエンコードが必要)
-    PipelineConfig config2;
+    PipelineConfig& config2 = cameras[1].config;
     config2.device = "/dev/video4";
     config2.port = 5001;
     config2.is_h264_native_source = false; // H.264ネイティブではない (エンコードが必要) ことを指定
+    config2.record_prefix = "cam2";
     // x264encのパラメータはPipelineConfig構造体のデフォルト値を使用
 
-    // カメラ2のパイプラインを作成・起動
-    if (!create_pipeline(config2, &pipeline2, &main_loop2)) return false;
-
-    // 各パイプラインのGMainLoopを別々のスレッドで実行開始
-    loop_thread1 = std::thread(run_main_loop, main_loop1);
-    loop_thread2 = std::thread(run_main_loop, main_loop2);
+    {
+        std::lock_guard<std::mutex> lock(startup_mutex);
+        startup_stop_requested = false;
+    }
+    for (int i = 0; i < NUM_CAMERAS; ++i) {
+        cameras[i].startup_thread = std::thread(camera_startup_worker, i);
+    }
 
-    std::cout << "GStreamerパイプラインを非同期で起動しました。" << std::endl;
+    std::cout << "GStreamerパイプラインをバックグラウンドで起動しています..." << std::endl;
     return true;
 }
 // GStreamerパイプラインを停止し、リソースを解放する関数
 void stop_gstreamer_pipelines() {
     std::cout << "GStreamerパイプラインを停止します..." << std::endl;
 
-    if (pipeline1) {
-        // パイプライン1をNULL状態に遷移させて停止
-        gst_element_set_state(pipeline1, GST_STATE_NULL);
-        // パイプライン1オブジェクトの参照カウントを減らす (不要になれば解放される)
-        gst_object_unref(pipeline1);
-        pipeline1 = nullptr;
-    }
-    if (main_loop1) {
-        // メインループ1に終了を要求
-        g_main_loop_quit(main_loop1);
-        // メインループ1を実行しているスレッドが終了するのを待つ
-        if (loop_thread1.joinable()) loop_thread1.join();
-        // メインループ1オブジェクトの参照カウントを減らす
-        g_main_loop_unref(main_loop1);
-        main_loop1 = nullptr;
-    }
-
-    if (pipeline2) {
-        // パイプライン2をNULL状態に遷移させて停止
-        gst_element_set_state(pipeline2, GST_STATE_NULL);
-        // パイプライン2オブジェクトの参照カウントを減らす
-        gst_object_unref(pipeline2);
-        pipeline2 = nullptr;
-    }
-    if (main_loop2) {
-        // メインループ2に終了を要求
-        g_main_loop_quit(main_loop2);
-        // メインループ2を実行しているスレッドが終了するのを待つ
-        if (loop_thread2.joinable()) loop_thread2.join();
-        // メインループ2オブジェクトの参照カウントを減らす
-        g_main_loop_unref(main_loop2);
-        main_loop2 = nullptr;
+    // 起動スレッドを先に止める (以降、パイプラインに触るのはこのスレッドだけ)
+    {
+        std::lock_guard<std::mutex> lock(startup_mutex);
+        startup_stop_requested = true;
+    }
+    startup_cv.notify_all();
+    for (CameraSlot& cam : cameras) {
+        if (cam.startup_thread.joinable()) cam.startup_thread.join();
+    }
+
+    if (free_space_timer_id != 0) {
+        g_source_remove(free_space_timer_id);
+        free_space_timer_id = 0;
+    }
+    {
+        // 録画中であれば現在のセグメントを確定させる
+        std::lock_guard<std::mutex> lock(recording_mutex);
+        for (CameraSlot& cam : cameras) finalize_recording(cam.pipeline, cam.rec);
+        recording_active = false;
     }
 
+    for (CameraSlot& cam : cameras) teardown_camera(cam);
+
     std::cout << "GStreamerパイプラインを停止しました。" << std::endl;
 }
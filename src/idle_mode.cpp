@@ -0,0 +1,124 @@
+#include "idle_mode.h"
+#include <math.h>         // sqrtf を使用するため
+#include <stdio.h>        // snprintf を使用するため
+#include <sys/resource.h> // getrusage を使用するため
+
+// 現在の状態に now_ms / usage までの分を加える
+static void accumulate(PowerStateStats *stats, const IdleController *idle, uint64_t now_ms, const PowerUsage &usage)
+{
+    stats->time_ms += now_ms > idle->state_since_ms ? now_ms - idle->state_since_ms : 0;
+    stats->cpu_ns += usage.cpu_ns > idle->state_usage.cpu_ns ? usage.cpu_ns - idle->state_usage.cpu_ns : 0;
+    stats->context_switches += usage.context_switches > idle->state_usage.context_switches
+                                   ? usage.context_switches - idle->state_usage.context_switches
+                                   : 0;
+}
+
+// 状態を切り替える (それまでの状態の分を累計に加える)
+static void enter_state(IdleController *idle, PowerState next, uint64_t now_ms, const PowerUsage &usage)
+{
+    accumulate(&idle->stats[idle->state], idle, now_ms, usage);
+    idle->state = next;
+    idle->state_since_ms = now_ms;
+    idle->state_usage = usage;
+    idle->stats[next].entries++;
+}
+
+void idle_init(IdleController *idle, const IdleConfig &config, uint64_t now_ms, const PowerUsage &usage)
+{
+    *idle = IdleController();
+    idle->config = config;
+    idle->state_since_ms = now_ms;
+    idle->state_usage = usage;
+    idle->stats[POWER_STATE_ACTIVE].entries = 1;
+}
+
+bool idle_update(IdleController *idle, bool operator_present, bool outputs_stopped, const AxisData &gyro,
+                 uint64_t now_ms, const PowerUsage &usage)
+{
+    idle->stats[idle->state].ticks++;
+
+    float rate_dps = sqrtf(gyro.x * gyro.x + gyro.y * gyro.y + gyro.z * gyro.z);
+    bool quiet = !operator_present && outputs_stopped && rate_dps <= idle->config.stationary_rate_dps;
+    if (quiet && !idle->quiet)
+        idle->quiet_since_ms = now_ms;
+    idle->quiet = quiet;
+
+    // 操縦者が現れたら (またはスラスターが動き出したら) 待たずに通常の状態に戻る。
+    // アイドル中の揺れは復帰の理由にしない (センサーの読み取りが遅いだけで、停止していることに変わりはない)
+    if (idle->state == POWER_STATE_IDLE)
+    {
+        if (operator_present || !outputs_stopped)
+        {
+            enter_state(idle, POWER_STATE_ACTIVE, now_ms, usage);
+            return true;
+        }
+        return false;
+    }
+    if (quiet && now_ms - idle->quiet_since_ms >= idle->config.enter_after_ms)
+    {
+        enter_state(idle, POWER_STATE_IDLE, now_ms, usage);
+        return true;
+    }
+    return false;
+}
+
+uint32_t idle_loop_period_ms(const IdleController *idle)
+{
+    return idle->state == POWER_STATE_IDLE ? idle->config.idle_period_ms : idle->config.active_period_ms;
+}
+
+void idle_stats(const IdleController *idle, uint64_t now_ms, const PowerUsage &usage, PowerStateStats out[POWER_STATE_COUNT])
+{
+    for (int s = 0; s < POWER_STATE_COUNT; ++s)
+        out[s] = idle->stats[s];
+    accumulate(&out[idle->state], idle, now_ms, usage);
+}
+
+const char *power_state_name(PowerState state)
+{
+    switch (state)
+    {
+    case POWER_STATE_ACTIVE:
+        return "ACTIVE";
+    case POWER_STATE_IDLE:
+        return "IDLE";
+    case POWER_STATE_COUNT:
+        break;
+    }
+    return "UNKNOWN";
+}
+
+bool power_usage_sample(PowerUsage *usage)
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+    {
+        perror("getrusage 失敗");
+        return false;
+    }
+    usage->cpu_ns = (static_cast<uint64_t>(ru.ru_utime.tv_sec) + static_cast<uint64_t>(ru.ru_stime.tv_sec)) * 1000000000ULL +
+                    (static_cast<uint64_t>(ru.ru_utime.tv_usec) + static_cast<uint64_t>(ru.ru_stime.tv_usec)) * 1000ULL;
+    usage->context_switches = static_cast<uint64_t>(ru.ru_nvcsw) + static_cast<uint64_t>(ru.ru_nivcsw);
+    return true;
+}
+
+bool format_power_stats(const IdleController *idle, uint64_t now_ms, const PowerUsage &usage, char *buffer, size_t buffer_size)
+{
+    if (!buffer || buffer_size == 0)
+        return false;
+    PowerStateStats stats[POWER_STATE_COUNT];
+    idle_stats(idle, now_ms, usage, stats);
+    int written = snprintf(buffer, buffer_size, "[POWER] state=%s", power_state_name(idle->state));
+    for (int s = 0; s < POWER_STATE_COUNT && written >= 0 && static_cast<size_t>(written) < buffer_size; ++s)
+    {
+        const PowerStateStats &st = stats[s];
+        double seconds = st.time_ms / 1000.0;
+        double cpu_percent = st.time_ms > 0 ? st.cpu_ns / 1e6 / st.time_ms * 100.0 : 0.0;
+        double wakeups_per_s = seconds > 0.0 ? st.context_switches / seconds : 0.0;
+        double loops_per_s = seconds > 0.0 ? st.ticks / seconds : 0.0;
+        written += snprintf(buffer + written, buffer_size - written, " %s=%.0fs(cpu=%.1f%%,wakeups=%.0f/s,loop=%.0f/s,entries=%u)",
+                            s == POWER_STATE_ACTIVE ? "active" : "idle", seconds, cpu_percent, wakeups_per_s,
+                            loops_per_s, st.entries);
+    }
+    return written >= 0 && static_cast<size_t>(written) < buffer_size;
+}
@@ -0,0 +1,188 @@
+#include "jitter_buffer.h"
+#include <algorithm> // std::max, std::min を使用するため
+
+#define STICK_MIN -32768 // スティック軸の最小値
+#define STICK_MAX 32767  // スティック軸の最大値
+
+// 新しい順に i 番目のサンプル (0 が最新)
+static const JitterSample &sample_at(const JitterBuffer *jb, int i)
+{
+    return jb->history[(jb->head - i + JITTER_HISTORY_SIZE) % JITTER_HISTORY_SIZE];
+}
+
+static int clamp_stick(float value)
+{
+    return static_cast<int>(std::max<float>(STICK_MIN, std::min<float>(STICK_MAX, value)));
+}
+
+// a から b へ t (0.0 〜 1.0) の位置で線形補間する。ボタンは a のものを使う
+static GamepadData lerp_command(const GamepadData &a, const GamepadData &b, float t)
+{
+    GamepadData out = a;
+    out.leftThumbX = clamp_stick(a.leftThumbX + (b.leftThumbX - a.leftThumbX) * t);
+    out.leftThumbY = clamp_stick(a.leftThumbY + (b.leftThumbY - a.leftThumbY) * t);
+    out.rightThumbX = clamp_stick(a.rightThumbX + (b.rightThumbX - a.rightThumbX) * t);
+    out.rightThumbY = clamp_stick(a.rightThumbY + (b.rightThumbY - a.rightThumbY) * t);
+    out.LT = static_cast<int>(a.LT + (b.LT - a.LT) * t);
+    out.RT = static_cast<int>(a.RT + (b.RT - a.RT) * t);
+    return out;
+}
+
+// 途切れ中のコマンドを求める: スティックを直近2件の変化率で外挿し、外挿時間を過ぎたらニュートラルへ減衰させる
+// トリガーは外挿せず減衰のみ、ボタンは最後の状態を保持する
+static GamepadData extrapolate_command(JitterBuffer *jb, uint32_t gap_ms)
+{
+    const JitterSample &newest = sample_at(jb, 0);
+    uint32_t since_gap_ms = gap_ms - jb->config.gap_threshold_ms;
+    float extrapolate_ms = static_cast<float>(std::min(since_gap_ms, jb->config.extrapolate_ms));
+
+    GamepadData out = newest.command;
+    if (jb->count >= 2)
+    {
+        const JitterSample &previous = sample_at(jb, 1);
+        uint64_t span_ms = newest.time_ms - previous.time_ms;
+        if (span_ms > 0)
+        {
+            // previous → newest の直線を newest から extrapolate_ms 先まで延ばす
+            out = lerp_command(previous.command, newest.command, 1.0f + extrapolate_ms / span_ms);
+            out.LT = newest.command.LT;
+            out.RT = newest.command.RT;
+            out.buttons = newest.command.buttons;
+        }
+    }
+
+    if (since_gap_ms <= jb->config.extrapolate_ms)
+    {
+        jb->stats.extrapolated++;
+        return out;
+    }
+
+    // 減衰は途絶の判定時間 (deadline_ms) までに終える
+    uint32_t decay_elapsed_ms = since_gap_ms - jb->config.extrapolate_ms;
+    uint32_t decay_start_ms = jb->config.gap_threshold_ms + jb->config.extrapolate_ms;
+    uint32_t decay_ms = jb->config.decay_ms;
+    if (decay_start_ms + decay_ms > jb->config.deadline_ms)
+        decay_ms = jb->config.deadline_ms > decay_start_ms ? jb->config.deadline_ms - decay_start_ms : 0;
+    float factor = decay_ms > 0 ? 1.0f - static_cast<float>(decay_elapsed_ms) / decay_ms : 0.0f;
+    factor = std::max(0.0f, factor);
+    GamepadData neutral;
+    neutral.buttons = out.buttons;
+    jb->stats.decayed++;
+    return lerp_command(neutral, out, factor);
+}
+
+// 遅延再生: now_ms - playout_delay_ms の時点のコマンドを前後のサンプルから補間する
+// 再生位置が最新のサンプルを越えた場合 (途切れ) は最新のコマンドを保持する
+static GamepadData delayed_command(JitterBuffer *jb, uint64_t now_ms)
+{
+    uint64_t playout_ms = now_ms > jb->config.playout_delay_ms ? now_ms - jb->config.playout_delay_ms : 0;
+    if (playout_ms >= sample_at(jb, 0).time_ms)
+    {
+        jb->stats.underruns++;
+        return sample_at(jb, 0).command;
+    }
+    for (int i = 1; i < jb->count; ++i)
+    {
+        const JitterSample &a = sample_at(jb, i);
+        if (a.time_ms <= playout_ms)
+        {
+            const JitterSample &b = sample_at(jb, i - 1);
+            float t = static_cast<float>(playout_ms - a.time_ms) / static_cast<float>(b.time_ms - a.time_ms);
+            jb->stats.interpolated++;
+            return lerp_command(a.command, b.command, t);
+        }
+    }
+    // 再生位置が履歴より古い (受信開始直後・送信元の切り替え直後) ので最も古いサンプルを使う
+    jb->stats.interpolated++;
+    return sample_at(jb, jb->count - 1).command;
+}
+
+void jitter_init(JitterBuffer *jb, const JitterConfig &config)
+{
+    *jb = JitterBuffer();
+    jb->config = config;
+}
+
+void jitter_push(JitterBuffer *jb, int source_id, const GamepadData &command, uint64_t time_ms)
+{
+    if (jb->count > 0 && source_id != jb->source_id)
+        jitter_reset(jb); // 別の操縦者のコマンドとは補間・外挿しない
+    jb->source_id = source_id;
+
+    if (jb->count > 0)
+    {
+        JitterSample &newest = jb->history[jb->head];
+        if (time_ms < newest.time_ms)
+            return; // 時刻が戻ったサンプルは使わない
+        if (time_ms == newest.time_ms)
+        {
+            newest.command = command; // 同じ周期に複数届いた場合は最新のものだけ残す
+            return;
+        }
+        jb->head = (jb->head + 1) % JITTER_HISTORY_SIZE;
+    }
+    jb->history[jb->head].time_ms = time_ms;
+    jb->history[jb->head].command = command;
+    if (jb->count < JITTER_HISTORY_SIZE)
+        jb->count++;
+}
+
+GamepadData jitter_sample(JitterBuffer *jb, uint64_t now_ms)
+{
+    jb->stats.samples++;
+    if (jb->count == 0)
+        return GamepadData{};
+
+    const JitterSample &newest = sample_at(jb, 0);
+    uint32_t gap_ms = now_ms > newest.time_ms ? static_cast<uint32_t>(now_ms - newest.time_ms) : 0;
+    bool in_gap = gap_ms > jb->config.gap_threshold_ms;
+    if (in_gap)
+    {
+        if (!jb->in_gap)
+            jb->stats.gaps++;
+        jb->stats.max_gap_ms = std::max(jb->stats.max_gap_ms, gap_ms);
+    }
+    jb->in_gap = in_gap;
+
+    if (gap_ms >= jb->config.deadline_ms)
+    {
+        // 途絶の判定時間を過ぎた: どの方式でもニュートラル (ウォッチドッグが出力を引き継ぐ)
+        jb->stats.decayed++;
+        GamepadData neutral;
+        neutral.buttons = newest.command.buttons;
+        return neutral;
+    }
+    if (jb->config.policy == JITTER_POLICY_DELAYED)
+        return delayed_command(jb, now_ms);
+    if (!in_gap)
+    {
+        jb->stats.fresh++;
+        return newest.command;
+    }
+    if (jb->config.policy == JITTER_POLICY_EXTRAPOLATE)
+        return extrapolate_command(jb, gap_ms);
+    jb->stats.held++;
+    return newest.command;
+}
+
+void jitter_reset(JitterBuffer *jb)
+{
+    jb->head = 0;
+    jb->count = 0;
+    jb->source_id = -1;
+    jb->in_gap = false;
+}
+
+const char *jitter_policy_name(JitterPolicy policy)
+{
+    switch (policy)
+    {
+    case JITTER_POLICY_HOLD:
+        return "HOLD";
+    case JITTER_POLICY_EXTRAPOLATE:
+        return "EXTRAPOLATE";
+    case JITTER_POLICY_DELAYED:
+        return "DELAYED";
+    }
+    return "UNKNOWN";
+}
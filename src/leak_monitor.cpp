@@ -0,0 +1,300 @@
+#include "leak_monitor.h"
+#include "bus_manager.h"     // bus_read_leak_now を使用するため
+#include "monotonic_clock.h" // CLOCK_MONOTONIC による時刻取得
+#include <stdio.h>           // printf, snprintf, perror を使用するため
+#include <unistd.h>          // read, close を使用するため
+#include <pthread.h>         // スレッド優先度の設定のため
+#include <sys/socket.h>      // socket, sendto を使用するため
+#include <sys/timerfd.h>     // timerfd_create, timerfd_settime を使用するため
+#include <thread>            // std::thread を使用するため
+#include <atomic>            // std::atomic を使用するため
+#include <mutex>             // std::mutex を使用するため
+
+// --- 浸水監視の状態 ---
+static LeakMonitorConfig lm_config;              // 現在の設定
+static std::thread lm_thread;                    // 監視スレッド
+static std::atomic<bool> lm_running(false);      // 監視スレッドの実行フラグ
+static std::atomic<bool> lm_latched(false);      // 浸水を確定しているか
+static std::atomic<bool> lm_clear_request(false); // leak_monitor_clear() の要求 (監視スレッドで処理する)
+static int lm_timer_fd = -1;                     // 監視周期の timerfd
+static int lm_alert_socket = -1;                 // 警報パケット送信用のソケット
+static uint64_t lm_start_ns = 0;                 // ログのタイムスタンプ基準時刻
+
+// 警報の送信先と統計は監視スレッドとメインループの両方から触るため lm_mutex で保護する
+static std::mutex lm_mutex;
+static struct sockaddr_in lm_targets[LEAK_MAX_ALERT_TARGETS];
+static int lm_target_count = 0;
+static LeakMonitorStats lm_stats;
+
+// 以下は監視スレッドのみが触る
+static uint32_t positive_count = 0;     // 連続して検知した回数
+static uint64_t first_positive_ns = 0;  // 連続検知の最初の時刻
+static uint64_t last_sample_ns = 0;     // 前回センサーを読んだ時刻
+static uint64_t last_alert_ns = 0;      // 前回警報を送った時刻
+static uint64_t last_led_toggle_ns = 0; // 前回LEDを切り替えた時刻
+static bool led_on = false;             // 点滅中のLEDの状態
+static uint32_t alert_seq = 0;          // 警報パケットの通し番号
+
+const char *leak_action_name(LeakAction action)
+{
+    switch (action)
+    {
+    case LEAK_ACTION_ALERT_ONLY:
+        return "ALERT_ONLY";
+    case LEAK_ACTION_STOP:
+        return "STOP";
+    case LEAK_ACTION_SURFACE:
+        return "SURFACE";
+    }
+    return "UNKNOWN";
+}
+
+// 警報パケットを全送信先へ送る
+// テレメトリと同じ "NAME:value" 形式 (ALERT:LEAK,SEQ:<n>,ACTION:<動作>,REACTION_US:<us>)
+static void send_alert(uint64_t now_ns)
+{
+    last_alert_ns = now_ns;
+    std::lock_guard<std::mutex> lock(lm_mutex);
+    char packet[128];
+    int len = snprintf(packet, sizeof(packet), "ALERT:LEAK,SEQ:%u,ACTION:%s,REACTION_US:%u",
+                       alert_seq++, leak_action_name(lm_config.action), lm_stats.last_reaction_us);
+    if (len < 0 || lm_alert_socket < 0)
+        return;
+    for (int i = 0; i < lm_target_count; ++i)
+    {
+        if (sendto(lm_alert_socket, packet, len, 0, (const struct sockaddr *)&lm_targets[i], sizeof(lm_targets[i])) == len)
+            lm_stats.alerts_sent++;
+    }
+}
+
+// 設定した保護動作を出力する。出力を占有した場合は true
+static bool apply_protective_action()
+{
+    if (lm_config.action == LEAK_ACTION_ALERT_ONLY)
+        return false;
+    thruster_claim_output(OUTPUT_OWNER_LEAK); // 以降ウォッチドッグ・メインループの出力は無視される
+    thruster_owner_set_all_pwm(OUTPUT_OWNER_LEAK, PWM_STOP);
+    if (lm_config.action == LEAK_ACTION_SURFACE)
+    {
+        for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+        {
+            if (lm_config.surface_channel_mask & (1u << ch))
+                thruster_owner_set_pwm(OUTPUT_OWNER_LEAK, ch, lm_config.surface_pwm);
+        }
+    }
+    return true;
+}
+
+// 浸水を確定したときの処理: 保護動作 → 警報の順に、センサーの反応から1周期以内に行う
+static void on_leak_confirmed(uint64_t now_ns)
+{
+    lm_latched.store(true);
+    bool claimed = apply_protective_action();
+    uint64_t reacted_ns = monotonic_now_ns();
+    {
+        std::lock_guard<std::mutex> lock(lm_mutex);
+        lm_stats.detections++;
+        lm_stats.last_reaction_us = static_cast<uint32_t>((reacted_ns - first_positive_ns) / 1000ULL);
+    }
+    send_alert(reacted_ns);
+    led_on = false;
+    last_led_toggle_ns = now_ns;
+    printf("[LEAK %10.3f] 浸水を検知しました。保護動作: %s%s (センサー反応から %.2f ms)\n",
+           (now_ns - lm_start_ns) / 1e9, leak_action_name(lm_config.action),
+           claimed ? "" : " (出力は変更しません)", (reacted_ns - first_positive_ns) / 1e6);
+}
+
+// 1周期分の監視処理
+static void leak_monitor_tick(uint64_t now_ns)
+{
+    if (lm_clear_request.exchange(false) && lm_latched.load())
+    {
+        lm_latched.store(false);
+        positive_count = 0;
+        thruster_release_output(OUTPUT_OWNER_LEAK); // 出力をウォッチドッグ・メインループに返す
+        printf("[LEAK %10.3f] 浸水の検知を解除しました。\n", (now_ns - lm_start_ns) / 1e9);
+    }
+
+    bool leak = bus_read_leak_now(); // バス管理の実行中はバススレッドに読ませ、読み終わるまで待つ
+    {
+        std::lock_guard<std::mutex> lock(lm_mutex);
+        lm_stats.samples++;
+        if (last_sample_ns != 0 && now_ns - last_sample_ns > lm_stats.max_sample_gap_us * 1000ULL)
+            lm_stats.max_sample_gap_us = static_cast<uint32_t>((now_ns - last_sample_ns) / 1000ULL);
+    }
+    last_sample_ns = now_ns;
+
+    if (!lm_latched.load())
+    {
+        if (!leak)
+        {
+            positive_count = 0;
+            return;
+        }
+        if (positive_count++ == 0)
+            first_positive_ns = now_ns;
+        if (positive_count >= lm_config.confirm_samples)
+            on_leak_confirmed(now_ns);
+        return;
+    }
+
+    // 検知中: 警報の再送と LED の点滅
+    if (now_ns - last_alert_ns >= static_cast<uint64_t>(lm_config.alert_repeat_ms) * 1000000ULL)
+        send_alert(now_ns);
+    if (lm_config.flash_led && lm_config.action != LEAK_ACTION_ALERT_ONLY &&
+        now_ns - last_led_toggle_ns >= static_cast<uint64_t>(lm_config.led_flash_period_ms) * 1000000ULL)
+    {
+        led_on = !led_on;
+        thruster_owner_set_pwm(OUTPUT_OWNER_LEAK, LED_PWM_CHANNEL, led_on ? LED_PWM_ON : LED_PWM_OFF);
+        last_led_toggle_ns = now_ns;
+    }
+}
+
+// 監視スレッド本体: timerfd で周期的に起床し、メインループや通信の状態とは無関係にセンサーを読む
+static void leak_monitor_thread_main()
+{
+    // ウォッチドッグ (優先度 10) より高い優先度で実行する (権限がなければ通常優先度のまま)
+    struct sched_param param;
+    param.sched_priority = 20;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    while (lm_running.load())
+    {
+        uint64_t expirations = 0;
+        if (read(lm_timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            continue; // EINTR など
+        leak_monitor_tick(monotonic_now_ns());
+    }
+}
+
+bool leak_monitor_start(const LeakMonitorConfig &config)
+{
+    if (lm_running.load())
+        return true;
+
+    lm_config = config;
+    if (lm_config.confirm_samples == 0)
+        lm_config.confirm_samples = 1;
+    if (lm_config.period_ms == 0)
+        lm_config.period_ms = 1; // 周期 0 の timerfd は停止したままになり、スレッドが満了を待ち続ける (停止の join も戻らない)
+    if (lm_config.action == LEAK_ACTION_SURFACE)
+    {
+        // 上向きの推力を出せないチャンネル (前進用など) で「浮上」させず、停止にとどめる
+        lm_config.surface_channel_mask = thruster_surface_channel_mask(config.surface_channel_mask);
+        if (lm_config.surface_channel_mask == 0)
+        {
+            fprintf(stderr, "警告: 浮上に使えるチャンネルがありません (要求 0x%x, 上向きの配分 0x%x)。浸水時の保護動作を STOP にします。\n",
+                    config.surface_channel_mask, thruster_heave_channel_mask());
+            lm_config.action = LEAK_ACTION_STOP;
+        }
+    }
+    lm_start_ns = monotonic_now_ns();
+    lm_latched.store(false);
+    lm_clear_request.store(false);
+    positive_count = 0;
+    last_sample_ns = 0;
+    last_alert_ns = 0;
+    alert_seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(lm_mutex);
+        lm_stats = LeakMonitorStats();
+    }
+
+    lm_alert_socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (lm_alert_socket < 0)
+    {
+        perror("浸水警報ソケット作成失敗"); // 警報は送れないが保護動作は行えるので続行
+    }
+
+    lm_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (lm_timer_fd < 0)
+    {
+        perror("浸水監視 timerfd 作成失敗");
+        if (lm_alert_socket >= 0)
+            close(lm_alert_socket);
+        lm_alert_socket = -1;
+        return false;
+    }
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = lm_config.period_ms / 1000;
+    spec.it_interval.tv_nsec = (lm_config.period_ms % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(lm_timer_fd, 0, &spec, NULL) < 0)
+    {
+        perror("浸水監視 timerfd 設定失敗");
+        close(lm_timer_fd);
+        lm_timer_fd = -1;
+        if (lm_alert_socket >= 0)
+            close(lm_alert_socket);
+        lm_alert_socket = -1;
+        return false;
+    }
+
+    lm_running.store(true);
+    lm_thread = std::thread(leak_monitor_thread_main);
+    printf("浸水監視開始 (周期 %u ms, 確定 %u 回, 保護動作 %s)\n",
+           lm_config.period_ms, lm_config.confirm_samples, leak_action_name(lm_config.action));
+    return true;
+}
+
+void leak_monitor_stop()
+{
+    if (!lm_running.load())
+        return;
+    lm_running.store(false);
+    if (lm_thread.joinable())
+        lm_thread.join(); // timerfd の次の満了 (最大 period_ms) で抜ける
+    close(lm_timer_fd);
+    lm_timer_fd = -1;
+    std::lock_guard<std::mutex> lock(lm_mutex);
+    if (lm_alert_socket >= 0)
+        close(lm_alert_socket);
+    lm_alert_socket = -1;
+    lm_latched.store(false);
+    thruster_release_output(OUTPUT_OWNER_LEAK);
+}
+
+bool leak_monitor_leak_detected()
+{
+    return lm_latched.load();
+}
+
+void leak_monitor_clear()
+{
+    lm_clear_request.store(true);
+}
+
+bool leak_clear_gesture_update(LeakClearGesture *gesture, uint16_t buttons, uint64_t now_ms)
+{
+    if ((buttons & LEAK_CLEAR_BUTTONS) != LEAK_CLEAR_BUTTONS)
+    {
+        gesture->holding = false;
+        gesture->fired = false;
+        return false;
+    }
+    if (!gesture->holding)
+    {
+        gesture->holding = true;
+        gesture->since_ms = now_ms;
+    }
+    if (gesture->fired || now_ms - gesture->since_ms < LEAK_CLEAR_HOLD_MS)
+        return false;
+    gesture->fired = true;
+    return true;
+}
+
+void leak_monitor_set_alert_targets(const struct sockaddr_in *targets, int count)
+{
+    std::lock_guard<std::mutex> lock(lm_mutex);
+    if (count > LEAK_MAX_ALERT_TARGETS)
+        count = LEAK_MAX_ALERT_TARGETS;
+    lm_target_count = 0;
+    for (int i = 0; i < count; ++i)
+        lm_targets[lm_target_count++] = targets[i];
+}
+
+LeakMonitorStats leak_monitor_stats()
+{
+    std::lock_guard<std::mutex> lock(lm_mutex);
+    return lm_stats;
+}
@@ -0,0 +1,281 @@
+#include "link_watchdog.h"
+#include "monotonic_clock.h" // CLOCK_MONOTONIC による時刻取得
+#include <stdio.h>           // printf, perror を使用するため
+#include <unistd.h>          // read, close を使用するため
+#include <pthread.h>         // スレッド優先度の設定のため
+#include <sys/timerfd.h>     // timerfd_create, timerfd_settime を使用するため
+#include <thread>            // std::thread を使用するため
+#include <atomic>            // std::atomic を使用するため
+#include <algorithm>         // std::min, std::max を使用するため
+
+// --- ウォッチドッグの状態 ---
+static WatchdogConfig wd_config;                      // 現在の設定
+static std::thread wd_thread;                         // 監視スレッド
+static std::atomic<bool> wd_running(false);           // 監視スレッドの実行フラグ
+static std::atomic<uint64_t> wd_last_feed_ns(0);      // 最後に feed された時刻 (0 は未接続)
+static std::atomic<int> wd_state(WATCHDOG_WAITING);   // 現在の状態
+static int wd_timer_fd = -1;                          // 監視周期の timerfd
+static uint64_t wd_start_ns = 0;                      // ログのタイムスタンプ基準時刻
+static uint64_t wd_state_entered_ns = 0;              // 現在の状態に入った時刻 (監視スレッドまたは watchdog_step のみが触る)
+static std::atomic<bool> wd_manual(false);            // 手動駆動モード (スレッドなし、watchdog_step で進める)
+
+const char *watchdog_state_name(WatchdogState state)
+{
+    switch (state)
+    {
+    case WATCHDOG_WAITING:
+        return "WAITING";
+    case WATCHDOG_NORMAL:
+        return "NORMAL";
+    case WATCHDOG_HOLD:
+        return "HOLD";
+    case WATCHDOG_RAMP_DOWN:
+        return "RAMP_DOWN";
+    case WATCHDOG_SAFE:
+        return "SAFE";
+    case WATCHDOG_SURFACE:
+        return "SURFACE";
+    }
+    return "UNKNOWN";
+}
+
+// 状態遷移を行い、タイムスタンプ付きでログを出力する
+static void transition(WatchdogState next, uint64_t now_ns, uint64_t link_age_ns)
+{
+    WatchdogState prev = static_cast<WatchdogState>(wd_state.load());
+    if (prev == next)
+        return;
+    wd_state.store(next);
+    printf("[WATCHDOG %10.3f] %s -> %s (最終コマンドから %.1f ms)\n",
+           (now_ns - wd_start_ns) / 1e9, watchdog_state_name(prev), watchdog_state_name(next), link_age_ns / 1e6);
+
+    if (next == WATCHDOG_NORMAL)
+        thruster_release_output(OUTPUT_OWNER_WATCHDOG); // メインループに出力を返す
+    else if (next != WATCHDOG_WAITING)
+        thruster_claim_output(OUTPUT_OWNER_WATCHDOG); // 以降メインループの出力は無視される
+}
+
+// RAMP_DOWN: 各スラスターを1周期分だけ安全値に近づける。全チャンネルが安全値に到達したら true
+// 優先度の高い主体 (浸水検知) が出力を占有していて書き込めない場合も、減速はその主体に任せて完了とする
+static bool ramp_down_step()
+{
+    int outputs[NUM_THRUSTERS];
+    thruster_get_outputs(outputs);
+
+    int max_step = static_cast<int>(static_cast<int64_t>(wd_config.ramp_slew_us_per_s) * wd_config.period_ms / 1000);
+    if (max_step < 1)
+        max_step = 1;
+
+    bool reached = true;
+    for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+    {
+        int diff = wd_config.safe_pwm - outputs[ch];
+        if (diff == 0)
+            continue;
+        int step = diff > 0 ? std::min(diff, max_step) : std::max(diff, -max_step);
+        if (!thruster_owner_set_pwm(OUTPUT_OWNER_WATCHDOG, ch, outputs[ch] + step))
+            return true;
+        if (outputs[ch] + step != wd_config.safe_pwm)
+            reached = false;
+    }
+    return reached;
+}
+
+// 1周期分の監視処理
+static void watchdog_tick(uint64_t now_ns)
+{
+    uint64_t &state_entered_ns = wd_state_entered_ns;
+    uint64_t last_feed_ns = wd_last_feed_ns.load();
+    WatchdogState state = static_cast<WatchdogState>(wd_state.load());
+    if (last_feed_ns == 0)
+        return; // 最初の操縦コマンドをまだ受け取っていない (WAITING)
+
+    uint64_t link_age_ns = now_ns > last_feed_ns ? now_ns - last_feed_ns : 0;
+    bool link_ok = link_age_ns <= static_cast<uint64_t>(wd_config.link_timeout_ms) * 1000000ULL;
+    uint64_t time_in_state_ms = (now_ns - state_entered_ns) / 1000000ULL;
+
+    WatchdogState next = state;
+    if (link_ok)
+    {
+        next = WATCHDOG_NORMAL;
+    }
+    else
+    {
+        switch (state)
+        {
+        case WATCHDOG_WAITING:
+        case WATCHDOG_NORMAL:
+            next = WATCHDOG_HOLD;
+            break;
+        case WATCHDOG_HOLD:
+            if (time_in_state_ms >= wd_config.hold_ms)
+                next = WATCHDOG_RAMP_DOWN;
+            break;
+        case WATCHDOG_RAMP_DOWN:
+            if (ramp_down_step())
+                next = WATCHDOG_SAFE;
+            break;
+        case WATCHDOG_SAFE:
+            if (wd_config.surface_enabled && time_in_state_ms >= wd_config.surface_delay_ms)
+                next = WATCHDOG_SURFACE;
+            break;
+        case WATCHDOG_SURFACE:
+            break;
+        }
+    }
+
+    if (next != state)
+    {
+        transition(next, now_ns, link_age_ns);
+        state_entered_ns = now_ns;
+        if (next == WATCHDOG_SAFE)
+        {
+            // LED も含めて安全状態にする (浸水検知の保護動作が出力を占有している場合は上書きしない)
+            thruster_owner_set_all_pwm(OUTPUT_OWNER_WATCHDOG, wd_config.safe_pwm);
+        }
+        else if (next == WATCHDOG_SURFACE)
+        {
+            for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+            {
+                if (wd_config.surface_channel_mask & (1u << ch))
+                    thruster_owner_set_pwm(OUTPUT_OWNER_WATCHDOG, ch, wd_config.surface_pwm);
+            }
+        }
+    }
+}
+
+// 監視スレッド本体: timerfd で周期的に起床し、メインループの進行とは無関係に途絶を検知する
+static void watchdog_thread_main()
+{
+    // 可能であればリアルタイム優先度で実行する (権限がなければ通常優先度のまま)
+    struct sched_param param;
+    param.sched_priority = 10;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    while (wd_running.load())
+    {
+        uint64_t expirations = 0;
+        if (read(wd_timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            continue; // EINTR など
+        watchdog_tick(monotonic_now_ns());
+    }
+}
+
+// 設定を反映し、状態を WAITING に戻す
+static void reset_watchdog(const WatchdogConfig &config)
+{
+    wd_config = config;
+    if (wd_config.surface_enabled)
+    {
+        // 上向きの推力を出せないチャンネル (前進用など) で「浮上」させない
+        unsigned int mask = thruster_surface_channel_mask(config.surface_channel_mask);
+        if (mask == 0)
+        {
+            fprintf(stderr, "警告: 浮上に使えるチャンネルがありません (要求 0x%x, 上向きの配分 0x%x)。ウォッチドッグの浮上を無効にします。\n",
+                    config.surface_channel_mask, thruster_heave_channel_mask());
+            wd_config.surface_enabled = false;
+        }
+        wd_config.surface_channel_mask = mask;
+    }
+    wd_start_ns = monotonic_now_ns();
+    wd_state_entered_ns = wd_start_ns;
+    wd_last_feed_ns.store(0);
+    wd_state.store(WATCHDOG_WAITING);
+}
+
+bool watchdog_start(const WatchdogConfig &config)
+{
+    if (wd_running.load())
+        return true;
+
+    reset_watchdog(config);
+
+    wd_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (wd_timer_fd < 0)
+    {
+        perror("ウォッチドッグ timerfd 作成失敗");
+        return false;
+    }
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = config.period_ms / 1000;
+    spec.it_interval.tv_nsec = (config.period_ms % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(wd_timer_fd, 0, &spec, NULL) < 0)
+    {
+        perror("ウォッチドッグ timerfd 設定失敗");
+        close(wd_timer_fd);
+        wd_timer_fd = -1;
+        return false;
+    }
+
+    wd_running.store(true);
+    wd_thread = std::thread(watchdog_thread_main);
+    printf("通信ウォッチドッグ開始 (周期 %u ms, タイムアウト %u ms, 保持 %u ms, スルーレート %d us/s)\n",
+           config.period_ms, config.link_timeout_ms, config.hold_ms, config.ramp_slew_us_per_s);
+    return true;
+}
+
+void watchdog_start_manual(const WatchdogConfig &config)
+{
+    if (wd_running.load())
+        return;
+    reset_watchdog(config);
+    wd_manual.store(true);
+    wd_running.store(true);
+}
+
+void watchdog_step(uint64_t now_ns)
+{
+    if (wd_manual.load())
+        watchdog_tick(now_ns);
+}
+
+void watchdog_stop()
+{
+    if (!wd_running.load())
+        return;
+    if (wd_manual.exchange(false))
+    {
+        wd_running.store(false);
+        thruster_release_output(OUTPUT_OWNER_WATCHDOG);
+        return;
+    }
+    wd_running.store(false);
+    if (wd_thread.joinable())
+        wd_thread.join(); // timerfd の次の満了 (最大 period_ms) で抜ける
+    close(wd_timer_fd);
+    wd_timer_fd = -1;
+    thruster_release_output(OUTPUT_OWNER_WATCHDOG);
+}
+
+void watchdog_feed()
+{
+    watchdog_feed_at(monotonic_now_ns());
+}
+
+void watchdog_feed_at(uint64_t command_ns)
+{
+    uint64_t now_ns = monotonic_now_ns();
+    if (command_ns > now_ns)
+        command_ns = now_ns;
+    uint64_t last_ns = wd_last_feed_ns.load();
+    while (command_ns > last_ns && !wd_last_feed_ns.compare_exchange_weak(last_ns, command_ns))
+    {
+    }
+}
+
+void watchdog_restore_feed(uint64_t last_feed_ns)
+{
+    if (last_feed_ns != 0 && last_feed_ns <= monotonic_now_ns())
+        wd_last_feed_ns.store(last_feed_ns);
+}
+
+WatchdogState watchdog_state()
+{
+    return static_cast<WatchdogState>(wd_state.load());
+}
+
+bool watchdog_control_allowed()
+{
+    return watchdog_state() == WATCHDOG_NORMAL;
+}
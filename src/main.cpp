@@ -4,165 +4,694 @@
 #include "thruster_control.h" // スラスター制御関連
 #include "sensor_data.h"      // センサーデータ読み取り・フォーマット関連
 #include "gstPipeline.h"      // GStreamerパイプライン起動用
+#include "command_arbiter.h"  // 複数送信元の操縦コマンド調停
+#include "link_watchdog.h"    // 通信途絶の監視と段階的フェイルセーフ
+#include "monotonic_clock.h"  // CLOCK_MONOTONIC による時刻取得
+#include "telemetry.h"        // テレメトリの差分送信スケジューラ
+#include "startup_metrics.h"  // 起動時間 (最初の制御周期・最初の映像フレームまで) の計測
+#include "attitude_estimator.h" // 姿勢推定 (相補フィルタ)
+#include "state_bus.h"        // 同一機体上の他プロセスとの共有メモリ状態バス
+#include "setpoint_controller.h" // 目標値コマンドの方位・深度制御
+#include "jitter_buffer.h"    // 短い通信の途切れの間の操縦コマンドの補完
+#include "leak_monitor.h"     // 浸水の高レート監視と保護動作
+#include "runtime_state.h"    // 再起動をまたいで引き継ぐ実行時状態 (共有メモリ)
+#include "supervisor.h"       // 制御・映像プロセスの監視と高速な再起動
+#include "bus_manager.h"      // センサー・PWM のバスアクセスを専用スレッドにまとめる
+#include "idle_mode.h"        // 操縦者がいない間の低消費電力のアイドルモード
 
 #include <iostream> // 標準入出力 (std::cout, std::cerr)
 #include <unistd.h> // POSIX API (usleep)
 #include <string.h> // 文字列操作 (strlen)
-#include <sys/time.h> // gettimeofday を使用するため
+#include <errno.h>  // errno, EAGAIN を使用するため
+#include <signal.h> // SIGINT, SIGTERM で終了処理を行うため
+#include <poll.h>   // アイドル中に受信ソケットを待つため
 
 // --- 定数 ---
-const double CONNECTION_TIMEOUT_SECONDS = 0.2; // 接続タイムアウトまでの秒数 (0.2秒)
+const double CONNECTION_TIMEOUT_SECONDS = 0.2; // 接続タイムアウトまでの秒数 (0.2秒)。送信元ごとの鮮度判定に使用
+const int MAX_PACKETS_PER_TICK = 32;           // 1周期で読み出す受信パケットの上限 (複数送信元からのパケットを溜めないため)
+const uint32_t TELEMETRY_BUDGET_BYTES_PER_S = 4000;  // テレメトリの送信帯域上限 (バイト/秒)
+const uint32_t TELEMETRY_KEYFRAME_INTERVAL_MS = 1000; // 全フィールドを含むキーフレームの送信間隔 (ミリ秒)
+const JitterPolicy COMMAND_JITTER_POLICY = JITTER_POLICY_EXTRAPOLATE; // 短い途切れの間の操縦コマンドの補い方 (HOLD で従来の動作)
+const uint64_t LINK_STATS_LOG_INTERVAL_MS = 10000;    // リンク品質 (ジッタバッファ・FEC) の統計をログに出す間隔 (ミリ秒)
+const bool TELEMETRY_FEC_ENABLED = false;             // テレメトリを FEC フレームで送るか (地上局が復号に対応している場合のみ true)
+const char *const TELEMETRY_MULTICAST_GROUP = NULL;   // テレメトリのマルチキャスト送信先グループ (例: "239.0.0.1")。NULL なら購読者ごとにユニキャスト送信する
+const int TELEMETRY_MULTICAST_PORT = DEFAULT_SEND_PORT; // マルチキャスト送信先のポート
+const int TELEMETRY_MULTICAST_TTL = 1;                // マルチキャストの TTL (1 でテザーのセグメント内に限る)
+const useconds_t VIDEO_PROCESS_POLL_US = 50000;       // 映像プロセスが録画の要求を確認する間隔 (マイクロ秒)
+const uint64_t BUS_STATS_LOG_INTERVAL_MS = 10000;     // バス管理の統計 (デバイスごとの処理時間) をログに出す間隔 (ミリ秒)
+const uint64_t POWER_STATS_LOG_INTERVAL_MS = 60000;   // 電力状態ごとの CPU 時間・起床回数をログに出す間隔 (ミリ秒。状態が変わったときも出す)
 
+// SIGINT / SIGTERM を受けたら、メインループを抜けてスラスターを停止してから終了する
+static volatile sig_atomic_t stop_requested = 0;
 
-// --- メイン関数 ---
-int main()
+static void handle_stop_signal(int)
+{
+    stop_requested = 1;
+}
+
+static void install_stop_handlers()
+{
+    signal(SIGINT, handle_stop_signal);
+    signal(SIGTERM, handle_stop_signal);
+}
+
+// 再起動に備えて、制御ループの状態を共有メモリに保存する (毎周期)
+static void save_runtime_state(RuntimeState *runtime_state, uint32_t tick, uint64_t last_command_ns,
+                               const CommandArbiter &arbiter, const NetworkContext &net_ctx,
+                               const TelemetryScheduler &telemetry, const SetpointController &setpoint_ctrl,
+                               const AttitudeEstimator &attitude)
+{
+    if (!runtime_state->layout)
+        return;
+    RuntimeSnapshot snapshot;
+    snapshot.saved_ns = monotonic_now_ns();
+    snapshot.tick = tick;
+    int outputs[NUM_THRUSTERS];
+    thruster_get_outputs(outputs);
+    for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+    {
+        snapshot.thruster_pwm[ch] = outputs[ch];
+    }
+    snapshot.led_pwm = thruster_get_led_pwm();
+    snapshot.last_command_ns = last_command_ns;
+    snapshot.arbiter = arbiter;
+    for (int i = 0; i < MAX_TELEMETRY_SUBSCRIBERS; ++i)
+    {
+        snapshot.subscribers[i] = net_ctx.subscribers[i];
+    }
+    snapshot.client_addr_send = net_ctx.client_addr_send;
+    snapshot.client_addr_known = net_ctx.client_addr_known;
+    snapshot.telemetry_seq = telemetry.seq;
+    snapshot.surface_valid = setpoint_ctrl.surface_valid;
+    snapshot.surface_pressure = setpoint_ctrl.surface_pressure;
+    snapshot.attitude = attitude;
+    runtime_state_save(runtime_state, snapshot);
+}
+
+// ウォーム再起動時に、スラスター出力とウォッチドッグ以外の状態を復元する
+static void restore_runtime_state(const RuntimeSnapshot &snapshot, CommandArbiter *arbiter, NetworkContext *net_ctx,
+                                  TelemetryScheduler *telemetry, SetpointController *setpoint_ctrl,
+                                  AttitudeEstimator *attitude)
+{
+    uint32_t freshness_timeout_ms = arbiter->freshness_timeout_ms;
+    *arbiter = snapshot.arbiter; // 送信元ごとのシーケンス番号を引き継ぎ、再起動前より古いパケットを受け付けない
+    arbiter->freshness_timeout_ms = freshness_timeout_ms;
+    for (int i = 0; i < MAX_TELEMETRY_SUBSCRIBERS; ++i)
+    {
+        net_ctx->subscribers[i] = snapshot.subscribers[i];
+    }
+    net_ctx->client_addr_send = snapshot.client_addr_send;
+    net_ctx->client_addr_known = snapshot.client_addr_known;
+    telemetry->seq = snapshot.telemetry_seq;
+    setpoint_ctrl->surface_valid = snapshot.surface_valid; // 水中で再起動しても深度の基準を変えない
+    setpoint_ctrl->surface_pressure = snapshot.surface_pressure;
+    *attitude = snapshot.attitude;
+}
+
+// Xボタンによるオンボード録画の切り替え
+// 映像を別プロセスで動かしている場合は共有メモリで要求を渡し、映像プロセスが反映する
+static void toggle_recording(bool video_in_separate_process, RuntimeState *runtime_state)
+{
+    if (!video_in_separate_process)
+    {
+        set_gstreamer_recording(!is_gstreamer_recording());
+    }
+    else if (runtime_state->layout)
+    {
+        bool recording = runtime_state->layout->recording_active.load() != 0;
+        runtime_state->layout->recording_requested.store(recording ? 0 : 1);
+    }
+}
+
+// アイドル中は映像パイプラインを READY に落とす (映像を別プロセスで動かしている場合は共有メモリで要求を渡す)
+static void set_video_idle(bool idle, bool video_in_separate_process, RuntimeState *runtime_state)
+{
+    if (!video_in_separate_process)
+    {
+        set_gstreamer_idle(idle);
+    }
+    else if (runtime_state->layout)
+    {
+        runtime_state->layout->video_idle_requested.store(idle ? 1 : 0);
+    }
+}
+
+// 電力状態ごとの累計をログに出す
+static void log_power_stats(const IdleController &idle, uint64_t now_ms)
 {
+    PowerUsage usage;
+    char power_log[256];
+    if (power_usage_sample(&usage) && format_power_stats(&idle, now_ms, usage, power_log, sizeof(power_log)))
+    {
+        printf("%s\n", power_log);
+    }
+}
+
+// 次の周期まで待つ
+// アイドル中は受信ソケットを poll で待ち、操縦パケットが届いたらすぐに戻る (周期の途中でも通常の周期に戻れるように)
+static void wait_for_next_tick(const IdleController &idle, const NetworkContext &net_ctx)
+{
+    uint32_t period_ms = idle_loop_period_ms(&idle);
+    if (idle.state != POWER_STATE_IDLE)
+    {
+        usleep(period_ms * 1000);
+        return;
+    }
+    struct pollfd pfd;
+    pfd.fd = net_ctx.recv_socket;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    poll(&pfd, 1, static_cast<int>(period_ms)); // タイムアウト・EINTR はどちらも次の周期に進むだけ
+}
+
+// --- 制御プロセス ---
+// video_in_separate_process: true の場合 (監視モード) は映像パイプラインを起動せず、録画の切り替えは映像プロセスに任せる
+static int run_control(bool video_in_separate_process)
+{
+    startup_metrics_begin(); // 起動時間計測の基準時刻
+    install_stop_handlers();
     printf("Navigator C++ Control Application\n");
 
+    // 直前に異常終了した制御プロセスの状態があれば引き継ぐ (ウォーム再起動)
+    RuntimeState runtime_state;
+    if (!runtime_state_open(&runtime_state, RUNTIME_STATE_DEFAULT_NAME))
+    {
+        std::cerr << "実行時状態の共有メモリを開けませんでした。再起動時の状態の引き継ぎなしで続行します..." << std::endl;
+    }
+    RuntimeSnapshot restored;
+    bool warm_start = runtime_state_load(&runtime_state, monotonic_now_ns(), RUNTIME_STATE_MAX_AGE_MS, &restored);
+    if (warm_start)
+    {
+        printf("ウォーム再起動: %.1f ms 前に保存した状態から制御を再開します。\n",
+               (monotonic_now_ns() - restored.saved_ns) / 1e6);
+    }
+
     // --- 初期化 ---
     printf("Initiating navigator module.\n");
     init(); // Navigator ハードウェアライブラリの初期化 (bindings.h 経由)
 
+    // バス管理の起動 (以降のセンサーの読み取りと PWM の書き込みはすべてバススレッドが行う)
+    // 起動できなくても、各スレッドから直接アクセスする従来の方式で続行する
+    if (!bus_manager_start(BusManagerConfig()))
+    {
+        std::cerr << "バス管理の起動に失敗しました。直接アクセスで続行します..." << std::endl;
+    }
+
     // ネットワークコンテキストの初期化
     NetworkContext net_ctx;
     if (!network_init(&net_ctx, DEFAULT_RECV_PORT, DEFAULT_SEND_PORT))
     {
         std::cerr << "ネットワーク初期化失敗。終了します。" << std::endl;
+        bus_manager_stop();
         return -1;
     }
 
-    // スラスター制御の初期化
-    if (!thruster_init())
+    // スラスター制御の初期化 (ウォーム再起動時は PWM_STOP に戻さず、最後の出力を復元する)
+    bool thrusters_ready;
+    if (warm_start)
+    {
+        int restored_pwm[NUM_THRUSTERS];
+        for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+        {
+            restored_pwm[ch] = restored.thruster_pwm[ch];
+        }
+        thrusters_ready = thruster_restore_outputs(restored_pwm, restored.led_pwm);
+    }
+    else
+    {
+        thrusters_ready = thruster_init();
+    }
+    if (!thrusters_ready)
     {
         std::cerr << "スラスター初期化失敗。終了します。" << std::endl;
         network_close(&net_ctx); // ネットワークリソースを解放
+        bus_manager_stop();
         return -1;
     }
 
-    // GStreamerパイプラインの起動
-    if (!start_gstreamer_pipelines())
+    // 通信ウォッチドッグの起動 (メインループとは独立したスレッドで途絶を監視する)
+    WatchdogConfig watchdog_config;
+    watchdog_config.link_timeout_ms = static_cast<uint32_t>(CONNECTION_TIMEOUT_SECONDS * 1000.0);
+    if (!watchdog_start(watchdog_config))
     {
-        std::cerr << "GStreamerパイプラインの起動に失敗しました。処理を続行します..." << std::endl;
-        // パイプライン起動失敗は致命的ではないかもしれないので、ここでは続行
+        std::cerr << "ウォッチドッグの起動に失敗しました。終了します。" << std::endl;
+        thruster_disable();
+        network_close(&net_ctx);
+        bus_manager_stop();
+        return -1;
+    }
+    if (warm_start)
+    {
+        // 操縦コマンドが途絶えたままなら、復元した出力から通常どおり段階的なフェイルセーフに進む
+        watchdog_restore_feed(restored.last_command_ns);
+    }
+
+    // テレメトリの前方誤り訂正 (受信した FEC フレームは設定に関係なく自動で復号される)
+    if (TELEMETRY_FEC_ENABLED)
+    {
+        network_enable_fec(&net_ctx, FecConfig()); // 既定: 4件ごとにパリティ、直前1件の冗長コピー
+    }
+
+    // 観測用PCが多い場合のテレメトリのマルチキャスト送信 (購読者ごとのレート指定は適用されない)
+    if (TELEMETRY_MULTICAST_GROUP &&
+        !network_enable_multicast(&net_ctx, TELEMETRY_MULTICAST_GROUP, TELEMETRY_MULTICAST_PORT, TELEMETRY_MULTICAST_TTL))
+    {
+        std::cerr << "マルチキャストを有効にできませんでした。購読者ごとのユニキャスト送信を続けます。" << std::endl;
+    }
+
+    // 浸水監視の起動 (通信の状態とは独立したスレッドでリークセンサーを読み、検知したら直ちに保護動作を行う)
+    LeakMonitorConfig leak_config; // 既定: 5ms 周期、2回連続で確定、全スラスター停止 + LED点滅
+    if (!leak_monitor_start(leak_config))
+    {
+        std::cerr << "浸水監視の起動に失敗しました。終了します。" << std::endl;
+        watchdog_stop();
+        thruster_disable();
+        network_close(&net_ctx);
+        bus_manager_stop();
+        return -1;
     }
 
+    // 共有メモリ状態バスの作成 (失敗しても UDP による操縦は可能なので続行)
+    // ウォーム再起動時は既存のものを引き継ぎ、接続中の外部プロセスがそのまま読み続けられるようにする
+    StateBus state_bus;
+    bool state_bus_ready = warm_start ? state_bus_resume(&state_bus, STATE_BUS_DEFAULT_NAME)
+                                      : state_bus_create(&state_bus, STATE_BUS_DEFAULT_NAME);
+    if (!state_bus_ready)
+    {
+        std::cerr << "状態バスの作成に失敗しました。共有メモリなしで続行します..." << std::endl;
+    }
+
+    // GStreamerパイプラインは最初の制御周期が完了してから起動する (カメラの状態に関係なく、すぐに操縦可能にするため)
     // --- メインループ ---
     GamepadData latest_gamepad_data;                 // 最後に受信した有効なゲームパッドデータを保持
     char recv_buffer[NET_BUFFER_SIZE];               // UDP受信バッファ
-    AxisData current_gyro_data = {0.0f, 0.0f, 0.0f}; // 最新のジャイロデータを保持
+    SensorData sensor_cache;                         // 最新のセンサー値のキャッシュ
     char sensor_buffer[SENSOR_BUFFER_SIZE];          // センサーデータ送信用文字列バッファ
-    unsigned int loop_counter = 0;                   // センサーデータ送信間隔制御用カウンター
-    const unsigned int SENSOR_SEND_INTERVAL = 10;    // センサーデータを送信するループ間隔 (100Hzループで10回 -> 10Hz)
+    unsigned int loop_counter = 0;                   // 低速センサー読み取り間隔制御用カウンター
+    const unsigned int SLOW_SENSOR_INTERVAL = 10;    // 低速センサーを読み取るループ間隔 (100Hzループで10回 -> 10Hz)
+    TelemetryScheduler telemetry;                    // テレメトリ送信スケジューラ (差分送信・帯域制限)
+    telemetry_init(&telemetry, TELEMETRY_BUDGET_BYTES_PER_S, TELEMETRY_KEYFRAME_INTERVAL_MS);
     bool running = true;                             // メインループの実行フラグ
+    bool x_button_previously_pressed = false;        // 録画切り替え (Xボタン) の前回の押下状態
+    LeakClearGesture leak_clear_gesture;             // 浸水検知のラッチ解除 (Back+Start 長押し) の判定状態
+    CommandArbiter arbiter;                          // 複数の操縦コマンド送信元の調停器
+    arbiter_init(&arbiter, static_cast<uint32_t>(CONNECTION_TIMEOUT_SECONDS * 1000.0));
+    arbiter.depth_hold_supported = thruster_heave_channel_mask() != 0; // 上下方向のスラスターがなければ深度の目標値を受け付けない
+    int active_source = ARBITER_NO_SOURCE;           // 現在操縦権を持つ送信元ID (テレメトリで報告)
+    JitterConfig jitter_config;                      // 操縦コマンドのジッタバッファ (途切れ判定・外挿時間などは既定値)
+    jitter_config.policy = COMMAND_JITTER_POLICY;
+    jitter_config.deadline_ms = watchdog_config.link_timeout_ms; // ウォッチドッグの途絶判定までにニュートラルへ戻す
+    JitterBuffer jitter;
+    jitter_init(&jitter, jitter_config);
+    uint64_t last_link_log_ms = 0;                   // リンク品質の統計を最後にログに出した時刻
+    uint32_t last_logged_gaps = 0;                   // 最後にログに出したときの途切れの回数 (新しい途切れがあったときだけ出す)
+    uint32_t last_logged_fec_frames = 0;             // 最後にログに出したときの FEC データフレーム数
+    uint64_t last_bus_log_ms = monotonic_now_ms();   // バス管理の統計を最後にログに出した時刻
+    AttitudeEstimator attitude;                      // 姿勢推定 (状態バスで公開)
+    attitude_init(&attitude, ATTITUDE_DEFAULT_ACCEL_WEIGHT, ATTITUDE_DEFAULT_MAG_WEIGHT);
+    SetpointController setpoint_ctrl;                // 目標値コマンド用の方位・深度制御ループ
+    setpoint_init(&setpoint_ctrl, SetpointGains());
+    uint64_t last_tick_ns = 0;                       // 前回の周期の時刻 (姿勢推定の積分用)
+    uint32_t tick = 0;                               // 制御周期の通し番号
+    uint64_t last_command_ns = 0;                    // 最後に受理した操縦コマンドの時刻 (再起動時にウォッチドッグへ引き継ぐ)
+    if (warm_start)
+    {
+        restore_runtime_state(restored, &arbiter, &net_ctx, &telemetry, &setpoint_ctrl, &attitude);
+        tick = restored.tick + 1;
+        last_command_ns = restored.last_command_ns;
+    }
 
+    IdleController idle;                             // 低消費電力のアイドルモード (操縦者なし・停止・静止が続いたら周期を下げる)
+    PowerUsage power_usage;                          // プロセスの資源使用量 (電力状態ごとの CPU 時間・起床回数の集計用)
+    power_usage_sample(&power_usage);
+    idle_init(&idle, IdleConfig(), monotonic_now_ms(), power_usage);
+    uint64_t last_power_log_ms = monotonic_now_ms(); // 電力状態の統計を最後にログに出した時刻
     bool currently_in_failsafe = true; // 初期状態はフェイルセーフ (最初の接続を待つ)
+    bool video_started = false;        // 映像パイプラインの起動を開始したか
 
     std::cout << "メインループ開始。Startボタンで終了。" << std::endl;
-    std::cout << "クライアントからの最初のデータ受信を待機しています... (スラスターはPWM: " << PWM_MIN << ")" << std::endl;
-    thruster_set_all_pwm(PWM_MIN); // プログラム開始時にスラスターを安全な状態に設定
+    if (!warm_start)
+    {
+        std::cout << "クライアントからの最初のデータ受信を待機しています... (スラスターはPWM: " << PWM_STOP << ")" << std::endl;
+        thruster_set_all_pwm(PWM_STOP); // プログラム開始時にスラスターを安全な状態に設定
+    }
 
-    // running フラグが true の間、ループを継続
-    while (running)
+    // running フラグが true の間 (終了シグナルを受けるまで)、ループを継続
+    while (running && !stop_requested)
     {
-        struct timeval current_time_tv;
-        gettimeofday(&current_time_tv, NULL);
+        uint64_t now_ms = monotonic_now_ms();
 
-        // 1. ネットワーク接続状態チェック (最後にパケットを受信してからの時間)
-        double time_since_last_packet = 0.0;
-        // net_ctx.client_addr_known は、network_receive内で最初の有効なパケット受信時にtrueになる
-        if (net_ctx.client_addr_known)
+        // 1. コマンド受信: この周期までに届いたパケットをすべて読み出し、送信元ごとに調停器へ渡す
+        //    (購読メッセージは network_receive 内で処理され 0 が返る)
+        for (int i = 0; i < MAX_PACKETS_PER_TICK; ++i)
+        {
+            ssize_t recv_len = network_receive(&net_ctx, recv_buffer, sizeof(recv_buffer));
+            if (recv_len < 0)
+            {
+                // recv_len < 0 かつ EAGAIN/EWOULDBLOCK 以外の場合は受信エラー
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    std::cerr << "致命的な受信エラー。ループを継続します..." << std::endl;
+                }
+                break; // 受信キューが空
+            }
+            if (recv_len == 0)
+            {
+                continue; // 購読メッセージなど、操縦データ以外のパケット
+            }
+            std::string received_str(recv_buffer, recv_len); // 受信した長さで文字列を作成
+            CommandPacket packet = parseCommandPacket(received_str); // パースして調停器へ
+            packet.has_sender = true; // 送信元IDを送信元アドレスに結び付けるため
+            packet.sender = net_ctx.client_addr_recv;
+            arbiter_submit(&arbiter, packet, now_ms);
+            // std::cout << "受信: " << received_str << std::endl; // Debug
+        }
+        // 同一機体上のプロセスから共有メモリ経由で届いたコマンドも同じ調停器に渡す
+        StateBusCommand bus_command;
+        for (int i = 0; i < MAX_PACKETS_PER_TICK && state_bus_pop_command(&state_bus, &bus_command); ++i)
         {
-            time_since_last_packet = (current_time_tv.tv_sec - net_ctx.last_successful_recv_time.tv_sec) +
-                                     (current_time_tv.tv_usec - net_ctx.last_successful_recv_time.tv_usec) / 1000000.0;
+            arbiter_submit(&arbiter, state_bus_command_to_packet(bus_command), now_ms);
         }
 
-        // 2. ゲームパッドデータ受信 (network_receive は net_ctx.last_successful_recv_time を更新)
-        ssize_t recv_len = network_receive(&net_ctx, recv_buffer, sizeof(recv_buffer));
-        bool just_received_packet = (recv_len > 0);
+        // 2. アクティブな送信元の選択 (鮮度内の送信元があればウォッチドッグに生存を通知)
+        active_source = arbiter_select(&arbiter, now_ms);
+        if (active_source != ARBITER_NO_SOURCE)
+        {
+            // 最後に受理したパケットの時刻を、ウォッチドッグの途絶判定とジッタバッファの減衰の共通の起点にする
+            // (現在時刻で feed すると鮮度判定の分だけフェイルセーフが遅れ、その間はジッタバッファの補い方も効かない)
+            last_command_ns = arbiter_active_feed_ms(&arbiter) * 1000000ULL;
+            watchdog_feed_at(last_command_ns);
+            // 受信したコマンドを受理時刻付きで履歴に積み、短い途切れの間はジッタバッファの方式で補う
+            jitter_push(&jitter, active_source, arbiter_active_command(&arbiter), arbiter_active_update_ms(&arbiter));
+            latest_gamepad_data = jitter_sample(&jitter, now_ms);
 
+            // Xボタンが押された瞬間 (立ち上がりエッジ) にオンボード録画の開始/停止を切り替える
+            bool x_button_currently_pressed = (latest_gamepad_data.buttons & GamepadButton::X);
+            if (x_button_currently_pressed && !x_button_previously_pressed)
+            {
+                toggle_recording(video_in_separate_process, &runtime_state);
+            }
+            x_button_previously_pressed = x_button_currently_pressed;
 
-        if (just_received_packet)
-        {
-            if (currently_in_failsafe) // フェイルセーフ状態からの復帰
+            // Back+Start の長押しで浸水検知のラッチを解除する (センサーが反応し続けていれば再び検知される)
+            if (leak_clear_gesture_update(&leak_clear_gesture, latest_gamepad_data.buttons, now_ms) && leak_monitor_leak_detected())
             {
-                std::cout << "接続確立/再確立。通常動作を再開します。" << std::endl;
-                currently_in_failsafe = false;
-                // 必要であれば、ここで thruster_init() を呼び出すなど復帰処理を追加
+                leak_monitor_clear();
+                printf("[LEAK] 操縦者の操作 (Back+Start 長押し) で浸水検知の解除を要求しました。\n");
             }
-            std::string received_str(recv_buffer, recv_len); // 受信した長さで文字列を作成
+        }
+        else
+        {
+            jitter_reset(&jitter); // 操縦者がいなくなったら (途絶の判定時間を過ぎたら) 古い履歴で補わない
+        }
 
-            latest_gamepad_data = parseGamepadData(received_str); // 受信文字列をパース
-            // std::cout << "受信: " << received_str << std::endl; // Debug
+        // 電力状態の更新: 操縦者なし・スラスター停止・静止が続いたらアイドルに移行し、操縦者が現れたらこの周期から通常に戻る
+        {
+            int outputs[NUM_THRUSTERS];
+            thruster_get_outputs(outputs);
+            bool outputs_stopped = true;
+            for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+            {
+                outputs_stopped = outputs_stopped && outputs[ch] == PWM_STOP;
+            }
+            power_usage_sample(&power_usage);
+            if (idle_update(&idle, active_source != ARBITER_NO_SOURCE, outputs_stopped, sensor_cache.gyro, now_ms, power_usage))
+            {
+                bool entering_idle = idle.state == POWER_STATE_IDLE;
+                bus_manager_set_idle(entering_idle); // 通常に戻るときは IMU をすぐに読み直す
+                set_video_idle(entering_idle, video_in_separate_process, &runtime_state);
+                if (entering_idle)
+                    printf("[POWER] 操縦者なし・停止・静止が %u ms 続いたため、アイドル (%u ms 周期) に移行します。\n",
+                           idle.config.enter_after_ms, idle.config.idle_period_ms);
+                else
+                    printf("[POWER] 通常の周期 (%u ms) に戻ります。\n", idle.config.active_period_ms);
+                log_power_stats(idle, now_ms);
+                last_power_log_ms = now_ms;
+            }
+            else if (now_ms - last_power_log_ms >= POWER_STATS_LOG_INTERVAL_MS)
+            {
+                log_power_stats(idle, now_ms);
+                last_power_log_ms = now_ms;
+            }
         }
-        else // 今回のループではパケット受信なし
+
+        // リンク品質の統計 (ジッタバッファ・FEC) は変化があったときだけ、最大 LINK_STATS_LOG_INTERVAL_MS に1回ログに出す
+        if (now_ms - last_link_log_ms >= LINK_STATS_LOG_INTERVAL_MS)
         {
-            // 接続が一度確立された後でタイムアウトした場合
-            if (net_ctx.client_addr_known && time_since_last_packet > CONNECTION_TIMEOUT_SECONDS)
+            const JitterStats &js = jitter.stats;
+            FecStats fec_stats;
+            network_fec_stats(&net_ctx, &fec_stats);
+            if (js.gaps != last_logged_gaps)
             {
-                if (!currently_in_failsafe)
-                {
-                    std::cout << "接続がタイムアウトしました。フェイルセーフモード (スラスターPWM: " << PWM_MIN << ") に移行します。" << std::endl;
-                    thruster_set_all_pwm(PWM_MIN);
-                    latest_gamepad_data = GamepadData{}; // 古いコマンドをクリア
-                    currently_in_failsafe = true;
-                }
+                printf("[JITTER] policy=%s gaps=%u max_gap=%ums fresh=%u held=%u extrapolated=%u decayed=%u interpolated=%u underruns=%u\n",
+                       jitter_policy_name(jitter.config.policy), js.gaps, js.max_gap_ms, js.fresh, js.held,
+                       js.extrapolated, js.decayed, js.interpolated, js.underruns);
+                last_logged_gaps = js.gaps;
+                last_link_log_ms = now_ms;
             }
-            // recv_len < 0 かつ EAGAIN/EWOULDBLOCK 以外の場合は受信エラー
-            if (recv_len < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            if (fec_stats.data_frames != last_logged_fec_frames)
             {
-                std::cerr << "致命的な受信エラー。ループを継続します..." << std::endl;
+                printf("[FEC] raw_loss=%.1f%% effective_loss=%.1f%% recovered_redundant=%u recovered_parity=%u malformed=%u resyncs=%u\n",
+                       fec_raw_loss_rate(fec_stats) * 100.0f, fec_effective_loss_rate(fec_stats) * 100.0f,
+                       fec_stats.recovered_redundant, fec_stats.recovered_parity, fec_stats.malformed, fec_stats.resyncs);
+                last_logged_fec_frames = fec_stats.data_frames;
+                last_link_log_ms = now_ms;
             }
         }
 
-        // 3. 制御ロジック (フェイルセーフ中でない場合のみ実行)
-        if (!currently_in_failsafe)
+        // バス管理の統計 (デバイスごとの平均/最大の処理時間・後回しにした回数) を BUS_STATS_LOG_INTERVAL_MS に1回ログに出す
+        if (bus_manager_running() && now_ms - last_bus_log_ms >= BUS_STATS_LOG_INTERVAL_MS)
+        {
+            char bus_log[768];
+            if (format_bus_stats(bus_manager_stats(), bus_log, sizeof(bus_log)))
+            {
+                printf("%s\n", bus_log);
+            }
+            last_bus_log_ms = now_ms;
+        }
+
+        // フェイルセーフの判定と出力 (保持・ランプダウン・停止) は独立したウォッチドッグスレッドが行う。
+        // メインループはウォッチドッグが NORMAL のときだけ通常制御を行う。
+        bool control_allowed = watchdog_control_allowed();
+        if (control_allowed && currently_in_failsafe) // フェイルセーフ状態からの復帰
+        {
+            std::cout << "接続確立/再確立 (送信元 " << active_source << ")。通常動作を再開します。" << std::endl;
+            currently_in_failsafe = false;
+        }
+        else if (!control_allowed && !currently_in_failsafe)
+        {
+            std::cout << "接続がタイムアウトしました。フェイルセーフ (" << watchdog_state_name(watchdog_state()) << ") に移行します。" << std::endl;
+            latest_gamepad_data = GamepadData{}; // 古いコマンドをクリア
+            currently_in_failsafe = true;
+        }
+
+        // 3. センサー読み取りと姿勢推定 (状態バスの読み手のため、フェイルセーフ中も毎周期行う)
+        //    IMU は毎周期、温度・圧力・リーク・ADC は SLOW_SENSOR_INTERVAL 周期ごとにキャッシュを更新 (アイドル中は周期が延びる分だけ間隔も延びる)
+        sensor_read_fast(&sensor_cache);
+        if (loop_counter >= SLOW_SENSOR_INTERVAL)
         {
-            current_gyro_data = read_gyro();
-            thruster_update(latest_gamepad_data, current_gyro_data);
+            loop_counter = 0; // カウンターリセット
+            sensor_read_slow(&sensor_cache);
+            // 浸水を確定している間はセンサーの瞬時値に関係なくテレメトリで報告し続ける
+            sensor_cache.leak = sensor_cache.leak || leak_monitor_leak_detected();
+            // 浸水警報の送信先をテレメトリの送信先に合わせる (警報は監視スレッドが自前のソケットで送る)
+            struct sockaddr_in alert_targets[LEAK_MAX_ALERT_TARGETS];
+            leak_monitor_set_alert_targets(alert_targets,
+                                           network_get_telemetry_targets(&net_ctx, alert_targets, LEAK_MAX_ALERT_TARGETS));
+        }
+        else
+        {
+            loop_counter++; // カウンターインクリメント
+        }
+        uint64_t tick_ns = monotonic_now_ns();
+        float dt_s = last_tick_ns ? static_cast<float>(tick_ns - last_tick_ns) / 1e9f : 0.0f;
+        last_tick_ns = tick_ns;
+        attitude_update(&attitude, sensor_cache.accel, sensor_cache.gyro, sensor_cache.mag, dt_s);
+        setpoint_update_depth(&setpoint_ctrl, sensor_cache.pressure, dt_s);
 
-            // センサーデータ処理 (読み取り、フォーマット、送信) - 一定間隔で実行
-            if (loop_counter >= SENSOR_SEND_INTERVAL)
+        // 4. 制御ロジック (フェイルセーフ中でない場合のみ実行)
+        if (!currently_in_failsafe)
+        {
+            ThrustAllocation allocation; // 推力配分の結果 (飽和で縮小した軸)
+            SetpointCommand setpoint;
+            if (arbiter_active_setpoint(&arbiter, &setpoint))
             {
-                std::cout << "[SENSOR LOG] " << sensor_buffer << std::endl; // ログは送信時のみ表示
+                // 目標値コマンド: 方位・深度のループを機体上で閉じ、推力配分表でPWMに変換する
+                BodyThrust demand = setpoint_update(&setpoint_ctrl, setpoint, attitude.attitude, sensor_cache.gyro, dt_s);
+                int pwm[NUM_THRUSTERS];
+                thruster_mix(demand, pwm, &allocation);
+                thruster_apply_pwm(pwm);
+            }
+            else
+            {
+                setpoint_reset(&setpoint_ctrl); // 目標値制御に戻ったときに古い積分値を使わない
+                thruster_update(latest_gamepad_data, sensor_cache.gyro, &allocation);
+            }
+            // 要求がスラスターの上限を超えて縮小した軸があれば、テレメトリで操縦権限の低下として報告する
+            telemetry_set_authority(&telemetry, allocation.min_authority, allocation.saturated_axes);
 
-                loop_counter = 0; // カウンターリセット
-                if (read_and_format_sensor_data(sensor_buffer, sizeof(sensor_buffer)))
+            // テレメトリ: 変化したフィールドだけを差分フレームで送信 (定期的に全フィールドのキーフレーム)
+            bool is_keyframe = false;
+            size_t frame_len = telemetry_build_frame(&telemetry, sensor_cache, active_source, now_ms,
+                                                     sensor_buffer, sizeof(sensor_buffer), &is_keyframe);
+            if (frame_len > 0)
+            {
+                // 差分フレームも変化したフィールドの値そのもの (NAME:value) なので、間引いても受信側の値が古くなるだけで再構成は誤らない。
+                // 差分フレームは購読者ごとのレートで送り、間引いた購読者の値を揃え直すキーフレームはレートに関係なく全購読者に送る
+                if (is_keyframe)
                 {
-                    std::cout << "[SENSOR LOG] " << sensor_buffer << std::endl;
-                    network_send(&net_ctx, sensor_buffer, strlen(sensor_buffer)); // フォーマットされたセンサーデータを送信
+                    std::cout << "[SENSOR LOG] " << sensor_buffer << std::endl; // ログはキーフレームのみ表示
+                    network_send_to_all(&net_ctx, sensor_buffer, frame_len);
                 }
                 else
                 {
-                    std::cerr << "センサーデータの読み取り/フォーマットに失敗。" << std::endl;
+                    network_send(&net_ctx, sensor_buffer, frame_len);
                 }
             }
-            else
-            {
-                loop_counter++; // カウンターインクリメント
-            }
         }
-        else
+        // フェイルセーフ中または最初の接続待機中は、スラスターはウォッチドッグが設定済み。
+
+        // 5. 状態バスへの公開 (他プロセスはロックなしで最新のスナップショットを読む)
+        StateSnapshot snapshot;
+        snapshot.timestamp_ns = tick_ns;
+        snapshot.tick = tick++;
+        snapshot.active_source = active_source;
+        snapshot.watchdog_state = watchdog_state();
+        snapshot.control_allowed = control_allowed ? 1 : 0;
+        snapshot.sensors = sensor_cache;
+        snapshot.attitude = attitude.attitude;
+        snapshot.depth_m = setpoint_ctrl.depth_m;
+        int outputs[NUM_THRUSTERS];
+        thruster_get_outputs(outputs);
+        for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
         {
-            // フェイルセーフ中または最初の接続待機中。スラスターは既に設定済み。
-            loop_counter = 0; // 再接続時にセンサーデータが即座に送信されるのを防ぐ
+            snapshot.thruster_pwm[ch] = outputs[ch];
         }
+        state_bus_publish(&state_bus, snapshot);
+        // 再起動に備えた状態の保存 (異常終了しても、次の制御プロセスが最大1周期前の状態から再開できる)
+        save_runtime_state(&runtime_state, snapshot.tick, last_command_ns, arbiter, net_ctx, telemetry, setpoint_ctrl, attitude);
 
-        // // 4. 終了条件チェック (データ受信時のみ Start ボタンを評価)
+        // // 6. 終了条件チェック (データ受信時のみ Start ボタンを評価)
         // if (just_received_packet && (latest_gamepad_data.buttons & GamepadButton::Start))
         // {
         //     std::cout << "Startボタン検出。終了します。" << std::endl;
         //     running = false;
         // }
 
-        // 5. ループ待機 (CPU負荷軽減とループ頻度調整)
-        usleep(10000); // 10000マイクロ秒 = 10ミリ秒待機 (約100Hzのループ周波数)
+        // 最初の制御周期が完了したら起動時間を記録し、映像パイプラインをバックグラウンドで起動する
+        // (カメラの列挙・ネゴシエーション・再試行は別スレッドで行われ、制御ループを待たせない)
+        // 監視モードでは映像は独立したプロセスで動いているため、制御プロセスの再起動で映像は途切れない
+        if (!video_started)
+        {
+            startup_metrics_mark_first_control_tick();
+            if (warm_start)
+            {
+                uint64_t restart_ns = runtime_state_mark_control_resumed(&runtime_state, restored.saved_ns, monotonic_now_ns());
+                printf("[RESTART] 制御プロセスの終了から制御再開まで %.1f ms (最大 %.1f ms, 再起動 %u 回目)\n",
+                       restart_ns / 1e6, runtime_state.layout->max_restart_to_control_ns.load() / 1e6,
+                       runtime_state.layout->restart_count.load());
+            }
+            if (!video_in_separate_process && !start_gstreamer_pipelines())
+            {
+                std::cerr << "GStreamerパイプラインの起動に失敗しました。処理を続行します..." << std::endl;
+                // パイプライン起動失敗は致命的ではないかもしれないので、ここでは続行
+            }
+            video_started = true;
+        }
+
+        // 7. ループ待機 (CPU負荷軽減とループ頻度調整)
+        wait_for_next_tick(idle, net_ctx); // 通常は10ミリ秒待機 (約100Hzのループ周波数)、アイドル中は操縦パケットが届くまで最大100ミリ秒
     }
 
     // --- クリーンアップ ---
     std::cout << "クリーンアップ処理を開始します..." << std::endl;
+    log_power_stats(idle, monotonic_now_ms());
+    leak_monitor_stop();     // 浸水監視スレッドを停止
+    watchdog_stop();         // ウォッチドッグスレッドを停止
+    state_bus_close(&state_bus); // 共有メモリを削除
     thruster_disable();      // スラスターへのPWM出力を停止
+    bus_manager_stop();      // バススレッドを停止 (thruster_disable の書き込みを済ませてから戻る)
     network_close(&net_ctx); // ネットワークソケットをクローズ
-    stop_gstreamer_pipelines(); // GStreamerパイプラインを停止
+    if (!video_in_separate_process)
+    {
+        stop_gstreamer_pipelines(); // GStreamerパイプラインを停止
+    }
+    runtime_state_invalidate(&runtime_state); // 正常終了したので、次回の起動はコールドスタートにする
+    runtime_state_close(&runtime_state);
     std::cout << "プログラム終了。" << std::endl;
     return 0;
 }
+
+// 監視モードの制御プロセス
+static int run_supervised_control()
+{
+    return run_control(true);
+}
+
+// --- 映像プロセス (監視モード) ---
+// 制御プロセスとは独立して映像パイプラインを動かし、制御プロセスからの録画の要求を反映する
+static int run_video_process()
+{
+    install_stop_handlers();
+    RuntimeState runtime_state;
+    if (!runtime_state_open(&runtime_state, RUNTIME_STATE_DEFAULT_NAME))
+    {
+        std::cerr << "実行時状態の共有メモリを開けませんでした。録画の切り替えなしで続行します..." << std::endl;
+    }
+    if (!start_gstreamer_pipelines())
+    {
+        std::cerr << "GStreamerパイプラインの起動に失敗しました。処理を続行します..." << std::endl;
+    }
+    bool last_requested = false; // 最後に反映した録画の要求 (要求が変わったときだけ切り替える)
+    while (!stop_requested)
+    {
+        if (runtime_state.layout)
+        {
+            bool requested = runtime_state.layout->recording_requested.load() != 0;
+            if (requested != last_requested)
+            {
+                set_gstreamer_recording(requested);
+                last_requested = requested;
+            }
+            set_gstreamer_idle(runtime_state.layout->video_idle_requested.load() != 0);
+            runtime_state.layout->recording_active.store(is_gstreamer_recording() ? 1 : 0);
+        }
+        usleep(VIDEO_PROCESS_POLL_US);
+    }
+    stop_gstreamer_pipelines();
+    runtime_state_close(&runtime_state);
+    return 0;
+}
+
+// --- メイン関数 ---
+// 引数なし: 制御と映像を1つのプロセスで動かす (従来どおり)
+// --supervise: 監視プロセスが制御プロセスと映像プロセスを起動し、異常終了したら直ちに起動し直す
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || strcmp(argv[1], "--supervise") != 0)
+    {
+        return run_control(false);
+    }
+
+    RuntimeState runtime_state;
+    if (!runtime_state_open(&runtime_state, RUNTIME_STATE_DEFAULT_NAME))
+    {
+        std::cerr << "実行時状態の共有メモリを開けませんでした。監視なしで起動します。" << std::endl;
+        return run_control(false);
+    }
+    runtime_state_invalidate(&runtime_state); // 監視プロセスの起動時は常にコールドスタート
+    runtime_state.layout->recording_requested.store(0);
+    runtime_state.layout->video_idle_requested.store(0);
+
+    SupervisedProcess processes[2];
+    processes[0].name = "制御プロセス";
+    processes[0].entry = run_supervised_control;
+    processes[0].is_control = true;
+    processes[1].name = "映像プロセス";
+    processes[1].entry = run_video_process;
+    int result = supervisor_run(SupervisorConfig(), processes, 2, &runtime_state);
+
+    runtime_state_close(&runtime_state);
+    runtime_state_unlink(RUNTIME_STATE_DEFAULT_NAME);
+    return result;
+}
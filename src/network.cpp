@@ -8,6 +8,56 @@
 #include <errno.h>
 
 #include <sys/time.h> // gettimeofday のため
+#include <sys/socket.h> // sendmmsg, struct mmsghdr のため
+
+#include "monotonic_clock.h" // 購読の期限管理 (CLOCK_MONOTONIC) のため
+
+// 2つのアドレスが同じ送信先 (IPアドレスとポート) を指しているか
+static bool same_endpoint(const struct sockaddr_in *a, const struct sockaddr_in *b)
+{
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+// 期限切れの購読者をテーブルから削除する
+static void expire_subscribers(NetworkContext *ctx, uint64_t now_ms)
+{
+    for (int i = 0; i < MAX_TELEMETRY_SUBSCRIBERS; ++i)
+    {
+        TelemetrySubscriber *sub = &ctx->subscribers[i];
+        if (sub->active && now_ms >= sub->expires_at_ms)
+        {
+            printf("テレメトリ購読の期限切れ: %s:%d\n", inet_ntoa(sub->addr.sin_addr), ntohs(sub->addr.sin_port));
+            sub->active = false;
+        }
+    }
+}
+
+// 購読の登録/解除メッセージ ("SUB,<rate_hz>[,<port>]" / "UNSUB") を処理する
+// 購読メッセージだった場合は true を返す (操縦データとしては扱わない)
+static bool handle_subscription_message(NetworkContext *ctx, const char *buffer)
+{
+    if (strncmp(buffer, "UNSUB", 5) == 0)
+    {
+        struct sockaddr_in addr = ctx->client_addr_recv;
+        addr.sin_port = ctx->client_addr_send.sin_port; // ポート指定なしの場合は既定の送信ポート
+        const char *port_str = strchr(buffer, ',');
+        if (port_str)
+            addr.sin_port = htons((uint16_t)atoi(port_str + 1));
+        network_unsubscribe(ctx, &addr);
+        return true;
+    }
+    if (strncmp(buffer, "SUB", 3) == 0)
+    {
+        int rate_hz = 0;
+        int port = ntohs(ctx->client_addr_send.sin_port);
+        sscanf(buffer, "SUB,%d,%d", &rate_hz, &port); // 省略された項目は既定値のまま
+        struct sockaddr_in addr = ctx->client_addr_recv;
+        addr.sin_port = htons((uint16_t)port);
+        network_subscribe(ctx, &addr, rate_hz);
+        return true;
+    }
+    return false;
+}
 
 // ネットワーク送受信コンテキストを初期化する関数
 bool network_init(NetworkContext *ctx, int recv_port, int send_port)
@@ -16,7 +66,7 @@ bool network_init(NetworkContext *ctx, int recv_port, int send_port)
         return false; // コンテキストポインタが無効なら失敗
 
     // コンテキスト初期化
-    memset(ctx, 0, sizeof(NetworkContext));
+    *ctx = NetworkContext(); // 値初期化 (FEC の状態を含めすべて 0 になる)
     ctx->recv_socket = -1;
     ctx->send_socket = -1;
     ctx->client_addr_len = sizeof(ctx->client_addr_recv);
@@ -71,7 +121,7 @@ bool network_init(NetworkContext *ctx, int recv_port, int send_port)
     memset(&ctx->client_addr_send, 0, sizeof(ctx->client_addr_send));
     ctx->client_addr_send.sin_family = AF_INET;
     ctx->client_addr_send.sin_port = htons(send_port); // 送信ポート番号を設定 (ネットワークバイトオーダーに変換)
-    // 送信先IPアドレスは最初の受信時に設定される
+    // 送信先IPアドレスは最初の受信時に設定される (購読者テーブルは memset で空の状態)
 
     printf("UDP送信準備完了 (送信先ポート: %d)\n", send_port);
     return true;
@@ -96,7 +146,56 @@ void network_close(NetworkContext *ctx)
     }
 }
 
+// 送信元アドレスに対応する FEC の復号状態を探し、なければ割り当てる
+static FecDecoder *fec_decoder_for(NetworkContext *ctx, const struct sockaddr_in *addr)
+{
+    uint64_t now_ms = monotonic_now_ms();
+    for (int i = 0; i < NETWORK_FEC_PEERS; ++i)
+    {
+        if (ctx->fec_rx_used[i] && same_endpoint(&ctx->fec_rx_addr[i], addr))
+        {
+            // しばらく届かなかった送信元は再起動している可能性があるため、seq を同期し直す
+            if (now_ms - ctx->fec_rx_last_ms[i] >= NETWORK_FEC_IDLE_RESYNC_MS)
+                fec_decoder_resync(&ctx->fec_rx[i]);
+            ctx->fec_rx_last_ms[i] = now_ms;
+            return &ctx->fec_rx[i];
+        }
+    }
+    int slot = -1;
+    for (int i = 0; i < NETWORK_FEC_PEERS && slot < 0; ++i)
+    {
+        if (!ctx->fec_rx_used[i])
+            slot = i;
+    }
+    if (slot < 0)
+    {
+        slot = ctx->fec_rx_next_victim;
+        ctx->fec_rx_next_victim = (ctx->fec_rx_next_victim + 1) % NETWORK_FEC_PEERS;
+    }
+    fec_decoder_init(&ctx->fec_rx[slot]);
+    ctx->fec_rx_addr[slot] = *addr;
+    ctx->fec_rx_used[slot] = true;
+    ctx->fec_rx_last_ms[slot] = now_ms;
+    return &ctx->fec_rx[slot];
+}
+
+// 受信したデータ (FEC で取り出したペイロードを含む) の共通処理
+static ssize_t handle_received_payload(NetworkContext *ctx, char *buffer, ssize_t len)
+{
+    // 購読の登録/解除メッセージは操縦データではないので、ここで処理して 0 を返す
+    if (handle_subscription_message(ctx, buffer))
+    {
+        return 0;
+    }
+    gettimeofday(&ctx->last_successful_recv_time, NULL); // 最終受信時刻を更新
+    // 操縦パケットの送信元を購読者として登録/更新 (有効期限の延長も兼ねる)
+    network_update_send_address(ctx);
+    return len;
+}
+
 // UDPデータを受信する関数 (ノンブロッキング)
+// FEC フレームは送信元ごとに復号し、取り出したペイロードを1回の呼び出しにつき1つ返す
+// (1フレームから複数のペイロードが取り出せた場合、残りは次の呼び出しでソケットを読む前に返す)
 ssize_t network_receive(NetworkContext *ctx, char *buffer, size_t buffer_size)
 {
     if (!ctx || ctx->recv_socket < 0 || !buffer || buffer_size == 0)
@@ -104,6 +203,17 @@ ssize_t network_receive(NetworkContext *ctx, char *buffer, size_t buffer_size)
         return -1; // 引数が無効ならエラー
     }
 
+    // 前回までに復号して取り出し待ちになっているペイロード
+    for (int i = 0; i < NETWORK_FEC_PEERS; ++i)
+    {
+        size_t payload_len = 0;
+        if (ctx->fec_rx_used[i] && fec_next_payload(&ctx->fec_rx[i], buffer, buffer_size, &payload_len))
+        {
+            ctx->client_addr_recv = ctx->fec_rx_addr[i];
+            return payload_len > 0 ? handle_received_payload(ctx, buffer, (ssize_t)payload_len) : 0;
+        }
+    }
+
     // 受信する前にアドレス長をリセット
     ctx->client_addr_len = sizeof(ctx->client_addr_recv);
     ssize_t recv_len = recvfrom(ctx->recv_socket, buffer, buffer_size - 1, 0,
@@ -112,12 +222,22 @@ ssize_t network_receive(NetworkContext *ctx, char *buffer, size_t buffer_size)
     if (recv_len > 0)
     {
         buffer[recv_len] = '\0'; // Null終端
-        gettimeofday(&ctx->last_successful_recv_time, NULL); // 最終受信時刻を更新
-        // 新しいクライアントか、IPが変わったかチェック
-        if (!ctx->client_addr_known || ctx->client_addr_send.sin_addr.s_addr != ctx->client_addr_recv.sin_addr.s_addr)
+        if (fec_is_frame((const uint8_t *)buffer, recv_len))
         {
-            network_update_send_address(ctx);
+            // 取り出したペイロードで buffer を上書きするため、フレームを退避してから復号する
+            uint8_t frame[FEC_MAX_FRAME];
+            size_t frame_len = (size_t)recv_len < sizeof(frame) ? (size_t)recv_len : sizeof(frame);
+            memcpy(frame, buffer, frame_len);
+            FecDecoder *dec = fec_decoder_for(ctx, &ctx->client_addr_recv);
+            fec_decode(dec, frame, frame_len);
+            size_t payload_len = 0;
+            if (!fec_next_payload(dec, buffer, buffer_size, &payload_len) || payload_len == 0)
+            {
+                return 0; // パリティのみ・受信済みの冗長コピーのみのフレーム
+            }
+            recv_len = (ssize_t)payload_len;
         }
+        return handle_received_payload(ctx, buffer, recv_len);
     }
     else if (recv_len < 0)
     {
@@ -133,43 +253,318 @@ ssize_t network_receive(NetworkContext *ctx, char *buffer, size_t buffer_size)
     return recv_len;
 }
 
-// UDPデータを送信する関数
-bool network_send(NetworkContext *ctx, const char *data, size_t data_len)
+// 送信するデータグラムを用意する。FEC が有効ならデータフレーム (+ グループが揃えばパリティフレーム) に符号化する
+// frames は FEC のフレームの格納先。データグラムの数を返す
+static int prepare_datagrams(NetworkContext *ctx, const char *data, size_t data_len,
+                             uint8_t frames[2][FEC_MAX_FRAME], struct iovec iov[2])
 {
-    if (!ctx || ctx->send_socket < 0 || !data || !ctx->client_addr_known)
+    if (ctx->fec_tx_enabled)
+    {
+        size_t frame_len[2];
+        int count = fec_encode(&ctx->fec_tx, (const uint8_t *)data, data_len, frames, frame_len);
+        for (int i = 0; i < count; ++i)
+        {
+            iov[i].iov_base = frames[i];
+            iov[i].iov_len = frame_len[i];
+        }
+        if (count > 0)
+            return count;
+        // FEC_MAX_PAYLOAD を超えるデータは保護せずにそのまま送る
+    }
+    iov[0].iov_base = (void *)data;
+    iov[0].iov_len = data_len;
+    return 1;
+}
+
+// 購読者へ送信する共通処理
+// 購読者ごとに sendto を呼ぶ代わりに sendmmsg でまとめて1回のシステムコールで送信する
+// respect_rate が true の場合は送信期限に達した購読者だけに送る
+static bool send_to_subscribers(NetworkContext *ctx, const char *data, size_t data_len, bool respect_rate)
+{
+    if (!ctx || ctx->send_socket < 0 || !data)
     {
-        // 送信先が不明な場合は送信しない
         return false;
     }
 
-    // データ送信試行
-    ssize_t sent_len = sendto(ctx->send_socket, data, data_len, 0,
-                              (const struct sockaddr *)&ctx->client_addr_send, sizeof(ctx->client_addr_send));
+    uint8_t frames[2][FEC_MAX_FRAME];
+    struct iovec iov[2];
 
-    if (sent_len < 0)
+    // マルチキャストが有効な場合は購読者数に関係なくグループへ1回だけ送信する
+    if (ctx->multicast_enabled)
     {
-        // クライアント切断時などにログが溢れるのを避けるため、頻繁なエラー出力は避ける
-        // perror("送信エラー");
+        int datagram_count = prepare_datagrams(ctx, data, data_len, frames, iov);
+        bool ok = true;
+        for (int d = 0; d < datagram_count; ++d)
+        {
+            ssize_t sent_len = sendto(ctx->send_socket, iov[d].iov_base, iov[d].iov_len, 0,
+                                      (const struct sockaddr *)&ctx->multicast_addr, sizeof(ctx->multicast_addr));
+            ok = ok && sent_len >= 0 && (size_t)sent_len == iov[d].iov_len;
+        }
+        return ok;
+    }
+
+    if (!ctx->client_addr_known)
+    {
+        // 送信先が不明な場合は送信しない
         return false;
     }
-    else if ((size_t)sent_len < data_len)
+
+    uint64_t now_ms = monotonic_now_ms();
+    expire_subscribers(ctx, now_ms);
+
+    // 今回送信すべき購読者を選ぶ (送信先がいなければ FEC の通し番号を進めないよう符号化しない)
+    TelemetrySubscriber *targets[MAX_TELEMETRY_SUBSCRIBERS];
+    unsigned int target_count = 0;
+    for (int i = 0; i < MAX_TELEMETRY_SUBSCRIBERS; ++i)
+    {
+        TelemetrySubscriber *sub = &ctx->subscribers[i];
+        if (!sub->active || (respect_rate && now_ms < sub->next_send_ms))
+            continue;
+        targets[target_count++] = sub;
+        // 次回送信時刻を更新 (送信が遅れた場合に連続送信にならないよう現在時刻基準で進める)
+        sub->next_send_ms = now_ms + sub->interval_ms;
+    }
+    if (target_count == 0)
+    {
+        return true; // 送信期限に達した購読者がいない
+    }
+
+    // 購読者 × データグラムのメッセージヘッダを組み立てる (データ本体は全員で共有)
+    int datagram_count = prepare_datagrams(ctx, data, data_len, frames, iov);
+    struct mmsghdr msgs[MAX_TELEMETRY_SUBSCRIBERS * 2];
+    unsigned int msg_count = 0;
+    for (int d = 0; d < datagram_count; ++d)
+    {
+        for (unsigned int t = 0; t < target_count; ++t)
+        {
+            memset(&msgs[msg_count], 0, sizeof(msgs[msg_count]));
+            msgs[msg_count].msg_hdr.msg_name = &targets[t]->addr;
+            msgs[msg_count].msg_hdr.msg_namelen = sizeof(targets[t]->addr);
+            msgs[msg_count].msg_hdr.msg_iov = &iov[d];
+            msgs[msg_count].msg_hdr.msg_iovlen = 1;
+            ++msg_count;
+        }
+    }
+
+    // sendmmsg は途中のメッセージで失敗するとそこで止まり、送れた数を返す (先頭で失敗した場合は -1)。
+    // 失敗した1件だけを飛ばして残りを送り直し、1人の購読者の失敗で後ろの購読者が受信できなくならないようにする
+    unsigned int offset = 0;
+    unsigned int failed = 0;
+    while (offset < msg_count)
     {
-        fprintf(stderr, "警告: データが部分的にしか送信されませんでした。\n");
-        return false; // 部分送信もエラー扱いとするか、状況による
+        int sent = sendmmsg(ctx->send_socket, msgs + offset, msg_count - offset, 0);
+        offset += sent > 0 ? (unsigned int)sent : 0;
+        if (offset < msg_count)
+        {
+            ++failed; // offset のメッセージで失敗した
+            ++offset;
+        }
+    }
+    if (failed > 0)
+    {
+        // クライアント切断時などにログが溢れるのを避けるため、全件失敗した場合は出力しない
+        if (failed < msg_count)
+        {
+            fprintf(stderr, "警告: テレメトリが一部の購読者にしか送信されませんでした (%u/%u)。\n", msg_count - failed, msg_count);
+        }
+        return false;
     }
 
     return true;
 }
 
-// 最後にデータを受信したクライアントのIPアドレスを送信先として設定/更新する関数
+// UDPデータを送信期限に達した全購読者へ送信する関数
+bool network_send(NetworkContext *ctx, const char *data, size_t data_len)
+{
+    return send_to_subscribers(ctx, data, data_len, true);
+}
+
+// UDPデータを購読者ごとのレートに関係なく全購読者へ送信する関数
+// (キーフレームなど、レートを下げた購読者にも必ず届ける必要があるデータ用)
+bool network_send_to_all(NetworkContext *ctx, const char *data, size_t data_len)
+{
+    return send_to_subscribers(ctx, data, data_len, false);
+}
+
+// 最後にデータを受信したクライアント (操縦者) を既定のテレメトリ送信先として登録/更新する関数
 bool network_update_send_address(NetworkContext *ctx)
 {
     if (!ctx)
         return false;
-    printf("センサーデータ送信先を設定/更新: %s:%d\n",
-           inet_ntoa(ctx->client_addr_recv.sin_addr),
-           ntohs(ctx->client_addr_send.sin_port));                   // ポートは固定
+    if (!ctx->client_addr_known || ctx->client_addr_send.sin_addr.s_addr != ctx->client_addr_recv.sin_addr.s_addr)
+    {
+        printf("センサーデータ送信先を設定/更新: %s:%d\n",
+               inet_ntoa(ctx->client_addr_recv.sin_addr),
+               ntohs(ctx->client_addr_send.sin_port));                   // ポートは固定
+    }
     ctx->client_addr_send.sin_addr = ctx->client_addr_recv.sin_addr; // IPアドレスを更新
     ctx->client_addr_known = true;
+    // 以前の送信先を上書きするのではなく、購読者テーブルに追加する (複数の地上局が同時に受信できる)
+    return network_subscribe(ctx, &ctx->client_addr_send, 0);
+}
+
+// 購読者を登録/更新する関数 (既に登録済みなら有効期限とレートを更新する)
+bool network_subscribe(NetworkContext *ctx, const struct sockaddr_in *addr, int rate_hz)
+{
+    if (!ctx || !addr)
+        return false;
+
+    uint64_t now_ms = monotonic_now_ms();
+    if (rate_hz <= 0)
+        rate_hz = DEFAULT_TELEMETRY_RATE_HZ;
+    uint32_t interval_ms = 1000u / (uint32_t)rate_hz;
+
+    TelemetrySubscriber *free_slot = NULL;
+    for (int i = 0; i < MAX_TELEMETRY_SUBSCRIBERS; ++i)
+    {
+        TelemetrySubscriber *sub = &ctx->subscribers[i];
+        if (sub->active && same_endpoint(&sub->addr, addr))
+        {
+            sub->interval_ms = interval_ms;
+            sub->expires_at_ms = now_ms + SUBSCRIBER_EXPIRY_MS;
+            return true;
+        }
+        if (!sub->active && !free_slot)
+            free_slot = sub;
+    }
+
+    if (!free_slot)
+    {
+        // 空きがなければ期限切れを掃除してから再試行する
+        expire_subscribers(ctx, now_ms);
+        for (int i = 0; i < MAX_TELEMETRY_SUBSCRIBERS && !free_slot; ++i)
+        {
+            if (!ctx->subscribers[i].active)
+                free_slot = &ctx->subscribers[i];
+        }
+        if (!free_slot)
+        {
+            fprintf(stderr, "警告: テレメトリ購読者テーブルが満杯です (%s:%d を登録できません)。\n",
+                    inet_ntoa(addr->sin_addr), ntohs(addr->sin_port));
+            return false;
+        }
+    }
+
+    free_slot->active = true;
+    free_slot->addr = *addr;
+    free_slot->interval_ms = interval_ms;
+    free_slot->next_send_ms = now_ms;
+    free_slot->expires_at_ms = now_ms + SUBSCRIBER_EXPIRY_MS;
+    ctx->client_addr_known = true; // 購読者が1件以上いればテレメトリを送信できる
+    printf("テレメトリ購読を登録: %s:%d (%d Hz)\n", inet_ntoa(addr->sin_addr), ntohs(addr->sin_port), rate_hz);
+    return true;
+}
+
+// 購読者を削除する関数
+void network_unsubscribe(NetworkContext *ctx, const struct sockaddr_in *addr)
+{
+    if (!ctx || !addr)
+        return;
+    for (int i = 0; i < MAX_TELEMETRY_SUBSCRIBERS; ++i)
+    {
+        TelemetrySubscriber *sub = &ctx->subscribers[i];
+        if (sub->active && same_endpoint(&sub->addr, addr))
+        {
+            sub->active = false;
+            printf("テレメトリ購読を解除: %s:%d\n", inet_ntoa(addr->sin_addr), ntohs(addr->sin_port));
+        }
+    }
+}
+
+// 現在有効な購読者数を返す関数
+int network_subscriber_count(const NetworkContext *ctx)
+{
+    if (!ctx)
+        return 0;
+    int count = 0;
+    for (int i = 0; i < MAX_TELEMETRY_SUBSCRIBERS; ++i)
+    {
+        if (ctx->subscribers[i].active)
+            ++count;
+    }
+    return count;
+}
+
+// テレメトリの送信先をコピーする関数
+// (浸水警報など、別スレッドから自前のソケットで送る場合に購読者テーブルを共有しないために使う)
+int network_get_telemetry_targets(const NetworkContext *ctx, struct sockaddr_in *out, int max_targets)
+{
+    if (!ctx || !out || max_targets <= 0)
+        return 0;
+    if (ctx->multicast_enabled)
+    {
+        out[0] = ctx->multicast_addr;
+        return 1;
+    }
+    int count = 0;
+    for (int i = 0; i < MAX_TELEMETRY_SUBSCRIBERS && count < max_targets; ++i)
+    {
+        if (ctx->subscribers[i].active)
+            out[count++] = ctx->subscribers[i].addr;
+    }
+    return count;
+}
+
+// テレメトリの送信を FEC フレームに切り替える関数
+// 受信側 (地上局) が FEC フレームを復号できる場合のみ有効にすること
+bool network_enable_fec(NetworkContext *ctx, const FecConfig &config)
+{
+    if (!ctx)
+        return false;
+    fec_encoder_init(&ctx->fec_tx, config);
+    ctx->fec_tx_enabled = true;
+    printf("テレメトリを FEC 付きで送信します (パリティ: %u 件ごと, 冗長コピー: %u 件)\n",
+           ctx->fec_tx.config.group_size, ctx->fec_tx.config.redundancy);
+    return true;
+}
+
+// 全送信元の FEC 受信統計を合計する関数
+void network_fec_stats(const NetworkContext *ctx, FecStats *out)
+{
+    *out = FecStats();
+    if (!ctx)
+        return;
+    for (int i = 0; i < NETWORK_FEC_PEERS; ++i)
+    {
+        if (!ctx->fec_rx_used[i])
+            continue;
+        const FecStats &s = ctx->fec_rx[i].stats;
+        out->data_frames += s.data_frames;
+        out->parity_frames += s.parity_frames;
+        out->malformed += s.malformed;
+        out->delivered += s.delivered;
+        out->recovered_redundant += s.recovered_redundant;
+        out->recovered_parity += s.recovered_parity;
+        out->duplicates += s.duplicates;
+        out->expected += s.expected;
+        out->resyncs += s.resyncs;
+    }
+}
+
+// テレメトリ送信をマルチキャストグループ宛てに切り替える関数
+// 有効にすると購読者数に関係なく1回の送信で全受信者に届く (購読者ごとのレート指定は適用されない)
+bool network_enable_multicast(NetworkContext *ctx, const char *group_ip, int port, int ttl)
+{
+    if (!ctx || ctx->send_socket < 0 || !group_ip)
+        return false;
+
+    memset(&ctx->multicast_addr, 0, sizeof(ctx->multicast_addr));
+    ctx->multicast_addr.sin_family = AF_INET;
+    ctx->multicast_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, group_ip, &ctx->multicast_addr.sin_addr) != 1)
+    {
+        fprintf(stderr, "無効なマルチキャストアドレス: %s\n", group_ip);
+        return false;
+    }
+
+    unsigned char ttl_value = (unsigned char)ttl;
+    if (setsockopt(ctx->send_socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl_value, sizeof(ttl_value)) < 0)
+    {
+        perror("マルチキャストTTLの設定失敗");
+        return false;
+    }
+
+    ctx->multicast_enabled = true;
+    printf("テレメトリをマルチキャスト送信します: %s:%d (TTL %d)\n", group_ip, port, ttl);
     return true;
 }
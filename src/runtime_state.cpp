@@ -0,0 +1,133 @@
+#include "runtime_state.h"
+#include <stdio.h>     // perror, printf を使用するため
+#include <string.h>    // memcpy, strncpy を使用するため
+#include <unistd.h>    // ftruncate, close を使用するため
+#include <fcntl.h>     // O_CREAT, O_RDWR を使用するため
+#include <sys/mman.h>  // shm_open, mmap, munmap, shm_unlink を使用するため
+#include <sys/stat.h>  // fstat, モード定数を使用するため
+#include <type_traits> // std::is_trivially_copyable を使用するため
+
+// 共有メモリ上の atomic はプロセス間で使うため、ロックフリーでなければならない
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "std::atomic<uint32_t> must be lock-free for shared memory");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "std::atomic<uint64_t> must be lock-free for shared memory");
+// スナップショットは memcpy で保存・復元する
+static_assert(std::is_trivially_copyable<RuntimeSnapshot>::value, "RuntimeSnapshot must be trivially copyable");
+
+// 新しいレイアウトとして初期化する (復元できる状態はなし)
+static void initialize_layout(RuntimeStateLayout *layout)
+{
+    memset(static_cast<void *>(layout), 0, sizeof(RuntimeStateLayout));
+    layout->version = RUNTIME_STATE_VERSION;
+    layout->layout_size = sizeof(RuntimeStateLayout);
+    // magic を最後に書くことで、途中で異常終了しても次回は作り直される
+    std::atomic_thread_fence(std::memory_order_release);
+    layout->magic = RUNTIME_STATE_MAGIC;
+}
+
+bool runtime_state_open(RuntimeState *state, const char *name)
+{
+    *state = RuntimeState();
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0660);
+    if (fd < 0)
+    {
+        perror("runtime state shm_open failed");
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        perror("runtime state fstat failed");
+        close(fd);
+        return false;
+    }
+    bool size_matches = static_cast<size_t>(st.st_size) == sizeof(RuntimeStateLayout);
+    if (!size_matches && ftruncate(fd, sizeof(RuntimeStateLayout)) != 0)
+    {
+        perror("runtime state ftruncate failed");
+        close(fd);
+        return false;
+    }
+    void *addr = mmap(nullptr, sizeof(RuntimeStateLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        perror("runtime state mmap failed");
+        close(fd);
+        return false;
+    }
+    state->layout = static_cast<RuntimeStateLayout *>(addr);
+    state->fd = fd;
+    strncpy(state->name, name, sizeof(state->name) - 1);
+    state->name[sizeof(state->name) - 1] = '\0';
+
+    RuntimeStateLayout *layout = state->layout;
+    if (!size_matches || layout->magic != RUNTIME_STATE_MAGIC || layout->version != RUNTIME_STATE_VERSION ||
+        layout->layout_size != sizeof(RuntimeStateLayout))
+    {
+        initialize_layout(layout);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+void runtime_state_close(RuntimeState *state)
+{
+    if (state->layout)
+        munmap(state->layout, sizeof(RuntimeStateLayout));
+    if (state->fd >= 0)
+        close(state->fd);
+    *state = RuntimeState();
+}
+
+void runtime_state_unlink(const char *name)
+{
+    shm_unlink(name);
+}
+
+void runtime_state_save(RuntimeState *state, const RuntimeSnapshot &snapshot)
+{
+    if (!state->layout)
+        return;
+    RuntimeStateLayout *layout = state->layout;
+    // 使っていない側のスロットに書き、書き終えてから切り替える (書き込み中の異常終了でも他方は一貫している)
+    uint32_t next = layout->active_slot.load(std::memory_order_relaxed) ^ 1u;
+    memcpy(&layout->slots[next], &snapshot, sizeof(RuntimeSnapshot));
+    layout->active_slot.store(next, std::memory_order_release);
+    layout->save_count.fetch_add(1, std::memory_order_release);
+}
+
+bool runtime_state_load(const RuntimeState *state, uint64_t now_ns, uint32_t max_age_ms, RuntimeSnapshot *out)
+{
+    if (!state->layout)
+        return false;
+    const RuntimeStateLayout *layout = state->layout;
+    if (layout->save_count.load(std::memory_order_acquire) == 0)
+        return false;
+    uint32_t slot = layout->active_slot.load(std::memory_order_acquire) & 1u;
+    memcpy(out, &layout->slots[slot], sizeof(RuntimeSnapshot));
+    if (out->saved_ns > now_ns || now_ns - out->saved_ns > static_cast<uint64_t>(max_age_ms) * 1000000ULL)
+        return false; // 古すぎる状態 (または別の起動時の時刻) からは復元しない
+    return true;
+}
+
+void runtime_state_invalidate(RuntimeState *state)
+{
+    if (!state->layout)
+        return;
+    state->layout->save_count.store(0, std::memory_order_release);
+    state->layout->control_exit_ns.store(0, std::memory_order_release);
+}
+
+uint64_t runtime_state_mark_control_resumed(RuntimeState *state, uint64_t saved_ns, uint64_t now_ns)
+{
+    if (!state->layout)
+        return 0;
+    RuntimeStateLayout *layout = state->layout;
+    // 監視プロセスが終了を検知した時刻があればそこから、なければ最後の保存 (異常終了の直前) から計る
+    uint64_t exit_ns = layout->control_exit_ns.exchange(0, std::memory_order_acq_rel);
+    uint64_t from_ns = (exit_ns != 0 && exit_ns <= now_ns) ? exit_ns : saved_ns;
+    uint64_t elapsed_ns = now_ns > from_ns ? now_ns - from_ns : 0;
+    layout->last_restart_to_control_ns.store(elapsed_ns, std::memory_order_relaxed);
+    if (elapsed_ns > layout->max_restart_to_control_ns.load(std::memory_order_relaxed))
+        layout->max_restart_to_control_ns.store(elapsed_ns, std::memory_order_relaxed);
+    return elapsed_ns;
+}
@@ -1,11 +1,49 @@
 // --- インクルード ---
 #include "sensor_data.h" // このモジュールのヘッダーファイル
-#include "bindings.h"    // ハードウェア読み取り関数 (read_*) を使用するため
+#include "bus_manager.h" // センサーの読み取りはバス管理を経由する (bus_read_*)
 #include <stdio.h>       // 標準入出力関数 (snprintf) を使用するため
 #include <iostream>      // 標準エラー出力 (std::cerr) を使用するため
 
+// IMU (加速度・ジャイロ・磁気) を読み取りキャッシュを更新する関数
+void sensor_read_fast(SensorData *data)
+{
+    if (!data)
+        return;
+    // 加速度・ジャイロ・磁気 (X, Y, Z軸)。バス管理の実行中はバススレッドが読んだ最新値
+    bus_read_imu(&data->accel, &data->gyro, &data->mag);
+}
+
+// 温度・圧力・リーク・ADC を読み取りキャッシュを更新する関数
+void sensor_read_slow(SensorData *data)
+{
+    if (!data)
+        return;
+    // 温度・圧力・リーク (true: 漏れあり, false: 漏れなし)・すべてのADCチャンネル。バス管理の実行中はバススレッドが読んだ最新値
+    bus_read_slow(&data->temperature, &data->pressure, &data->leak, data->adc, SENSOR_ADC_CHANNELS);
+    sensor_update_power(data);
+}
+
+// ADC の値から電源モジュールの電圧・電流・消費電力を計算する関数
+// フィルタバンクを通した ADC の値から計算するため、PWM の切り替えによる電流の細かい変動は平均化される
+void sensor_update_power(SensorData *data)
+{
+    data->battery_voltage = data->adc[SENSOR_ADC_VOLTAGE_CHANNEL] * SENSOR_VOLTS_PER_ADC_V;
+    data->battery_current = (data->adc[SENSOR_ADC_CURRENT_CHANNEL] - SENSOR_CURRENT_OFFSET_V) * SENSOR_AMPS_PER_ADC_V;
+    data->power_w = data->battery_voltage * data->battery_current;
+}
+
 // 関連するすべてのセンサーを読み取り、指定されたバッファに文字列としてフォーマットする関数
 bool read_and_format_sensor_data(char *buffer, size_t buffer_size)
+{
+    // --- センサーデータの取得 ---
+    SensorData data;
+    sensor_read_slow(&data);
+    sensor_read_fast(&data);
+    return format_sensor_data(data, buffer, buffer_size);
+}
+
+// キャッシュの全センサー値を指定されたバッファに文字列としてフォーマットする関数
+bool format_sensor_data(const SensorData &data, char *buffer, size_t buffer_size)
 {
     // 引数チェック: バッファポインタが NULL またはバッファサイズが 0 の場合は失敗
     if (!buffer || buffer_size == 0)
@@ -13,16 +51,6 @@ bool read_and_format_sensor_data(char *buffer, size_t buffer_size)
         return false;
     }
 
-    // --- センサーデータの取得 ---
-    float temperature = read_temp();  // 温度センサーの値を読み取る
-    float pressure = read_pressure(); // 圧力センサーの値を読み取る
-    bool leak = read_leak();          // リークセンサーの状態を読み取る (true: 漏れあり, false: 漏れなし)
-    float adc[4];                     // ADC (アナログ-デジタル変換器) の値を格納する配列
-    read_adc_all(adc, 4);             // すべてのADCチャンネルの値を読み取る (read_adc_all が効率的であると仮定)
-    AxisData accel = read_accel();    // 加速度センサーの値を読み取る (X, Y, Z軸)
-    AxisData gyro = read_gyro();      // ジャイロセンサーの値を読み取る (X, Y, Z軸)
-    AxisData mag = read_mag();        // 磁力センサーの値を読み取る (X, Y, Z軸)
-
     // --- 文字列へのフォーマット ---
     // snprintf を使用して、取得したセンサーデータをカンマ区切りの文字列にフォーマットする
     // 各センサー値にラベルを付け、固定小数点数 (%.6f) または整数 (%d) で表現する
@@ -32,11 +60,11 @@ bool read_and_format_sensor_data(char *buffer, size_t buffer_size)
                            "ACCX:%.6f,ACCY:%.6f,ACCZ:%.6f,"
                            "GYROX:%.6f,GYROY:%.6f,GYROZ:%.6f,"
                            "MAGX:%.6f,MAGY:%.6f,MAGZ:%.6f",
-                           temperature, pressure, leak ? 1 : 0,
-                           adc[0], adc[1], adc[2], adc[3],
-                           accel.x, accel.y, accel.z,
-                           gyro.x, gyro.y, gyro.z,
-                           mag.x, mag.y, mag.z);
+                           data.temperature, data.pressure, data.leak ? 1 : 0,
+                           data.adc[0], data.adc[1], data.adc[2], data.adc[3],
+                           data.accel.x, data.accel.y, data.accel.z,
+                           data.gyro.x, data.gyro.y, data.gyro.z,
+                           data.mag.x, data.mag.y, data.mag.z);
 
     // --- エラーチェック ---
     // snprintf の戻り値を確認
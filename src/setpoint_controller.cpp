@@ -0,0 +1,81 @@
+#include "setpoint_controller.h"
+#include <algorithm> // std::max, std::min を使用するため
+#include <cmath>     // std::abs を使用するため
+
+static const float DEPTH_RATE_FILTER = 0.2f; // 深度変化率の平滑化係数 (1周期あたり)
+
+static float clamp_unit(float value)
+{
+    return std::max(-1.0f, std::min(1.0f, value));
+}
+
+void setpoint_init(SetpointController *ctrl, const SetpointGains &gains)
+{
+    *ctrl = SetpointController();
+    ctrl->gains = gains;
+}
+
+float setpoint_update_depth(SetpointController *ctrl, float pressure, float dt_s)
+{
+    if (pressure <= 0.0f)
+        return ctrl->depth_m; // まだ読み取っていない、または読み取り失敗
+    if (!ctrl->surface_valid)
+    {
+        // 起動時は水面にいるものとして、最初の圧力を深度0の基準にする
+        ctrl->surface_pressure = pressure;
+        ctrl->surface_valid = true;
+    }
+    float depth = (pressure - ctrl->surface_pressure) / ctrl->gains.kpa_per_m;
+    if (dt_s > 0.0f && dt_s <= ATTITUDE_MAX_DT_S)
+    {
+        float rate = (depth - ctrl->depth_m) / dt_s;
+        ctrl->depth_rate += DEPTH_RATE_FILTER * (rate - ctrl->depth_rate);
+    }
+    ctrl->depth_m = depth;
+    return depth;
+}
+
+BodyThrust setpoint_update(SetpointController *ctrl, const SetpointCommand &setpoint, const Attitude &attitude,
+                           const AxisData &gyro, float dt_s)
+{
+    const SetpointGains &g = ctrl->gains;
+    BodyThrust demand;
+    demand.surge = clamp_unit(setpoint.surge);
+    demand.sway = clamp_unit(setpoint.sway);
+
+    // ヨー: 方位保持 (最短方向に回る) またはヨー角速度制御
+    if (setpoint.hold_heading)
+    {
+        float error = attitude_wrap_deg(setpoint.heading_deg - attitude.yaw_deg);
+        demand.yaw = clamp_unit(g.heading_kp * error - g.heading_kd * gyro.z);
+    }
+    else
+    {
+        demand.yaw = clamp_unit(g.yaw_rate_kp * (setpoint.yaw_rate_dps - gyro.z));
+    }
+
+    // 上下: 深度保持 (水面の基準がない場合は要求をそのまま使う)
+    if (setpoint.hold_depth && ctrl->surface_valid)
+    {
+        float error = setpoint.depth_m - ctrl->depth_m; // 正: もっと深く潜る必要がある
+        float down = g.depth_kp * error + ctrl->depth_integral - g.depth_kd * ctrl->depth_rate;
+        // 積分の更新は出力が飽和していない間、または積分が飽和を緩める方向のときだけ (ワインドアップ防止)
+        if (dt_s > 0.0f && dt_s <= ATTITUDE_MAX_DT_S && (std::abs(down) < 1.0f || (down > 0.0f) != (error > 0.0f)))
+        {
+            ctrl->depth_integral += g.depth_ki * error * dt_s;
+            ctrl->depth_integral = std::max(-g.depth_integral_limit, std::min(g.depth_integral_limit, ctrl->depth_integral));
+        }
+        demand.heave = clamp_unit(-down); // heave は上向き正
+    }
+    else
+    {
+        ctrl->depth_integral = 0.0f;
+        demand.heave = clamp_unit(setpoint.heave);
+    }
+    return demand;
+}
+
+void setpoint_reset(SetpointController *ctrl)
+{
+    ctrl->depth_integral = 0.0f;
+}
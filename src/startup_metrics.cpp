@@ -0,0 +1,61 @@
+#include "startup_metrics.h"
+#include "monotonic_clock.h" // monotonic_now_ns を使用するため
+#include <atomic>            // std::atomic を使用するため (映像のストリーミングスレッドから記録される)
+#include <stdio.h>           // printf を使用するため
+
+// 計測の基準時刻 (CLOCK_MONOTONIC, ナノ秒)
+static std::atomic<uint64_t> start_ns(0);
+// 基準時刻からの経過時間 (ナノ秒)。0 は未記録
+static std::atomic<uint64_t> first_control_tick_ns(0);
+static std::atomic<uint64_t> first_video_frame_ns[STARTUP_MAX_CAMERAS];
+
+// 基準時刻からの経過時間を返す (0 を「未記録」に使うため最小値は 1)
+static uint64_t elapsed_since_start_ns()
+{
+    uint64_t now = monotonic_now_ns();
+    uint64_t start = start_ns.load(std::memory_order_relaxed);
+    return (now > start) ? now - start : 1;
+}
+
+// 未記録の場合のみ値を書き込む。最初に書き込んだ呼び出しだけが true を返す
+static bool record_once(std::atomic<uint64_t> &slot, uint64_t value)
+{
+    uint64_t expected = 0;
+    return slot.compare_exchange_strong(expected, value, std::memory_order_relaxed);
+}
+
+void startup_metrics_begin()
+{
+    start_ns.store(monotonic_now_ns(), std::memory_order_relaxed);
+    first_control_tick_ns.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < STARTUP_MAX_CAMERAS; ++i)
+        first_video_frame_ns[i].store(0, std::memory_order_relaxed);
+}
+
+void startup_metrics_mark_first_control_tick()
+{
+    uint64_t elapsed = elapsed_since_start_ns();
+    if (record_once(first_control_tick_ns, elapsed))
+        printf("[STARTUP] 起動から最初の制御周期まで: %.1f ms\n", elapsed / 1e6);
+}
+
+void startup_metrics_mark_first_video_frame(int camera_index)
+{
+    if (camera_index < 0 || camera_index >= STARTUP_MAX_CAMERAS)
+        return;
+    uint64_t elapsed = elapsed_since_start_ns();
+    if (record_once(first_video_frame_ns[camera_index], elapsed))
+        printf("[STARTUP] 起動からカメラ%d の最初の映像フレームまで: %.1f ms\n", camera_index + 1, elapsed / 1e6);
+}
+
+uint64_t startup_metrics_first_control_tick_ns()
+{
+    return first_control_tick_ns.load(std::memory_order_relaxed);
+}
+
+uint64_t startup_metrics_first_video_frame_ns(int camera_index)
+{
+    if (camera_index < 0 || camera_index >= STARTUP_MAX_CAMERAS)
+        return 0;
+    return first_video_frame_ns[camera_index].load(std::memory_order_relaxed);
+}
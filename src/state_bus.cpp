@@ -0,0 +1,255 @@
+#include "state_bus.h"
+#include <stdio.h>     // perror, fprintf, snprintf を使用するため
+#include <string.h>    // memcpy, strncpy を使用するため
+#include <unistd.h>    // ftruncate, close, getpid を使用するため
+#include <fcntl.h>     // O_CREAT, O_RDWR を使用するため
+#include <sys/mman.h>  // shm_open, mmap, munmap, shm_unlink を使用するため
+#include <sys/stat.h>  // モード定数を使用するため
+#include <algorithm>   // std::max, std::min を使用するため
+#include <cmath>       // std::isfinite を使用するため
+
+// 共有メモリ上の atomic はプロセス間で使うため、ロックフリーでなければならない
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "std::atomic<uint32_t> must be lock-free for shared memory");
+static_assert((STATE_BUS_COMMAND_CAPACITY & (STATE_BUS_COMMAND_CAPACITY - 1)) == 0,
+              "STATE_BUS_COMMAND_CAPACITY must be a power of two");
+
+static const uint32_t COMMAND_INDEX_MASK = STATE_BUS_COMMAND_CAPACITY - 1;
+static const int SEQLOCK_MAX_RETRIES = 1000; // 読み取りの再試行上限 (書き手が異常終了して seq が奇数のまま残った場合に備える)
+
+static bool map_layout(StateBus *bus, int fd, const char *name, bool owner)
+{
+    void *addr = mmap(nullptr, sizeof(StateBusLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        perror("state bus mmap failed");
+        close(fd);
+        return false;
+    }
+    bus->layout = static_cast<StateBusLayout *>(addr);
+    bus->fd = fd;
+    bus->owner = owner;
+    strncpy(bus->name, name, sizeof(bus->name) - 1);
+    bus->name[sizeof(bus->name) - 1] = '\0';
+    return true;
+}
+
+bool state_bus_create(StateBus *bus, const char *name)
+{
+    *bus = StateBus();
+    // 前回の異常終了で残った共有メモリは作り直す (新しい領域はゼロで初期化される)
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd < 0)
+    {
+        perror("state bus shm_open failed");
+        return false;
+    }
+    if (ftruncate(fd, sizeof(StateBusLayout)) != 0)
+    {
+        perror("state bus ftruncate failed");
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    if (!map_layout(bus, fd, name, true))
+    {
+        shm_unlink(name);
+        return false;
+    }
+
+    StateBusLayout *layout = bus->layout;
+    layout->version = STATE_BUS_VERSION;
+    layout->layout_size = sizeof(StateBusLayout);
+    layout->writer_pid = static_cast<int32_t>(getpid());
+    layout->state_seq.store(0, std::memory_order_relaxed);
+    layout->command_head.store(0, std::memory_order_relaxed);
+    layout->command_tail.store(0, std::memory_order_relaxed);
+    layout->commands_dropped.store(0, std::memory_order_relaxed);
+    // magic を最後に書くことで、接続側は初期化済みのレイアウトだけを受け入れる
+    std::atomic_thread_fence(std::memory_order_release);
+    layout->magic = STATE_BUS_MAGIC;
+
+    printf("状態バスを作成しました: /dev/shm%s (%zu バイト)\n", name, sizeof(StateBusLayout));
+    return true;
+}
+
+bool state_bus_resume(StateBus *bus, const char *name)
+{
+    // 前の制御プロセスが作った一致するレイアウトがあれば、作り直さずに書き手として引き継ぐ
+    // (接続中の外部プロセスのマッピングとキューに残ったコマンドがそのまま使える)
+    int fd = shm_open(name, O_RDWR, 0);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(StateBusLayout))
+    {
+        if (fd >= 0)
+            close(fd);
+        return state_bus_create(bus, name);
+    }
+    *bus = StateBus();
+    if (!map_layout(bus, fd, name, true))
+        return state_bus_create(bus, name);
+    StateBusLayout *layout = bus->layout;
+    if (layout->magic != STATE_BUS_MAGIC || layout->version != STATE_BUS_VERSION ||
+        layout->layout_size != sizeof(StateBusLayout))
+    {
+        state_bus_close(bus); // 名前も削除される
+        return state_bus_create(bus, name);
+    }
+    // 公開の途中で異常終了していたら seq が奇数のまま残っているので偶数に戻す (内容は次の公開で置き換わる)
+    uint32_t seq = layout->state_seq.load(std::memory_order_relaxed);
+    if (seq & 1u)
+        layout->state_seq.store(seq + 1, std::memory_order_release);
+    layout->writer_pid = static_cast<int32_t>(getpid());
+    printf("状態バスを引き継ぎました: /dev/shm%s\n", name);
+    return true;
+}
+
+bool state_bus_open(StateBus *bus, const char *name)
+{
+    *bus = StateBus();
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        perror("state bus shm_open failed (制御プロセスは起動していますか?)");
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(StateBusLayout))
+    {
+        fprintf(stderr, "状態バスのサイズが一致しません (%s)\n", name);
+        close(fd);
+        return false;
+    }
+    if (!map_layout(bus, fd, name, false))
+        return false;
+
+    const StateBusLayout *layout = bus->layout;
+    if (layout->magic != STATE_BUS_MAGIC || layout->version != STATE_BUS_VERSION ||
+        layout->layout_size != sizeof(StateBusLayout))
+    {
+        fprintf(stderr, "状態バスのバージョンが一致しません (%s)。制御プロセスと同じヘッダーでビルドしてください。\n", name);
+        state_bus_close(bus);
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+void state_bus_close(StateBus *bus)
+{
+    if (bus->layout)
+        munmap(bus->layout, sizeof(StateBusLayout));
+    if (bus->fd >= 0)
+        close(bus->fd);
+    if (bus->owner && bus->name[0] != '\0')
+        shm_unlink(bus->name);
+    *bus = StateBus();
+}
+
+void state_bus_publish(StateBus *bus, const StateSnapshot &snapshot)
+{
+    if (!bus->layout)
+        return;
+    StateBusLayout *layout = bus->layout;
+    // seqlock の書き込み: seq を奇数にしてから本体を書き、偶数に戻す
+    uint32_t seq = layout->state_seq.load(std::memory_order_relaxed);
+    layout->state_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&layout->state, &snapshot, sizeof(StateSnapshot));
+    layout->state_seq.store(seq + 2, std::memory_order_release);
+}
+
+bool state_bus_read(const StateBus *bus, StateSnapshot *snapshot)
+{
+    if (!bus->layout)
+        return false;
+    const StateBusLayout *layout = bus->layout;
+    for (int attempt = 0; attempt < SEQLOCK_MAX_RETRIES; ++attempt)
+    {
+        uint32_t before = layout->state_seq.load(std::memory_order_acquire);
+        if (before == 0)
+            return false; // まだ一度も公開されていない
+        if (before & 1u)
+            continue; // 書き込み中
+        memcpy(snapshot, &layout->state, sizeof(StateSnapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (layout->state_seq.load(std::memory_order_relaxed) == before)
+            return true; // 読み取り中に書き込みがなかった
+    }
+    return false;
+}
+
+bool state_bus_push_command(StateBus *bus, const StateBusCommand &command)
+{
+    if (!bus->layout)
+        return false;
+    StateBusLayout *layout = bus->layout;
+    uint32_t tail = layout->command_tail.load(std::memory_order_relaxed);
+    uint32_t head = layout->command_head.load(std::memory_order_acquire);
+    if (tail - head >= STATE_BUS_COMMAND_CAPACITY)
+    {
+        layout->commands_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false; // 満杯
+    }
+    layout->commands[tail & COMMAND_INDEX_MASK] = command;
+    layout->command_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool state_bus_pop_command(StateBus *bus, StateBusCommand *command)
+{
+    if (!bus->layout)
+        return false;
+    StateBusLayout *layout = bus->layout;
+    uint32_t head = layout->command_head.load(std::memory_order_relaxed);
+    uint32_t tail = layout->command_tail.load(std::memory_order_acquire);
+    if (head == tail)
+        return false; // 空
+    *command = layout->commands[head & COMMAND_INDEX_MASK];
+    layout->command_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+CommandPacket state_bus_command_to_packet(const StateBusCommand &command)
+{
+    CommandPacket packet;
+    if (command.type != CommandGamepad && command.type != CommandSetpoint &&
+        command.type != CommandTakeover && command.type != CommandRelease)
+        return packet; // CommandInvalid
+    packet.type = static_cast<CommandPacketType>(command.type);
+    packet.source_id = command.source_id;
+    packet.seq = command.seq;
+    packet.has_seq = true;
+    packet.priority = command.priority;
+
+    if (command.type == CommandSetpoint)
+    {
+        // 数値でない目標値のコマンドは受け付けない (クランプの前に調べる。std::min/max は NaN を範囲の端に変えてしまう)
+        if (!std::isfinite(command.thrust[0]) || !std::isfinite(command.thrust[1]) || !std::isfinite(command.thrust[2]) ||
+            !std::isfinite(command.yaw_rate_dps) || !std::isfinite(command.heading_deg) || !std::isfinite(command.depth_m))
+            return CommandPacket();
+        // UDP の目標値コマンドと同じ範囲・タイムアウトの制限をかける
+        SetpointCommand &sp = packet.setpoint;
+        sp.surge = std::max(-1.0f, std::min(1.0f, command.thrust[0]));
+        sp.sway = std::max(-1.0f, std::min(1.0f, command.thrust[1]));
+        sp.heave = std::max(-1.0f, std::min(1.0f, command.thrust[2]));
+        sp.yaw_rate_dps = command.yaw_rate_dps;
+        sp.hold_heading = (command.flags & STATE_BUS_HOLD_HEADING) != 0;
+        sp.heading_deg = command.heading_deg;
+        sp.hold_depth = (command.flags & STATE_BUS_HOLD_DEPTH) != 0;
+        sp.depth_m = command.depth_m;
+        sp.timeout_ms = command.timeout_ms == 0 ? SETPOINT_DEFAULT_TIMEOUT_MS
+                                                : std::min<uint32_t>(command.timeout_ms, SETPOINT_MAX_TIMEOUT_MS);
+        return packet;
+    }
+
+    // スティックは操縦パケットと同じ範囲に収める (トリガーは UDP と同じくそのまま渡す)
+    packet.gamepad.leftThumbX = std::max(-32768, std::min(32767, command.axes[0]));
+    packet.gamepad.leftThumbY = std::max(-32768, std::min(32767, command.axes[1]));
+    packet.gamepad.rightThumbX = std::max(-32768, std::min(32767, command.axes[2]));
+    packet.gamepad.rightThumbY = std::max(-32768, std::min(32767, command.axes[3]));
+    packet.gamepad.LT = command.axes[4];
+    packet.gamepad.RT = command.axes[5];
+    packet.gamepad.buttons = static_cast<uint16_t>(command.buttons);
+    return packet;
+}
@@ -0,0 +1,214 @@
+#include "supervisor.h"
+#include "monotonic_clock.h" // CLOCK_MONOTONIC による時刻取得
+#include <stdio.h>           // printf, perror, fflush を使用するため
+#include <string.h>          // strsignal を使用するため
+#include <errno.h>           // errno, EINTR, ECHILD を使用するため
+#include <signal.h>          // sigaction, kill を使用するため
+#include <unistd.h>          // fork, _exit, usleep, getppid を使用するため
+#include <sys/wait.h>        // waitpid を使用するため
+#include <sys/prctl.h>       // prctl(PR_SET_PDEATHSIG) を使用するため
+
+static const uint64_t SHUTDOWN_TIMEOUT_NS = 5000000000ULL; // 終了要求から SIGKILL までの猶予 (映像パイプラインの後始末を含む)
+static const useconds_t POLL_INTERVAL_US = 10000;          // バックオフ中・終了待ちの waitpid の確認間隔
+
+static volatile sig_atomic_t stop_requested = 0; // SIGINT / SIGTERM を受けたか
+
+static void handle_stop_signal(int)
+{
+    stop_requested = 1;
+}
+
+// 子プロセスを起動する。子プロセス側では entry を実行して終了する (監視ループには戻らない)
+static bool spawn_process(SupervisedProcess &proc)
+{
+    fflush(stdout); // 未出力のバッファを子プロセスに複製しない
+    fflush(stderr);
+    pid_t supervisor_pid = getpid();
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("子プロセスの起動 (fork) 失敗");
+        return false;
+    }
+    if (pid == 0)
+    {
+        // 監視プロセスのシグナル設定を戻し、監視プロセスが終了したら子プロセスも終了させる
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() != supervisor_pid)
+            _exit(1); // prctl より前に監視プロセスが終了していた
+        int code = proc.entry();
+        fflush(stdout);
+        fflush(stderr);
+        _exit(code & 0xff);
+    }
+    proc.pid = pid;
+    proc.started_ns = monotonic_now_ns();
+    proc.restart_at_ns = 0;
+    return true;
+}
+
+// 子プロセスの終了を処理し、起動し直す時刻を決める。制御プロセスが正常終了した場合は true (監視を終える)
+static bool handle_exit(const SupervisorConfig &config, SupervisedProcess &proc, int status, uint64_t now_ns,
+                        RuntimeState *state)
+{
+    pid_t pid = proc.pid;
+    proc.pid = -1;
+    if (proc.is_control && state->layout)
+        state->layout->control_exit_ns.store(now_ns, std::memory_order_release); // 再起動後の制御プロセスが計測の起点にする
+
+    bool clean = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (WIFSIGNALED(status))
+        printf("[SUPERVISOR] %s (pid %d) がシグナル %d (%s) で終了しました。\n",
+               proc.name, static_cast<int>(pid), WTERMSIG(status), strsignal(WTERMSIG(status)));
+    else
+        printf("[SUPERVISOR] %s (pid %d) が終了コード %d で終了しました。\n",
+               proc.name, static_cast<int>(pid), WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+
+    if (stop_requested)
+        return false;
+    if (clean && proc.is_control)
+        return true; // 制御プロセスの正常終了 (Startボタンなど) は監視全体の終了
+
+    uint64_t uptime_ms = (now_ns - proc.started_ns) / 1000000ULL;
+    proc.rapid_failures = uptime_ms < config.stable_ms ? proc.rapid_failures + 1 : 0;
+    proc.restarts++;
+    if (proc.is_control && state->layout)
+        state->layout->restart_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (proc.rapid_failures >= config.rapid_failure_limit)
+    {
+        // 起動直後の異常終了が続く: 同じ状態を復元し続けないよう、コールドスタート (スラスターを PWM_STOP に初期化) にして間隔を空ける
+        if (proc.is_control)
+            runtime_state_invalidate(state);
+        proc.restart_at_ns = now_ns + static_cast<uint64_t>(config.backoff_ms) * 1000000ULL;
+        printf("[SUPERVISOR] %s が起動直後に %u 回続けて終了しました。%u ms 後にコールドスタートで起動し直します。\n",
+               proc.name, proc.rapid_failures, config.backoff_ms);
+    }
+    else
+    {
+        proc.restart_at_ns = now_ns; // 直ちに起動し直す
+        printf("[SUPERVISOR] %s を起動し直します (%u 回目)。\n", proc.name, proc.restarts);
+    }
+    return false;
+}
+
+// 全ての子プロセスに終了を要求し、終了を待つ (猶予を過ぎたら SIGKILL)
+static void stop_all(SupervisedProcess *processes, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (processes[i].pid > 0)
+            kill(processes[i].pid, SIGTERM);
+    }
+    uint64_t deadline_ns = monotonic_now_ns() + SHUTDOWN_TIMEOUT_NS;
+    bool killed = false;
+    for (;;)
+    {
+        int remaining = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            if (processes[i].pid <= 0)
+                continue;
+            int status = 0;
+            if (waitpid(processes[i].pid, &status, WNOHANG) == processes[i].pid)
+                processes[i].pid = -1;
+            else
+                remaining++;
+        }
+        if (remaining == 0)
+            return;
+        if (!killed && monotonic_now_ns() >= deadline_ns)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                if (processes[i].pid > 0)
+                {
+                    printf("[SUPERVISOR] %s (pid %d) が終了しないため強制終了します。\n",
+                           processes[i].name, static_cast<int>(processes[i].pid));
+                    kill(processes[i].pid, SIGKILL);
+                }
+            }
+            killed = true;
+        }
+        usleep(POLL_INTERVAL_US);
+    }
+}
+
+int supervisor_run(const SupervisorConfig &config, SupervisedProcess *processes, int count, RuntimeState *state)
+{
+    if (count <= 0 || count > SUPERVISOR_MAX_PROCESSES)
+        return -1;
+
+    // SA_RESTART を付けないことで、シグナルを受けたら waitpid から EINTR で戻る
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop_signal;
+    sigemptyset(&action.sa_mask);
+    struct sigaction previous_int, previous_term;
+    sigaction(SIGINT, &action, &previous_int);
+    sigaction(SIGTERM, &action, &previous_term);
+    stop_requested = 0;
+
+    uint64_t now_ns = monotonic_now_ns();
+    for (int i = 0; i < count; ++i)
+    {
+        processes[i].pid = -1;
+        processes[i].restart_at_ns = now_ns; // 最初は全て直ちに起動する
+        processes[i].rapid_failures = 0;
+        processes[i].restarts = 0;
+    }
+    printf("[SUPERVISOR] 監視を開始します (pid %d, 子プロセス %d 個)。\n", static_cast<int>(getpid()), count);
+
+    bool finished = false;
+    while (!finished && !stop_requested)
+    {
+        // 起動待ちの子プロセスのうち、起動時刻になったものを起動する
+        now_ns = monotonic_now_ns();
+        bool waiting = false;
+        for (int i = 0; i < count; ++i)
+        {
+            SupervisedProcess &proc = processes[i];
+            if (proc.pid > 0 || proc.restart_at_ns == 0)
+                continue;
+            if (now_ns < proc.restart_at_ns)
+            {
+                waiting = true;
+                continue;
+            }
+            if (!spawn_process(proc))
+            {
+                proc.restart_at_ns = now_ns + static_cast<uint64_t>(config.backoff_ms) * 1000000ULL;
+                waiting = true;
+            }
+        }
+
+        // 子プロセスの終了を待つ (起動待ちがあれば一定間隔で確認する)
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, waiting ? WNOHANG : 0);
+        if (pid == 0 || (pid < 0 && errno == ECHILD))
+        {
+            usleep(POLL_INTERVAL_US);
+            continue;
+        }
+        if (pid < 0)
+            continue; // EINTR (終了要求など)
+        now_ns = monotonic_now_ns();
+        for (int i = 0; i < count; ++i)
+        {
+            if (processes[i].pid == pid)
+            {
+                finished = handle_exit(config, processes[i], status, now_ns, state);
+                break;
+            }
+        }
+    }
+
+    printf("[SUPERVISOR] 子プロセスを終了しています...\n");
+    stop_all(processes, count);
+    sigaction(SIGINT, &previous_int, nullptr);
+    sigaction(SIGTERM, &previous_term, nullptr);
+    printf("[SUPERVISOR] 監視を終了しました。\n");
+    return 0;
+}
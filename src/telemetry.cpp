@@ -0,0 +1,193 @@
+#include "telemetry.h"
+#include <stdio.h>  // snprintf を使用するため
+#include <string.h> // memcpy を使用するため
+#include <math.h>   // fabsf を使用するため
+
+// 既定のフィールド設定 (TelemetryField の順)
+// IMU は高レート・小さいしきい値、温度やADCなど変化の遅いフィールドは低レートにして帯域を節約する
+static const TelemetryFieldConfig DEFAULT_FIELDS[TELEMETRY_FIELD_COUNT] = {
+    {"LEAK", 50.0f, 0.5f},
+    {"SRC", 50.0f, 0.5f},
+    {"AUTH", 10.0f, 0.05f},
+    {"SATAX", 10.0f, 0.5f},
+    {"GYROX", 50.0f, 0.05f},
+    {"GYROY", 50.0f, 0.05f},
+    {"GYROZ", 50.0f, 0.05f},
+    {"ACCX", 50.0f, 0.02f},
+    {"ACCY", 50.0f, 0.02f},
+    {"ACCZ", 50.0f, 0.02f},
+    {"PRESSURE", 10.0f, 0.05f},
+    {"MAGX", 10.0f, 0.5f},
+    {"MAGY", 10.0f, 0.5f},
+    {"MAGZ", 10.0f, 0.5f},
+    {"TEMP", 1.0f, 0.05f},
+    {"ADC0", 2.0f, 0.01f},
+    {"ADC1", 2.0f, 0.01f},
+    {"ADC2", 2.0f, 0.01f},
+    {"ADC3", 2.0f, 0.01f},
+    {"POWER", 2.0f, 1.0f},
+};
+
+// センサーキャッシュ・制御の状態からフィールドの値を取り出す
+static float field_value(const TelemetryScheduler &sched, const SensorData &data, int active_source, int field)
+{
+    switch (field)
+    {
+    case TF_LEAK:
+        return data.leak ? 1.0f : 0.0f;
+    case TF_SRC:
+        return static_cast<float>(active_source);
+    case TF_AUTH:
+        return sched.authority;
+    case TF_SATAX:
+        return static_cast<float>(sched.saturated_axes);
+    case TF_GYROX:
+        return data.gyro.x;
+    case TF_GYROY:
+        return data.gyro.y;
+    case TF_GYROZ:
+        return data.gyro.z;
+    case TF_ACCX:
+        return data.accel.x;
+    case TF_ACCY:
+        return data.accel.y;
+    case TF_ACCZ:
+        return data.accel.z;
+    case TF_PRESSURE:
+        return data.pressure;
+    case TF_MAGX:
+        return data.mag.x;
+    case TF_MAGY:
+        return data.mag.y;
+    case TF_MAGZ:
+        return data.mag.z;
+    case TF_TEMP:
+        return data.temperature;
+    case TF_ADC0:
+    case TF_ADC1:
+    case TF_ADC2:
+    case TF_ADC3:
+        return data.adc[field - TF_ADC0];
+    case TF_POWER:
+        return data.power_w;
+    }
+    return 0.0f;
+}
+
+// 1フィールドを "NAME:value," の形式で追記する。書き込めなかった場合は -1
+static int append_field(char *buffer, size_t buffer_size, size_t offset, const char *name, float value)
+{
+    if (offset >= buffer_size)
+        return -1;
+    int written = snprintf(buffer + offset, buffer_size - offset, ",%s:%.6g", name, value);
+    if (written < 0 || offset + written >= buffer_size)
+        return -1;
+    return written;
+}
+
+void telemetry_init(TelemetryScheduler *sched, uint32_t budget_bytes_per_s, uint32_t keyframe_interval_ms)
+{
+    memset(sched, 0, sizeof(*sched));
+    memcpy(sched->fields, DEFAULT_FIELDS, sizeof(DEFAULT_FIELDS));
+    sched->budget_bytes_per_s = budget_bytes_per_s;
+    sched->keyframe_interval_ms = keyframe_interval_ms;
+    sched->tokens = budget_bytes_per_s; // 起動直後は1秒分のバーストを許可
+    sched->authority = 1.0f;
+}
+
+void telemetry_set_authority(TelemetryScheduler *sched, float authority, uint32_t saturated_axes)
+{
+    sched->authority = authority;
+    sched->saturated_axes = saturated_axes;
+}
+
+void telemetry_set_field(TelemetryScheduler *sched, TelemetryField field, float rate_hz, float threshold)
+{
+    sched->fields[field].rate_hz = rate_hz;
+    sched->fields[field].threshold = threshold;
+}
+
+size_t telemetry_build_frame(TelemetryScheduler *sched, const SensorData &data, int active_source, uint64_t now_ms,
+                             char *buffer, size_t buffer_size, bool *is_keyframe)
+{
+    if (is_keyframe)
+        *is_keyframe = false;
+    if (!buffer || buffer_size == 0)
+        return 0;
+
+    // トークンバケットの補充 (最大1秒分まで貯める)
+    if (sched->last_refill_ms != 0)
+    {
+        sched->tokens += static_cast<double>(sched->budget_bytes_per_s) * (now_ms - sched->last_refill_ms) / 1000.0;
+        if (sched->tokens > sched->budget_bytes_per_s)
+            sched->tokens = sched->budget_bytes_per_s;
+    }
+    sched->last_refill_ms = now_ms;
+
+    bool keyframe = !sched->keyframe_sent || now_ms - sched->last_keyframe_ms >= sched->keyframe_interval_ms;
+    if (!keyframe && sched->tokens <= TELEMETRY_DATAGRAM_OVERHEAD_BYTES)
+        return 0; // 帯域を使い切っている (ヘッダだけで残量を超える)
+
+    int header = snprintf(buffer, buffer_size, "SEQ:%u,KF:%d", sched->seq, keyframe ? 1 : 0);
+    if (header < 0 || static_cast<size_t>(header) >= buffer_size)
+        return 0;
+    size_t len = static_cast<size_t>(header);
+    int field_count = 0;
+
+    for (int f = 0; f < TELEMETRY_FIELD_COUNT; ++f)
+    {
+        const TelemetryFieldConfig &cfg = sched->fields[f];
+        float value = field_value(*sched, data, active_source, f);
+
+        if (!keyframe)
+        {
+            // レート上限: 最後の送信から 1/rate 秒経過していないフィールドは送らない
+            if (cfg.rate_hz <= 0.0f || (now_ms - sched->last_sent_ms[f]) * cfg.rate_hz < 1000.0f)
+                continue;
+            // 変化量のしきい値以下なら送らない
+            if (fabsf(value - sched->last_sent_value[f]) <= cfg.threshold)
+                continue;
+        }
+
+        size_t before = len;
+        int written = append_field(buffer, buffer_size, len, cfg.name, value);
+        if (written < 0)
+        {
+            sched->fields_deferred++;
+            buffer[before] = '\0';
+            continue;
+        }
+        // 差分フレームは帯域の残量を超えるフィールドを次の周期に持ち越す (キーフレームは常に全フィールド)
+        if (!keyframe && before + written + TELEMETRY_DATAGRAM_OVERHEAD_BYTES > sched->tokens)
+        {
+            sched->fields_deferred++;
+            buffer[before] = '\0';
+            continue;
+        }
+        len += written;
+        sched->last_sent_value[f] = value;
+        sched->last_sent_ms[f] = now_ms;
+        field_count++;
+    }
+
+    if (field_count == 0)
+    {
+        buffer[0] = '\0';
+        return 0; // 変化したフィールドなし
+    }
+
+    if (keyframe)
+    {
+        sched->keyframe_sent = true;
+        sched->last_keyframe_ms = now_ms;
+        sched->keyframes_sent++;
+    }
+    size_t wire_len = len + TELEMETRY_DATAGRAM_OVERHEAD_BYTES; // 回線上では UDP/IP ヘッダが加わる
+    sched->tokens -= static_cast<double>(wire_len);
+    sched->seq++;
+    sched->frames_sent++;
+    sched->bytes_sent += wire_len;
+    if (is_keyframe)
+        *is_keyframe = keyframe;
+    return len;
+}
@@ -1,24 +1,124 @@
 #include "thruster_control.h"
 #include <cmath>     // For std::abs
 #include <algorithm> // For std::max, std::min
+#include <float.h>   // For FLT_MAX
 #include <stdio.h>   // For printf
+#include <mutex>     // For std::mutex (出力段の排他制御)
+#include <atomic>    // For std::atomic (出力の所有者管理)
+#include "thrust_curve.h"    // スティック入力 -> PWM 変換テーブル
+#include "monotonic_clock.h" // スルーレート制限の経過時間計測
+#include "bus_manager.h"     // PWM の書き込みはバス管理を経由する (bus_set_pwm_*)
+
+// --- 出力段の状態 ---
+// PWM出力はメインループ (通常制御) とウォッチドッグスレッド (フェイルセーフ) の両方から書き込まれるため、
+// ハードウェアへの書き込みと最終出力値の記録は output_mutex で保護する
+static std::mutex output_mutex;
+// 各スラスターチャンネルに最後に書き込んだPWM値 (クランプ後)。フェイルセーフのランプダウンの起点になる
+static int last_output_pwm[NUM_THRUSTERS] = {PWM_STOP, PWM_STOP, PWM_STOP, PWM_STOP, PWM_STOP, PWM_STOP};
+// 出力を占有している所有者のビットマスク (bit n = ThrusterOutputOwner n)
+static std::atomic<unsigned int> claimed_owners(0);
+// 通常制御で前回出力した時刻 (スルーレート制限の経過時間計算用。output_mutex で保護)
+static uint64_t last_control_update_ns = 0;
+// LED の現在のPWM値 (Yボタンで切り替え。再起動時に復元できるようファイルスコープに置く)
+static int current_led_pwm = LED_PWM_OFF;
+
+// 推力配分表: 各スラスターが機体座標系の各軸 (surge, sway, heave, yaw) の推力にどれだけ寄与するか
+//   Ch0 (前左): 右平行移動・右旋回, Ch1 (前右): 左平行移動・左旋回
+//   Ch2 (後左): 右平行移動・左旋回, Ch3 (後右): 左平行移動・右旋回
+//   Ch4-5: 前進
+// 両方向 ESC では負の配分は後退推力として出力する (例: 右平行移動は Ch0/Ch2 の前進と Ch1/Ch3 の後退)。
+// 一方向 ESC では負の配分は出力されず、対になるスラスターの正の配分だけで推力を出す。
+// 現在の構成には上下方向のスラスターがないため heave の列は 0 (深度保持・浮上を使う場合は該当チャンネルに設定する)。
+// heave の列が 0 の間は、浮上の動作は無効になり (thruster_surface_channel_mask)、深度の目標値は受け付けない
+static const float THRUSTER_ALLOCATION[NUM_THRUSTERS][THRUST_AXIS_COUNT] = {
+    // surge, sway, heave, yaw
+    {0.0f, 1.0f, 0.0f, 1.0f},   // Ch0
+    {0.0f, -1.0f, 0.0f, -1.0f}, // Ch1
+    {0.0f, 1.0f, 0.0f, -1.0f},  // Ch2
+    {0.0f, -1.0f, 0.0f, 1.0f},  // Ch3
+    {1.0f, 0.0f, 0.0f, 0.0f},   // Ch4
+    {1.0f, 0.0f, 0.0f, 0.0f},   // Ch5
+};
+
+// 飽和時に推力を割り当てる軸の順 (先の軸ほど縮小されにくい)
+// 旋回 (方位の保持・ジャイロによる安定化) を最後まで保ち、前進から縮小する
+static const ThrustAxis THRUST_AXIS_PRIORITY[THRUST_AXIS_COUNT] = {THRUST_AXIS_YAW, THRUST_AXIS_HEAVE, THRUST_AXIS_SWAY,
+                                                                   THRUST_AXIS_SURGE};
+
+// スラスター1基が出せる推力の範囲 (前進の最大推力を 1.0 とした割合)
+static const float THRUST_UPPER = 1.0f;
+#if THRUSTER_BIDIRECTIONAL
+static const float THRUST_LOWER = -THRUSTER_REVERSE_RATIO;
+#else
+static const float THRUST_LOWER = 0.0f;
+#endif
+
+// 手動操縦のジャイロによる補正 (推力要求の単位)
+static const float MANUAL_ROLL_KP = 0.0005f;           // 平行移動中のロール角速度 [deg/s] あたりの旋回補正
+static const float MANUAL_YAW_KP = 0.000375f;          // 平行移動中のヨー角速度 [deg/s] あたりの旋回補正
+static const float MANUAL_YAW_HOLD_THRESHOLD_DPS = 2.0f; // 旋回操作がないとき、これを超えるヨー角速度を打ち消す
+static const float MANUAL_YAW_HOLD_GAIN = 0.0064f;     // ヨー角速度 [deg/s] あたりの打ち消し (SetpointGains::yaw_rate_kp と同じ)
+static const float MANUAL_YAW_HOLD_LIMIT = 0.5f;       // 打ち消しの上限
+
+// 現在出力を書き込む権利を持つ所有者 (占有中の所有者のうち最も優先度の高いもの)
+static ThrusterOutputOwner current_output_owner()
+{
+    unsigned int mask = claimed_owners.load();
+    int owner = OUTPUT_OWNER_CONTROL;
+    for (int i = 0; i < 32; ++i)
+    {
+        if (mask & (1u << i))
+            owner = i;
+    }
+    return static_cast<ThrusterOutputOwner>(owner);
+}
 
 // --- ヘルパー関数 ---
 
-// 線形補正関数
-static float map_value(float x, float in_min, float in_max, float out_min, float out_max)
+// スティック入力 -> PWM の変換はコンパイル時生成のルックアップテーブル (thrust_curve.h) で行う
+static_assert(STICK_LUT_DEADZONE == JOYSTICK_DEADZONE, "thrust_curve.h のデッドゾーンを JOYSTICK_DEADZONE と一致させてください");
+
+// 出力段のスルーレート制限: 前回出力から max_step 以上変化しないように目標値を制限する
+// (急激な出力変化による電流スパイクを防ぐ。呼び出し側で output_mutex を保持していること)
+static int slew_limit(int channel, int target_pwm, int max_step)
+{
+    int current = last_output_pwm[channel];
+    if (target_pwm > current + max_step)
+        return current + max_step;
+    if (target_pwm < current - max_step)
+        return current - max_step;
+    return target_pwm;
+}
+
+// PWM値を設定するヘルパー (範囲チェックとデューティサイクル計算を含む)
+// 呼び出し側で output_mutex を保持していること
+static void set_thruster_pwm(int channel, int pulse_width_us);
+
+// 通常制御の出力を全スラスターに書き込む (スルーレート制限付き)。呼び出し側で output_mutex を保持していること
+// 出力が他の所有者に占有されている場合は何もせず false を返す。applied_pwm には実際に出力した値が入る
+static bool write_control_outputs(const int target_pwm[NUM_THRUSTERS], int applied_pwm[NUM_THRUSTERS])
 {
-    if (in_max == in_min)
+    if (current_output_owner() != OUTPUT_OWNER_CONTROL)
+        return false;
+    // スルーレート制限: 前回の更新からの経過時間で1チャンネルあたりの変化量を制限する
+    // (ループが止まっていた直後に大きく変化しないよう、経過時間は上限付き)
+    uint64_t now_ns = monotonic_now_ns();
+    uint64_t dt_ns = last_control_update_ns == 0 ? 0 : now_ns - last_control_update_ns;
+    if (dt_ns > THRUSTER_SLEW_MAX_DT_NS)
+        dt_ns = THRUSTER_SLEW_MAX_DT_NS;
+    last_control_update_ns = now_ns;
+    int max_step = static_cast<int>(THRUSTER_SLEW_US_PER_S * dt_ns / 1000000000ULL);
+    if (max_step < 1)
+        max_step = 1;
+
+    for (int i = 0; i < NUM_THRUSTERS; ++i)
     {
-        // ゼロ除算を回避
-        return out_min;
+        applied_pwm[i] = slew_limit(i, target_pwm[i], max_step);
+        set_thruster_pwm(i, applied_pwm[i]);
     }
-    // マッピング前に入力値を指定範囲内にクランプ
-    x = std::max(in_min, std::min(x, in_max));
-    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+    return true;
 }
 
-// PWM値を設定するヘルパー (範囲チェックとデューティサイクル計算を含む)
 static void set_thruster_pwm(int channel, int pulse_width_us)
 {
     // PWM値が有効な動作範囲内にあることを保証するためにクランプ
@@ -29,7 +129,11 @@ static void set_thruster_pwm(int channel, int pulse_width_us)
     float duty_cycle = static_cast<float>(clamped_pwm) / PWM_PERIOD_US;
 
     // 指定されたチャンネルのPWMデューティサイクルを設定
-    set_pwm_channel_duty_cycle(channel, duty_cycle);
+    bus_set_pwm_duty(channel, duty_cycle);
+    if (channel >= 0 && channel < NUM_THRUSTERS)
+    {
+        last_output_pwm[channel] = clamped_pwm; // 最終出力値を記録 (呼び出し側で output_mutex を保持)
+    }
 
     // デバッグ出力 (オプション)
     // printf("Ch%d: Set PWM = %d (Clamped: %d), Duty = %.4f\n", channel, pulse_width_us, clamped_pwm, duty_cycle);
@@ -39,258 +143,117 @@ static void set_thruster_pwm(int channel, int pulse_width_us)
 
 bool thruster_init()
 {
+    std::lock_guard<std::mutex> lock(output_mutex);
     printf("Enabling PWM\n");
-    set_pwm_enable(true);
+    bus_set_pwm_enable(true);
     printf("Setting PWM frequency to %.1f Hz\n", PWM_FREQUENCY);
-    set_pwm_freq_hz(PWM_FREQUENCY);
-    // すべてのスラスターをニュートラル/最小値に初期化？
+    bus_set_pwm_freq_hz(PWM_FREQUENCY);
+    // すべてのスラスターを停止 (推力ゼロ) に初期化
     for (int i = 0; i < NUM_THRUSTERS; ++i)
     {
-        set_thruster_pwm(i, PWM_MIN); // または適用可能であれば PWM_NEUTRAL
+        set_thruster_pwm(i, PWM_STOP);
     }
     // LEDチャンネルを初期状態 (OFF) に設定
+    current_led_pwm = LED_PWM_OFF;
     set_thruster_pwm(LED_PWM_CHANNEL, LED_PWM_OFF);
-    printf("Thrusters initialized to PWM %d. LED on Ch%d initialized to PWM %d (OFF).\n", PWM_MIN, LED_PWM_CHANNEL, LED_PWM_OFF);
+    printf("Thrusters initialized to PWM %d. LED on Ch%d initialized to PWM %d (OFF).\n", PWM_STOP, LED_PWM_CHANNEL, LED_PWM_OFF);
     return true; // 初期化関数が簡単にステータスを返さないと仮定
 }
 
+bool thruster_restore_outputs(const int pwm[NUM_THRUSTERS], int led_pwm)
+{
+    std::lock_guard<std::mutex> lock(output_mutex);
+    printf("Enabling PWM (warm restart)\n");
+    bus_set_pwm_enable(true);
+    bus_set_pwm_freq_hz(PWM_FREQUENCY);
+    // PWM_STOP を経由せず、異常終了の直前に出力していた値をそのまま書き直す
+    // (ハードウェアライブラリの init() が出力を初期化していても、最後の出力に戻る)
+    for (int i = 0; i < NUM_THRUSTERS; ++i)
+    {
+        set_thruster_pwm(i, pwm[i]);
+    }
+    current_led_pwm = (led_pwm == LED_PWM_ON) ? LED_PWM_ON : LED_PWM_OFF;
+    set_thruster_pwm(LED_PWM_CHANNEL, current_led_pwm);
+    // スルーレート制限は復元した出力を起点にする
+    last_control_update_ns = monotonic_now_ns();
+    printf("Thruster outputs restored: Ch0-5 = %d %d %d %d %d %d, LED %s\n", last_output_pwm[0], last_output_pwm[1],
+           last_output_pwm[2], last_output_pwm[3], last_output_pwm[4], last_output_pwm[5],
+           current_led_pwm == LED_PWM_ON ? "ON" : "OFF");
+    return true;
+}
+
 void thruster_disable()
 {
+    std::lock_guard<std::mutex> lock(output_mutex);
     printf("Disabling PWM\n");
-    // 無効にする前に、オプションですべてのスラスターをニュートラル/最小値に設定
+    // 無効にする前に、すべてのスラスターを停止 (推力ゼロ) に設定
     for (int i = 0; i < NUM_THRUSTERS; ++i)
     {
-        set_thruster_pwm(i, PWM_MIN); // または PWM_NEUTRAL
+        set_thruster_pwm(i, PWM_STOP);
     }
     // LEDチャンネルをOFFに設定
     set_thruster_pwm(LED_PWM_CHANNEL, LED_PWM_OFF);
-    set_pwm_enable(false);
+    bus_set_pwm_enable(false);
 }
 
-// 水平スラスター制御ロジック (updateThrustersFromSticksの内容を移植・調整)
-static void update_horizontal_thrusters(const GamepadData &data, const AxisData &gyro_data, int pwm_out[4])
+// 手動操縦の推力要求を求める関数
+// 左スティックX: 旋回、右スティックX: 平行移動、右スティックY: 前進/後退 (推力が入力に比例するようテーブルで変換)。
+// 各軸の要求をまとめて推力配分に渡すため、複数の操作を同時に行っても上限を超えた分は優先度に従って縮小される
+BodyThrust thruster_manual_demand(const GamepadData &data, const AxisData &gyro_data)
 {
-    // Initialize output PWM array to neutral/min
-    for (int i = 0; i < 4; ++i) // 出力PWM配列をニュートラル/最小値に初期化
-        pwm_out[i] = PWM_MIN;
+    BodyThrust demand;
+    demand.yaw = stick_demand_q15(data.leftThumbX) / static_cast<float>(THRUST_Q15_ONE);
+    demand.sway = stick_demand_q15(data.rightThumbX) / static_cast<float>(THRUST_Q15_ONE);
+    demand.surge = stick_demand_q15(data.rightThumbY) / static_cast<float>(THRUST_Q15_ONE);
 
     bool lx_active = std::abs(data.leftThumbX) > JOYSTICK_DEADZONE;
     bool rx_active = std::abs(data.rightThumbX) > JOYSTICK_DEADZONE;
 
-    int pwm_lx[4] = {PWM_MIN, PWM_MIN, PWM_MIN, PWM_MIN};
-    int pwm_rx[4] = {PWM_MIN, PWM_MIN, PWM_MIN, PWM_MIN};
-
-    // Lx (回転) の寄与 (PWM_MIN - PWM_NORMAL_MAX にマッピング)
-    if (data.leftThumbX < -JOYSTICK_DEADZONE)
-    { // 左旋回
-        int val = static_cast<int>(map_value(data.leftThumbX, -32768, -JOYSTICK_DEADZONE, PWM_NORMAL_MAX, PWM_MIN));
-        pwm_lx[1] = val; // Ch 1 (前右)
-        pwm_lx[2] = val; // Ch 2 (後左)
-    }
-    else if (data.leftThumbX > JOYSTICK_DEADZONE)
-    { // 右旋回
-        int val = static_cast<int>(map_value(data.leftThumbX, JOYSTICK_DEADZONE, 32767, PWM_MIN, PWM_NORMAL_MAX));
-        pwm_lx[0] = val; // Ch 0 (前左)
-        pwm_lx[3] = val; // Ch 3 (後右)
-    }
-
-    // Rx (平行移動) の寄与 (PWM_MIN - PWM_NORMAL_MAX にマッピング)
-    if (data.rightThumbX < -JOYSTICK_DEADZONE)
-    { // 左平行移動
-        int val = static_cast<int>(map_value(data.rightThumbX, -32768, -JOYSTICK_DEADZONE, PWM_NORMAL_MAX, PWM_MIN));
-        pwm_rx[1] = val; // Ch 1 (前右) - FR/RLが左に押すX構成と仮定
-        pwm_rx[3] = val; // Ch 3 (後右)  - FR/RLが左に押すX構成と仮定
-    }
-    else if (data.rightThumbX > JOYSTICK_DEADZONE)
-    { // 右平行移動
-        int val = static_cast<int>(map_value(data.rightThumbX, JOYSTICK_DEADZONE, 32767, PWM_MIN, PWM_NORMAL_MAX));
-        pwm_rx[0] = val; // Ch 0 (前左) - FL/RRが右に押すX構成と仮定
-        pwm_rx[2] = val; // Ch 2 (後左)  - FL/RRが右に押すX構成と仮定
-    }
-
-    // 両方のスティックがアクティブな場合、寄与を結合してブーストを適用
-    if (lx_active && rx_active)
-    {
-        const int boost_range = PWM_BOOST_MAX - PWM_NORMAL_MAX;
-        int abs_lx = std::abs(data.leftThumbX);
-        int abs_rx = std::abs(data.rightThumbX);
-        int weaker_input_abs = std::min(abs_lx, abs_rx);
-        int boost_add = static_cast<int>(map_value(weaker_input_abs, JOYSTICK_DEADZONE, 32768, 0, boost_range));
-
-        // スティックの方向に基づいてブーストされるチャンネルを決定
-        if (data.leftThumbX < 0 && data.rightThumbX < 0)
-        { // 左旋回 + 左平行移動 -> Ch 1 (FR) をブースト
-            pwm_out[0] = std::max(pwm_lx[0], pwm_rx[0]);
-            pwm_out[1] = std::max(pwm_lx[1], pwm_rx[1]) + boost_add;
-            pwm_out[2] = std::max(pwm_lx[2], pwm_rx[2]);
-            pwm_out[3] = std::max(pwm_lx[3], pwm_rx[3]);
-        }
-        else if (data.leftThumbX < 0 && data.rightThumbX > 0)
-        { // 左旋回 + 右平行移動 -> Ch 2 (RL) をブースト
-            pwm_out[0] = std::max(pwm_lx[0], pwm_rx[0]);
-            pwm_out[1] = std::max(pwm_lx[1], pwm_rx[1]);
-            pwm_out[2] = std::max(pwm_lx[2], pwm_rx[2]) + boost_add;
-            pwm_out[3] = std::max(pwm_lx[3], pwm_rx[3]);
-        }
-        else if (data.leftThumbX > 0 && data.rightThumbX < 0)
-        { // 右旋回 + 左平行移動 -> Ch 3 (RR) をブースト
-            pwm_out[0] = std::max(pwm_lx[0], pwm_rx[0]);
-            pwm_out[1] = std::max(pwm_lx[1], pwm_rx[1]);
-            pwm_out[2] = std::max(pwm_lx[2], pwm_rx[2]);
-            pwm_out[3] = std::max(pwm_lx[3], pwm_rx[3]) + boost_add;
-        }
-        else
-        { // 右旋回 + 右平行移動 -> Ch 0 (FL) をブースト
-            pwm_out[0] = std::max(pwm_lx[0], pwm_rx[0]) + boost_add;
-            pwm_out[1] = std::max(pwm_lx[1], pwm_rx[1]);
-            pwm_out[2] = std::max(pwm_lx[2], pwm_rx[2]);
-            pwm_out[3] = std::max(pwm_lx[3], pwm_rx[3]);
-        }
-    }
-    else
-    {
-        // 一方のスティックのみアクティブ、またはどちらも非アクティブ: 単純な組み合わせ (最大値)
-        for (int i = 0; i < 4; ++i)
-        {
-            pwm_out[i] = std::max(pwm_lx[i], pwm_rx[i]);
-        }
-    }
-
-    // --- ジャイロによるロール安定化補正 (エルロン操作時) ---
-    // rx_active は data.rightThumbX (エルロン操作) がデッドゾーン外であるかを示すフラグ
-    if (rx_active) // エルロン操作中のみ安定化制御を行う
+    // --- ジャイロによるロール・ヨー安定化補正 (平行移動中) ---
+    // 仮定: gyro_data.x がロール、gyro_data.z がヨーの角速度 (右が正、deg/s)
+    // 右へのロール・ヨーには左旋回 (Ch1/Ch2 側) の推力を加える
+    if (rx_active)
     {
-        // --- ロール補正 ---
-        // 仮定: gyro_data.x がロール軸の角速度 (右へのロールが正)
-        //       単位が deg/s の場合を想定。rad/s ならKp値を調整。
-        float roll_rate = gyro_data.x;
-
-        // P制御ゲイン (要調整: この値は非常に小さい値から試してください)
-        const float Kp_roll = 0.2f; // ★★★ 要調整 ★★★
-
-        // 補正値の計算
-        // roll_rate > 0 (右にロール) の場合、左回転の力を加えたい。
-        // 左回転は Ch1(前右)とCh2(後左)を強く、Ch0(前左)とCh3(後右)を弱くする。
-        // correction_pwm_roll が正の時に左回転を強める。
-        int correction_pwm_roll = static_cast<int>(roll_rate * Kp_roll);
-
-        // pwm_out にロール補正を適用 (回転スラスターのバランスを調整)
-        // Ch0 (前左): 減らす (左回転のため)
-        // Ch1 (前右): 増やす (左回転のため)
-        // Ch2 (後左): 増やす (左回転のため)
-        // Ch3 (後右): 減らす (左回転のため)
-        pwm_out[0] -= correction_pwm_roll;
-        pwm_out[1] += correction_pwm_roll;
-        pwm_out[2] += correction_pwm_roll;
-        pwm_out[3] -= correction_pwm_roll;
-
-        // --- ヨー補正 (Z軸回転の調整) ---
-        // 仮定: gyro_data.z がヨー軸の角速度 (右へのヨーイングが正)
-        //       単位が deg/s の場合を想定。rad/s ならKp値を調整。
-        //       センサーのZ軸が機体のヨー軸と一致しているか、符号が正しいか確認してください。
-        float yaw_rate = gyro_data.z;
-
-        // P制御ゲイン (ヨー用 - 要調整)
-        const float Kp_yaw = 0.15f; // ★★★ 要調整 ★★★ (ロール用とは別に調整)
-
-        // ヨー補正値の計算
-        // yaw_rate > 0 (右にヨー) の場合、左ヨーの力を加えたい。
-        // 左ヨーは Ch1(前右)とCh2(後左)を強く、Ch0(前左)とCh3(後右)を弱くする (回転制御と同じ)。
-        // correction_pwm_yaw が正の時に左ヨーを強める。
-        int correction_pwm_yaw = static_cast<int>(yaw_rate * Kp_yaw);
-
-        // pwm_out にヨー補正を適用 (回転スラスターのバランスを調整)
-        pwm_out[0] -= correction_pwm_yaw; // 左ヨーを助ける (Ch0を弱める)
-        pwm_out[1] += correction_pwm_yaw; // 左ヨーを助ける (Ch1を強める)
-        pwm_out[2] += correction_pwm_yaw; // 左ヨーを助ける (Ch2を強める)
-        pwm_out[3] -= correction_pwm_yaw; // 左ヨーを助ける (Ch3を弱める)
-    }
-
-    // --- GyroによるYaw補正 (Rx入力時にZ軸回転しないよう補正) ---
-    if (!lx_active)
-    {
-        // GyroのZ軸角速度が±一定以上なら補正を行う
-        const float yaw_threshold_dps = 2.0f; // deg/s単位のしきい値（調整可能）
-        const float yaw_gain = 50.0f;         // 補正のゲイン（調整可能）
-
-        float yaw_rate = -gyro_data.z; // Z軸の角速度[deg/s]
-
-        if (std::abs(yaw_rate) > yaw_threshold_dps)
-        {
-            // Yaw補正のLx寄与を生成（符号反転：回転を打ち消す）
-            int yaw_pwm = static_cast<int>(yaw_rate * -yaw_gain);
-
-            // yaw_pwmを安全な範囲にクリップ（±で出る値を考慮してオフセット加算）
-            yaw_pwm = std::max(-400, std::min(400, yaw_pwm));
-
-            // 既存のpwm_rxにLx補正を加える
-            // Lxと同様のチャネルへ適用（Lxと同じ方向に推力を加えることで補正）
-            if (yaw_pwm < 0)
-            {
-                // 左旋回を打ち消す（＝右回転） → Ch 0,3を加算
-                pwm_out[0] = std::min(PWM_BOOST_MAX, pwm_out[0] + std::abs(yaw_pwm));
-                pwm_out[3] = std::min(PWM_BOOST_MAX, pwm_out[3] + std::abs(yaw_pwm));
-            }
-            else
-            {
-                // 右旋回を打ち消す（＝左回転） → Ch 1,2を加算
-                pwm_out[1] = std::min(PWM_BOOST_MAX, pwm_out[1] + yaw_pwm);
-                pwm_out[2] = std::min(PWM_BOOST_MAX, pwm_out[2] + yaw_pwm);
-            }
-        }
+        demand.yaw -= MANUAL_ROLL_KP * gyro_data.x + MANUAL_YAW_KP * gyro_data.z;
     }
 
-} // 最終的なクランプは set_thruster_pwm で行われる
-
-// 前進/後退スラスター制御ロジック
-static int calculate_forward_reverse_pwm(int value)
-{
-    int pulse_width;
-    // 定数を直接使用 (ヘッダーファイルで定義されている値)
-    const int current_max_pwm = PWM_BOOST_MAX; // 1900
-    const int current_min_pwm = PWM_MIN;       // 1100
-
-    // value が JOYSTICK_DEADZONE 以下 (後退方向またはデッドゾーン内) の場合
-    if (value <= JOYSTICK_DEADZONE)
+    // --- 旋回操作がないときのヨー角速度の打ち消し (平行移動・前進で回頭しないように) ---
+    if (!lx_active && std::abs(gyro_data.z) > MANUAL_YAW_HOLD_THRESHOLD_DPS)
     {
-        // PWMを PWM_MIN (1100) に固定
-        pulse_width = PWM_MIN;
+        float hold = -gyro_data.z * MANUAL_YAW_HOLD_GAIN;
+        demand.yaw += std::max(-MANUAL_YAW_HOLD_LIMIT, std::min(MANUAL_YAW_HOLD_LIMIT, hold));
     }
-    else
-    { // value > JOYSTICK_DEADZONE (前進)
-        // 前進推力: 入力 JOYSTICK_DEADZONE ~ 32767 を 出力 PWM_MIN ~ PWM_BOOST_MAX にマッピング
-        pulse_width = static_cast<int>(map_value(value, JOYSTICK_DEADZONE, 32767, PWM_MIN, current_max_pwm));
-    }
-    // 最終的なクランプ処理は set_thruster_pwm 関数内で行われます
-    return pulse_width;
+    return demand;
 }
 
 // メインの更新関数
-void thruster_update(const GamepadData &gamepad_data, const AxisData &gyro_data)
+void thruster_update(const GamepadData &gamepad_data, const AxisData &gyro_data, ThrustAllocation *report)
 {
-    int horizontal_pwm[4];
-    update_horizontal_thrusters(gamepad_data, gyro_data, horizontal_pwm);
-
-    // 元の main() に基づき、チャンネル4が前進/後退用と仮定
-    int forward_pwm = calculate_forward_reverse_pwm(gamepad_data.rightThumbY);
+    // スティックとジャイロから推力要求を求め、目標値制御と同じ推力配分でPWMに変換する
+    int target_pwm[NUM_THRUSTERS];
+    thruster_mix(thruster_manual_demand(gamepad_data, gyro_data), target_pwm, report);
 
     // --- PWM信号をスラスターに送信 ---
+    int applied_pwm[NUM_THRUSTERS];
+    std::lock_guard<std::mutex> lock(output_mutex);
+    if (!write_control_outputs(target_pwm, applied_pwm))
+    {
+        // フェイルセーフ中などで出力が占有されている場合は書き込まない (最後の出力を占有側が管理する)
+        return;
+    }
+
     printf("--- Thruster and LED PWM ---\n");
     // 水平スラスター
     for (int i = 0; i < 4; ++i)
     {
-        set_thruster_pwm(i, horizontal_pwm[i]);                // 水平スラスターPWM設定
-        printf("Ch%d: Hori PWM = %d\n", i, horizontal_pwm[i]); // デバッグ
+        printf("Ch%d: Hori PWM = %d (target %d)\n", i, applied_pwm[i], target_pwm[i]); // デバッグ
     }
     // 前進/後退スラスター
-    set_thruster_pwm(4, forward_pwm);
-    printf("Ch4: FwdRev PWM = %d\n", forward_pwm);
-    set_thruster_pwm(5, forward_pwm);
-    printf("Ch5: FwdRev PWM = %d\n", forward_pwm); // Ch5のデバッグ出力追加
+    printf("Ch4: FwdRev PWM = %d (target %d)\n", applied_pwm[4], target_pwm[4]);
+    printf("Ch5: FwdRev PWM = %d (target %d)\n", applied_pwm[5], target_pwm[5]); // Ch5のデバッグ出力追加
 
     // --- LED制御 ---
-    // 静的変数を導入してLEDの現在のPWM値とYボタンの前回状態を保持
-    static int current_led_pwm = LED_PWM_OFF; // 初期状態は消灯
+    // LEDの現在のPWM値 (current_led_pwm) とYボタンの前回状態を保持
     static bool y_button_previously_pressed = false;
 
     // 現在のYボタンの押下状態を取得
@@ -324,6 +287,7 @@ void thruster_update(const GamepadData &gamepad_data, const AxisData &gyro_data)
 void thruster_set_all_pwm(int pwm_value)
 {
     // printf("フェイルセーフ: 全スラスターをPWM %d に設定、LEDをオフ\n", pwm_value);
+    std::lock_guard<std::mutex> lock(output_mutex);
     for (int i = 0; i < NUM_THRUSTERS; ++i) // NUM_THRUSTERS は Ch0 から Ch5 までを想定
     {
         // set_thruster_pwm はクランプ処理を含むので安全
@@ -332,3 +296,244 @@ void thruster_set_all_pwm(int pwm_value)
     // フェイルセーフ時にはLEDもオフにする
     set_thruster_pwm(LED_PWM_CHANNEL, LED_PWM_OFF);
 }
+
+// 出力を占有する関数 (占有中は優先度の低い所有者からの書き込みが無視される)
+void thruster_claim_output(ThrusterOutputOwner owner)
+{
+    claimed_owners.fetch_or(1u << owner);
+}
+
+// 出力の占有を解除する関数
+void thruster_release_output(ThrusterOutputOwner owner)
+{
+    claimed_owners.fetch_and(~(1u << owner));
+}
+
+// 指定した所有者として1チャンネルのPWM値を設定する関数
+// 所有者が現在出力を書き込む権利を持たない場合は何もせず false を返す
+bool thruster_owner_set_pwm(ThrusterOutputOwner owner, int channel, int pwm_value)
+{
+    std::lock_guard<std::mutex> lock(output_mutex);
+    if (current_output_owner() != owner)
+    {
+        return false;
+    }
+    set_thruster_pwm(channel, pwm_value);
+    return true;
+}
+
+// 指定した所有者として全スラスターを同じPWM値にし、LEDをオフにする関数
+// (thruster_set_all_pwm と違い、より優先度の高い所有者が出力を占有している場合は何もしない)
+bool thruster_owner_set_all_pwm(ThrusterOutputOwner owner, int pwm_value)
+{
+    std::lock_guard<std::mutex> lock(output_mutex);
+    if (current_output_owner() != owner)
+    {
+        return false;
+    }
+    for (int i = 0; i < NUM_THRUSTERS; ++i)
+    {
+        set_thruster_pwm(i, pwm_value);
+    }
+    set_thruster_pwm(LED_PWM_CHANNEL, LED_PWM_OFF);
+    return true;
+}
+
+// 各スラスターチャンネルに最後に書き込んだPWM値を取得する関数
+void thruster_get_outputs(int pwm_out[NUM_THRUSTERS])
+{
+    std::lock_guard<std::mutex> lock(output_mutex);
+    for (int i = 0; i < NUM_THRUSTERS; ++i)
+    {
+        pwm_out[i] = last_output_pwm[i];
+    }
+}
+
+int thruster_get_led_pwm()
+{
+    std::lock_guard<std::mutex> lock(output_mutex);
+    return current_led_pwm;
+}
+
+// 軸ごとの要求 1.0 に対応する配分の倍率: その軸だけを要求したときに、いずれかのスラスターがちょうど上限に達する倍率
+// (後退は前進より弱いため、後退を使う軸・向きでは 1.0 より小さい)。[axis][0] は正、[1] は負の向き
+// 毎周期の配分で除算と配分表の参照を繰り返さないよう、各スラスターへの寄与と、上限までの余裕を倍率に直す係数も前計算しておく
+struct AxisMixTable
+{
+    float scale[THRUST_AXIS_COUNT][2];
+    float contribution[THRUST_AXIS_COUNT][2][NUM_THRUSTERS]; // 要求の大きさ 1.0 あたりの推力 (配分 * 向き * scale)
+    float upper_gain[THRUST_AXIS_COUNT][2][NUM_THRUSTERS];   // 前進の上限までの余裕 -> 倍率 (寄与が正のとき 1 / 寄与、それ以外 0)
+    float lower_gain[THRUST_AXIS_COUNT][2][NUM_THRUSTERS];   // 後退の上限までの余裕 -> 倍率 (両方向 ESC で寄与が負のとき 1 / -寄与、それ以外 0)
+    float unlimited[THRUST_AXIS_COUNT][2][NUM_THRUSTERS];    // 上限で制限しないスラスターの倍率の上限 (制限するスラスターは 0)
+};
+
+static AxisMixTable compute_axis_mix_table()
+{
+    AxisMixTable table;
+    for (int a = 0; a < THRUST_AXIS_COUNT; ++a)
+    {
+        for (int dir = 0; dir < 2; ++dir)
+        {
+            float sign = dir == 0 ? 1.0f : -1.0f;
+            float scale = 0.0f; // 寄与するスラスターがない軸は 0 (要求しても推力は出ない)
+            bool found = false;
+            for (int i = 0; i < NUM_THRUSTERS; ++i)
+            {
+                float c = THRUSTER_ALLOCATION[i][a] * sign;
+                float limit;
+                if (c > 0.0f)
+                    limit = THRUST_UPPER / c;
+                else if (c < 0.0f && THRUST_LOWER < 0.0f)
+                    limit = THRUST_LOWER / c;
+                else
+                    continue; // 一方向 ESC の負の配分は対になるスラスターが受け持つ
+                scale = found ? std::min(scale, limit) : limit;
+                found = true;
+            }
+            table.scale[a][dir] = scale;
+            for (int i = 0; i < NUM_THRUSTERS; ++i)
+            {
+                float c = THRUSTER_ALLOCATION[i][a] * sign * scale;
+                bool limited_up = c > 0.0f;
+                bool limited_down = c < 0.0f && THRUST_LOWER < 0.0f;
+                table.contribution[a][dir][i] = c;
+                table.upper_gain[a][dir][i] = limited_up ? 1.0f / c : 0.0f;
+                table.lower_gain[a][dir][i] = limited_down ? -1.0f / c : 0.0f;
+                table.unlimited[a][dir][i] = limited_up || limited_down ? 0.0f : FLT_MAX;
+            }
+        }
+    }
+    return table;
+}
+
+// 配分の前計算 (THRUSTER_ALLOCATION から起動時に1回だけ作る)
+static const AxisMixTable AXIS_MIX = compute_axis_mix_table();
+
+// スラスター1基の推力をPWM値に変換する (推力特性テーブルで線形化。スティック操作と同じ推力曲線)
+// thruster_mix の全チャンネルの変換で呼び出しのオーバーヘッドを除くため、本体はインライン展開できるようにしておく
+static inline int pwm_from_thrust(float thrust)
+{
+#if THRUSTER_BIDIRECTIONAL
+    if (thrust < 0.0f)
+    {
+        // 後退: PWM_NEUTRAL から PWM_MIN 側へ (PWM_MIN で後退の最大推力)
+        int32_t thrust_q15 = static_cast<int32_t>(std::min(1.0f, -thrust / THRUSTER_REVERSE_RATIO) * 32767.0f);
+        int32_t pwm_q15 = thrust_q15 > 0 ? pwm_q15_from_thrust_q15(thrust_q15) : 0;
+        return PWM_NEUTRAL - ((pwm_q15 * (PWM_NEUTRAL - PWM_MIN) + (1 << 14)) >> 15);
+    }
+#endif
+    // 前進: PWM_STOP から PWM_BOOST_MAX 側へ (一方向 ESC では負の推力は停止)
+    int32_t thrust_q15 = static_cast<int32_t>(std::min(1.0f, std::max(0.0f, thrust)) * 32767.0f);
+    int32_t pwm_q15 = thrust_q15 > 0 ? pwm_q15_from_thrust_q15(thrust_q15) : 0;
+    return PWM_STOP + ((pwm_q15 * (PWM_BOOST_MAX - PWM_STOP) + (1 << 14)) >> 15); // 四捨五入 (最大推力で PWM_BOOST_MAX)
+}
+
+// スラスター1基の推力をPWM値に変換する関数
+int thrust_to_pwm(float thrust)
+{
+    return pwm_from_thrust(thrust);
+}
+
+// 機体座標系の推力要求を各スラスターのPWM値に変換する関数
+// 優先度の高い軸から順に推力を割り当て、各軸はスラスターの残りの範囲 (前進の上限・後退の上限) に収まる倍率まで縮小する。
+// そのため上限を超える要求では、旋回が保たれたまま前進・平行移動が縮小され、軸の比率は崩れても優先する軸の制御は失われない。
+void thruster_mix(const BodyThrust &demand, int pwm_out[NUM_THRUSTERS], ThrustAllocation *report)
+{
+    const float axes[THRUST_AXIS_COUNT] = {demand.surge, demand.sway, demand.heave, demand.yaw};
+    float achieved[THRUST_AXIS_COUNT] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float authority[THRUST_AXIS_COUNT] = {1.0f, 1.0f, 1.0f, 1.0f};
+    float thrust[NUM_THRUSTERS] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    bool allocated = false; // 先の軸にすでに推力を割り当てたか
+    for (int p = 0; p < THRUST_AXIS_COUNT; ++p)
+    {
+        int a = THRUST_AXIS_PRIORITY[p];
+        float d = std::max(-1.0f, std::min(1.0f, axes[a]));
+        if (d == 0.0f)
+            continue;
+        int dir = d > 0.0f ? 0 : 1;
+        if (!(AXIS_MIX.scale[a][dir] > 0.0f))
+        {
+            achieved[a] = 0.0f; // この軸に割り当てられるスラスターがない
+            authority[a] = 0.0f;
+            continue;
+        }
+        // 要求の大きさ m で割り当てられる割合 k: 各スラスターの上限までの余裕 / (m * 寄与) の最小値 (1.0 を超えない)。
+        // 分岐せずに全スラスターの余裕を求め、除算は軸ごとに1回にする。
+        // 最初に割り当てる軸は全スラスターが 0 のため、scale の定義から常に全量 (k = 1) を割り当てられる
+        const float *contribution = AXIS_MIX.contribution[a][dir];
+        float magnitude = dir == 0 ? d : -d;
+        float k = 1.0f;
+        if (allocated)
+        {
+            const float *upper_gain = AXIS_MIX.upper_gain[a][dir];
+            const float *lower_gain = AXIS_MIX.lower_gain[a][dir];
+            const float *unlimited = AXIS_MIX.unlimited[a][dir];
+            float room[NUM_THRUSTERS];
+            for (int i = 0; i < NUM_THRUSTERS; ++i)
+            {
+                room[i] = std::max(0.0f, THRUST_UPPER - thrust[i]) * upper_gain[i] +
+                          std::max(0.0f, thrust[i] - THRUST_LOWER) * lower_gain[i] + unlimited[i];
+            }
+            // 最小値は依存の連鎖が短くなるよう対ごとに取る
+            static_assert(NUM_THRUSTERS == 6, "余裕の最小値の計算をチャンネル数に合わせてください");
+            float headroom = std::min(std::min(std::min(room[0], room[1]), std::min(room[2], room[3])),
+                                      std::min(room[4], room[5]));
+            k = std::min(1.0f, headroom / magnitude);
+        }
+        allocated = true;
+        float step = k * magnitude;
+        for (int i = 0; i < NUM_THRUSTERS; ++i)
+            thrust[i] += step * contribution[i];
+        achieved[a] = d * k;
+        authority[a] = k;
+    }
+    for (int i = 0; i < NUM_THRUSTERS; ++i)
+    {
+        pwm_out[i] = pwm_from_thrust(thrust[i]);
+    }
+
+    if (report)
+    {
+        *report = ThrustAllocation();
+        report->achieved.surge = achieved[THRUST_AXIS_SURGE];
+        report->achieved.sway = achieved[THRUST_AXIS_SWAY];
+        report->achieved.heave = achieved[THRUST_AXIS_HEAVE];
+        report->achieved.yaw = achieved[THRUST_AXIS_YAW];
+        for (int a = 0; a < THRUST_AXIS_COUNT; ++a)
+        {
+            report->authority[a] = authority[a];
+            report->min_authority = std::min(report->min_authority, authority[a]);
+            if (authority[a] < 0.999f)
+                report->saturated_axes |= 1u << a;
+        }
+    }
+}
+
+// 目標値制御の出力をスラスターに書き込む関数 (LEDは手動操縦で設定した状態のまま)
+void thruster_apply_pwm(const int pwm[NUM_THRUSTERS])
+{
+    int applied_pwm[NUM_THRUSTERS];
+    std::lock_guard<std::mutex> lock(output_mutex);
+    write_control_outputs(pwm, applied_pwm);
+}
+
+unsigned int thruster_heave_channel_mask()
+{
+    unsigned int mask = 0;
+    for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+    {
+        if (THRUSTER_ALLOCATION[ch][THRUST_AXIS_HEAVE] > 0.0f)
+            mask |= 1u << ch;
+    }
+    return mask;
+}
+
+unsigned int thruster_surface_channel_mask(unsigned int requested_mask)
+{
+    unsigned int heave_mask = thruster_heave_channel_mask();
+    if (requested_mask == 0)
+        return heave_mask;
+    if ((requested_mask & ~heave_mask) != 0)
+        return 0; // 上向きの推力を出せないチャンネルを含む
+    return requested_mask;
+}
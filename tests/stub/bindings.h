@@ -0,0 +1,48 @@
+#ifndef BINDINGS_STUB_H
+#define BINDINGS_STUB_H
+
+// navigator-lib の C バインディング (bindings.h) のテスト用スタブ
+// 本物のヘッダーと同じ関数シグネチャを持ち、実装は bindings_stub.cpp でメモリ上の値を返す/記録する。
+// これにより Navigator ハードウェアや navigator-lib がない Linux 環境でもテスト・ベンチマークをビルドできる。
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum AdcChannel
+{
+    Ch0,
+    Ch1,
+    Ch2,
+    Ch3,
+} AdcChannel;
+
+typedef struct AxisData
+{
+    float x;
+    float y;
+    float z;
+} AxisData;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void init(void);
+    float read_temp(void);
+    float read_pressure(void);
+    float read_adc(AdcChannel channel);
+    void read_adc_all(float *adc_array, uintptr_t length);
+    AxisData read_mag(void);
+    AxisData read_accel(void);
+    AxisData read_gyro(void);
+    bool read_leak(void);
+    void set_pwm_enable(bool state);
+    void set_pwm_freq_hz(float freq);
+    void set_pwm_channel_duty_cycle(uintptr_t channel, float duty_cycle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BINDINGS_STUB_H
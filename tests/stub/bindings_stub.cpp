@@ -0,0 +1,97 @@
+#include "bindings_stub.h"
+#include <string.h> // memset を使用するため
+
+static StubHardwareState stub_state;
+
+StubHardwareState &stub_hardware()
+{
+    return stub_state;
+}
+
+void stub_hardware_reset()
+{
+    memset(&stub_state, 0, sizeof(stub_state));
+    stub_state.temperature = 20.0f;
+    stub_state.pressure = 1013.25f;
+    stub_state.accel.z = 9.81f;
+    stub_state.mag.x = 0.3f;
+}
+
+int stub_pwm_us(int channel)
+{
+    // thruster_control.cpp と同じ周期 (50Hz = 20000us) で換算する
+    return static_cast<int>(stub_state.pwm_duty[channel] * 20000.0f + 0.5f);
+}
+
+extern "C"
+{
+    void init(void)
+    {
+    }
+
+    float read_temp(void)
+    {
+        stub_state.sensor_reads++;
+        return stub_state.temperature;
+    }
+
+    float read_pressure(void)
+    {
+        stub_state.sensor_reads++;
+        return stub_state.pressure;
+    }
+
+    float read_adc(AdcChannel channel)
+    {
+        stub_state.sensor_reads++;
+        return stub_state.adc[channel];
+    }
+
+    void read_adc_all(float *adc_array, uintptr_t length)
+    {
+        stub_state.sensor_reads++;
+        for (uintptr_t i = 0; i < length && i < 4; ++i)
+            adc_array[i] = stub_state.adc[i];
+    }
+
+    AxisData read_mag(void)
+    {
+        stub_state.sensor_reads++;
+        return stub_state.mag;
+    }
+
+    AxisData read_accel(void)
+    {
+        stub_state.sensor_reads++;
+        return stub_state.accel;
+    }
+
+    AxisData read_gyro(void)
+    {
+        stub_state.sensor_reads++;
+        return stub_state.gyro;
+    }
+
+    bool read_leak(void)
+    {
+        stub_state.sensor_reads++;
+        return stub_state.leak;
+    }
+
+    void set_pwm_enable(bool state)
+    {
+        stub_state.pwm_enabled = state;
+    }
+
+    void set_pwm_freq_hz(float freq)
+    {
+        stub_state.pwm_freq_hz = freq;
+    }
+
+    void set_pwm_channel_duty_cycle(uintptr_t channel, float duty_cycle)
+    {
+        if (channel < STUB_PWM_CHANNELS)
+            stub_state.pwm_duty[channel] = duty_cycle;
+        stub_state.pwm_writes++;
+    }
+}
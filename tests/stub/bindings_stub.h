@@ -0,0 +1,34 @@
+#ifndef BINDINGS_STUB_CONTROL_H
+#define BINDINGS_STUB_CONTROL_H
+
+#include "bindings.h" // AxisData を使用するため
+
+#define STUB_PWM_CHANNELS 16 // Navigator の PWM チャンネル数
+
+// スタブが返すセンサー値と、書き込まれた PWM 出力を保持する構造体
+// テストから値を設定し、モジュールがハードウェアに何を書き込んだかを確認するために使う
+struct StubHardwareState
+{
+    float temperature;
+    float pressure;
+    bool leak;
+    float adc[4];
+    AxisData accel;
+    AxisData gyro;
+    AxisData mag;
+
+    bool pwm_enabled;
+    float pwm_freq_hz;
+    float pwm_duty[STUB_PWM_CHANNELS];
+    unsigned int pwm_writes;  // set_pwm_channel_duty_cycle の呼び出し回数
+    unsigned int sensor_reads; // read_* の呼び出し回数
+};
+
+// スタブの状態への参照を返す
+StubHardwareState &stub_hardware();
+// スタブの状態を既定値に戻す
+void stub_hardware_reset();
+// 指定チャンネルに最後に書き込まれたデューティ比をパルス幅 (マイクロ秒) に換算して返す
+int stub_pwm_us(int channel);
+
+#endif // BINDINGS_STUB_CONTROL_H
@@ -0,0 +1,217 @@
+#include "test_framework.h"
+#include "adc_filter.h"
+#include <algorithm>
+#include <math.h>
+
+// 1チャンネル分の参照実装 (ベクトル化した実装と同じ段を1サンプルずつスカラーで計算する)
+struct ScalarAdcFilter
+{
+    AdcFilterConfig config;
+    float median_window[ADC_FILTER_MAX_MEDIAN];
+    float average_window[ADC_FILTER_MAX_AVERAGE];
+    uint32_t median_pos = 0;
+    uint32_t average_pos = 0;
+    float y = 0.0f;
+    bool primed = false;
+
+    float step(float x)
+    {
+        if (!primed)
+        {
+            std::fill(median_window, median_window + config.median_taps, x);
+            std::fill(average_window, average_window + config.average_taps, x);
+            y = x;
+            primed = true;
+        }
+        median_window[median_pos] = x;
+        median_pos = (median_pos + 1) % config.median_taps;
+        float sorted[ADC_FILTER_MAX_MEDIAN];
+        for (uint32_t i = 0; i < config.median_taps; ++i)
+        {
+            // 挿入ソート
+            uint32_t j = i;
+            for (; j > 0 && sorted[j - 1] > median_window[i]; --j)
+                sorted[j] = sorted[j - 1];
+            sorted[j] = median_window[i];
+        }
+        x = sorted[config.median_taps / 2];
+        average_window[average_pos] = x;
+        average_pos = (average_pos + 1) % config.average_taps;
+        float sum = 0.0f;
+        for (uint32_t i = 0; i < config.average_taps; ++i)
+            sum += average_window[i];
+        x = sum / config.average_taps;
+        y += config.iir_alpha * (x - y);
+        return y;
+    }
+};
+
+// 再現可能な雑音 (線形合同法)
+static float noise(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return static_cast<float>(*state >> 8) / 16777216.0f - 0.5f;
+}
+
+TEST(adc_filter_rejects_invalid_config)
+{
+    AdcFilterBank bank;
+    AdcFilterConfig config;
+    CHECK(adc_filter_init(&bank, config));
+    config.median_taps = 4; // 偶数
+    CHECK(!adc_filter_init(&bank, config));
+    config = AdcFilterConfig();
+    config.median_taps = ADC_FILTER_MAX_MEDIAN + 2;
+    CHECK(!adc_filter_init(&bank, config));
+    config = AdcFilterConfig();
+    config.average_taps = 0;
+    CHECK(!adc_filter_init(&bank, config));
+    config = AdcFilterConfig();
+    config.iir_alpha = 0.0f;
+    CHECK(!adc_filter_init(&bank, config));
+    config = AdcFilterConfig();
+    config.decimation = ADC_FILTER_MAX_BLOCK + 1;
+    CHECK(!adc_filter_init(&bank, config));
+}
+
+TEST(adc_filter_decimates_across_blocks_without_startup_ramp)
+{
+    AdcFilterBank bank;
+    AdcFilterConfig config;
+    config.decimation = 10;
+    CHECK(adc_filter_init(&bank, config));
+    float samples[25][ADC_FILTER_CHANNELS];
+    for (int n = 0; n < 25; ++n)
+    {
+        samples[n][0] = 12.0f;
+        samples[n][1] = 0.5f;
+        samples[n][2] = -1.0f;
+        samples[n][3] = 3.3f;
+    }
+    float out[4][ADC_FILTER_CHANNELS];
+    // 最初のサンプルで状態を埋めるため、一定の入力は最初の出力からそのまま出る
+    CHECK_EQ(2, adc_filter_process(&bank, samples, 25, out, 4));
+    CHECK_NEAR(12.0f, out[0][0], 1e-5f);
+    CHECK_NEAR(0.5f, out[0][1], 1e-6f);
+    CHECK_NEAR(-1.0f, out[1][2], 1e-6f);
+    CHECK_NEAR(3.3f, out[1][3], 1e-6f);
+    // 間引きの位置はブロックをまたいで引き継がれる (25 + 5 = 30 個目で3つ目の出力)
+    CHECK_EQ(0, adc_filter_process(&bank, samples, 4, out, 4));
+    CHECK_EQ(1, adc_filter_process(&bank, samples, 1, out, 4));
+    CHECK_EQ(0, adc_filter_process(&bank, samples, 0, out, 4));
+}
+
+TEST(adc_filter_rejects_block_that_overflows_output)
+{
+    AdcFilterBank bank;
+    AdcFilterConfig config;
+    config.decimation = 10;
+    CHECK(adc_filter_init(&bank, config));
+    float samples[25][ADC_FILTER_CHANNELS];
+    for (int n = 0; n < 25; ++n)
+    {
+        for (int ch = 0; ch < ADC_FILTER_CHANNELS; ++ch)
+            samples[n][ch] = 2.0f;
+    }
+    float out[2][ADC_FILTER_CHANNELS];
+    // 出力先1つ分に2つの出力が出るブロックは処理しない (出力を黙って捨てない)
+    CHECK_EQ(-1, adc_filter_process(&bank, samples, 25, out, 1));
+    CHECK_EQ(0u, bank.decimation_count);
+    CHECK(!bank.primed);
+    // 分割すれば同じサンプルをすべて処理できる
+    CHECK_EQ(2, adc_filter_process(&bank, samples, 20, out, 2));
+    CHECK_EQ(0, adc_filter_process(&bank, samples, 5, out, 0));
+    CHECK_EQ(5u, bank.decimation_count);
+}
+
+TEST(adc_filter_median_removes_single_spikes_per_channel)
+{
+    AdcFilterBank bank;
+    AdcFilterConfig config;
+    config.median_taps = 3;
+    config.average_taps = 1;
+    config.iir_alpha = 1.0f;
+    config.decimation = 1;
+    CHECK(adc_filter_init(&bank, config));
+    float samples[12][ADC_FILTER_CHANNELS];
+    for (int n = 0; n < 12; ++n)
+    {
+        for (int ch = 0; ch < ADC_FILTER_CHANNELS; ++ch)
+            samples[n][ch] = 1.0f + ch;
+    }
+    samples[5][2] = 50.0f; // チャンネル2だけの単発のスパイク
+    samples[8][0] = -50.0f;
+    float out[12][ADC_FILTER_CHANNELS];
+    CHECK_EQ(12, adc_filter_process(&bank, samples, 12, out, 12));
+    for (int n = 0; n < 12; ++n)
+    {
+        for (int ch = 0; ch < ADC_FILTER_CHANNELS; ++ch)
+            CHECK_NEAR(1.0f + ch, out[n][ch], 1e-6f);
+    }
+}
+
+TEST(adc_filter_matches_scalar_reference_on_noisy_input)
+{
+    AdcFilterConfig config;
+    config.median_taps = 5;
+    config.average_taps = 7;
+    config.iir_alpha = 0.3f;
+    config.decimation = 1;
+    AdcFilterBank bank;
+    CHECK(adc_filter_init(&bank, config));
+    ScalarAdcFilter reference[ADC_FILTER_CHANNELS];
+    for (ScalarAdcFilter &r : reference)
+        r.config = config;
+
+    uint32_t seed = 12345;
+    const int blocks = 40;
+    const int block_size = 13; // 移動平均の窓の長さと揃わないブロックで、窓の一周をまたぐ
+    for (int b = 0; b < blocks; ++b)
+    {
+        float samples[block_size][ADC_FILTER_CHANNELS];
+        for (int n = 0; n < block_size; ++n)
+        {
+            for (int ch = 0; ch < ADC_FILTER_CHANNELS; ++ch)
+            {
+                float spike = (noise(&seed) > 0.45f) ? 20.0f : 0.0f;
+                samples[n][ch] = (ch + 1) * 2.0f + noise(&seed) + spike;
+            }
+        }
+        float out[block_size][ADC_FILTER_CHANNELS];
+        CHECK_EQ(block_size, adc_filter_process(&bank, samples, block_size, out, block_size));
+        for (int n = 0; n < block_size; ++n)
+        {
+            for (int ch = 0; ch < ADC_FILTER_CHANNELS; ++ch)
+                CHECK_NEAR(reference[ch].step(samples[n][ch]), out[n][ch], 1e-4f);
+        }
+    }
+}
+
+TEST(adc_filter_attenuates_noise)
+{
+    AdcFilterBank bank;
+    CHECK(adc_filter_init(&bank, AdcFilterConfig()));
+    uint32_t seed = 7;
+    double raw_sq = 0.0, filtered_sq = 0.0;
+    int filtered_count = 0;
+    for (int b = 0; b < 50; ++b)
+    {
+        float samples[10][ADC_FILTER_CHANNELS];
+        for (int n = 0; n < 10; ++n)
+        {
+            for (int ch = 0; ch < ADC_FILTER_CHANNELS; ++ch)
+            {
+                samples[n][ch] = 1.0f + noise(&seed);
+                raw_sq += (samples[n][ch] - 1.0f) * (samples[n][ch] - 1.0f);
+            }
+        }
+        float out[1][ADC_FILTER_CHANNELS];
+        CHECK_EQ(1, adc_filter_process(&bank, samples, 10, out, 1));
+        for (int ch = 0; ch < ADC_FILTER_CHANNELS; ++ch)
+            filtered_sq += (out[0][ch] - 1.0f) * (out[0][ch] - 1.0f);
+        filtered_count += ADC_FILTER_CHANNELS;
+    }
+    double raw_rms = sqrt(raw_sq / (50 * 10 * ADC_FILTER_CHANNELS));
+    double filtered_rms = sqrt(filtered_sq / filtered_count);
+    CHECK(filtered_rms < raw_rms * 0.4);
+}
@@ -0,0 +1,55 @@
+#include "test_framework.h"
+#include "attitude_estimator.h"
+
+TEST(attitude_level_and_tilted_from_accel)
+{
+    AttitudeEstimator est;
+    attitude_init(&est, ATTITUDE_DEFAULT_ACCEL_WEIGHT, 0.0f);
+    AxisData zero = {0.0f, 0.0f, 0.0f};
+    AxisData level = {0.0f, 0.0f, 9.81f};
+    attitude_update(&est, level, zero, zero, 0.01f);
+    CHECK_NEAR(0.0f, est.attitude.roll_deg, 0.01f);
+    CHECK_NEAR(0.0f, est.attitude.pitch_deg, 0.01f);
+
+    // 右に30度傾けた状態が続くと、相補フィルタがその角度に収束する
+    AxisData rolled = {0.0f, 9.81f * 0.5f, 9.81f * 0.8660254f};
+    for (int i = 0; i < 1000; ++i)
+        attitude_update(&est, rolled, zero, zero, 0.01f);
+    CHECK_NEAR(30.0f, est.attitude.roll_deg, 0.5f);
+    CHECK_NEAR(0.0f, est.attitude.pitch_deg, 0.5f);
+}
+
+TEST(attitude_integrates_gyro_yaw_and_wraps)
+{
+    AttitudeEstimator est;
+    attitude_init(&est, ATTITUDE_DEFAULT_ACCEL_WEIGHT, 0.0f);
+    AxisData zero = {0.0f, 0.0f, 0.0f};
+    AxisData level = {0.0f, 0.0f, 9.81f};
+    AxisData yawing = {0.0f, 0.0f, 90.0f}; // 90 deg/s
+    attitude_update(&est, level, zero, zero, 0.01f);
+    for (int i = 0; i < 100; ++i)
+        attitude_update(&est, level, yawing, zero, 0.01f);
+    CHECK_NEAR(90.0f, est.attitude.yaw_deg, 0.5f);
+    for (int i = 0; i < 200; ++i)
+        attitude_update(&est, level, yawing, zero, 0.01f);
+    CHECK_NEAR(-90.0f, est.attitude.yaw_deg, 0.5f); // 270度は -90度に正規化される
+
+    // 周期間隔が長すぎる更新は積分しない
+    attitude_update(&est, level, yawing, zero, 1.0f);
+    CHECK_NEAR(-90.0f, est.attitude.yaw_deg, 0.5f);
+}
+
+TEST(attitude_yaw_follows_magnetometer)
+{
+    AttitudeEstimator est;
+    attitude_init(&est, ATTITUDE_DEFAULT_ACCEL_WEIGHT, 0.05f);
+    AxisData zero = {0.0f, 0.0f, 0.0f};
+    AxisData level = {0.0f, 0.0f, 9.81f};
+    AxisData north = {30.0f, 0.0f, 0.0f};
+    AxisData east = {0.0f, -30.0f, 0.0f};
+    attitude_update(&est, level, zero, north, 0.01f);
+    CHECK_NEAR(0.0f, est.attitude.yaw_deg, 0.01f);
+    for (int i = 0; i < 500; ++i)
+        attitude_update(&est, level, zero, east, 0.01f);
+    CHECK_NEAR(90.0f, est.attitude.yaw_deg, 0.5f);
+}
@@ -0,0 +1,200 @@
+#include "test_framework.h"
+#include "bus_manager.h"
+#include "sensor_data.h"
+#include "thruster_control.h"
+#include "bindings_stub.h"
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+
+TEST(bus_direct_access_when_not_running)
+{
+    stub_hardware_reset();
+    CHECK(!bus_manager_running());
+    bus_set_pwm_duty(4, 1500.0f / PWM_PERIOD_US);
+    CHECK_EQ(1500, stub_pwm_us(4)); // バス管理なしでは呼び出したスレッドですぐに書き込む
+
+    stub_hardware().gyro.z = 12.0f;
+    SensorData data;
+    sensor_read_fast(&data);
+    CHECK_NEAR(12.0f, data.gyro.z, 1e-6f);
+}
+
+TEST(bus_manager_flushes_pwm_and_caches_sensors)
+{
+    stub_hardware_reset();
+    stub_hardware().gyro.z = 5.0f;
+    stub_hardware().pressure = 1100.0f;
+    BusManagerConfig config;
+    config.period_ms = 2;
+    config.device_period_ms[BUS_DEVICE_PRESSURE] = 4;
+    CHECK(bus_manager_start(config));
+    CHECK(bus_manager_running());
+
+    // 開始時に全センサーを読んでいるため、すぐに最新値がある
+    SensorData data;
+    sensor_read_fast(&data);
+    sensor_read_slow(&data);
+    CHECK_NEAR(5.0f, data.gyro.z, 1e-6f);
+    CHECK_NEAR(1100.0f, data.pressure, 1e-3f);
+
+    // PWM はバススレッドが書き込む。同じチャンネルへの書き込みは最後の値にまとめられる
+    thruster_set_all_pwm(1300);
+    thruster_set_all_pwm(1400);
+    stub_hardware().gyro.z = -3.0f;
+    stub_hardware().pressure = 1200.0f;
+    usleep(20000);
+    CHECK_EQ(1400, stub_pwm_us(0));
+    CHECK_EQ(1400, stub_pwm_us(5));
+    sensor_read_fast(&data);
+    sensor_read_slow(&data);
+    CHECK_NEAR(-3.0f, data.gyro.z, 1e-6f);
+    CHECK_NEAR(1200.0f, data.pressure, 1e-3f);
+
+    BusStats stats = bus_manager_stats();
+    CHECK(stats.ticks > 0u);
+    CHECK(stats.devices[BUS_DEVICE_PWM].transactions >= NUM_THRUSTERS);
+    CHECK(stats.devices[BUS_DEVICE_GYRO].transactions > 1u);
+    CHECK(stats.devices[BUS_DEVICE_TEMP].transactions >= 1u);
+
+    // 停止時に未処理の書き込み (thruster_disable) を済ませる
+    thruster_disable();
+    bus_manager_stop();
+    CHECK(!bus_manager_running());
+    CHECK_EQ(PWM_STOP, stub_pwm_us(0));
+    CHECK(!stub_hardware().pwm_enabled);
+}
+
+TEST(bus_manager_stop_keeps_direct_writes_after_queued_ones)
+{
+    // 停止と同時に書き込む別スレッド (ウォッチドッグ・浸水監視) の直接書き込みが、
+    // 停止前に登録された古い書き込み待ちの値で上書きされないこと
+    for (int round = 0; round < 20; ++round)
+    {
+        stub_hardware_reset();
+        BusManagerConfig config;
+        config.period_ms = 1;
+        CHECK(bus_manager_start(config));
+        std::thread writer([]() {
+            while (bus_manager_running())
+                bus_set_pwm_duty(4, 1300.0f / PWM_PERIOD_US);
+            bus_set_pwm_duty(4, 1700.0f / PWM_PERIOD_US); // 停止後の直接書き込み
+        });
+        usleep(2000);
+        bus_manager_stop();
+        writer.join();
+        CHECK_EQ(1700, stub_pwm_us(4));
+    }
+}
+
+TEST(bus_manager_defers_slow_devices_over_budget)
+{
+    stub_hardware_reset();
+    BusManagerConfig config;
+    config.period_ms = 2;
+    config.tick_budget_us = 0; // 低速のセンサーは常に予算に収まらない
+    config.max_defer_ticks = 3;
+    config.device_period_ms[BUS_DEVICE_PRESSURE] = 2;
+    CHECK(bus_manager_start(config));
+    usleep(40000);
+    bus_manager_stop();
+
+    BusStats stats = bus_manager_stats();
+    const BusDeviceStats &pressure = stats.devices[BUS_DEVICE_PRESSURE];
+    CHECK(pressure.deferred > 0u);
+    // 後回しは max_defer_ticks 回までで、その次の周期には予算を超えても読む
+    CHECK(pressure.transactions > 1u);
+    CHECK(pressure.deferred <= pressure.transactions * config.max_defer_ticks);
+    // ジャイロは予算に関係なく毎周期読む
+    CHECK_EQ(0u, stats.devices[BUS_DEVICE_GYRO].deferred);
+}
+
+TEST(bus_read_leak_now_waits_for_fresh_sample)
+{
+    stub_hardware_reset();
+    BusManagerConfig config;
+    config.period_ms = 50; // 周期の読み取りより先に即時の読み取りが返ることを確認する
+    CHECK(bus_manager_start(config));
+    CHECK(!bus_read_leak_now());
+    stub_hardware().leak = true;
+    CHECK(bus_read_leak_now());
+    bus_manager_stop();
+    CHECK(bus_manager_stats().on_demand_reads >= 2u);
+    CHECK(bus_read_leak_now()); // 停止後は直接読む
+}
+
+TEST(bus_manager_idle_parks_slow_devices_and_refreshes_imu_on_wake)
+{
+    stub_hardware_reset();
+    BusManagerConfig config;
+    config.period_ms = 2;
+    config.idle_period_ms = 20;
+    config.device_period_ms[BUS_DEVICE_PRESSURE] = 2;
+    CHECK(bus_manager_start(config));
+    bus_manager_set_idle(true);
+    BusStats before = bus_manager_stats();
+    usleep(100000);
+    BusStats idle = bus_manager_stats();
+    // 周期が延び (100ms で 20ms 周期なら5回前後)、低速のセンサーは idle_slow_period_ms (1秒) まで読まない
+    CHECK(idle.idle_ticks > 0u);
+    CHECK(idle.ticks - before.ticks <= 10u);
+    CHECK(idle.devices[BUS_DEVICE_PRESSURE].transactions - before.devices[BUS_DEVICE_PRESSURE].transactions <= 1u);
+
+    // アイドル中も PWM はすぐに書き込む
+    thruster_set_all_pwm(1400);
+    usleep(5000);
+    CHECK_EQ(1400, stub_pwm_us(0));
+
+    // 戻すと次の周期を待たずに IMU を読み直す
+    stub_hardware().gyro.z = 7.0f;
+    bus_manager_set_idle(false);
+    usleep(5000);
+    SensorData data;
+    sensor_read_fast(&data);
+    CHECK_NEAR(7.0f, data.gyro.z, 1e-6f);
+    bus_manager_stop();
+}
+
+TEST(bus_manager_filters_oversampled_adc)
+{
+    stub_hardware_reset();
+    stub_hardware().adc[0] = 1.0f;
+    BusManagerConfig config;
+    config.period_ms = 2;
+    config.device_period_ms[BUS_DEVICE_ADC] = 2;
+    config.adc_filter.decimation = 5;
+    config.adc_filter.iir_alpha = 1.0f;
+    CHECK(bus_manager_start(config));
+    SensorData data;
+    sensor_read_slow(&data);
+    CHECK_NEAR(1.0f, data.adc[0], 1e-6f); // フィルタの出力が出るまでは開始時に読んだ生の値
+
+    // 値が変わるとフィルタを通して追従する (移動平均の窓が埋まるまでは中間の値)
+    stub_hardware().adc[0] = 2.0f;
+    usleep(100000);
+    sensor_read_slow(&data);
+    CHECK_NEAR(2.0f, data.adc[0], 1e-5f);
+    bus_manager_stop();
+    CHECK(bus_manager_stats().devices[BUS_DEVICE_ADC].transactions >= 10u);
+
+    // 範囲外の設定では開始しない
+    config.adc_filter.median_taps = 2;
+    CHECK(!bus_manager_start(config));
+    CHECK(!bus_manager_running());
+}
+
+TEST(format_bus_stats_lists_every_device)
+{
+    BusStats stats;
+    stats.ticks = 100;
+    stats.devices[BUS_DEVICE_GYRO].transactions = 2;
+    stats.devices[BUS_DEVICE_GYRO].total_ns = 60000;
+    stats.devices[BUS_DEVICE_GYRO].max_ns = 40000;
+    char buf[768];
+    CHECK(format_bus_stats(stats, buf, sizeof(buf)));
+    CHECK(strncmp(buf, "[BUS] ticks=100 idle_ticks=0", 28) == 0);
+    CHECK(strstr(buf, " gyro=30/40us(n=2,deferred=0)") != NULL);
+    CHECK(strstr(buf, " temp=") != NULL);
+    char small[16];
+    CHECK(!format_bus_stats(stats, small, sizeof(small)));
+}
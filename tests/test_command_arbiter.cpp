@@ -0,0 +1,171 @@
+#include "test_framework.h"
+#include "command_arbiter.h"
+#include <arpa/inet.h>
+
+static CommandPacket make_packet(int source, uint32_t seq, int priority, int lx)
+{
+    CommandPacket packet;
+    packet.type = CommandGamepad;
+    packet.source_id = source;
+    packet.seq = seq;
+    packet.has_seq = true;
+    packet.priority = priority;
+    packet.gamepad.leftThumbX = lx;
+    return packet;
+}
+
+TEST(arbiter_selects_highest_priority_fresh_source)
+{
+    CommandArbiter arb;
+    arbiter_init(&arb, 200);
+    arbiter_submit(&arb, make_packet(1, 1, 10, 100), 0);
+    arbiter_submit(&arb, make_packet(2, 1, 20, 200), 0);
+    CHECK_EQ(2, arbiter_select(&arb, 0));
+    CHECK_EQ(200, arbiter_active_command(&arb).leftThumbX);
+
+    // 優先度の高い送信元が途絶したら次の周期で切り替わる
+    arbiter_submit(&arb, make_packet(1, 2, 10, 101), 150);
+    CHECK_EQ(1, arbiter_select(&arb, 250));
+    CHECK_EQ(101, arbiter_active_command(&arb).leftThumbX);
+
+    CHECK_EQ(ARBITER_NO_SOURCE, arbiter_select(&arb, 1000));
+}
+
+TEST(arbiter_rejects_stale_sequence_numbers)
+{
+    CommandArbiter arb;
+    arbiter_init(&arb, 200);
+    CHECK(arbiter_submit(&arb, make_packet(1, 10, 10, 1), 0));
+    CHECK(!arbiter_submit(&arb, make_packet(1, 9, 10, 2), 10));
+    CHECK(!arbiter_submit(&arb, make_packet(1, 10, 10, 3), 10));
+    CHECK(arbiter_submit(&arb, make_packet(1, 11, 10, 4), 10));
+    arbiter_select(&arb, 10);
+    CHECK_EQ(4, arbiter_active_command(&arb).leftThumbX);
+
+    // 鮮度切れの後は送信側の再起動とみなして番号をリセットする
+    CHECK(arbiter_submit(&arb, make_packet(1, 0, 10, 5), 1000));
+}
+
+TEST(arbiter_takeover_overrides_priority_until_release)
+{
+    CommandArbiter arb;
+    arbiter_init(&arb, 200);
+    arbiter_submit(&arb, make_packet(1, 1, 50, 1), 0);
+    arbiter_submit(&arb, make_packet(2, 1, 5, 2), 0);
+    CHECK_EQ(1, arbiter_select(&arb, 0));
+
+    CommandPacket takeover;
+    takeover.type = CommandTakeover;
+    takeover.source_id = 2;
+    takeover.priority = 5;
+    arbiter_submit(&arb, takeover, 10);
+    CHECK_EQ(2, arbiter_select(&arb, 10));
+
+    CommandPacket release;
+    release.type = CommandRelease;
+    release.source_id = 2;
+    arbiter_submit(&arb, release, 20);
+    CHECK_EQ(1, arbiter_select(&arb, 20));
+}
+
+TEST(arbiter_setpoint_source_uses_its_own_timeout)
+{
+    CommandArbiter arb;
+    arbiter_init(&arb, 200);
+    CommandPacket setpoint = parseCommandPacket("S,4,1,20,0.2,0,0,0,45,-,1000");
+    CHECK(arbiter_submit(&arb, setpoint, 0));
+    CHECK_EQ(4, arbiter_select(&arb, 500)); // 既定の 200ms を過ぎても目標値のタイムアウト内
+    SetpointCommand active;
+    CHECK(arbiter_active_setpoint(&arb, &active));
+    CHECK_NEAR(45.0f, active.heading_deg, 1e-6f);
+    CHECK_EQ(ARBITER_NO_SOURCE, arbiter_select(&arb, 1100));
+
+    // 同じ送信元がスティック操作に戻れば既定の鮮度判定に戻る
+    arbiter_submit(&arb, make_packet(4, 2, 20, 100), 1200);
+    CHECK_EQ(4, arbiter_select(&arb, 1200));
+    CHECK(!arbiter_active_setpoint(&arb, &active));
+    CHECK_EQ(ARBITER_NO_SOURCE, arbiter_select(&arb, 1500));
+}
+
+// 送信元アドレスを付けたパケット (ネットワーク経由)
+static CommandPacket from_address(CommandPacket packet, const char *ip, int port)
+{
+    packet.has_sender = true;
+    packet.sender.sin_family = AF_INET;
+    inet_pton(AF_INET, ip, &packet.sender.sin_addr);
+    packet.sender.sin_port = htons(port);
+    return packet;
+}
+
+TEST(arbiter_binds_source_id_to_first_sender_address)
+{
+    CommandArbiter arb;
+    arbiter_init(&arb, 200);
+    CHECK(arbiter_submit(&arb, from_address(make_packet(1, 1, 50, 1), "192.168.2.1", 40000), 0));
+    CHECK_EQ(1, arbiter_select(&arb, 0));
+
+    // 別のアドレスから同じ送信元IDを名乗るパケットは、操縦データも TAKEOVER / RELEASE も破棄する
+    CHECK(!arbiter_submit(&arb, from_address(make_packet(1, 2, 50, 99), "192.168.2.66", 40000), 10));
+    CHECK(!arbiter_submit(&arb, from_address(make_packet(1, 2, 50, 99), "192.168.2.1", 40001), 10));
+    CHECK(!arbiter_submit(&arb, make_packet(1, 2, 50, 99), 10)); // 同一機体上のプロセスからも同じ
+    CommandPacket takeover;
+    takeover.type = CommandTakeover;
+    takeover.source_id = 1;
+    CHECK(!arbiter_submit(&arb, from_address(takeover, "192.168.2.66", 40000), 10));
+    CHECK_EQ(ARBITER_NO_SOURCE, arb.takeover_slot);
+    arbiter_select(&arb, 10);
+    CHECK_EQ(1, arbiter_active_command(&arb).leftThumbX);
+    CHECK_EQ(4u, arb.sources[arb.active_slot].address_rejected_count);
+
+    CHECK(arbiter_submit(&arb, from_address(make_packet(1, 2, 50, 2), "192.168.2.1", 40000), 20));
+
+    // 長く何も届かなければ、再起動した地上局の新しいアドレスに結び付け直す
+    CHECK(!arbiter_submit(&arb, from_address(make_packet(1, 1, 50, 3), "192.168.2.1", 40001), 20 + arb.rebind_after_ms));
+    CHECK(arbiter_submit(&arb, from_address(make_packet(1, 1, 50, 3), "192.168.2.1", 40001), 21 + arb.rebind_after_ms));
+    CHECK(!arbiter_submit(&arb, from_address(make_packet(1, 2, 50, 4), "192.168.2.1", 40000), 22 + arb.rebind_after_ms));
+}
+
+TEST(arbiter_takeover_without_priority_keeps_current_priority)
+{
+    CommandArbiter arb;
+    arbiter_init(&arb, 200);
+    arbiter_submit(&arb, make_packet(1, 1, 50, 1), 0);
+    CommandPacket takeover = parseCommandPacket("TAKEOVER,1");
+    CHECK(!takeover.has_priority);
+    CHECK(arbiter_submit(&arb, takeover, 10));
+    CHECK_EQ(50, arb.sources[arb.takeover_slot].priority);
+
+    // 優先度を指定した場合はその値に変える
+    CHECK(arbiter_submit(&arb, parseCommandPacket("TAKEOVER,1,30"), 20));
+    CHECK_EQ(30, arb.sources[arb.takeover_slot].priority);
+}
+
+TEST(arbiter_feed_time_follows_source_timeout)
+{
+    CommandArbiter arb;
+    arbiter_init(&arb, 200);
+    arbiter_submit(&arb, make_packet(1, 1, 10, 1), 1000);
+    arbiter_select(&arb, 1100);
+    CHECK_EQ(1000u, arbiter_active_feed_ms(&arb)); // 操縦データは受理した時刻
+
+    // 目標値コマンドは、既定より長いタイムアウトの分だけ後ろにずらす (鮮度切れと同時に途絶と判定される)
+    CommandPacket setpoint = parseCommandPacket("S,2,1,20,0,0,0,0,-,-,1000");
+    arbiter_submit(&arb, setpoint, 2000);
+    arbiter_select(&arb, 2000);
+    CHECK_EQ(2800u, arbiter_active_feed_ms(&arb));
+    arbiter_init(&arb, 200);
+    CHECK_EQ(0u, arbiter_active_feed_ms(&arb));
+}
+
+TEST(arbiter_rejects_depth_setpoints_without_heave_thrusters)
+{
+    CommandArbiter arb;
+    arbiter_init(&arb, 200);
+    arb.depth_hold_supported = false;
+    CHECK(!arbiter_submit(&arb, parseCommandPacket("S,3,1,20,0.5,0,0,0,-,2.0,0"), 1000));
+    CHECK_EQ(ARBITER_NO_SOURCE, arbiter_select(&arb, 1000));
+    // 深度を指定しない目標値はそのまま受け付ける
+    CHECK(arbiter_submit(&arb, parseCommandPacket("S,3,2,20,0.5,0,0,0,-,-,0"), 1010));
+    CHECK_EQ(3, arbiter_select(&arb, 1010));
+    CHECK_EQ(1u, arb.sources[arb.active_slot].unsupported_count);
+}
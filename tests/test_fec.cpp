@@ -0,0 +1,325 @@
+#include "test_framework.h"
+#include "fec.h"
+#include "network.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// count 件のペイロード "CMD<n>" を符号化し、drop(フレーム番号) が true のフレームを捨てて復号する
+// 取り出せたペイロードの番号を received[] に記録する
+template <typename DropFunc>
+static void run_link(const FecConfig &config, int count, DropFunc drop, FecDecoder *dec, bool *received)
+{
+    FecEncoder enc;
+    fec_encoder_init(&enc, config);
+    fec_decoder_init(dec);
+    static uint8_t frames[2][FEC_MAX_FRAME];
+    size_t frame_len[2];
+    int frame_index = 0;
+    for (int n = 0; n < count; ++n)
+    {
+        char payload[32];
+        int len = snprintf(payload, sizeof(payload), "CMD%d", n);
+        int frame_count = fec_encode(&enc, reinterpret_cast<const uint8_t *>(payload), len, frames, frame_len);
+        for (int f = 0; f < frame_count; ++f)
+        {
+            if (!drop(frame_index++))
+                fec_decode(dec, frames[f], frame_len[f]);
+        }
+        char out[FEC_MAX_PAYLOAD + 1];
+        size_t out_len = 0;
+        while (fec_next_payload(dec, out, sizeof(out), &out_len))
+        {
+            int value = -1;
+            if (sscanf(out, "CMD%d", &value) == 1 && value >= 0 && value < count)
+                received[value] = true;
+        }
+    }
+}
+
+static int count_missing(const bool *received, int count)
+{
+    int missing = 0;
+    for (int i = 0; i < count; ++i)
+        missing += received[i] ? 0 : 1;
+    return missing;
+}
+
+TEST(fec_lossless_link_delivers_everything_once)
+{
+    FecConfig config;
+    FecDecoder dec;
+    bool received[40] = {false};
+    run_link(config, 40, [](int) { return false; }, &dec, received);
+    CHECK_EQ(0, count_missing(received, 40));
+    CHECK_EQ(40u, dec.stats.delivered);
+    CHECK_EQ(40u, dec.stats.expected);
+    CHECK_EQ(10u, dec.stats.parity_frames);
+    CHECK_EQ(0u, dec.stats.recovered_redundant);
+    CHECK_NEAR(0.0f, fec_effective_loss_rate(dec.stats), 1e-6f);
+}
+
+TEST(fec_redundant_copy_recovers_isolated_drops)
+{
+    FecConfig config;
+    config.group_size = 0; // 冗長コピーのみ
+    config.redundancy = 1;
+    FecDecoder dec;
+    bool received[40] = {false};
+    // 1つおきにフレームを捨てる (50% の欠落)
+    run_link(config, 40, [](int i) { return i % 2 == 1; }, &dec, received);
+    CHECK_EQ(0, count_missing(received, 39)); // 最後の1件は次のフレームがないため補えない
+    CHECK_NEAR(0.5f, fec_raw_loss_rate(dec.stats), 0.03f);
+    CHECK(dec.stats.recovered_redundant >= 19u);
+}
+
+TEST(fec_parity_recovers_one_loss_per_group)
+{
+    FecConfig config;
+    config.group_size = 4;
+    config.redundancy = 0; // パリティのみ
+    FecDecoder dec;
+    bool received[40] = {false};
+    // フレームの並び: D0 D1 D2 D3 P, D4 ... (グループごとに5フレーム)。各グループの2番目のデータを捨てる
+    run_link(config, 40, [](int i) { return i % 5 == 1; }, &dec, received);
+    CHECK_EQ(0, count_missing(received, 40));
+    CHECK_EQ(10u, dec.stats.recovered_parity);
+    CHECK_NEAR(0.25f, fec_raw_loss_rate(dec.stats), 1e-6f);
+    CHECK_NEAR(0.0f, fec_effective_loss_rate(dec.stats), 1e-6f);
+
+    // 1グループに2件の欠落はパリティだけでは復元できない
+    bool received2[40] = {false};
+    run_link(config, 40, [](int i) { return i % 5 == 1 || i % 5 == 2; }, &dec, received2);
+    CHECK_EQ(20, count_missing(received2, 40));
+    CHECK_NEAR(0.5f, fec_effective_loss_rate(dec.stats), 0.03f);
+}
+
+TEST(fec_redundancy_and_parity_cover_burst)
+{
+    FecConfig config;
+    config.group_size = 4;
+    config.redundancy = 1;
+    FecDecoder dec;
+    bool received[40] = {false};
+    // 各グループの D1, D2 を連続で捨てる: D2 は D3 の冗長コピーから、D1 はパリティから復元される
+    run_link(config, 40, [](int i) { return i % 5 == 1 || i % 5 == 2; }, &dec, received);
+    CHECK_EQ(0, count_missing(received, 40));
+    CHECK(dec.stats.recovered_parity > 0u);
+    CHECK(dec.stats.recovered_redundant > 0u);
+    CHECK(fec_raw_loss_rate(dec.stats) > 0.35f);
+}
+
+TEST(fec_rejects_malformed_frames)
+{
+    FecDecoder dec;
+    fec_decoder_init(&dec);
+    const uint8_t truncated[] = {FEC_MAGIC0, FEC_MAGIC1, 0, 1, 0, 0, 0, 1, 0, 50, 'x'};
+    CHECK_EQ(-1, fec_decode(&dec, truncated, sizeof(truncated)));
+    CHECK_EQ(1u, dec.stats.malformed);
+    CHECK(!fec_is_frame(reinterpret_cast<const uint8_t *>("0,0,0,0,0,0,0"), 13));
+}
+
+TEST(fec_network_loopback_recovers_dropped_commands)
+{
+    NetworkContext ctx;
+    CHECK(network_init(&ctx, 39300, 39301));
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server.sin_port = htons(39300);
+
+    FecConfig config;
+    config.group_size = 4;
+    config.redundancy = 1;
+    FecEncoder enc;
+    fec_encoder_init(&enc, config);
+    static uint8_t frames[2][FEC_MAX_FRAME];
+    size_t frame_len[2];
+    int frame_index = 0;
+    bool received[20] = {false};
+    char buffer[NET_BUFFER_SIZE];
+    for (int n = 0; n < 20; ++n)
+    {
+        char payload[64];
+        int len = snprintf(payload, sizeof(payload), "C,1,%d,10,%d,0,0,0,0,0,0", n + 1, n);
+        int frame_count = fec_encode(&enc, reinterpret_cast<const uint8_t *>(payload), len, frames, frame_len);
+        for (int f = 0; f < frame_count; ++f)
+        {
+            if (frame_index++ % 3 != 2) // 3フレームに1つを捨てる
+                sendto(fd, frames[f], frame_len[f], 0, (struct sockaddr *)&server, sizeof(server));
+        }
+        usleep(1000);
+        ssize_t recv_len;
+        while ((recv_len = network_receive(&ctx, buffer, sizeof(buffer))) >= 0)
+        {
+            int source = 0, seq = 0, priority = 0, lx = -1;
+            if (recv_len > 0 && sscanf(buffer, "C,%d,%d,%d,%d", &source, &seq, &priority, &lx) == 4 && lx >= 0 && lx < 20)
+                received[lx] = true;
+        }
+    }
+    CHECK_EQ(0, count_missing(received, 19));
+    // FEC で受信した送信元もテレメトリ購読者として登録される
+    CHECK_EQ(1, network_subscriber_count(&ctx));
+    FecStats stats;
+    network_fec_stats(&ctx, &stats);
+    CHECK(fec_raw_loss_rate(stats) > 0.2f);
+    CHECK(fec_effective_loss_rate(stats) < 0.06f);
+    close(fd);
+    network_close(&ctx);
+}
+
+TEST(fec_decoder_resyncs_when_sender_restarts_sequence)
+{
+    FecConfig config;
+    FecEncoder enc;
+    fec_encoder_init(&enc, config);
+    FecDecoder dec;
+    fec_decoder_init(&dec);
+    static uint8_t frames[2][FEC_MAX_FRAME];
+    size_t frame_len[2];
+    char out[FEC_MAX_PAYLOAD + 1];
+    size_t out_len = 0;
+    for (int n = 0; n < 100; ++n)
+    {
+        int count = fec_encode(&enc, reinterpret_cast<const uint8_t *>("OLD"), 3, frames, frame_len);
+        for (int f = 0; f < count; ++f)
+            fec_decode(&dec, frames[f], frame_len[f]);
+        while (fec_next_payload(&dec, out, sizeof(out), &out_len))
+        {
+        }
+    }
+    // 送信側が再起動して seq 0 から送り直す: 最初のフレームから取り出せる
+    fec_encoder_init(&enc, config);
+    int count = fec_encode(&enc, reinterpret_cast<const uint8_t *>("NEW"), 3, frames, frame_len);
+    CHECK_EQ(1, count);
+    CHECK_EQ(1, fec_decode(&dec, frames[0], frame_len[0]));
+    CHECK(fec_next_payload(&dec, out, sizeof(out), &out_len));
+    CHECK(strcmp(out, "NEW") == 0);
+    CHECK_EQ(1u, dec.stats.resyncs);
+    CHECK_EQ(101u, dec.stats.expected);
+    // 窓の中の後戻り (並べ替え・冗長コピー) では同期し直さない
+    CHECK_EQ(0, fec_decode(&dec, frames[0], frame_len[0]));
+    CHECK_EQ(1u, dec.stats.resyncs);
+}
+
+TEST(fec_decoder_compares_seq_across_wrap)
+{
+    FecConfig config;
+    config.group_size = 0;
+    config.redundancy = 0;
+    FecEncoder enc;
+    fec_encoder_init(&enc, config);
+    enc.next_seq = 0xFFFFFFFEu; // 一周の直前から送る
+    FecDecoder dec;
+    fec_decoder_init(&dec);
+    static uint8_t frames[2][FEC_MAX_FRAME];
+    size_t frame_len[2];
+    char out[FEC_MAX_PAYLOAD + 1];
+    size_t out_len = 0;
+    for (int n = 0; n < 6; ++n)
+    {
+        fec_encode(&enc, reinterpret_cast<const uint8_t *>("CMD"), 3, frames, frame_len);
+        CHECK_EQ(1, fec_decode(&dec, frames[0], frame_len[0]));
+        CHECK(fec_next_payload(&dec, out, sizeof(out), &out_len));
+    }
+    CHECK_EQ(6u, dec.stats.delivered);
+    CHECK_EQ(0u, dec.stats.duplicates);
+    CHECK_EQ(0u, dec.stats.resyncs);
+    CHECK_EQ(3u, dec.highest_seq);
+}
+
+TEST(fec_network_loopback_resyncs_restarted_sender)
+{
+    NetworkContext ctx;
+    CHECK(network_init(&ctx, 39302, 39303));
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server.sin_port = htons(39302);
+
+    FecConfig config;
+    static uint8_t frames[2][FEC_MAX_FRAME];
+    size_t frame_len[2];
+    char buffer[NET_BUFFER_SIZE];
+    // 送信側 (同じソケット = 同じ IP:ポート) が seq 0 から2回送る。2回目は再起動後の短いセッション
+    // (窓より大きくは戻らないため、無通信の時間で同期し直す)
+    int received_after_restart = 0;
+    for (int session = 0; session < 2; ++session)
+    {
+        FecEncoder enc;
+        fec_encoder_init(&enc, config);
+        for (int n = 0; n < 12; ++n)
+        {
+            char payload[64];
+            int len = snprintf(payload, sizeof(payload), "C,1,%d,10,%d,0,0,0,0,0,0", n + 1, session);
+            int frame_count = fec_encode(&enc, reinterpret_cast<const uint8_t *>(payload), len, frames, frame_len);
+            for (int f = 0; f < frame_count; ++f)
+                sendto(fd, frames[f], frame_len[f], 0, (struct sockaddr *)&server, sizeof(server));
+            usleep(1000);
+            ssize_t recv_len;
+            while ((recv_len = network_receive(&ctx, buffer, sizeof(buffer))) >= 0)
+            {
+                int source = 0, seq = 0, priority = 0, lx = -1;
+                if (recv_len > 0 && sscanf(buffer, "C,%d,%d,%d,%d", &source, &seq, &priority, &lx) == 4 && lx == 1)
+                    received_after_restart++;
+            }
+        }
+        if (session == 0)
+            usleep((NETWORK_FEC_IDLE_RESYNC_MS + 50) * 1000);
+    }
+    CHECK_EQ(12, received_after_restart);
+    FecStats stats;
+    network_fec_stats(&ctx, &stats);
+    CHECK_EQ(1u, stats.resyncs);
+    close(fd);
+    network_close(&ctx);
+}
+
+TEST(fec_network_telemetry_is_sent_as_frames)
+{
+    NetworkContext ctx;
+    CHECK(network_init(&ctx, 39310, 39311));
+    int station = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(39311);
+    bind(station, (struct sockaddr *)&addr, sizeof(addr));
+    CHECK(network_subscribe(&ctx, &addr, 0));
+
+    FecConfig config;
+    config.group_size = 2;
+    config.redundancy = 1;
+    CHECK(network_enable_fec(&ctx, config));
+    CHECK(network_send_to_all(&ctx, "SEQ:0,KF:1", 10));
+    CHECK(network_send_to_all(&ctx, "SEQ:1,KF:0", 10));
+    usleep(2000);
+
+    // データ2つとパリティ1つが届き、地上局側で復号できる
+    FecDecoder dec;
+    fec_decoder_init(&dec);
+    uint8_t frame[FEC_MAX_FRAME];
+    int frames = 0;
+    ssize_t len;
+    while ((len = recv(station, frame, sizeof(frame), MSG_DONTWAIT)) > 0)
+    {
+        CHECK(fec_is_frame(frame, len));
+        fec_decode(&dec, frame, len);
+        frames++;
+    }
+    CHECK_EQ(3, frames);
+    char out[FEC_MAX_PAYLOAD + 1];
+    size_t out_len = 0;
+    CHECK(fec_next_payload(&dec, out, sizeof(out), &out_len));
+    CHECK(strcmp(out, "SEQ:0,KF:1") == 0);
+    CHECK(fec_next_payload(&dec, out, sizeof(out), &out_len));
+    CHECK(strcmp(out, "SEQ:1,KF:0") == 0);
+    close(station);
+    network_close(&ctx);
+}
@@ -0,0 +1,64 @@
+#ifndef TEST_FRAMEWORK_H
+#define TEST_FRAMEWORK_H
+
+// 外部ライブラリに依存しない最小限のテストフレームワーク
+// TEST(name) で定義した関数は自動的に登録され、test_main.cpp の run_all_tests() で順に実行される。
+
+#include <iostream> // 失敗時のメッセージ出力のため
+
+typedef void (*TestFunction)();
+
+// テストを登録する (TEST マクロから呼ばれる)
+void register_test(const char *name, TestFunction func);
+// 現在実行中のテストを失敗として記録する
+void test_fail(const char *file, int line, const char *message);
+
+struct TestRegistrar
+{
+    TestRegistrar(const char *name, TestFunction func) { register_test(name, func); }
+};
+
+#define TEST(name)                                             \
+    static void name();                                        \
+    static TestRegistrar registrar_##name(#name, name);        \
+    static void name()
+
+// 条件が偽ならテストを失敗させて中断する
+#define CHECK(cond)                                            \
+    do                                                         \
+    {                                                          \
+        if (!(cond))                                           \
+        {                                                      \
+            test_fail(__FILE__, __LINE__, #cond);              \
+            return;                                            \
+        }                                                      \
+    } while (0)
+
+// 2つの値が等しくなければテストを失敗させて中断する (値も表示する)
+#define CHECK_EQ(expected, actual)                                                          \
+    do                                                                                      \
+    {                                                                                       \
+        if (!((expected) == (actual)))                                                      \
+        {                                                                                   \
+            std::cerr << "    expected: " << (expected) << ", actual: " << (actual) << std::endl; \
+            test_fail(__FILE__, __LINE__, #expected " == " #actual);                        \
+            return;                                                                         \
+        }                                                                                   \
+    } while (0)
+
+// 2つの浮動小数点値の差が tol 以下でなければテストを失敗させて中断する
+#define CHECK_NEAR(expected, actual, tol)                                                   \
+    do                                                                                      \
+    {                                                                                       \
+        double diff_ = (double)(expected) - (double)(actual);                               \
+        if (diff_ < 0)                                                                      \
+            diff_ = -diff_;                                                                 \
+        if (diff_ > (tol))                                                                  \
+        {                                                                                   \
+            std::cerr << "    expected: " << (expected) << ", actual: " << (actual) << std::endl; \
+            test_fail(__FILE__, __LINE__, #expected " ~= " #actual);                        \
+            return;                                                                         \
+        }                                                                                   \
+    } while (0)
+
+#endif // TEST_FRAMEWORK_H
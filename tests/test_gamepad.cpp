@@ -0,0 +1,109 @@
+#include "test_framework.h"
+#include "gamepad.h"
+
+TEST(gamepad_parses_legacy_format)
+{
+    GamepadData data = parseGamepadData("100,-200,300,-400,5,6,4096");
+    CHECK_EQ(100, data.leftThumbX);
+    CHECK_EQ(-200, data.leftThumbY);
+    CHECK_EQ(300, data.rightThumbX);
+    CHECK_EQ(-400, data.rightThumbY);
+    CHECK_EQ(5, data.LT);
+    CHECK_EQ(6, data.RT);
+    CHECK_EQ(GamepadButton::A, data.buttons);
+}
+
+TEST(gamepad_invalid_token_returns_neutral)
+{
+    GamepadData data = parseGamepadData("100,abc,300,0,0,0,0");
+    CHECK_EQ(0, data.leftThumbX);
+    CHECK_EQ(0, data.rightThumbX);
+}
+
+TEST(command_packet_legacy_maps_to_default_source)
+{
+    CommandPacket packet = parseCommandPacket("1,2,3,4,5,6,7");
+    CHECK_EQ(CommandGamepad, packet.type);
+    CHECK_EQ(LEGACY_SOURCE_ID, packet.source_id);
+    CHECK_EQ(LEGACY_SOURCE_PRIORITY, packet.priority);
+    CHECK(!packet.has_seq);
+    CHECK_EQ(1, packet.gamepad.leftThumbX);
+}
+
+TEST(command_packet_parses_source_header)
+{
+    CommandPacket packet = parseCommandPacket("C,3,42,20,10,11,12,13,14,15,16");
+    CHECK_EQ(CommandGamepad, packet.type);
+    CHECK_EQ(3, packet.source_id);
+    CHECK_EQ(42u, packet.seq);
+    CHECK(packet.has_seq);
+    CHECK_EQ(20, packet.priority);
+    CHECK_EQ(10, packet.gamepad.leftThumbX);
+    CHECK_EQ(16, packet.gamepad.buttons);
+}
+
+TEST(command_packet_parses_takeover_and_release)
+{
+    CommandPacket takeover = parseCommandPacket("TAKEOVER,5");
+    CHECK_EQ(CommandTakeover, takeover.type);
+    CHECK_EQ(5, takeover.source_id);
+    CommandPacket release = parseCommandPacket("RELEASE,5");
+    CHECK_EQ(CommandRelease, release.type);
+    CHECK_EQ(5, release.source_id);
+    CHECK_EQ(CommandInvalid, parseCommandPacket("C,bad").type);
+}
+
+TEST(command_packet_parses_setpoint)
+{
+    CommandPacket packet = parseCommandPacket("S,7,12,30,0.5,-0.25,0,15,90.5,-,1000");
+    CHECK_EQ(CommandSetpoint, packet.type);
+    CHECK_EQ(7, packet.source_id);
+    CHECK_EQ(12u, packet.seq);
+    CHECK_EQ(30, packet.priority);
+    CHECK_NEAR(0.5f, packet.setpoint.surge, 1e-6f);
+    CHECK_NEAR(-0.25f, packet.setpoint.sway, 1e-6f);
+    CHECK_NEAR(15.0f, packet.setpoint.yaw_rate_dps, 1e-6f);
+    CHECK(packet.setpoint.hold_heading);
+    CHECK_NEAR(90.5f, packet.setpoint.heading_deg, 1e-6f);
+    CHECK(!packet.setpoint.hold_depth);
+    CHECK_EQ(1000u, packet.setpoint.timeout_ms);
+
+    // 範囲外の推力はクランプ、タイムアウトは上限で制限、0 は既定値
+    CommandPacket clamped = parseCommandPacket("S,7,13,30,3,0,0,0,-,2.5,0");
+    CHECK_NEAR(1.0f, clamped.setpoint.surge, 1e-6f);
+    CHECK(clamped.setpoint.hold_depth);
+    CHECK_NEAR(2.5f, clamped.setpoint.depth_m, 1e-6f);
+    CHECK_EQ(static_cast<uint32_t>(SETPOINT_DEFAULT_TIMEOUT_MS), clamped.setpoint.timeout_ms);
+    CHECK_EQ(static_cast<uint32_t>(SETPOINT_MAX_TIMEOUT_MS),
+             parseCommandPacket("S,7,14,30,0,0,0,0,-,-,60000").setpoint.timeout_ms);
+
+    CHECK_EQ(CommandInvalid, parseCommandPacket("S,7,15,30,0,0,0,0,north,-,100").type);
+    CHECK_EQ(CommandInvalid, parseCommandPacket("S,7,16,30,0,0").type);
+}
+
+TEST(command_packet_setpoint_empty_target_means_no_hold)
+{
+    // 方位・深度のフィールドが空なら "-" と同じく保持なし
+    CommandPacket packet = parseCommandPacket("S,1,2,10,0,0,0,0,,,100");
+    CHECK_EQ(CommandSetpoint, packet.type);
+    CHECK(!packet.setpoint.hold_heading);
+    CHECK(!packet.setpoint.hold_depth);
+    CHECK_EQ(100u, packet.setpoint.timeout_ms);
+
+    packet = parseCommandPacket("S,1,3,10,0,0,0,0,45,,100");
+    CHECK_EQ(CommandSetpoint, packet.type);
+    CHECK(packet.setpoint.hold_heading);
+    CHECK_NEAR(45.0f, packet.setpoint.heading_deg, 1e-6f);
+    CHECK(!packet.setpoint.hold_depth);
+
+    packet = parseCommandPacket("S,1,4,10,0,0,0,0,,1.5,100");
+    CHECK_EQ(CommandSetpoint, packet.type);
+    CHECK(!packet.setpoint.hold_heading);
+    CHECK(packet.setpoint.hold_depth);
+    CHECK_NEAR(1.5f, packet.setpoint.depth_m, 1e-6f);
+
+    // タイムアウトのフィールドがない、区切りが足りない場合は不正
+    CHECK_EQ(CommandInvalid, parseCommandPacket("S,1,5,10,0,0,0,0,,,").type);
+    CHECK_EQ(CommandInvalid, parseCommandPacket("S,1,6,10,0,0,0,0,,").type);
+    CHECK_EQ(CommandInvalid, parseCommandPacket("S,1,7,10,0,0,0,0,0123456789012345678901234567890123456789,-,100").type);
+}
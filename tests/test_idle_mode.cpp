@@ -0,0 +1,102 @@
+#include "test_framework.h"
+#include "idle_mode.h"
+#include <string.h>
+
+static const AxisData STILL = {0.0f, 0.0f, 0.0f};
+
+// 指定した資源使用量の標本
+static PowerUsage usage_at(uint64_t cpu_ms, uint64_t context_switches)
+{
+    PowerUsage usage;
+    usage.cpu_ns = cpu_ms * 1000000ULL;
+    usage.context_switches = context_switches;
+    return usage;
+}
+
+TEST(idle_enters_after_quiet_period_and_wakes_on_operator)
+{
+    IdleConfig config;
+    config.enter_after_ms = 1000;
+    IdleController idle;
+    idle_init(&idle, config, 0, PowerUsage());
+    CHECK_EQ(config.active_period_ms, idle_loop_period_ms(&idle));
+
+    // 条件を満たし始めてから enter_after_ms 経つまでは通常のまま
+    CHECK(!idle_update(&idle, false, true, STILL, 100, PowerUsage()));
+    CHECK(!idle_update(&idle, false, true, STILL, 1099, PowerUsage()));
+    CHECK_EQ(POWER_STATE_ACTIVE, idle.state);
+    CHECK(idle_update(&idle, false, true, STILL, 1100, PowerUsage()));
+    CHECK_EQ(POWER_STATE_IDLE, idle.state);
+    CHECK_EQ(config.idle_period_ms, idle_loop_period_ms(&idle));
+    CHECK(!idle_update(&idle, false, true, STILL, 1200, PowerUsage()));
+
+    // 操縦者が現れた周期に通常に戻る
+    CHECK(idle_update(&idle, true, true, STILL, 1250, PowerUsage()));
+    CHECK_EQ(POWER_STATE_ACTIVE, idle.state);
+    CHECK_EQ(config.active_period_ms, idle_loop_period_ms(&idle));
+    CHECK_EQ(1u, idle.stats[POWER_STATE_IDLE].entries);
+}
+
+TEST(idle_requires_stopped_and_stationary_vehicle)
+{
+    IdleConfig config;
+    config.enter_after_ms = 1000;
+    IdleController idle;
+    idle_init(&idle, config, 0, PowerUsage());
+
+    // フェイルセーフで減速中 (スラスターがまだ停止していない) はアイドルにしない
+    CHECK(!idle_update(&idle, false, false, STILL, 0, PowerUsage()));
+    CHECK(!idle_update(&idle, false, false, STILL, 5000, PowerUsage()));
+    // 揺れている間もアイドルにせず、静止してから改めて待つ
+    AxisData rolling = {0.0f, 5.0f, 0.0f};
+    CHECK(!idle_update(&idle, false, true, rolling, 5100, PowerUsage()));
+    CHECK(!idle_update(&idle, false, true, STILL, 5200, PowerUsage()));
+    CHECK(!idle_update(&idle, false, true, STILL, 6100, PowerUsage()));
+    CHECK(idle_update(&idle, false, true, STILL, 6200, PowerUsage()));
+
+    // アイドル中にスラスターが動き出したら (浸水の浮上など) 通常に戻る
+    CHECK(idle_update(&idle, false, false, STILL, 6300, PowerUsage()));
+    CHECK_EQ(POWER_STATE_ACTIVE, idle.state);
+}
+
+TEST(idle_stats_split_cpu_and_wakeups_by_state)
+{
+    IdleConfig config;
+    config.enter_after_ms = 0;
+    IdleController idle;
+    idle_init(&idle, config, 0, usage_at(0, 0));
+    CHECK(!idle_update(&idle, true, true, STILL, 500, usage_at(10, 100)));
+    // 2000ms まで通常: CPU 100ms, コンテキストスイッチ 400回
+    CHECK(idle_update(&idle, false, true, STILL, 2000, usage_at(100, 400)));
+    // 12000ms までアイドル: CPU 50ms, コンテキストスイッチ 100回
+    PowerStateStats stats[POWER_STATE_COUNT];
+    idle_stats(&idle, 12000, usage_at(150, 500), stats);
+    CHECK_EQ(2000u, stats[POWER_STATE_ACTIVE].time_ms);
+    CHECK_EQ(100000000u, stats[POWER_STATE_ACTIVE].cpu_ns);
+    CHECK_EQ(400u, stats[POWER_STATE_ACTIVE].context_switches);
+    CHECK_EQ(2u, stats[POWER_STATE_ACTIVE].ticks);
+    CHECK_EQ(10000u, stats[POWER_STATE_IDLE].time_ms);
+    CHECK_EQ(50000000u, stats[POWER_STATE_IDLE].cpu_ns);
+    CHECK_EQ(100u, stats[POWER_STATE_IDLE].context_switches);
+
+    char buf[256];
+    CHECK(format_power_stats(&idle, 12000, usage_at(150, 500), buf, sizeof(buf)));
+    CHECK(strncmp(buf, "[POWER] state=IDLE", 18) == 0);
+    CHECK(strstr(buf, " active=2s(cpu=5.0%,wakeups=200/s,loop=1/s,entries=1)") != NULL);
+    CHECK(strstr(buf, " idle=10s(cpu=0.5%,wakeups=10/s,loop=0/s,entries=1)") != NULL);
+    char small[16];
+    CHECK(!format_power_stats(&idle, 12000, usage_at(150, 500), small, sizeof(small)));
+}
+
+TEST(power_usage_sample_reads_process_usage)
+{
+    PowerUsage before;
+    CHECK(power_usage_sample(&before));
+    volatile uint64_t sink = 0;
+    for (uint64_t i = 0; i < 20000000ULL; ++i)
+        sink += i;
+    PowerUsage after;
+    CHECK(power_usage_sample(&after));
+    CHECK(after.cpu_ns > before.cpu_ns);
+    CHECK(after.context_switches >= before.context_switches);
+}
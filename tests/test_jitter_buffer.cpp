@@ -0,0 +1,125 @@
+#include "test_framework.h"
+#include "jitter_buffer.h"
+
+static GamepadData stick(int lx)
+{
+    GamepadData data;
+    data.leftThumbX = lx;
+    data.RT = 500;
+    return data;
+}
+
+static JitterConfig make_config(JitterPolicy policy)
+{
+    JitterConfig config;
+    config.policy = policy;
+    config.gap_threshold_ms = 40;
+    config.extrapolate_ms = 50;
+    config.decay_ms = 100;
+    config.playout_delay_ms = 40;
+    return config;
+}
+
+TEST(jitter_hold_keeps_last_command_and_counts_gap)
+{
+    JitterBuffer jb;
+    jitter_init(&jb, make_config(JITTER_POLICY_HOLD));
+    CHECK_EQ(0, jitter_sample(&jb, 0).leftThumbX); // 履歴なしはニュートラル
+
+    jitter_push(&jb, 1, stick(1000), 100);
+    jitter_push(&jb, 1, stick(2000), 120);
+    CHECK_EQ(2000, jitter_sample(&jb, 130).leftThumbX);
+    CHECK_EQ(2000, jitter_sample(&jb, 250).leftThumbX);
+    CHECK_EQ(2000, jitter_sample(&jb, 260).leftThumbX);
+    CHECK_EQ(1u, jb.stats.fresh);
+    CHECK_EQ(2u, jb.stats.held);
+    CHECK_EQ(1u, jb.stats.gaps); // 連続した途切れは1回と数える
+    CHECK_EQ(140u, jb.stats.max_gap_ms);
+}
+
+TEST(jitter_extrapolate_continues_then_decays_to_neutral)
+{
+    JitterBuffer jb;
+    jitter_init(&jb, make_config(JITTER_POLICY_EXTRAPOLATE));
+    jitter_push(&jb, 1, stick(1000), 100);
+    jitter_push(&jb, 1, stick(2000), 120); // 50/ms で増加中
+
+    CHECK_EQ(2000, jitter_sample(&jb, 160).leftThumbX); // 40ms までは途切れとみなさない
+    CHECK_EQ(2500, jitter_sample(&jb, 170).leftThumbX); // 途切れから10ms 外挿
+    CHECK_EQ(4500, jitter_sample(&jb, 210).leftThumbX); // 外挿の上限 (50ms)
+
+    GamepadData half = jitter_sample(&jb, 260); // 減衰の途中
+    CHECK_EQ(2250, half.leftThumbX);
+    CHECK_EQ(250, half.RT);
+    GamepadData neutral = jitter_sample(&jb, 310);
+    CHECK_EQ(0, neutral.leftThumbX);
+    CHECK_EQ(0, neutral.RT);
+
+    CHECK_EQ(1u, jb.stats.fresh);
+    CHECK_EQ(2u, jb.stats.extrapolated);
+    CHECK_EQ(2u, jb.stats.decayed);
+
+    // 受信が再開したらすぐに受信値へ戻る
+    jitter_push(&jb, 1, stick(-500), 320);
+    CHECK_EQ(-500, jitter_sample(&jb, 320).leftThumbX);
+}
+
+TEST(jitter_extrapolation_is_clamped_to_stick_range)
+{
+    JitterBuffer jb;
+    jitter_init(&jb, make_config(JITTER_POLICY_EXTRAPOLATE));
+    jitter_push(&jb, 1, stick(20000), 0);
+    jitter_push(&jb, 1, stick(32000), 10);
+    CHECK_EQ(32767, jitter_sample(&jb, 100).leftThumbX);
+}
+
+TEST(jitter_delayed_playout_interpolates_history)
+{
+    JitterBuffer jb;
+    jitter_init(&jb, make_config(JITTER_POLICY_DELAYED));
+    jitter_push(&jb, 1, stick(0), 100);
+    jitter_push(&jb, 1, stick(1000), 120);
+    jitter_push(&jb, 1, stick(3000), 160); // 40ms 遅れて届いたコマンド
+
+    CHECK_EQ(500, jitter_sample(&jb, 150).leftThumbX);  // 再生位置 110ms
+    CHECK_EQ(2000, jitter_sample(&jb, 180).leftThumbX); // 再生位置 140ms
+    CHECK_EQ(3000, jitter_sample(&jb, 210).leftThumbX); // 最新の受信に追いついた
+    CHECK_EQ(2u, jb.stats.interpolated);
+    CHECK_EQ(1u, jb.stats.underruns);
+}
+
+TEST(jitter_source_change_discards_history)
+{
+    JitterBuffer jb;
+    jitter_init(&jb, make_config(JITTER_POLICY_EXTRAPOLATE));
+    jitter_push(&jb, 1, stick(-10000), 0);
+    jitter_push(&jb, 1, stick(0), 10);
+    jitter_push(&jb, 2, stick(5000), 20);
+    CHECK_EQ(1, jb.count);
+    // 前の送信元の変化率では外挿しない
+    CHECK_EQ(5000, jitter_sample(&jb, 100).leftThumbX);
+
+    // 同じ時刻のコマンドは置き換える
+    jitter_push(&jb, 2, stick(6000), 20);
+    CHECK_EQ(1, jb.count);
+    CHECK_EQ(6000, jitter_sample(&jb, 20).leftThumbX);
+}
+
+TEST(jitter_returns_to_neutral_by_link_deadline)
+{
+    // HOLD でも、最後の受信から途絶の判定時間 (ウォッチドッグと同じ起点) でニュートラルになる
+    JitterBuffer jb;
+    jitter_init(&jb, make_config(JITTER_POLICY_HOLD));
+    jitter_push(&jb, 1, stick(2000), 100);
+    CHECK_EQ(2000, jitter_sample(&jb, 299).leftThumbX);
+    CHECK_EQ(0, jitter_sample(&jb, 300).leftThumbX);
+
+    // 途切れ判定+外挿+減衰が判定時間を超える設定では、減衰を短くして判定時間までに終える
+    JitterConfig config = make_config(JITTER_POLICY_EXTRAPOLATE);
+    config.deadline_ms = 140;
+    jitter_init(&jb, config);
+    jitter_push(&jb, 1, stick(2000), 100);
+    CHECK_EQ(2000, jitter_sample(&jb, 190).leftThumbX); // 外挿の終わり (変化率なし)
+    CHECK_EQ(1000, jitter_sample(&jb, 215).leftThumbX); // 減衰は 50ms に縮む
+    CHECK_EQ(0, jitter_sample(&jb, 240).leftThumbX);
+}
@@ -0,0 +1,136 @@
+#include "test_framework.h"
+#include "leak_monitor.h"
+#include "bindings_stub.h"
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// ループバック上の警報受信用ソケット
+static int open_receiver(int port, struct sockaddr_in *addr)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr->sin_port = htons(port);
+    bind(fd, (struct sockaddr *)addr, sizeof(*addr));
+    return fd;
+}
+
+TEST(leak_monitor_stops_thrusters_and_sends_alert)
+{
+    stub_hardware_reset();
+    thruster_set_all_pwm(PWM_STOP);
+    struct sockaddr_in station;
+    int fd = open_receiver(39200, &station);
+
+    LeakMonitorConfig config;
+    config.period_ms = 2;
+    config.confirm_samples = 2;
+    config.led_flash_period_ms = 10;
+    CHECK(leak_monitor_start(config));
+    leak_monitor_set_alert_targets(&station, 1);
+    CHECK(thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 4, 1700));
+
+    usleep(20000);
+    CHECK(!leak_monitor_leak_detected());
+
+    stub_hardware().leak = true;
+    usleep(30000);
+    CHECK(leak_monitor_leak_detected());
+    CHECK_EQ(PWM_STOP, stub_pwm_us(4));
+    // 保護動作中は通常制御・ウォッチドッグの書き込みが無視される
+    CHECK(!thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 4, 1700));
+    CHECK(!thruster_owner_set_all_pwm(OUTPUT_OWNER_WATCHDOG, 1500));
+    CHECK_EQ(PWM_STOP, stub_pwm_us(4));
+
+    char buf[256];
+    ssize_t len = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+    CHECK(len > 0);
+    buf[len] = '\0';
+    CHECK(strncmp(buf, "ALERT:LEAK,SEQ:0,ACTION:STOP", 28) == 0);
+
+    LeakMonitorStats stats = leak_monitor_stats();
+    CHECK_EQ(1u, stats.detections);
+    CHECK(stats.alerts_sent >= 1u);
+    // センサーの反応から保護動作まで: 確定に必要な周期 + スケジューリングの遅れ
+    CHECK(stats.last_reaction_us < 20000u);
+
+    // 解除すると出力が返る (センサーが反応し続けていれば再び検知される)
+    stub_hardware().leak = false;
+    leak_monitor_clear();
+    usleep(10000);
+    CHECK(!leak_monitor_leak_detected());
+    CHECK(thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 4, 1200));
+
+    leak_monitor_stop();
+    close(fd);
+}
+
+TEST(leak_monitor_surface_action_and_noise_rejection)
+{
+    stub_hardware_reset();
+    thruster_set_all_pwm(PWM_STOP);
+    LeakMonitorConfig config;
+    config.period_ms = 2;
+    config.confirm_samples = 1000; // 実質的に確定しない: 一時的な反応では動作しない
+    config.action = LEAK_ACTION_SURFACE;
+    CHECK(leak_monitor_start(config));
+    stub_hardware().leak = true;
+    usleep(20000);
+    CHECK(!leak_monitor_leak_detected());
+    leak_monitor_stop();
+
+    config.confirm_samples = 1;
+    CHECK(leak_monitor_start(config));
+    usleep(20000);
+    CHECK(leak_monitor_leak_detected());
+    CHECK_EQ(PWM_STOP, stub_pwm_us(0));
+    // 上下方向のスラスターがない構成では、前進用の Ch4-5 を回さずに停止する
+    CHECK_EQ(0u, thruster_heave_channel_mask());
+    CHECK_EQ(PWM_STOP, stub_pwm_us(4));
+    CHECK_EQ(PWM_STOP, stub_pwm_us(5));
+    leak_monitor_stop();
+    stub_hardware().leak = false;
+
+    // 停止すると出力の占有も解除される
+    CHECK(thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 4, PWM_STOP));
+}
+
+TEST(leak_monitor_zero_period_still_samples_and_stops)
+{
+    stub_hardware_reset();
+    thruster_set_all_pwm(PWM_STOP);
+    LeakMonitorConfig config;
+    config.period_ms = 0; // timerfd を止めずに最短の周期で動く
+    config.confirm_samples = 1;
+    CHECK(leak_monitor_start(config));
+    stub_hardware().leak = true;
+    usleep(20000);
+    CHECK(leak_monitor_leak_detected());
+    CHECK(leak_monitor_stats().samples > 0u);
+    leak_monitor_stop(); // スレッドが満了を待ち続けると、ここで戻らなくなる
+    stub_hardware().leak = false;
+    CHECK(thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 4, PWM_STOP));
+}
+
+TEST(leak_clear_gesture_requires_held_combo)
+{
+    LeakClearGesture gesture;
+    uint16_t combo = LEAK_CLEAR_BUTTONS;
+    // 片方だけでは解除しない
+    CHECK(!leak_clear_gesture_update(&gesture, GamepadButton::Start, 0));
+    CHECK(!leak_clear_gesture_update(&gesture, GamepadButton::Start, LEAK_CLEAR_HOLD_MS + 10));
+    // 押し続けた時間が足りなければ解除しない (途中で離すと計り直す)
+    CHECK(!leak_clear_gesture_update(&gesture, combo, 1000));
+    CHECK(!leak_clear_gesture_update(&gesture, combo, 1000 + LEAK_CLEAR_HOLD_MS - 1));
+    CHECK(!leak_clear_gesture_update(&gesture, 0, 1000 + LEAK_CLEAR_HOLD_MS));
+    CHECK(!leak_clear_gesture_update(&gesture, combo | GamepadButton::A, 5000));
+    CHECK(leak_clear_gesture_update(&gesture, combo | GamepadButton::A, 5000 + LEAK_CLEAR_HOLD_MS));
+    // 押し続けている間は1度だけ
+    CHECK(!leak_clear_gesture_update(&gesture, combo, 9000 + LEAK_CLEAR_HOLD_MS));
+    CHECK(!leak_clear_gesture_update(&gesture, 0, 9100 + LEAK_CLEAR_HOLD_MS));
+    CHECK(!leak_clear_gesture_update(&gesture, combo, 10000));
+    CHECK(leak_clear_gesture_update(&gesture, combo, 10000 + LEAK_CLEAR_HOLD_MS));
+}
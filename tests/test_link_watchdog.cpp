@@ -0,0 +1,155 @@
+#include "test_framework.h"
+#include "link_watchdog.h"
+#include "bindings_stub.h"
+#include "monotonic_clock.h"
+#include <unistd.h>
+
+TEST(watchdog_ramps_down_and_recovers)
+{
+    thruster_set_all_pwm(PWM_STOP);
+    WatchdogConfig config;
+    config.period_ms = 5;
+    config.link_timeout_ms = 30;
+    config.hold_ms = 30;
+    config.ramp_slew_us_per_s = 60000;
+    CHECK(watchdog_start(config));
+    CHECK_EQ(WATCHDOG_WAITING, watchdog_state());
+
+    watchdog_feed();
+    usleep(20000);
+    CHECK(watchdog_control_allowed());
+    thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 4, 1700);
+
+    // feed を止めると HOLD を経て SAFE まで下がる
+    usleep(45000);
+    CHECK(!watchdog_control_allowed());
+    usleep(100000);
+    CHECK_EQ(WATCHDOG_SAFE, watchdog_state());
+    CHECK_EQ(PWM_STOP, stub_pwm_us(4));
+
+    // コマンドが再開すれば NORMAL に戻り、メインループが出力できる
+    watchdog_feed();
+    usleep(20000);
+    CHECK(watchdog_control_allowed());
+    CHECK(thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 4, 1200));
+    watchdog_stop();
+}
+
+TEST(watchdog_manual_mode_steps_with_given_time)
+{
+    thruster_set_all_pwm(PWM_STOP);
+    WatchdogConfig config;
+    config.period_ms = 10;
+    config.link_timeout_ms = 200;
+    config.hold_ms = 300;
+    config.ramp_slew_us_per_s = 2000;
+    watchdog_start_manual(config);
+    thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 4, PWM_BOOST_MAX);
+
+    // 再起動前の最後のコマンドの時刻を引き継ぐ: 途絶えたままなら HOLD から始まる
+    uint64_t now_ns = monotonic_now_ns();
+    watchdog_restore_feed(now_ns - 150000000ULL);
+    watchdog_step(now_ns);
+    CHECK_EQ(WATCHDOG_NORMAL, watchdog_state());
+    now_ns += 100000000ULL;
+    watchdog_step(now_ns);
+    CHECK_EQ(WATCHDOG_HOLD, watchdog_state());
+    CHECK_EQ(PWM_BOOST_MAX, stub_pwm_us(4)); // HOLD 中は最後の出力を保持
+
+    // 時刻を進めるだけで (実時間を待たずに) RAMP_DOWN を経て SAFE になる: 10ms ごとに 20us ずつ下げる
+    for (int i = 0; i < 30; ++i)
+    {
+        now_ns += 10000000ULL;
+        watchdog_step(now_ns);
+    }
+    CHECK_EQ(WATCHDOG_RAMP_DOWN, watchdog_state());
+    for (int i = 0; i < (PWM_BOOST_MAX - PWM_STOP) / 20 + 1; ++i)
+    {
+        now_ns += 10000000ULL;
+        watchdog_step(now_ns);
+    }
+    CHECK_EQ(WATCHDOG_SAFE, watchdog_state());
+    CHECK_EQ(PWM_STOP, stub_pwm_us(4));
+    watchdog_stop();
+    CHECK(thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 4, PWM_STOP)); // 停止すると出力の占有も解除される
+}
+
+TEST(watchdog_times_out_from_last_packet_not_last_feed_call)
+{
+    thruster_set_all_pwm(PWM_STOP);
+    WatchdogConfig config;
+    config.link_timeout_ms = 200;
+    watchdog_start_manual(config);
+
+    // 鮮度内の間は毎周期 feed されても、渡される時刻は最後のパケットの受理時刻のまま
+    uint64_t packet_ns = monotonic_now_ns() - 500000000ULL;
+    uint64_t now_ns = packet_ns;
+    for (int i = 0; i < 20; ++i)
+    {
+        watchdog_feed_at(packet_ns);
+        watchdog_step(now_ns);
+        now_ns += 10000000ULL;
+    }
+    CHECK_EQ(WATCHDOG_NORMAL, watchdog_state());
+    watchdog_feed_at(packet_ns - 50000000ULL); // 古い時刻では戻らない
+    watchdog_step(packet_ns + 200000000ULL);
+    CHECK_EQ(WATCHDOG_NORMAL, watchdog_state());
+    watchdog_step(packet_ns + 210000000ULL);
+    CHECK_EQ(WATCHDOG_HOLD, watchdog_state()); // 最後のパケットから link_timeout_ms で途絶と判定する
+    watchdog_stop();
+}
+
+TEST(watchdog_surface_is_disabled_without_heave_thrusters)
+{
+    thruster_set_all_pwm(PWM_STOP);
+    WatchdogConfig config;
+    config.link_timeout_ms = 200;
+    config.hold_ms = 0;
+    config.surface_enabled = true;
+    config.surface_delay_ms = 0;
+    config.surface_channel_mask = (1u << 4) | (1u << 5);
+    watchdog_start_manual(config);
+
+    uint64_t now_ns = monotonic_now_ns();
+    watchdog_restore_feed(now_ns);
+    for (int i = 0; i < 100; ++i)
+    {
+        now_ns += 10000000ULL;
+        watchdog_step(now_ns);
+    }
+    // 前進用の Ch4-5 で「浮上」せず、SAFE にとどまる
+    CHECK_EQ(WATCHDOG_SAFE, watchdog_state());
+    CHECK_EQ(PWM_STOP, stub_pwm_us(4));
+    CHECK_EQ(PWM_STOP, stub_pwm_us(5));
+    watchdog_stop();
+}
+
+TEST(watchdog_ramp_down_completes_when_leak_owns_outputs)
+{
+    thruster_set_all_pwm(PWM_STOP);
+    WatchdogConfig config;
+    config.period_ms = 10;
+    config.link_timeout_ms = 200;
+    config.hold_ms = 300;
+    config.ramp_slew_us_per_s = 2000;
+    watchdog_start_manual(config);
+    thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 4, PWM_BOOST_MAX);
+
+    uint64_t now_ns = monotonic_now_ns();
+    watchdog_restore_feed(now_ns);
+    now_ns += 250000000ULL;
+    watchdog_step(now_ns);
+    CHECK_EQ(WATCHDOG_HOLD, watchdog_state());
+    now_ns += 310000000ULL;
+    watchdog_step(now_ns);
+    CHECK_EQ(WATCHDOG_RAMP_DOWN, watchdog_state());
+
+    // 浸水検知が出力を占有すると (安全値と異なる出力のままでも) 減速は完了として SAFE に進む
+    thruster_claim_output(OUTPUT_OWNER_LEAK);
+    now_ns += 10000000ULL;
+    watchdog_step(now_ns);
+    CHECK_EQ(WATCHDOG_SAFE, watchdog_state());
+    CHECK(stub_pwm_us(4) != PWM_STOP); // 浸水検知の出力を上書きしない
+    thruster_release_output(OUTPUT_OWNER_LEAK);
+    watchdog_stop();
+}
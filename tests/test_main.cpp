@@ -0,0 +1,61 @@
+#include "test_framework.h"
+#include "bindings_stub.h" // 各テストの前にスタブの状態をリセットするため
+#include <vector>
+#include <string>
+
+struct RegisteredTest
+{
+    const char *name;
+    TestFunction func;
+};
+
+// 静的初期化順序に依存しないよう、関数内の static でテスト一覧を保持する
+static std::vector<RegisteredTest> &registered_tests()
+{
+    static std::vector<RegisteredTest> tests;
+    return tests;
+}
+
+static bool current_test_failed = false;
+
+void register_test(const char *name, TestFunction func)
+{
+    RegisteredTest test = {name, func};
+    registered_tests().push_back(test);
+}
+
+void test_fail(const char *file, int line, const char *message)
+{
+    std::cerr << "    " << file << ":" << line << ": CHECK failed: " << message << std::endl;
+    current_test_failed = true;
+}
+
+int main(int argc, char **argv)
+{
+    // 引数でテスト名の一部を指定すると、それを含むテストだけを実行する
+    std::string filter = argc > 1 ? argv[1] : "";
+    int passed = 0;
+    int failed = 0;
+
+    for (const RegisteredTest &test : registered_tests())
+    {
+        if (!filter.empty() && std::string(test.name).find(filter) == std::string::npos)
+            continue;
+        stub_hardware_reset();
+        current_test_failed = false;
+        test.func();
+        if (current_test_failed)
+        {
+            std::cout << "[FAIL] " << test.name << std::endl;
+            failed++;
+        }
+        else
+        {
+            std::cout << "[ OK ] " << test.name << std::endl;
+            passed++;
+        }
+    }
+
+    std::cout << passed << " passed, " << failed << " failed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
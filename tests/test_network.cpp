@@ -0,0 +1,135 @@
+#include "test_framework.h"
+#include "network.h"
+#include <arpa/inet.h>
+#include <string.h>
+#include <unistd.h>
+
+// ループバック上のテスト用クライアントソケット
+static int open_client(int port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    return fd;
+}
+
+static void send_to_server(int fd, int server_port, const char *msg)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server_port);
+    sendto(fd, msg, strlen(msg), 0, (struct sockaddr *)&addr, sizeof(addr));
+    usleep(2000); // ループバックでの到着を待つ
+}
+
+static int count_received(int fd)
+{
+    char buf[256];
+    int count = 0;
+    while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+        count++;
+    return count;
+}
+
+TEST(network_control_packet_registers_sender_as_subscriber)
+{
+    NetworkContext ctx;
+    CHECK(network_init(&ctx, 39100, 39101));
+    int pilot = open_client(39101);
+    send_to_server(pilot, 39100, "0,0,0,0,0,0,0");
+
+    char buf[NET_BUFFER_SIZE];
+    CHECK_EQ(13, (int)network_receive(&ctx, buf, sizeof(buf)));
+    CHECK(ctx.client_addr_known);
+    CHECK_EQ(1, network_subscriber_count(&ctx));
+    CHECK(network_send(&ctx, "hello", 5));
+    usleep(2000);
+    CHECK_EQ(1, count_received(pilot));
+
+    close(pilot);
+    network_close(&ctx);
+}
+
+TEST(network_fans_out_to_observers_without_stealing)
+{
+    NetworkContext ctx;
+    CHECK(network_init(&ctx, 39110, 39111));
+    int pilot = open_client(39111);
+    int observer = open_client(39112);
+    send_to_server(pilot, 39110, "0,0,0,0,0,0,0");
+    send_to_server(observer, 39110, "SUB,100,39112");
+
+    char buf[NET_BUFFER_SIZE];
+    CHECK(network_receive(&ctx, buf, sizeof(buf)) > 0);
+    CHECK_EQ(0, (int)network_receive(&ctx, buf, sizeof(buf))); // 購読メッセージは操縦データとして返らない
+    CHECK_EQ(2, network_subscriber_count(&ctx));
+
+    CHECK(network_send(&ctx, "frame", 5));
+    usleep(2000);
+    CHECK_EQ(1, count_received(pilot));
+    CHECK_EQ(1, count_received(observer));
+
+    send_to_server(observer, 39110, "UNSUB,39112");
+    CHECK_EQ(0, (int)network_receive(&ctx, buf, sizeof(buf)));
+    CHECK_EQ(1, network_subscriber_count(&ctx));
+
+    close(pilot);
+    close(observer);
+    network_close(&ctx);
+}
+
+TEST(network_respects_subscriber_rate_except_send_to_all)
+{
+    NetworkContext ctx;
+    CHECK(network_init(&ctx, 39120, 39121));
+    int observer = open_client(39122);
+    send_to_server(observer, 39120, "SUB,1,39122"); // 1Hz
+
+    char buf[NET_BUFFER_SIZE];
+    network_receive(&ctx, buf, sizeof(buf));
+    CHECK(network_send(&ctx, "a", 1));
+    CHECK(network_send(&ctx, "b", 1)); // レート制限で送られない
+    CHECK(network_send_to_all(&ctx, "k", 1));
+    usleep(2000);
+    CHECK_EQ(2, count_received(observer));
+
+    close(observer);
+    network_close(&ctx);
+}
+
+TEST(network_skips_failed_subscriber_and_sends_to_the_rest)
+{
+    NetworkContext ctx;
+    CHECK(network_init(&ctx, 39130, 39131));
+    int pilot = open_client(39131);
+    int observer = open_client(39132);
+    send_to_server(pilot, 39130, "0,0,0,0,0,0,0");
+    char buf[NET_BUFFER_SIZE];
+    CHECK(network_receive(&ctx, buf, sizeof(buf)) > 0);
+
+    // ポート 0 宛ての送信は失敗する。操縦者と観測用PCの間に置き、sendmmsg を途中で止めさせる
+    struct sockaddr_in broken;
+    memset(&broken, 0, sizeof(broken));
+    broken.sin_family = AF_INET;
+    broken.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    broken.sin_port = htons(0);
+    CHECK(network_subscribe(&ctx, &broken, 100));
+    send_to_server(observer, 39130, "SUB,100,39132");
+    network_receive(&ctx, buf, sizeof(buf));
+    CHECK_EQ(3, network_subscriber_count(&ctx));
+
+    CHECK(!network_send_to_all(&ctx, "frame", 5)); // 失敗した購読者があることは報告する
+    usleep(2000);
+    CHECK_EQ(1, count_received(pilot));
+    CHECK_EQ(1, count_received(observer)); // 失敗した購読者より後ろにも届く
+
+    close(pilot);
+    close(observer);
+    network_close(&ctx);
+}
@@ -0,0 +1,105 @@
+#include "test_framework.h"
+#include "runtime_state.h"
+#include "monotonic_clock.h"
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+
+// テストごとに別の共有メモリ名を使う (並行実行や前回の残骸と衝突しないように)
+static void test_state_name(char *buf, size_t size, const char *suffix)
+{
+    snprintf(buf, size, "/ws3_runtime_state_test_%d_%s", static_cast<int>(getpid()), suffix);
+}
+
+static RuntimeSnapshot make_snapshot(uint32_t tick, int pwm4)
+{
+    RuntimeSnapshot snapshot = RuntimeSnapshot();
+    snapshot.saved_ns = monotonic_now_ns();
+    snapshot.tick = tick;
+    for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+        snapshot.thruster_pwm[ch] = PWM_MIN;
+    snapshot.thruster_pwm[4] = pwm4;
+    snapshot.led_pwm = LED_PWM_ON;
+    snapshot.arbiter.sources[0].in_use = true;
+    snapshot.arbiter.sources[0].last_seq = 1000 + tick;
+    snapshot.surface_valid = true;
+    snapshot.surface_pressure = 101.3f;
+    return snapshot;
+}
+
+TEST(runtime_state_survives_reopen)
+{
+    char name[64];
+    test_state_name(name, sizeof(name), "reopen");
+    RuntimeState writer;
+    CHECK(runtime_state_open(&writer, name));
+    RuntimeSnapshot loaded;
+    CHECK(!runtime_state_load(&writer, monotonic_now_ns(), RUNTIME_STATE_MAX_AGE_MS, &loaded)); // 保存前
+
+    runtime_state_save(&writer, make_snapshot(7, 1700));
+    runtime_state_save(&writer, make_snapshot(8, 1750));
+    runtime_state_close(&writer); // 異常終了した制御プロセスに相当 (共有メモリは残る)
+
+    RuntimeState reader;
+    CHECK(runtime_state_open(&reader, name));
+    CHECK(runtime_state_load(&reader, monotonic_now_ns(), RUNTIME_STATE_MAX_AGE_MS, &loaded));
+    CHECK_EQ(8u, loaded.tick);
+    CHECK_EQ(1750, loaded.thruster_pwm[4]);
+    CHECK_EQ(LED_PWM_ON, loaded.led_pwm);
+    CHECK_EQ(1008u, loaded.arbiter.sources[0].last_seq);
+    CHECK(loaded.surface_valid);
+    CHECK_NEAR(101.3f, loaded.surface_pressure, 1e-4f);
+
+    // 古すぎる状態・無効にした状態からは復元しない
+    CHECK(!runtime_state_load(&reader, loaded.saved_ns + 2000000000ULL, RUNTIME_STATE_MAX_AGE_MS, &loaded));
+    runtime_state_invalidate(&reader);
+    CHECK(!runtime_state_load(&reader, monotonic_now_ns(), RUNTIME_STATE_MAX_AGE_MS, &loaded));
+    runtime_state_close(&reader);
+    runtime_state_unlink(name);
+}
+
+TEST(runtime_state_interrupted_save_keeps_previous_slot)
+{
+    char name[64];
+    test_state_name(name, sizeof(name), "torn");
+    RuntimeState state;
+    CHECK(runtime_state_open(&state, name));
+    runtime_state_save(&state, make_snapshot(1, 1600));
+
+    // 保存の途中 (切り替え前) で異常終了した場合: 書きかけのスロットは使われない
+    uint32_t inactive = state.layout->active_slot.load() ^ 1u;
+    memset(static_cast<void *>(&state.layout->slots[inactive]), 0xAB, sizeof(RuntimeSnapshot));
+
+    RuntimeSnapshot loaded;
+    CHECK(runtime_state_load(&state, monotonic_now_ns(), RUNTIME_STATE_MAX_AGE_MS, &loaded));
+    CHECK_EQ(1u, loaded.tick);
+    CHECK_EQ(1600, loaded.thruster_pwm[4]);
+    runtime_state_close(&state);
+    runtime_state_unlink(name);
+}
+
+TEST(runtime_state_mismatched_layout_is_recreated)
+{
+    char name[64];
+    test_state_name(name, sizeof(name), "version");
+    RuntimeState state;
+    CHECK(runtime_state_open(&state, name));
+    runtime_state_save(&state, make_snapshot(3, 1600));
+    state.layout->version = RUNTIME_STATE_VERSION + 1; // 別のビルドが残したレイアウト
+    runtime_state_close(&state);
+
+    CHECK(runtime_state_open(&state, name));
+    CHECK_EQ(static_cast<uint32_t>(RUNTIME_STATE_VERSION), state.layout->version);
+    RuntimeSnapshot loaded;
+    CHECK(!runtime_state_load(&state, monotonic_now_ns(), RUNTIME_STATE_MAX_AGE_MS, &loaded));
+
+    // 終了検知の時刻がなければ最後の保存から計る
+    uint64_t now_ns = monotonic_now_ns();
+    CHECK_EQ(5000000u, runtime_state_mark_control_resumed(&state, now_ns - 5000000ULL, now_ns));
+    state.layout->control_exit_ns.store(now_ns - 2000000ULL);
+    CHECK_EQ(2000000u, runtime_state_mark_control_resumed(&state, now_ns - 5000000ULL, now_ns));
+    CHECK_EQ(0u, state.layout->control_exit_ns.load()); // 計測に使った時刻は消える
+    CHECK_EQ(5000000u, state.layout->max_restart_to_control_ns.load());
+    runtime_state_close(&state);
+    runtime_state_unlink(name);
+}
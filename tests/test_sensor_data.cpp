@@ -0,0 +1,47 @@
+#include "test_framework.h"
+#include "sensor_data.h"
+#include "bindings_stub.h"
+#include <string.h>
+
+TEST(sensor_read_updates_cache_from_hardware)
+{
+    stub_hardware().leak = true;
+    stub_hardware().adc[2] = 3.3f;
+    stub_hardware().gyro.z = -1.5f;
+    SensorData data;
+    sensor_read_slow(&data);
+    sensor_read_fast(&data);
+    CHECK(data.leak);
+    CHECK_NEAR(3.3f, data.adc[2], 1e-6);
+    CHECK_NEAR(-1.5f, data.gyro.z, 1e-6);
+    CHECK_NEAR(1013.25f, data.pressure, 1e-3);
+}
+
+TEST(sensor_read_slow_converts_power_module_channels)
+{
+    stub_hardware_reset();
+    stub_hardware().adc[SENSOR_ADC_VOLTAGE_CHANNEL] = 1.5f;
+    stub_hardware().adc[SENSOR_ADC_CURRENT_CHANNEL] = 0.33f + 0.264f; // 10A
+    SensorData data;
+    sensor_read_slow(&data);
+    CHECK_NEAR(16.5f, data.battery_voltage, 1e-4f);
+    CHECK_NEAR(10.0f, data.battery_current, 1e-2f);
+    CHECK_NEAR(165.0f, data.power_w, 0.2f);
+}
+
+TEST(sensor_format_contains_all_fields)
+{
+    char buffer[SENSOR_BUFFER_SIZE];
+    CHECK(read_and_format_sensor_data(buffer, sizeof(buffer)));
+    const char *labels[] = {"TEMP:", "PRESSURE:", "LEAK:0", "ADC0:", "ADC3:", "ACCZ:9.81", "GYROX:", "MAGZ:"};
+    for (const char *label : labels)
+        CHECK(strstr(buffer, label) != NULL);
+}
+
+TEST(sensor_format_rejects_empty_buffer)
+{
+    SensorData data;
+    CHECK(!format_sensor_data(data, NULL, 10));
+    char buffer[1];
+    CHECK(!format_sensor_data(data, buffer, 0));
+}
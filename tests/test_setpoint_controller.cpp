@@ -0,0 +1,67 @@
+#include "test_framework.h"
+#include "setpoint_controller.h"
+
+static const AxisData NO_ROTATION = {0.0f, 0.0f, 0.0f};
+
+TEST(setpoint_heading_turns_shortest_way)
+{
+    SetpointController ctrl;
+    setpoint_init(&ctrl, SetpointGains());
+    SetpointCommand sp;
+    sp.hold_heading = true;
+    sp.heading_deg = 170.0f;
+    Attitude att;
+    att.yaw_deg = -170.0f; // 目標まで左回りで 20度 (右回りだと 340度)
+    BodyThrust demand = setpoint_update(&ctrl, sp, att, NO_ROTATION, 0.01f);
+    CHECK(demand.yaw < 0.0f); // 左旋回
+    CHECK_NEAR(-0.4f, demand.yaw, 0.001f);
+
+    // 目標に向かって回っているときは角速度でダンピングされる
+    AxisData turning_left = {0.0f, 0.0f, -40.0f};
+    BodyThrust damped = setpoint_update(&ctrl, sp, att, turning_left, 0.01f);
+    CHECK(damped.yaw > demand.yaw);
+}
+
+TEST(setpoint_yaw_rate_and_passthrough_axes)
+{
+    SetpointController ctrl;
+    setpoint_init(&ctrl, SetpointGains());
+    SetpointCommand sp;
+    sp.surge = 0.5f;
+    sp.sway = -2.0f; // 範囲外はクランプ
+    sp.heave = 0.25f;
+    sp.yaw_rate_dps = 30.0f;
+    BodyThrust demand = setpoint_update(&ctrl, sp, Attitude(), NO_ROTATION, 0.01f);
+    CHECK_NEAR(0.5f, demand.surge, 1e-6f);
+    CHECK_NEAR(-1.0f, demand.sway, 1e-6f);
+    CHECK_NEAR(0.25f, demand.heave, 1e-6f); // 深度保持なしなら heave はそのまま
+    CHECK_NEAR(30.0f * SetpointGains().yaw_rate_kp, demand.yaw, 1e-6f);
+}
+
+TEST(setpoint_depth_hold_converges_in_simple_plant)
+{
+    SetpointController ctrl;
+    setpoint_init(&ctrl, SetpointGains());
+    const float surface_kpa = 101.3f;
+    setpoint_update_depth(&ctrl, surface_kpa, 0.0f);
+    CHECK(ctrl.surface_valid);
+    CHECK_NEAR(0.0f, ctrl.depth_m, 1e-6f);
+
+    SetpointCommand sp;
+    sp.hold_depth = true;
+    sp.depth_m = 2.0f;
+    // 簡単な一次系: 上下推力 1.0 で 0.5 m/s、わずかな正浮力 (0.02 m/s で浮上)
+    float depth = 0.0f;
+    const float dt = 0.01f;
+    for (int i = 0; i < 6000; ++i)
+    {
+        setpoint_update_depth(&ctrl, surface_kpa + depth * ctrl.gains.kpa_per_m, dt);
+        BodyThrust demand = setpoint_update(&ctrl, sp, Attitude(), NO_ROTATION, dt);
+        depth += (-demand.heave * 0.5f - 0.02f) * dt;
+    }
+    CHECK_NEAR(2.0f, depth, 0.05f);
+    CHECK(ctrl.depth_integral > 0.0f); // 浮力を打ち消す分が積分に溜まる
+
+    setpoint_reset(&ctrl);
+    CHECK_NEAR(0.0f, ctrl.depth_integral, 1e-6f);
+}
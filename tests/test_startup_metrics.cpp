@@ -0,0 +1,26 @@
+#include "test_framework.h"
+#include "startup_metrics.h"
+#include <unistd.h>
+
+TEST(startup_metrics_record_only_first_event)
+{
+    startup_metrics_begin();
+    CHECK_EQ(0u, startup_metrics_first_control_tick_ns());
+    CHECK_EQ(0u, startup_metrics_first_video_frame_ns(0));
+
+    startup_metrics_mark_first_control_tick();
+    uint64_t first_tick = startup_metrics_first_control_tick_ns();
+    CHECK(first_tick > 0);
+    usleep(2000);
+    startup_metrics_mark_first_control_tick();
+    CHECK_EQ(first_tick, startup_metrics_first_control_tick_ns());
+
+    // カメラごとに独立して記録される
+    startup_metrics_mark_first_video_frame(1);
+    CHECK(startup_metrics_first_video_frame_ns(1) >= first_tick);
+    CHECK_EQ(0u, startup_metrics_first_video_frame_ns(0));
+
+    // 範囲外のカメラ番号は無視
+    startup_metrics_mark_first_video_frame(STARTUP_MAX_CAMERAS);
+    CHECK_EQ(0u, startup_metrics_first_video_frame_ns(STARTUP_MAX_CAMERAS));
+}
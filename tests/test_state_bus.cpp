@@ -0,0 +1,226 @@
+#include "test_framework.h"
+#include "state_bus.h"
+#include "monotonic_clock.h"
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+#include <stdio.h>
+#include <math.h>
+
+// テストごとに別の共有メモリ名を使う (並行実行や前回の残骸と衝突しないように)
+static void test_bus_name(char *buf, size_t size, const char *suffix)
+{
+    snprintf(buf, size, "/ws3_state_bus_test_%d_%s", static_cast<int>(getpid()), suffix);
+}
+
+TEST(state_bus_publishes_snapshot_to_reader)
+{
+    char name[64];
+    test_bus_name(name, sizeof(name), "pub");
+    StateBus server, client;
+    CHECK(state_bus_create(&server, name));
+    CHECK(state_bus_open(&client, name));
+
+    StateSnapshot snapshot;
+    CHECK(!state_bus_read(&client, &snapshot)); // 公開前は読めない
+
+    StateSnapshot published = StateSnapshot();
+    published.tick = 42;
+    published.active_source = 3;
+    published.sensors.pressure = 1013.25f;
+    published.attitude.yaw_deg = 91.5f;
+    published.thruster_pwm[5] = 1700;
+    state_bus_publish(&server, published);
+
+    CHECK(state_bus_read(&client, &snapshot));
+    CHECK_EQ(42u, snapshot.tick);
+    CHECK_EQ(3, snapshot.active_source);
+    CHECK_NEAR(1013.25f, snapshot.sensors.pressure, 0.001f);
+    CHECK_NEAR(91.5f, snapshot.attitude.yaw_deg, 0.001f);
+    CHECK_EQ(1700, snapshot.thruster_pwm[5]);
+
+    state_bus_close(&client);
+    state_bus_close(&server);
+    CHECK(!state_bus_open(&client, name)); // 制御プロセス側が閉じたら名前も消える
+}
+
+TEST(state_bus_reader_never_sees_torn_snapshot)
+{
+    char name[64];
+    test_bus_name(name, sizeof(name), "torn");
+    StateBus server, client;
+    CHECK(state_bus_create(&server, name));
+    CHECK(state_bus_open(&client, name));
+
+    // 書き手はすべての PWM を tick と同じ値にして公開し続ける。読み手は混ざった値を見てはならない
+    std::atomic<bool> stop(false);
+    std::thread writer([&]() {
+        StateSnapshot s = StateSnapshot();
+        for (uint32_t tick = 1; !stop.load(); ++tick)
+        {
+            s.tick = tick;
+            for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+                s.thruster_pwm[ch] = static_cast<int32_t>(tick);
+            state_bus_publish(&server, s);
+        }
+    });
+    int torn = 0;
+    int reads = 0;
+    uint64_t deadline_ms = monotonic_now_ms() + 500;
+    while (reads < 100000 && monotonic_now_ms() < deadline_ms)
+    {
+        StateSnapshot s;
+        if (!state_bus_read(&client, &s))
+            continue;
+        reads++;
+        for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+            if (s.thruster_pwm[ch] != static_cast<int32_t>(s.tick))
+                torn++;
+    }
+    stop.store(true);
+    writer.join();
+    CHECK(reads > 0);
+    CHECK_EQ(0, torn);
+
+    state_bus_close(&client);
+    state_bus_close(&server);
+}
+
+TEST(state_bus_command_queue_is_fifo_and_bounded)
+{
+    char name[64];
+    test_bus_name(name, sizeof(name), "cmd");
+    StateBus server, client;
+    CHECK(state_bus_create(&server, name));
+    CHECK(state_bus_open(&client, name));
+
+    StateBusCommand command = StateBusCommand();
+    command.type = CommandGamepad;
+    command.source_id = 5;
+    for (uint32_t i = 0; i < STATE_BUS_COMMAND_CAPACITY; ++i)
+    {
+        command.seq = i;
+        CHECK(state_bus_push_command(&client, command));
+    }
+    CHECK(!state_bus_push_command(&client, command)); // 満杯
+    CHECK_EQ(1u, server.layout->commands_dropped.load());
+
+    StateBusCommand popped;
+    for (uint32_t i = 0; i < STATE_BUS_COMMAND_CAPACITY; ++i)
+    {
+        CHECK(state_bus_pop_command(&server, &popped));
+        CHECK_EQ(i, popped.seq);
+    }
+    CHECK(!state_bus_pop_command(&server, &popped)); // 空
+
+    state_bus_close(&client);
+    state_bus_close(&server);
+}
+
+TEST(state_bus_resume_keeps_reader_mapping_and_queue)
+{
+    char name[64];
+    test_bus_name(name, sizeof(name), "resume");
+    StateBus crashed, client;
+    CHECK(state_bus_create(&crashed, name));
+    CHECK(state_bus_open(&client, name));
+    StateBusCommand command = StateBusCommand();
+    command.type = CommandGamepad;
+    command.seq = 77;
+    CHECK(state_bus_push_command(&client, command));
+    // 公開の途中で異常終了した制御プロセス (seq が奇数のまま、名前も削除されない)
+    crashed.layout->state_seq.fetch_add(1);
+    crashed.owner = false;
+    state_bus_close(&crashed);
+
+    StateBus resumed;
+    CHECK(state_bus_resume(&resumed, name));
+    CHECK(resumed.owner);
+    StateBusCommand popped;
+    CHECK(state_bus_pop_command(&resumed, &popped)); // 再起動前に積まれたコマンドも失われない
+    CHECK_EQ(77u, popped.seq);
+
+    // 接続したままの読み手が、再起動後の公開を読める
+    StateSnapshot published = StateSnapshot();
+    published.tick = 9;
+    state_bus_publish(&resumed, published);
+    StateSnapshot snapshot;
+    CHECK(state_bus_read(&client, &snapshot));
+    CHECK_EQ(9u, snapshot.tick);
+
+    state_bus_close(&client);
+    state_bus_close(&resumed);
+}
+
+TEST(state_bus_command_converts_to_arbiter_packet)
+{
+    StateBusCommand command = StateBusCommand();
+    command.type = CommandGamepad;
+    command.source_id = 6;
+    command.seq = 9;
+    command.priority = 30;
+    command.axes[0] = 40000; // 範囲外はクランプ
+    command.axes[3] = -1200;
+    command.buttons = GamepadButton::A;
+    CommandPacket packet = state_bus_command_to_packet(command);
+    CHECK_EQ(CommandGamepad, packet.type);
+    CHECK_EQ(6, packet.source_id);
+    CHECK(packet.has_seq);
+    CHECK_EQ(9u, packet.seq);
+    CHECK_EQ(30, packet.priority);
+    CHECK_EQ(32767, packet.gamepad.leftThumbX);
+    CHECK_EQ(-1200, packet.gamepad.rightThumbY);
+    CHECK_EQ(static_cast<uint16_t>(GamepadButton::A), packet.gamepad.buttons);
+
+    command.type = 99;
+    CHECK_EQ(CommandInvalid, state_bus_command_to_packet(command).type);
+}
+
+TEST(state_bus_setpoint_command_converts_with_limits)
+{
+    StateBusCommand command = StateBusCommand();
+    command.type = CommandSetpoint;
+    command.source_id = 6;
+    command.thrust[0] = 0.4f;
+    command.thrust[2] = -3.0f;
+    command.heading_deg = 120.0f;
+    command.depth_m = 1.5f;
+    command.flags = STATE_BUS_HOLD_DEPTH;
+    command.timeout_ms = 100000;
+    CommandPacket packet = state_bus_command_to_packet(command);
+    CHECK_EQ(CommandSetpoint, packet.type);
+    CHECK_NEAR(0.4f, packet.setpoint.surge, 1e-6f);
+    CHECK_NEAR(-1.0f, packet.setpoint.heave, 1e-6f);
+    CHECK(!packet.setpoint.hold_heading);
+    CHECK(packet.setpoint.hold_depth);
+    CHECK_NEAR(1.5f, packet.setpoint.depth_m, 1e-6f);
+    CHECK_EQ(static_cast<uint32_t>(SETPOINT_MAX_TIMEOUT_MS), packet.setpoint.timeout_ms);
+
+    command.yaw_rate_dps = NAN;
+    CHECK_EQ(CommandInvalid, state_bus_command_to_packet(command).type);
+}
+
+TEST(state_bus_setpoint_command_rejects_nan_thrust)
+{
+    // 範囲の制限で NaN が最大推力に変わらないこと (クランプの前に拒否する)
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        StateBusCommand command = StateBusCommand();
+        command.type = CommandSetpoint;
+        command.source_id = 6;
+        command.thrust[axis] = NAN;
+        CHECK_EQ(CommandInvalid, state_bus_command_to_packet(command).type);
+    }
+    StateBusCommand command = StateBusCommand();
+    command.type = CommandSetpoint;
+    command.thrust[0] = INFINITY;
+    CHECK_EQ(CommandInvalid, state_bus_command_to_packet(command).type);
+    command.thrust[0] = 0.2f;
+    command.heading_deg = NAN;
+    CHECK_EQ(CommandInvalid, state_bus_command_to_packet(command).type);
+    command.heading_deg = 0.0f;
+    command.depth_m = NAN;
+    CHECK_EQ(CommandInvalid, state_bus_command_to_packet(command).type);
+    command.depth_m = 0.0f;
+    CHECK_EQ(CommandSetpoint, state_bus_command_to_packet(command).type);
+}
@@ -0,0 +1,111 @@
+#include "test_framework.h"
+#include "supervisor.h"
+#include "monotonic_clock.h"
+#include <signal.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/wait.h>
+
+// 子プロセスから参照する共有メモリ (fork 前に開き、子プロセスはマッピングを引き継ぐ)
+static RuntimeState supervised_state;
+
+// 起動するたびに1回目はシグナルで、2回目は異常終了コードで終わり、3回目は正常終了する制御プロセス
+static int crashing_control()
+{
+    RuntimeStateLayout *layout = supervised_state.layout;
+    uint32_t restarts = layout->restart_count.load();
+    if (restarts > 0)
+    {
+        // 起動までの時間: 監視プロセスが終了を検知してからこの関数が動き始めるまで
+        uint64_t exit_ns = layout->control_exit_ns.load();
+        uint64_t elapsed_ns = monotonic_now_ns() - exit_ns;
+        if (elapsed_ns > layout->max_restart_to_control_ns.load())
+            layout->max_restart_to_control_ns.store(elapsed_ns);
+    }
+    if (restarts == 0)
+        raise(SIGKILL);
+    if (restarts == 1)
+        return 3;
+    return 0;
+}
+
+// 終了要求 (SIGTERM) を受けるまで動き続ける映像プロセス
+static int idle_video()
+{
+    for (;;)
+        pause();
+    return 0;
+}
+
+// 常に起動直後に終了する制御プロセス
+static int always_failing_control()
+{
+    return 1;
+}
+
+TEST(supervisor_restarts_crashed_control_quickly)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/ws3_supervisor_test_%d", static_cast<int>(getpid()));
+    CHECK(runtime_state_open(&supervised_state, name));
+    runtime_state_invalidate(&supervised_state);
+
+    SupervisedProcess processes[2];
+    processes[0].name = "control";
+    processes[0].entry = crashing_control;
+    processes[0].is_control = true;
+    processes[1].name = "video";
+    processes[1].entry = idle_video;
+    CHECK_EQ(0, supervisor_run(SupervisorConfig(), processes, 2, &supervised_state));
+
+    // 制御プロセスだけが2回起動し直され、映像プロセスは最後まで同じプロセスのまま
+    CHECK_EQ(2u, processes[0].restarts);
+    CHECK_EQ(0u, processes[1].restarts);
+    CHECK_EQ(2u, supervised_state.layout->restart_count.load());
+    CHECK(processes[1].pid < 0); // 監視の終了時に停止・回収されている
+    // 終了の検知から次の制御プロセスの開始まで 100 ms を大きく下回る
+    CHECK(supervised_state.layout->max_restart_to_control_ns.load() > 0u);
+    CHECK(supervised_state.layout->max_restart_to_control_ns.load() < 50000000u);
+
+    runtime_state_close(&supervised_state);
+    runtime_state_unlink(name);
+}
+
+TEST(supervisor_backs_off_and_cold_starts_on_crash_loop)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/ws3_supervisor_loop_test_%d", static_cast<int>(getpid()));
+    CHECK(runtime_state_open(&supervised_state, name));
+    RuntimeSnapshot snapshot = RuntimeSnapshot();
+    snapshot.saved_ns = monotonic_now_ns();
+    runtime_state_save(&supervised_state, snapshot);
+
+    SupervisorConfig config;
+    config.rapid_failure_limit = 3;
+    config.backoff_ms = 200;
+    SupervisedProcess process;
+    process.name = "control";
+    process.entry = always_failing_control;
+    process.is_control = true;
+
+    // 監視プロセスを別プロセスで動かし、一定時間後に終了を要求する
+    pid_t supervisor_pid = fork();
+    if (supervisor_pid == 0)
+        _exit(supervisor_run(config, &process, 1, &supervised_state));
+    usleep(300000);
+    kill(supervisor_pid, SIGTERM);
+    int status = 0;
+    waitpid(supervisor_pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // 3回続けて終了した後はバックオフするため、300 ms の間の再起動は数回に収まる
+    uint32_t restarts = supervised_state.layout->restart_count.load();
+    CHECK(restarts >= 3u);
+    CHECK(restarts <= 5u);
+    // 同じ状態の復元を繰り返さないよう、保存した状態は無効にされる
+    RuntimeSnapshot loaded;
+    CHECK(!runtime_state_load(&supervised_state, monotonic_now_ns(), RUNTIME_STATE_MAX_AGE_MS, &loaded));
+
+    runtime_state_close(&supervised_state);
+    runtime_state_unlink(name);
+}
@@ -0,0 +1,86 @@
+#include "test_framework.h"
+#include "telemetry.h"
+#include <string.h>
+
+TEST(telemetry_first_frame_is_keyframe_with_all_fields)
+{
+    TelemetryScheduler sched;
+    telemetry_init(&sched, 10000, 1000);
+    SensorData data;
+    char buf[SENSOR_BUFFER_SIZE];
+    bool keyframe = false;
+    CHECK(telemetry_build_frame(&sched, data, 0, 1000, buf, sizeof(buf), &keyframe) > 0);
+    CHECK(keyframe);
+    CHECK(strstr(buf, "KF:1") != NULL);
+    CHECK(strstr(buf, "TEMP:") != NULL);
+    CHECK(strstr(buf, "ADC3:") != NULL);
+}
+
+TEST(telemetry_delta_frames_carry_only_changed_fields)
+{
+    TelemetryScheduler sched;
+    telemetry_init(&sched, 10000, 1000);
+    SensorData data;
+    char buf[SENSOR_BUFFER_SIZE];
+    bool keyframe = false;
+    telemetry_build_frame(&sched, data, 0, 1000, buf, sizeof(buf), &keyframe);
+
+    // 変化がなければ何も送らない
+    CHECK_EQ(0u, telemetry_build_frame(&sched, data, 0, 1100, buf, sizeof(buf), &keyframe));
+
+    data.gyro.z = 5.0f;
+    CHECK(telemetry_build_frame(&sched, data, 0, 1200, buf, sizeof(buf), &keyframe) > 0);
+    CHECK(!keyframe);
+    CHECK(strstr(buf, "GYROZ:5") != NULL);
+    CHECK(strstr(buf, "TEMP:") == NULL);
+
+    // キーフレーム間隔が経過したら全フィールドを送る
+    telemetry_build_frame(&sched, data, 0, 2000, buf, sizeof(buf), &keyframe);
+    CHECK(keyframe);
+}
+
+TEST(telemetry_stays_within_byte_budget)
+{
+    const uint32_t budget = 2000;
+    TelemetryScheduler sched;
+    telemetry_init(&sched, budget, 1000);
+    SensorData data;
+    char buf[SENSOR_BUFFER_SIZE];
+    for (int t = 0; t < 10000; t += 10) // 100Hz で10秒間、全IMU値が毎周期変化する
+    {
+        float v = (t % 20 == 0) ? 1.0f : -1.0f;
+        data.gyro.x = data.gyro.y = data.gyro.z = v;
+        data.accel.x = data.accel.y = data.accel.z = v;
+        telemetry_build_frame(&sched, data, 0, 1000 + t, buf, sizeof(buf), NULL);
+    }
+    // 初期バースト (1秒分) を含めて budget * 11 以内
+    CHECK(sched.bytes_sent <= budget * 11ULL);
+    // 帯域不足の周期はフレームを送らない (1000周期すべては送れない)
+    CHECK(sched.frames_sent < 1000u);
+}
+
+TEST(telemetry_budget_counts_udp_ip_header_per_frame)
+{
+    // 1秒あたり 20 フレーム分のヘッダ (560 バイト) + 少しの予算: ヘッダ込みで予算を超えない
+    const uint32_t budget = 20 * TELEMETRY_DATAGRAM_OVERHEAD_BYTES + 200;
+    TelemetryScheduler sched;
+    telemetry_init(&sched, budget, 100000);
+    SensorData data;
+    char buf[SENSOR_BUFFER_SIZE];
+    telemetry_build_frame(&sched, data, 0, 1000, buf, sizeof(buf), NULL); // 最初のキーフレーム
+    uint64_t bytes_before = sched.bytes_sent;
+    uint32_t frames_before = sched.frames_sent;
+    sched.tokens = 0.0; // 初期バーストを使い切った状態から計測する
+    for (int t = 10; t <= 10000; t += 10) // 100Hz で10秒間、1フィールドだけ毎周期変化する
+    {
+        data.gyro.z = (t % 20 == 0) ? 1.0f : -1.0f;
+        telemetry_build_frame(&sched, data, 0, 1000 + t, buf, sizeof(buf), NULL);
+    }
+    uint64_t wire_bytes = sched.bytes_sent - bytes_before;
+    uint32_t frames = sched.frames_sent - frames_before;
+    CHECK(frames > 0u);
+    CHECK(wire_bytes <= budget * 10ULL);
+    // ヘッダを数えなければ送れていたはずのフレーム数 (GYROZ の1フィールドのフレームは 30 バイト未満) より少ない
+    CHECK(frames < 10u * budget / 30u);
+    CHECK(wire_bytes >= frames * static_cast<uint64_t>(TELEMETRY_DATAGRAM_OVERHEAD_BYTES));
+}
@@ -0,0 +1,40 @@
+#include "test_framework.h"
+#include "thrust_curve.h"
+
+TEST(thrust_tables_are_monotonic)
+{
+    for (int i = 1; i < THRUST_LUT_SIZE; ++i)
+    {
+        CHECK(ThrustFromPwmTable::values[i] >= ThrustFromPwmTable::values[i - 1]);
+        CHECK(PwmFromThrustTable::values[i] >= PwmFromThrustTable::values[i - 1]);
+        CHECK(StickDemandTable::values[i] >= StickDemandTable::values[i - 1]);
+    }
+}
+
+TEST(thrust_tables_cover_full_range)
+{
+    CHECK_EQ(0, ThrustFromPwmTable::values[0]);
+    CHECK_EQ(THRUST_Q15_ONE, ThrustFromPwmTable::values[THRUST_LUT_SIZE - 1]);
+    CHECK_EQ(0, PwmFromThrustTable::values[0]);
+    CHECK_EQ(THRUST_Q15_ONE, PwmFromThrustTable::values[THRUST_LUT_SIZE - 1]);
+}
+
+TEST(thrust_inverse_round_trips)
+{
+    // 推力 -> PWM -> 推力 がほぼ元に戻ること (補間誤差 1% 以内)
+    for (int32_t thrust = 1024; thrust <= THRUST_Q15_ONE; thrust += 1024)
+    {
+        int32_t back = thrust_q15_from_pwm_q15(pwm_q15_from_thrust_q15(thrust));
+        CHECK_NEAR(thrust, back, THRUST_Q15_ONE / 100);
+    }
+}
+
+TEST(stick_to_pwm_respects_deadzone_and_limits)
+{
+    CHECK_EQ(1100, stick_to_pwm(0, 1100, 800));
+    CHECK_EQ(1100, stick_to_pwm(STICK_LUT_DEADZONE, 1100, 800));
+    CHECK_EQ(1100, stick_to_pwm(-STICK_LUT_DEADZONE, 1100, 800));
+    CHECK(stick_to_pwm(STICK_LUT_DEADZONE + 200, 1100, 800) > 1100);
+    CHECK_NEAR(1900, stick_to_pwm(32767, 1100, 800), 1);
+    CHECK_EQ(stick_to_pwm(20000, 1100, 800), stick_to_pwm(-20000, 1100, 800));
+}
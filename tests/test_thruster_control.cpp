@@ -0,0 +1,200 @@
+#include "test_framework.h"
+#include "thruster_control.h"
+#include "bindings_stub.h"
+
+TEST(manual_demand_maps_sticks_to_signed_axes)
+{
+    GamepadData data;
+    AxisData gyro = {0.0f, 0.0f, 0.0f};
+    data.leftThumbX = 32767;    // 右旋回
+    data.rightThumbX = -32768;  // 左平行移動
+    data.rightThumbY = -32768;  // 後退
+    BodyThrust demand = thruster_manual_demand(data, gyro);
+    CHECK_NEAR(1.0f, demand.yaw, 0.01f);
+    CHECK_NEAR(-1.0f, demand.sway, 0.01f);
+    CHECK_NEAR(-1.0f, demand.surge, 0.01f);
+
+    // デッドゾーン内は 0
+    data.leftThumbX = JOYSTICK_DEADZONE - 1;
+    data.rightThumbX = -(JOYSTICK_DEADZONE - 1);
+    data.rightThumbY = JOYSTICK_DEADZONE;
+    demand = thruster_manual_demand(data, gyro);
+    CHECK_EQ(0.0f, demand.yaw);
+    CHECK_EQ(0.0f, demand.sway);
+    CHECK_EQ(0.0f, demand.surge);
+
+    // 旋回操作がないときはヨー角速度を打ち消す
+    gyro.z = 10.0f;
+    demand = thruster_manual_demand(data, gyro);
+    CHECK(demand.yaw < 0.0f);
+}
+
+TEST(thrust_to_pwm_covers_full_range)
+{
+    CHECK_EQ(PWM_STOP, thrust_to_pwm(0.0f));
+    CHECK_EQ(PWM_BOOST_MAX, thrust_to_pwm(1.0f));
+    CHECK_EQ(PWM_BOOST_MAX, thrust_to_pwm(5.0f));
+#if THRUSTER_BIDIRECTIONAL
+    CHECK_EQ(PWM_MIN, thrust_to_pwm(-THRUSTER_REVERSE_RATIO));
+    CHECK(thrust_to_pwm(-0.3f) < PWM_NEUTRAL && thrust_to_pwm(-0.3f) > PWM_MIN);
+#else
+    CHECK_EQ(PWM_MIN, thrust_to_pwm(-1.0f));
+#endif
+}
+
+TEST(output_owner_blocks_lower_priority_writes)
+{
+    thruster_set_all_pwm(PWM_STOP);
+    thruster_claim_output(OUTPUT_OWNER_WATCHDOG);
+    CHECK(!thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 0, 1700));
+    CHECK(thruster_owner_set_pwm(OUTPUT_OWNER_WATCHDOG, 0, 1300));
+    thruster_release_output(OUTPUT_OWNER_WATCHDOG);
+
+    int outputs[NUM_THRUSTERS];
+    thruster_get_outputs(outputs);
+    CHECK_EQ(1300, outputs[0]);
+    CHECK_EQ(1300, stub_pwm_us(0));
+    CHECK(thruster_owner_set_pwm(OUTPUT_OWNER_CONTROL, 0, 1400));
+}
+
+TEST(set_all_pwm_clamps_and_turns_led_off)
+{
+    thruster_set_all_pwm(5000);
+    for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+        CHECK_EQ(PWM_BOOST_MAX, stub_pwm_us(ch));
+    CHECK_EQ(LED_PWM_OFF, stub_pwm_us(LED_PWM_CHANNEL));
+}
+
+TEST(restore_outputs_resumes_last_pwm_without_reset)
+{
+    stub_hardware_reset();
+    int saved[NUM_THRUSTERS] = {1300, PWM_STOP, PWM_STOP, 1300, 1700, 1700};
+    CHECK(thruster_restore_outputs(saved, LED_PWM_ON));
+    // 各チャンネルに1回ずつ、保存した値だけを書き込む (PWM_STOP を経由しない)
+    CHECK_EQ(static_cast<unsigned int>(NUM_THRUSTERS + 1), stub_hardware().pwm_writes);
+    CHECK(stub_hardware().pwm_enabled);
+    CHECK_EQ(1700, stub_pwm_us(4));
+    CHECK_EQ(1300, stub_pwm_us(0));
+    CHECK_EQ(LED_PWM_ON, stub_pwm_us(LED_PWM_CHANNEL));
+    CHECK_EQ(LED_PWM_ON, thruster_get_led_pwm());
+
+    int outputs[NUM_THRUSTERS];
+    thruster_get_outputs(outputs);
+    CHECK_EQ(1700, outputs[5]); // フェイルセーフのランプダウンは復元した値から始まる
+    CHECK(thruster_init());
+    CHECK_EQ(LED_PWM_OFF, thruster_get_led_pwm());
+}
+
+TEST(thruster_mix_matches_channel_assignment)
+{
+    int pwm[NUM_THRUSTERS];
+    BodyThrust idle;
+    thruster_mix(idle, pwm);
+    for (int ch = 0; ch < NUM_THRUSTERS; ++ch)
+        CHECK_EQ(PWM_STOP, pwm[ch]);
+
+    // 右平行移動は Ch0, Ch2 の前進 (両方向 ESC では Ch1, Ch3 の後退も)、右旋回は Ch0, Ch3 の前進
+    BodyThrust sway;
+    sway.sway = 1.0f;
+    thruster_mix(sway, pwm);
+    CHECK(pwm[0] > PWM_STOP);
+    CHECK_EQ(pwm[0], pwm[2]);
+#if THRUSTER_BIDIRECTIONAL
+    CHECK_EQ(PWM_MIN, pwm[1]); // 後退は前進より弱いため、後退が最大になるところで左右の推力が釣り合う
+    CHECK_EQ(PWM_MIN, pwm[3]);
+    CHECK(pwm[0] < PWM_BOOST_MAX);
+#else
+    CHECK_EQ(PWM_BOOST_MAX, pwm[0]);
+    CHECK_EQ(PWM_MIN, pwm[1]);
+#endif
+
+    BodyThrust yaw;
+    yaw.yaw = 0.5f;
+    thruster_mix(yaw, pwm);
+    CHECK(pwm[0] > PWM_STOP && pwm[0] < PWM_BOOST_MAX);
+    CHECK_EQ(pwm[0], pwm[3]);
+    CHECK_EQ(pwm[1], pwm[2]);
+    CHECK(pwm[1] <= PWM_STOP);
+
+    // 前進は Ch4-5
+    BodyThrust surge;
+    surge.surge = 1.0f;
+    thruster_mix(surge, pwm);
+    CHECK_EQ(PWM_BOOST_MAX, pwm[4]);
+    CHECK_EQ(PWM_BOOST_MAX, pwm[5]);
+    surge.surge = -1.0f;
+    thruster_mix(surge, pwm);
+    CHECK_EQ(PWM_MIN, pwm[4]); // 両方向 ESC では後退最大、一方向 ESC では停止
+}
+
+#if THRUSTER_BIDIRECTIONAL
+TEST(thruster_mix_desaturates_by_axis_priority)
+{
+    int pwm[NUM_THRUSTERS];
+    ThrustAllocation report;
+
+    // 上限内なら全軸そのまま
+    BodyThrust small;
+    small.yaw = 0.3f;
+    small.sway = 0.3f;
+    small.surge = 1.0f;
+    thruster_mix(small, pwm, &report);
+    CHECK_EQ(0u, report.saturated_axes);
+    CHECK_NEAR(1.0f, report.min_authority, 1e-6f);
+    CHECK_NEAR(0.3f, report.achieved.sway, 1e-6f);
+
+    // 旋回と平行移動の合計が上限を超える: 旋回を保ち、平行移動を縮小して報告する
+    BodyThrust both;
+    both.yaw = 0.5f;
+    both.sway = 0.8f;
+    thruster_mix(both, pwm, &report);
+    CHECK_NEAR(1.0f, report.authority[THRUST_AXIS_YAW], 1e-6f);
+    CHECK_NEAR(0.5f, report.achieved.yaw, 1e-6f);
+    CHECK(report.authority[THRUST_AXIS_SWAY] > 0.5f && report.authority[THRUST_AXIS_SWAY] < 0.7f);
+    CHECK_EQ(1u << THRUST_AXIS_SWAY, report.saturated_axes);
+    CHECK_NEAR(report.authority[THRUST_AXIS_SWAY], report.min_authority, 1e-6f);
+    // 後退側が上限 (PWM_MIN) に達し、どのチャンネルも範囲外にクリップされない
+    CHECK_EQ(PWM_MIN, pwm[1]);
+    for (int ch = 0; ch < 4; ++ch)
+        CHECK(pwm[ch] >= PWM_MIN && pwm[ch] <= PWM_BOOST_MAX);
+
+    // 旋回が最大なら平行移動の余地はない
+    both.yaw = 1.0f;
+    both.sway = 1.0f;
+    thruster_mix(both, pwm, &report);
+    CHECK_NEAR(1.0f, report.authority[THRUST_AXIS_YAW], 1e-6f);
+    CHECK_NEAR(0.0f, report.authority[THRUST_AXIS_SWAY], 1e-6f);
+    CHECK_EQ(pwm[0], pwm[3]);
+    CHECK_EQ(pwm[1], pwm[2]);
+
+    // 上下方向のスラスターがない構成では heave は出せない
+    BodyThrust heave;
+    heave.heave = 0.5f;
+    thruster_mix(heave, pwm, &report);
+    CHECK_NEAR(0.0f, report.authority[THRUST_AXIS_HEAVE], 1e-6f);
+    CHECK_EQ(1u << THRUST_AXIS_HEAVE, report.saturated_axes);
+}
+
+TEST(manual_turn_uses_full_reversible_range)
+{
+    // 旋回スティックを倒し切ると、前進側・後退側の両方が最大付近まで出る (以前は PWM_NEUTRAL で頭打ち)
+    GamepadData data;
+    AxisData gyro = {0.0f, 0.0f, 0.0f};
+    data.leftThumbX = 32767;
+    int pwm[NUM_THRUSTERS];
+    thruster_mix(thruster_manual_demand(data, gyro), pwm);
+    CHECK(pwm[0] > PWM_NEUTRAL + 300);
+    CHECK_EQ(pwm[0], pwm[3]);
+    CHECK_EQ(PWM_MIN, pwm[1]);
+    CHECK_EQ(PWM_MIN, pwm[2]);
+    CHECK_EQ(PWM_STOP, pwm[4]);
+}
+#endif
+
+TEST(surface_channels_require_upward_thrust)
+{
+    // 現在の推力配分表には上下方向のスラスターがない: 浮上に使えるチャンネルはない
+    CHECK_EQ(0u, thruster_heave_channel_mask());
+    CHECK_EQ(0u, thruster_surface_channel_mask(0));
+    CHECK_EQ(0u, thruster_surface_channel_mask((1u << 4) | (1u << 5))); // 前進用の Ch4-5 は使わない
+}